@@ -56,9 +56,9 @@ GalilAxis::GalilAxis(class GalilController *pC, //Pointer to controller instance
   : asynMotorAxis(pC, (toupper(axisname[0]) - AASCII)),
     pC_(pC), pollRequest_(10, sizeof(int))
 {
-  char axis_limit_code[LIMIT_CODE_LEN];   	//Code generated for limits interrupt on this axis
-  char axis_digital_code[INP_CODE_LEN];	     	//Code generated for digital interrupt related to this axis
-  char axis_thread_code[THREAD_CODE_LEN]; 	//Code generated for the axis (eg. home code, limits response)
+  GalilCodeBuffer axis_limit_code(LIMIT_CODE_LEN);	//Code generated for limits interrupt on this axis
+  GalilCodeBuffer axis_digital_code(INP_CODE_LEN);	//Code generated for digital interrupt related to this axis
+  GalilCodeBuffer axis_thread_code(THREAD_CODE_LEN);	//Code generated for the axis (eg. home code, limits response)
 
   epicsTimeGetCurrent(&stop_begint_);
   stop_nowt_ = stop_begint_;
@@ -80,24 +80,24 @@ GalilAxis::GalilAxis(class GalilController *pC, //Pointer to controller instance
   store_motors_enable();
   //Generate the code for this axis based on specified settings
   //Initialize the code generator
-  initialize_codegen(axis_thread_code, axis_limit_code, axis_digital_code);
+  initialize_codegen(&axis_thread_code, &axis_limit_code, &axis_digital_code);
   //Generate code for limits interrupt.  Motor behaviour on limits active
-  gen_limitcode(axisName_, axis_thread_code, axis_limit_code);
+  gen_limitcode(axisName_, &axis_thread_code, &axis_limit_code);
   //Generate code for axis homing routine
-  gen_homecode(axisName_, axis_thread_code);
+  gen_homecode(axisName_, &axis_thread_code);
   /* insert motor interlock code into thread A */
   if (axisName_ == 'A')
 	{
-	sprintf(axis_thread_code,"%sIF (mlock=1)\n",axis_thread_code);
-	sprintf(axis_thread_code,"%sII ,,dpon,dvalues\nENDIF\n",axis_thread_code);
+	axis_thread_code.append("IF (mlock=1)\n");
+	axis_thread_code.append("II ,,dpon,dvalues\nENDIF\n");
 	}
 
   //Insert the final jump statement for the current thread code
-  sprintf(axis_thread_code,"%sJP #THREAD%c\n",axis_thread_code, axisName_);
+  axis_thread_code.appendf("JP #THREAD%c\n", axisName_);
   //Copy this axis code into the controller class code buffers
-  strcat(pC->thread_code_, axis_thread_code);
-  strcat(pC->limit_code_, axis_limit_code);
-  strcat(pC->digital_code_, axis_digital_code);
+  pC->thread_code_->append(axis_thread_code.c_str());
+  pC->limit_code_->append(axis_limit_code.c_str());
+  pC->digital_code_->append(axis_digital_code.c_str());
   
   // Create the thread that will service poll requests
   // To write to the controller
@@ -244,9 +244,9 @@ void GalilAxis::store_motors_enable(void)
 /*--------------------------------------------------------------------------------*/
 /* Initialize code buffers, insert program labels, set generator variables */
 
-void GalilAxis::initialize_codegen(char axis_thread_code[],
-			  	   char axis_limit_code[],
-			  	   char axis_digital_code[])
+void GalilAxis::initialize_codegen(GalilCodeBuffer *axis_thread_code,
+			  	   GalilCodeBuffer *axis_limit_code,
+			  	   GalilCodeBuffer *axis_digital_code)
 {
 	//Program label for digital input interrupt program
 	char axis_digital_label[10]="#ININT\n";
@@ -255,56 +255,59 @@ void GalilAxis::initialize_codegen(char axis_thread_code[],
 	if (pC_->codegen_init_ == false)	
 		{
 		//setup #AUTO label
-		strcpy(pC_->card_code_,"#AUTO\n");
+		pC_->card_code_->clear();
+		pC_->card_code_->append("#AUTO\n");
 		
 		//setup #LIMSWI label	 
-		strcpy(pC_->limit_code_,"#LIMSWI\n");
+		pC_->limit_code_->clear();
+		pC_->limit_code_->append("#LIMSWI\n");
 
 		//Code generator has now been initialized
 		pC_->codegen_init_ = true;
 		}
 	
 	/*Empty code buffers for this axis*/
-	strcpy(axis_thread_code, "");
-	strcpy(axis_limit_code, "");
+	axis_thread_code->clear();
+	axis_limit_code->clear();
 		
 	//Insert code to start motor thread that will be constucted
 	//thread 0 (motor A) is auto starting
 	if (axisName_ != 'A')
-		sprintf(pC_->card_code_,"%sXQ #THREAD%c,%d\n",pC_->card_code_, axisName_, axisNo_);
+		pC_->card_code_->appendf("XQ #THREAD%c,%d\n", axisName_, axisNo_);
 
 	//Insert label for motor thread we are constructing	
-	sprintf(axis_thread_code,"%s#THREAD%c\n",axis_thread_code, axisName_);
+	axis_thread_code->appendf("#THREAD%c\n", axisName_);
 
 	//Setup ININT program label for digital input interrupts.  Used for motor enable/disable.
 	if (pC_->digitalinput_init_ == false && strcmp(enables_string_, "") != 0)
 		{
 		//Insert digital input program label #ININT
-		strcpy(axis_digital_code, axis_digital_label);
+		axis_digital_code->clear();
+		axis_digital_code->append(axis_digital_label);
 		// Insert code to initialize dpoff (digital ports off) used for motor interlocks management
-		sprintf(axis_digital_code,"%sdpoff=dpon\n",axis_digital_code);
+		axis_digital_code->append("dpoff=dpon\n");
 		//Digital input label has been inserted
 		pC_->digitalinput_init_ = true;
 		}
 	else	//Empty digital input code buffer
-		strcpy(axis_digital_code,"");
+		axis_digital_code->clear();
 }
 
 /*--------------------------------------------------------------------------------*/
 /* Generate the required limit code for this axis */
 
 void GalilAxis::gen_limitcode(char c,			 //GalilAxis::axisName_ used very often
-			      char axis_thread_code[],
-			      char axis_limit_code[])
+			      GalilCodeBuffer *axis_thread_code,
+			      GalilCodeBuffer *axis_limit_code)
 {
 	//Setup the LIMSWI interrupt routine. The Galil Code Below, is called once per limit activate on ANY axis **
 	//Determine axis that requires stop based on stop code and moving status
 	//Use user desired deceleration, stop motor, then put deceleration back to that for normal moves
-	sprintf(axis_limit_code,"%sIF (((_SC%c=2) | (_SC%c=3)) & (_BG%c=1))\noldecel%c=_DC%c;ocds=_VDS;ocdt=_VDT;DC%c=limdc%c;VDS=limdc%c;VDT=limdc%c;ST%c\n",axis_limit_code,c,c,c,c,c,c,c,c,c,c);
+	axis_limit_code->appendf("IF (((_SC%c=2) | (_SC%c=3)) & (_BG%c=1))\noldecel%c=_DC%c;ocds=_VDS;ocdt=_VDT;DC%c=limdc%c;VDS=limdc%c;VDT=limdc%c;ST%c\n",c,c,c,c,c,c,c,c,c,c);
         if (!limit_as_home_)	//Hitting limit when homing to home switch is a fail, cancel home process
-		sprintf(axis_limit_code,"%sDC%c=oldecel%c;VDS=ocds;VDT=ocdt;home%c=0;MG \"home%c\",home%c;ENDIF\n",axis_limit_code,c,c,c,c,c);
+		axis_limit_code->appendf("DC%c=oldecel%c;VDS=ocds;VDT=ocdt;home%c=0;MG \"home%c\",home%c;ENDIF\n",c,c,c,c,c);
 	else			//Hitting limit when homing to limit switch is normal
-		sprintf(axis_limit_code,"%sDC%c=oldecel%c;VDS=ocds;VDT=ocdt;ENDIF\n",axis_limit_code,c,c);
+		axis_limit_code->appendf("DC%c=oldecel%c;VDS=ocds;VDT=ocdt;ENDIF\n",c,c);
  	
 	/*provide sensible default for limdc (limit deceleration) value*/
 	sprintf(pC_->cmd_, "limdc%c=67107840", c);
@@ -315,9 +318,9 @@ void GalilAxis::gen_limitcode(char c,			 //GalilAxis::axisName_ used very often
 /* Generate home code.*/
 
 void GalilAxis::gen_homecode(char c,			//GalilAxis::axisName_ used very often
-			     char axis_thread_code[])
+			     GalilCodeBuffer *axis_thread_code)
 {
-	sprintf(axis_thread_code,"%sIF ((home%c=1))\n",axis_thread_code,c);
+	axis_thread_code->appendf("IF ((home%c=1))\n",c);
 	
 	//Setup home code
 	if (limit_as_home_)
@@ -326,39 +329,39 @@ void GalilAxis::gen_homecode(char c,			//GalilAxis::axisName_ used very often
 		/*hjog%c=2 we have found limit switch inner edge*/
 		/*hjog%c=3 we have found our final home pos*/
 		//Code to jog off limit
-		sprintf(axis_thread_code,"%sIF ((home%c=1) & (_MO%c=0) & (hjog%c=0) & (_BG%c=0) & ((_LR%c=0) | (_LF%c=0)))\nspeed%c=_SP%c;DC%c=hjgdc%c;JG%c=hjgsp%c;WT10;BG%c;hjog%c=1;ENDIF\n",axis_thread_code,c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+		axis_thread_code->appendf("IF ((home%c=1) & (_MO%c=0) & (hjog%c=0) & (_BG%c=0) & ((_LR%c=0) | (_LF%c=0)))\nspeed%c=_SP%c;DC%c=hjgdc%c;JG%c=hjgsp%c;WT10;BG%c;hjog%c=1;ENDIF\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
 		//Stop motor once off limit
-		sprintf(axis_thread_code,"%sIF ((_LR%c=1) & (_LF%c=1) & (hjog%c=1) & (_BG%c=1))\nST%c;ENDIF\n",axis_thread_code,c,c,c,c,c);
+		axis_thread_code->appendf("IF ((_LR%c=1) & (_LF%c=1) & (hjog%c=1) & (_BG%c=1))\nST%c;ENDIF\n",c,c,c,c,c);
 		//Find encoder index 
-		sprintf(axis_thread_code,"%sIF ((_LR%c=1) & (_LF%c=1) & (hjog%c=1) & (_BG%c=0))\nIF ((home%c=1) & (_MO%c=0) & (ueip%c=1) & (ui%c=1))\nSP%c=speed%c;DC%c=67107840;FI%c;WT10;BG%c;hjog%c=2\nELSE\n",axis_thread_code,c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+		axis_thread_code->appendf("IF ((_LR%c=1) & (_LF%c=1) & (hjog%c=1) & (_BG%c=0))\nIF ((home%c=1) & (_MO%c=0) & (ueip%c=1) & (ui%c=1))\nSP%c=speed%c;DC%c=67107840;FI%c;WT10;BG%c;hjog%c=2\nELSE\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
 		}	
 	else
 		{
 		//Stop motor once home activated
-		sprintf(axis_thread_code,"%sIF ((_HM%c=hswact%c) & (hjog%c=0) & (_BG%c=1))\nST%c;ENDIF\n",axis_thread_code,c,c,c,c,c);
+		axis_thread_code->appendf("IF ((_HM%c=hswact%c) & (hjog%c=0) & (_BG%c=1))\nST%c;ENDIF\n",c,c,c,c,c);
 		//Code to jog off home
-		sprintf(axis_thread_code,"%sIF ((home%c=1) & (_MO%c=0) & (_HM%c=hswact%c) & (hjog%c=0) & (_BG%c=0))\nspeed%c=_SP%c;DC%c=hjgdc%c;JG%c=hjgsp%c;WT10;BG%c;hjog%c=1;ENDIF\n",axis_thread_code,c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+		axis_thread_code->appendf("IF ((home%c=1) & (_MO%c=0) & (_HM%c=hswact%c) & (hjog%c=0) & (_BG%c=0))\nspeed%c=_SP%c;DC%c=hjgdc%c;JG%c=hjgsp%c;WT10;BG%c;hjog%c=1;ENDIF\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
 		//Stop motor once off home
-		sprintf(axis_thread_code,"%sIF ((_HM%c=hswiact%c) & (hjog%c=1) & (_BG%c=1))\nST%c;ENDIF\n",axis_thread_code,c,c,c,c,c);
+		axis_thread_code->appendf("IF ((_HM%c=hswiact%c) & (hjog%c=1) & (_BG%c=1))\nST%c;ENDIF\n",c,c,c,c,c);
 		//Find encoder index
-		sprintf(axis_thread_code,"%sIF ((_HM%c=hswiact%c) & (hjog%c=1) & (_BG%c=0))\nIF ((home%c=1) & (_MO%c=0) & (ueip%c=1) & (ui%c=1))\nSP%c=speed%c;DC%c=67107840;FI%c;WT10;BG%c;hjog%c=2\nELSE\n",axis_thread_code,c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+		axis_thread_code->appendf("IF ((_HM%c=hswiact%c) & (hjog%c=1) & (_BG%c=0))\nIF ((home%c=1) & (_MO%c=0) & (ueip%c=1) & (ui%c=1))\nSP%c=speed%c;DC%c=67107840;FI%c;WT10;BG%c;hjog%c=2\nELSE\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
 		}
 
 	//Common homing code regardless of homing to limit or home switch
 	//If no encoder we are home already
-	sprintf(axis_thread_code,"%shjog%c=3;ENDIF;ENDIF\n",axis_thread_code,c);
+	axis_thread_code->appendf("hjog%c=3;ENDIF;ENDIF\n",c);
 	//If encoder index complete we are home
-	sprintf(axis_thread_code,"%sIF ((hjog%c=2) & (_BG%c=0))\nhjog%c=3;ENDIF\n",axis_thread_code,c,c,c);
+	axis_thread_code->appendf("IF ((hjog%c=2) & (_BG%c=0))\nhjog%c=3;ENDIF\n",c,c,c);
 	//Unset home flag
 	if (limit_as_home_)
-		sprintf(axis_thread_code,"%sIF ((_LR%c=1) & (_LF%c=1) & (hjog%c=3) & (_BG%c=0))\n",axis_thread_code,c,c,c,c);
+		axis_thread_code->appendf("IF ((_LR%c=1) & (_LF%c=1) & (hjog%c=3) & (_BG%c=0))\n",c,c,c,c);
 	else
-		sprintf(axis_thread_code,"%sIF ((_HM%c=hswiact%c) & (hjog%c=3) & (_BG%c=0))\n",axis_thread_code,c,c,c,c);
+		axis_thread_code->appendf("IF ((_HM%c=hswiact%c) & (hjog%c=3) & (_BG%c=0))\n",c,c,c,c);
 	//Common homing code regardless of homing to limit or home switch
 	//Flag homing complete
-	sprintf(axis_thread_code,"%sWT10;hjog%c=0;SP%c=speed%c;home%c=0\n", axis_thread_code,c,c,c,c);
+	axis_thread_code->appendf("WT10;hjog%c=0;SP%c=speed%c;home%c=0\n",c,c,c,c);
 	//Send unsolicited messages to epics informing home and homed status
-	sprintf(axis_thread_code,"%shomed%c=1;MG \"homed%c\",homed%c;MG \"home%c\",home%c;ENDIF\nENDIF\n", axis_thread_code,c,c,c,c,c);
+	axis_thread_code->appendf("homed%c=1;MG \"homed%c\",homed%c;MG \"home%c\",home%c;ENDIF\nENDIF\n",c,c,c,c,c);
 	
 	//Initialize home related parameters on controller
 	//initialise home variable for this axis, set to not homming just yet.  Set to homming only when doing a home
@@ -402,7 +405,7 @@ void GalilAxis::gen_homecode(char c,			//GalilAxis::axisName_ used very often
 	//Add code that counts cpu cycles through thread 0
 	if (axisName_ == 'A')
 		{
-		sprintf(axis_thread_code,"%scounter=counter+1\n",axis_thread_code);
+		axis_thread_code->append("counter=counter+1\n");
 		
 		//initialise counter variable
 		sprintf(pC_->cmd_, "counter=0");
@@ -451,9 +454,7 @@ asynStatus GalilAxis::setLimitDecel(double velocity)
    //Find closest hardware setting
    decceleration = (long)(lrint(deccel/1024.0) * 1024);
    //Ensure decceleration is within maximum for this model
-   maxAcceleration = 67107840;
-   if (pC_->model_[0] == 'D' && pC_->model_[3] == '4')
-	maxAcceleration = 1073740800;
+   maxAcceleration = pC_->modelMaxAcceleration();
    decceleration = (decceleration > maxAcceleration) ? maxAcceleration : decceleration;
    sprintf(pC_->cmd_, "limdc%c=%ld", axisName_, decceleration);
    status = pC_->sync_writeReadController();
@@ -931,6 +932,37 @@ asynStatus GalilAxis::setClosedLoop(bool closedLoop)
   return status;
 }
 
+/** Convert profile readbacks, and following errors to user units, and do array callbacks.
+  * asynMotorAxis::readbackProfile takes the readback count from address 0, which is shared by the profile contexts
+  * \param[in] numReadbacks Number of points in the readback, from the profile context readback is for */
+asynStatus GalilAxis::readbackProfile(int numReadbacks)
+{
+  double resolution;
+  double offset;
+  int direction;
+  int status;
+  int i;
+
+  status = pC_->getDoubleParam(axisNo_, pC_->profileMotorResolution_, &resolution);
+  status |= pC_->getDoubleParam(axisNo_, pC_->profileMotorOffset_, &offset);
+  status |= pC_->getIntegerParam(axisNo_, pC_->profileMotorDirection_, &direction);
+  if (status)
+	return asynError;
+
+  //Convert to user units
+  if (direction != 0)
+	resolution = -resolution;
+  for (i = 0; i < numReadbacks; i++)
+	{
+	profileReadbacks_[i] = profileReadbacks_[i] * resolution + offset;
+	profileFollowingErrors_[i] = profileFollowingErrors_[i] * resolution;
+	}
+  pC_->doCallbacksFloat64Array(profileReadbacks_, numReadbacks, pC_->profileReadbacks_, axisNo_);
+  pC_->doCallbacksFloat64Array(profileFollowingErrors_, numReadbacks, pC_->profileFollowingErrors_, axisNo_);
+
+  return asynSuccess;
+}
+
 /** Set the motor brake status. 
   * \param[in] enable true = brake, false = release brake. */
 asynStatus GalilAxis::setBrake(bool enable)
@@ -55,23 +55,23 @@ public:
   void store_motors_enable(void);
 
   //Initialize code generator
-  void initialize_codegen(char axis_thread_code[],
-			  char axis_limit_code[],
-			  char axis_dighome_code[]);
+  void initialize_codegen(GalilCodeBuffer *axis_thread_code,
+			  GalilCodeBuffer *axis_limit_code,
+			  GalilCodeBuffer *axis_dighome_code);
 
   //Generate code for limits interrupt
   void gen_limitcode(char c,
-		     char axis_thread_code[],
-		     char axis_limit_code[]);
+		     GalilCodeBuffer *axis_thread_code,
+		     GalilCodeBuffer *axis_limit_code);
 
   //Generate code for digital input interrupt
   void gen_digitalcode(char c,
 		       int digitalhome,
 		       int digitalaway,
-		       char axis_dighome_code[]);
+		       GalilCodeBuffer *axis_dighome_code);
 
   //Generate axis home routine
-  void gen_homecode(char c, char axis_thread_code[]);
+  void gen_homecode(char c, GalilCodeBuffer *axis_thread_code);
    
   //Is the motor in an enabled/go state with current digital IO status
   bool motor_enabled(void);
@@ -123,6 +123,8 @@ public:
   asynStatus setBrake(bool enable);
   //Restore the motor brake status after axisReady_
   asynStatus restoreBrake(void);
+  //Convert profile readbacks to user units, and publish numReadbacks points
+  asynStatus readbackProfile(int numReadbacks);
 
   /* These are the methods we override from the base class */
   asynStatus move(double position, int relative, double minVelocity, double maxVelocity, double acceleration);
@@ -45,6 +45,14 @@ extern "C" {
 #include "GalilController.h"
 #include <epicsExport.h>
 
+//Is equation[i] a standalone axis letter in the range first to last
+static bool isAxisLetter(const char *equation, unsigned i, char first, char last)
+{
+  char c = toupper(equation[i]);
+
+  return (c >= first && c <= last && !isalpha(equation[i+1]) && (!i || !isalpha(equation[i-1])));
+}
+
 // These are the GalilCSAxis methods
 
 /** Creates a new GalilCSAxis object.
@@ -76,12 +84,25 @@ GalilCSAxis::GalilCSAxis(class GalilController *pC, 	//The GalilController
   //Forward kinematic substitutes List of A-P
   fwdsubs_ = (char *)calloc(MAX_GALIL_AXES, sizeof(char));
 
+  //Forward kinematic transform compiled
+  fwdcalc_ = new GalilTransform;
+  //No transform dependencies until transforms are parsed
+  fwddeps_ = revdeps_ = 0;
+  fwdresultvalid_ = false;
+  fwdstatus_ = asynError;
+  //No kinematic errors recorded yet
+  errorCount_ = 0;
+  errorsPending_ = false;
+  errorsLock_ = epicsMutexMustCreate();
+
   //Reverse transforms for the real axis
   reverse_ = (char **)calloc(MAX_GALIL_AXES, sizeof(char*));
   //Reverse transforms variables
   revvars_ = (char **)calloc(MAX_GALIL_AXES, sizeof(char*));
   //Reverse transforms substitutes
   revsubs_ = (char **)calloc(MAX_GALIL_AXES, sizeof(char*));
+  //Reverse transforms compiled
+  revcalc_ = new GalilTransform[MAX_GALIL_AXES];
 
   for (i = 0; i < MAX_GALIL_AXES; i++)
      {
@@ -108,6 +129,7 @@ GalilCSAxis::~GalilCSAxis()
    free(forward_);
    free(fwdvars_);
    free(fwdsubs_);
+   delete fwdcalc_;
 
    for (i = 0; i < MAX_GALIL_AXES; i++)
       {
@@ -119,6 +141,8 @@ GalilCSAxis::~GalilCSAxis()
    free(reverse_);
    free(revvars_);
    free(revsubs_);
+   delete [] revcalc_;
+   epicsMutexDestroy(errorsLock_);
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -161,87 +185,82 @@ asynStatus GalilCSAxis::setDefaults(void)
   return asynSuccess;
 }
 
-/** Check requested motor velocities
+/** Limit requested motor velocities, and accelerations to what the real motors can do
+  * Largest feasible move is found from real axis VMAX, and the controller maximum acceleration
+  * All real axis are scaled by the same factor so the coordinated motion keeps its path
   * \param[in] npos - After kinematics these are the requested motor positions Units=Steps
-  * \param[in] nvel - After kinematics these are the requested  motor velocities Units=Steps/s */
-asynStatus GalilCSAxis::checkMotorVelocities(double npos[], double nvel[])
+  * \param[in,out] nvel - After kinematics these are the requested motor velocities Units=Steps/s
+  * \param[in,out] naccel - After kinematics these are the requested motor accelerations Units=Steps/s/s */
+asynStatus GalilCSAxis::checkMotorVelocities(double npos[], double nvel[], double naccel[])
 {
+  unsigned naxes = strlen(revaxes_);	//Number of real motors
   unsigned i;				//Looping
+  GalilAxisSample sample[MAX_GALIL_AXES];	//Real motor data
   double incmove[MAX_GALIL_AXES];	//Real motor relative move distances
-  char mesg[MAX_GALIL_STRING_SIZE];	//Controller error mesg
-  double mres, eres;			//Motor record mres, eres
-  int ueip;				//Motor record ueip
-  double mpos, epos;			//Motor position, encoder position for real motor
   double vectorVelocity = 0;		//Computed vector velocity
+  double vectorAcceleration = 0;	//Computed vector acceleration
   double vectorDistance = 0;		//Computed vector distance
-  double vel;				//Temp variable used to calculate real motor velocity
-  double vmax;				//Motor record vmax
-
-  if (deferredMode_)
+  double ratio;				//Real motor share of vector move
+  double vel;				//Real motor velocity the controller will use Units=EGU/s
+  double accel;				//Real motor acceleration the controller will use Units=Steps/s/s
+  double amax = pC_->modelMaxAcceleration();	//Controller maximum acceleration
+  double vscale = 1.0;			//Velocity scale factor
+  double ascale = 1.0;			//Acceleration scale factor
+
+  //Retrieve real motor data once
+  for (i = 0; i < naxes; i++)
      {
-     //Sync start and stop uses linear mode
-     //Use vector mathematics to check requested motor velocities
-     //Loop thru all real motors, calculate vector distance and velocity
-     for (i = 0; i < strlen(revaxes_); i++)
+     pC_->getAxisSample(revaxes_[i] - AASCII, &sample[i]);
+     if (sample[i].status)
+        return asynError;
+     if (deferredMode_)
         {
-        //Get the readbacks for the axis
-        pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->motorEncoderPosition_, &epos);
-        pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->motorPosition_, &mpos);
-        //Retrieve needed motor record fields
-        pC_->getIntegerParam(revaxes_[i] - AASCII, pC_->GalilUseEncoder_, &ueip);
-        //Calculate incremental move distance in steps
-        incmove[i] = (ueip) ? npos[i] - epos : npos[i] - mpos;
-        //Calculate vector distance
-        vectorDistance += pow(incmove[i], 2);
-        //Calculate vector velocity
-        vectorVelocity += pow(nvel[i], 2);
+        //Sync start and stop uses linear mode, motor speeds follow from the vector move
+        incmove[i] = npos[i] - sample[i].readback / sample[i].mres;
+        vectorDistance += incmove[i] * incmove[i];
+        vectorVelocity += nvel[i] * nvel[i];
+        vectorAcceleration += naccel[i] * naccel[i];
         }
+     }
+  vectorDistance = sqrt(vectorDistance);
+  vectorVelocity = sqrt(vectorVelocity);
+  vectorAcceleration = sqrt(vectorAcceleration);
 
-     //Calculate vector distance
-     vectorDistance = sqrt(vectorDistance);
-     //Calculate vector velocity
-     vectorVelocity = sqrt(vectorVelocity);
-
-     //Calculate actual motor speeds as controller does in linear mode
-     for (i = 0; i < strlen(revaxes_); i++)
+  //Find largest feasible fraction of the requested velocity, and acceleration
+  for (i = 0; i < naxes; i++)
+     {
+     if (deferredMode_)
         {
-        //Retrieve needed motor record fields
-        pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->GalilMotorVmax_, &vmax);
-        pC_->getIntegerParam(revaxes_[i] - AASCII, pC_->GalilUseEncoder_, &ueip);
-        pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->motorResolution_, &mres);
-        pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->GalilEncoderResolution_, &eres);
-        //Calculate this motors actual velocity in egu
-        vel = (incmove[i]/vectorDistance) * vectorVelocity;
-        vel = (ueip) ? vel * eres : vel * mres;
-        if (lrint(fabs(vel)*1000.0)/1000.0 > lrint(fabs(vmax)*1000.0)/1000.0)
-           {
-           sprintf(mesg, "Move failed, axis %c velocity %lf > VMAX %lf\n", revaxes_[i], fabs(vel), fabs(vmax));
-           pC_->setCtrlError(mesg);
-           return asynError;
-           }
+        //Calculate actual motor speeds as controller does in linear mode
+        ratio = (vectorDistance > 0.0) ? fabs(incmove[i] / vectorDistance) : 0.0;
+        vel = ratio * vectorVelocity;
+        accel = ratio * vectorAcceleration;
         }
-    }
-  else
-    {
-    //Sync start only mode
-    //Loop thru all real motors and check velocity
-    for (i = 0; i < strlen(revaxes_); i++)
-       {
-       //Retrieve needed motor record fields
-       pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->GalilMotorVmax_, &vmax);
-       pC_->getIntegerParam(revaxes_[i] - AASCII, pC_->GalilUseEncoder_, &ueip);
-       pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->motorResolution_, &mres);
-       pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->GalilEncoderResolution_, &eres);
-       //Calculate requested velocity in egu
-       vel = (ueip) ? nvel[i] * eres : nvel[i] * mres;
-       if (lrint(fabs(vel)*1000.0)/1000.0 > lrint(fabs(vmax)*1000.0)/1000.0)
-           {
-           sprintf(mesg, "Move failed, axis %c velocity %2.21lf > VMAX %2.21lf\n", revaxes_[i], fabs(vel), fabs(vmax));
-           pC_->setCtrlError(mesg);
-           return asynError;
-           }
-       }
-    }
+     else
+        {
+        //Sync start only mode, motors use requested speeds
+        vel = fabs(nvel[i]);
+        accel = fabs(naccel[i]);
+        }
+     //Calculate this motors actual velocity in egu
+     vel = (sample[i].ueip) ? vel * fabs(sample[i].eres) : vel * fabs(sample[i].mres);
+     //VMAX of 0 means no limit
+     if (sample[i].vmax != 0.0 && vel > fabs(sample[i].vmax))
+        vscale = (fabs(sample[i].vmax) / vel < vscale) ? fabs(sample[i].vmax) / vel : vscale;
+     if (accel > amax)
+        ascale = (amax / accel < ascale) ? amax / accel : ascale;
+     }
+
+  //Scale the move
+  for (i = 0; i < naxes; i++)
+     {
+     nvel[i] *= vscale;
+     naccel[i] *= ascale;
+     }
+
+  //Report velocity, and acceleration scale factors
+  pC_->setDoubleParam(axisNo_, pC_->GalilCSMotorVelocityScale_, vscale);
+  pC_->setDoubleParam(axisNo_, pC_->GalilCSMotorAccelScale_, ascale);
 
   return asynSuccess;
 }
@@ -255,7 +274,8 @@ asynStatus GalilCSAxis::checkMotorVelocities(double npos[], double nvel[])
   * \param[in] acceleration The acceleration value. Units=steps/sec/sec. */
 asynStatus GalilCSAxis::move(double position, int relative, double minVelocity, double maxVelocity, double acceleration)
 {
-  //static const char *functionName = "GalilCSAxis::move";
+  static const char *functionName = "move";
+  char mesg[MAX_GALIL_STRING_SIZE];	//Controller error mesg
   GalilCSAxis *pCSAxis;			//Pointer to GalilCSAxis instance
   unsigned i, j = 0;			//Looping, indexing
   double npos[MAX_GALIL_AXES];		//Real axis position targets
@@ -264,6 +284,7 @@ asynStatus GalilCSAxis::move(double position, int relative, double minVelocity,
   CSTargets targets;			//Addtional CSAxis targets
   GalilAxis *pAxis;			//Pointer to GalilAxis instance
   int deferredMode;			//Deferred move mode
+  double tolerance = 0.0;		//Path mode tolerance
   string axes = "";			//Construct a real axis list
   int status = asynError;
 
@@ -274,11 +295,22 @@ asynStatus GalilCSAxis::move(double position, int relative, double minVelocity,
 
   //Retrieve deferred moves mode
   pC_->getIntegerParam(pC_->GalilDeferredMode_, &deferredMode);
+  //Coordinate systems cannot span controllers, sync start only is used
+  if (multiController())
+     deferredMode = 0;
   deferredMode_ = deferredMode;
 
   //Are moves to be deferred ?
   if (pC_->movesDeferred_ != 0)
 	{
+	//Deferred moves are processed by this controller only
+	if (multiController())
+		{
+		sprintf(mesg, "%s failed, deferred moves not supported for axis %c using other controllers", functionName, axisName_);
+		pC_->setCtrlError(mesg);
+		return asynSuccess;
+		}
+
 	//Store parameters for deferred move in GalilCSAxis
 	deferredPosition_ = position;
 	pC_->getIntegerParam(0, pC_->GalilCoordSys_, &deferredCoordsys_);
@@ -313,7 +345,7 @@ asynStatus GalilCSAxis::move(double position, int relative, double minVelocity,
 	status = reverseTransform(position, maxVelocity, acceleration, &targets, npos, nvel, naccel);
 
 	//Check requested motor velocities
-	status |= checkMotorVelocities(npos, nvel);
+	status |= checkMotorVelocities(npos, nvel, naccel);
 
 	//Write the motor setpoints, but dont move
 	if (!status)
@@ -339,13 +371,28 @@ asynStatus GalilCSAxis::move(double position, int relative, double minVelocity,
 	status = reverseTransform(position, maxVelocity, acceleration, NULL, npos, nvel, naccel);
 
 	//Check requested motor velocities
-	status |= checkMotorVelocities(npos, nvel);
+	status |= checkMotorVelocities(npos, nvel, naccel);
+
+	//Real axis on several controllers are started together
+	if (!status && multiController())
+		{
+		multiControllerMove(npos, nvel, naccel);
+		return asynSuccess;
+		}
 
 	//Select a free coordinate system
 	if (deferredMode && !status)
 	   if ((coordsys_ = selectFreeCoordinateSystem()) == -1)
 		status = asynError;
 
+	//Path mode, real axis follow the csaxis path within tolerance using linear segments
+	pC_->getDoubleParam(axisNo_, pC_->GalilCSMotorPathTolerance_, &tolerance);
+	if (deferredMode && !status && tolerance > 0.0)
+		{
+		pathMove(position, relative, tolerance, nvel, naccel);
+		return asynSuccess;
+		}
+
 	//Do the coordinate system axis move, using deferredMoves facility in GalilController
 	if (!status)
 		{
@@ -375,6 +422,312 @@ asynStatus GalilCSAxis::move(double position, int relative, double minVelocity,
   return asynSuccess;
 }
 
+/** Reverse transform all real axis at the given csaxis position
+  * Other csaxis and real axis readbacks, and kinematic variables are taken from snapshot
+  * \param[in] snap - Kinematic snapshot
+  * \param[in] cspos - CSAxis position Units=EGU
+  * \param[out] q - Real axis positions in revaxes_ order Units=EGU */
+asynStatus GalilCSAxis::pathPoint(const GalilKinematicSnapshot *snap, double cspos, double q[])
+{
+  double ctargs[SCALCARGS] = {0};	//Coordinate transform arguments
+  unsigned i;				//Looping
+  int status;
+
+  //Pack position readback args for reverse and forward axes
+  status = packReadbackArgs(snap, revaxes_, ctargs);
+  status |= packReadbackArgs(snap, fwdaxes_, ctargs);
+  //Substitute csaxis position for readback
+  ctargs[axisName_ - AASCII] = cspos;
+
+  for (i = 0; i < strlen(revaxes_); i++)
+	{
+	//Get kinematic variable values for this reverse transform
+	status |= packVariableArgs(snap, revvars_[i], revsubs_[i], ctargs);
+	if (!status)
+		status |= doCalc(reverse_[i], &revcalc_[i], KINEMATIC_REVERSE_POSITION, ctargs, &q[i]);
+	}
+
+  return (asynStatus)status;
+}
+
+/** Forward transform csaxis at the given real axis positions
+  * Other csaxis and real axis readbacks, and kinematic variables are taken from snapshot
+  * \param[in] snap - Kinematic snapshot
+  * \param[in] q - Real axis positions in revaxes_ order Units=EGU
+  * \param[out] cspos - CSAxis position Units=EGU */
+asynStatus GalilCSAxis::pathForward(const GalilKinematicSnapshot *snap, const double q[], double *cspos)
+{
+  double mrargs[SCALCARGS] = {0};	//Forward transform arguments
+  unsigned i;				//Looping
+  int status;
+
+  //Pack position readback args for reverse and forward axes
+  status = packReadbackArgs(snap, revaxes_, mrargs);
+  status |= packReadbackArgs(snap, fwdaxes_, mrargs);
+  //Substitute real axis positions for readbacks
+  for (i = 0; i < strlen(revaxes_); i++)
+     mrargs[revaxes_[i] - AASCII] = q[i];
+  //Get kinematic variable values for forward transform
+  status |= packVariableArgs(snap, fwdvars_, fwdsubs_, mrargs);
+  if (!status)
+     status |= doCalc(forward_, fwdcalc_, KINEMATIC_FORWARD, mrargs, cspos);
+
+  return (asynStatus)status;
+}
+
+//CSAxis kinematics a path is built with, transforms use one kinematic snapshot for the whole path
+class GalilCSPath : public GalilPathKinematics {
+public:
+  GalilCSPath(GalilCSAxis *pCSAxis, const GalilKinematicSnapshot *snap) : pCSAxis_(pCSAxis), snap_(snap) {}
+  int reverse(double cspos, double q[]) { return pCSAxis_->pathPoint(snap_, cspos, q); }
+  int forward(const double q[], double *cspos) { return pCSAxis_->pathForward(snap_, q, cspos); }
+private:
+  GalilCSAxis *pCSAxis_;
+  const GalilKinematicSnapshot *snap_;
+};
+
+/** Move csaxis along a path of linear segments in the selected coordinate system
+  * Straight line real axis moves deviate from the csaxis path when kinematics are non-linear
+  * Path is bisected until the forward transform of each segment midpoint is within tolerance
+  * Segments are streamed to the controller as linear interpolation (LI) increments
+  * \param[in] position - CSAxis position required Units=Steps
+  * \param[in] relative - Position is relative to the csaxis readback
+  * \param[in] tolerance - Maximum midpoint deviation Units=EGU
+  * \param[in] nvel - Real axis velocities from reverseTransform Units=Steps/s
+  * \param[in] naccel - Real axis accelerations from reverseTransform Units=Steps/s/s */
+asynStatus GalilCSAxis::pathMove(double position, int relative, double tolerance, double nvel[], double naccel[])
+{
+  static const char *functionName = "pathMove";
+  GalilKinematicSnapshot snap;		//Kinematic data used for this move
+  GalilCSPath kinematics(this, &snap);	//CSAxis kinematics from snapshot
+  GalilPath path;			//Subdivided path
+  GalilAxis *pAxis;			//Pointer to GalilAxis instance
+  int axis = axisName_ - AASCII;	//Axis number
+  unsigned naxes = strlen(revaxes_);	//Number of real axis
+  double res;				//Motor record mres, or eres depending on ueip
+  double cs0, cs1;			//CSAxis start, and end position Units=EGU
+  double qres[MAX_GALIL_AXES];		//Real axis resolution positions are converted to steps with
+  long last[MAX_GALIL_AXES];		//Real axis position at end of previous segment Units=Steps
+  vector<string> segments;		//Linear interpolation segments
+  double vectorVelocity = 0.0;		//Coordinate system velocity
+  double vectorAcceleration = 0.0;	//Coordinate system acceleration
+  bool encoder;				//Controller positions real axis using encoder
+  unsigned i;				//Looping
+  int status;
+
+  //Retrieve kinematic data once for the whole path
+  pC_->buildKinematicSnapshot(&snap);
+  status = snap.axisStatus[axis];
+  if (status)
+     return asynError;
+
+  //CSAxis start and end position in egu dial coordinates
+  res = (snap.ueip[axis]) ? snap.eres[axis] : snap.mres[axis];
+  cs0 = snap.readback[axis];
+  cs1 = (relative) ? cs0 + position * res : position * res;
+
+  //Subdivide path
+  if (path.build(&kinematics, revaxes_, cs0, cs1, tolerance))
+     return asynError;
+
+  //Real axis start positions in steps
+  for (i = 0; i < naxes; i++)
+     {
+     pAxis = pC_->getAxis(revaxes_[i] - AASCII);
+     if (!pAxis)
+        return asynError;
+     //Check velocity and wlp protection
+     if (pAxis->beginCheck(functionName, nvel[i]))
+        return asynError;
+     //Controller uses encoder_position_ for positioning servo with ueip_
+     encoder = (pAxis->ueip_ && (pAxis->motorType_ == 0 || pAxis->motorType_ == 1)) ? true : false;
+     last[i] = (encoder) ? lrint(pAxis->encoder_position_) : lrint(pAxis->motor_position_);
+     //Path positions are converted to the same units as last
+     qres[i] = (encoder) ? snap.eres[revaxes_[i] - AASCII] : snap.mres[revaxes_[i] - AASCII];
+     //Add this motors' contribution to vector velocity, acceleration
+     vectorVelocity += pow(nvel[i], 2);
+     vectorAcceleration += pow(naccel[i], 2);
+     }
+
+  //Construct linear interpolation segments
+  path.segments(qres, last, segments);
+
+  //Report path quality
+  pC_->setDoubleParam(axisNo_, pC_->GalilCSMotorPathDeviation_, path.deviation());
+  pC_->setIntegerParam(axisNo_, pC_->GalilCSMotorPathSegments_, (int)segments.size());
+
+  //Nothing to do
+  if (!segments.size())
+     return asynSuccess;
+
+  //Calculate final vectorVelocity and vectorAcceleration
+  vectorVelocity = lrint(sqrt(vectorVelocity)/2.0) * 2;
+  vectorAcceleration = lrint(sqrt(vectorAcceleration)/1024.0) * 1024;
+
+  //Start the move
+  status = pC_->executeLinearSegments(coordsys_, revaxes_, segments, vectorAcceleration, vectorVelocity);
+  if (!status)
+     move_started_ = true;
+
+  return (asynStatus)status;
+}
+
+/** Does this cs axis use real axis bound to other controllers by GalilCreateRemoteAxis
+  */
+bool GalilCSAxis::multiController(void)
+{
+  unsigned i;		//Looping
+  int axisNo;		//Axis number on controller axis belongs to
+
+  for (i = 0; i < strlen(revaxes_); i++)
+     if (pC_->realController(revaxes_[i] - AASCII, &axisNo) != pC_)
+        return true;
+
+  return false;
+}
+
+/** Group real axis by the controller they belong to
+  * This controller is always the first group, and may have an empty axis list
+  * \param[out] ctrl - Controller for each group
+  * \param[out] axes - Axis list for each group, using axis names on that controller
+  * \param[out] group - Group for each real axis in revaxes_
+  * \return Number of groups
+  */
+unsigned GalilCSAxis::groupRealAxes(GalilController *ctrl[], char axes[][MAX_GALIL_AXES + 1], unsigned group[])
+{
+  GalilController *pRC;		//Controller the axis belongs to
+  int axisNo;			//Axis number on that controller
+  unsigned ngroups = 1;		//Number of groups
+  unsigned i, g;		//Looping
+  size_t len;			//Axis list length
+
+  ctrl[0] = pC_;
+  axes[0][0] = '\0';
+  for (i = 0; i < strlen(revaxes_); i++)
+     {
+     pRC = pC_->realController(revaxes_[i] - AASCII, &axisNo);
+     //Find group for this controller
+     for (g = 0; g < ngroups; g++)
+        if (ctrl[g] == pRC)
+           break;
+     if (g == ngroups)
+        {
+        //New group
+        ctrl[g] = pRC;
+        axes[g][0] = '\0';
+        ngroups++;
+        }
+     //Add axis to group
+     len = strlen(axes[g]);
+     axes[g][len] = axisNo + AASCII;
+     axes[g][len + 1] = '\0';
+     group[i] = g;
+     }
+
+  return ngroups;
+}
+
+/** Start real axis on several controllers together
+  * All controllers are prepared first, then motion is begun on each controller back to back
+  * Start time skew between controllers is estimated from the begin command round trip times
+  * \param[in] npos - Real axis positions Units=Steps
+  * \param[in] nvel - Real axis velocities Units=Steps/s
+  * \param[in] naccel - Real axis accelerations Units=Steps/s/s
+  */
+asynStatus GalilCSAxis::multiControllerMove(double npos[], double nvel[], double naccel[])
+{
+  static const char *functionName = "multiControllerMove";
+  GalilController *ctrl[MAX_GALIL_AXES];	//Controllers real axis belong to
+  char axes[MAX_GALIL_AXES][MAX_GALIL_AXES + 1];	//Real axis list for each controller
+  unsigned group[MAX_GALIL_AXES];		//Controller for each real axis
+  double gpos[MAX_GALIL_AXES][MAX_GALIL_AXES];	//Positions for each controller in axis list order
+  double gvel[MAX_GALIL_AXES][MAX_GALIL_AXES];	//Velocities for each controller
+  double gaccel[MAX_GALIL_AXES][MAX_GALIL_AXES];	//Accelerations for each controller
+  unsigned count[MAX_GALIL_AXES] = {0};		//Axis in each controller
+  epicsTimeStamp start[MAX_GALIL_AXES];		//Estimated start time for each controller
+  GalilAxis *pAxis;				//First axis started on each controller
+  char mesg[MAX_GALIL_STRING_SIZE];		//Controller error mesg
+  double skew = 0.0;				//Start time difference between controllers
+  epicsTimeStamp nowt;				//Time now
+  double begin_time;				//Time begin has taken
+  bool fail = false;				//Begin fail flag
+  unsigned ngroups;				//Number of controllers
+  unsigned i, g;				//Looping
+  int status = asynSuccess;
+
+  //Group axis by controller
+  ngroups = groupRealAxes(ctrl, axes, group);
+  for (i = 0; i < strlen(revaxes_); i++)
+     {
+     g = group[i];
+     gpos[g][count[g]] = npos[i];
+     gvel[g][count[g]] = nvel[i];
+     gaccel[g][count[g]++] = naccel[i];
+     }
+
+  //Lock all controllers in port name order, this controller lock is released and taken again in order
+  GalilController::lockControllers(ctrl, ngroups, pC_);
+
+  //Prepare all controllers before any motion begins
+  for (g = 0; g < ngroups; g++)
+     if (count[g])
+        status |= ctrl[g]->prepareSyncStart(axes[g], gpos[g], gvel[g], gaccel[g]);
+
+  //Begin motion on each controller back to back
+  if (!status)
+     for (g = 0; g < ngroups; g++)
+        if (count[g])
+           status |= ctrl[g]->beginSyncStart(axes[g], &start[g]);
+
+  GalilController::unlockControllers(ctrl, ngroups, pC_);
+
+  if (status)
+     {
+     sprintf(mesg, "%s begin failure axis %c", functionName, axisName_);
+     pC_->setCtrlError(mesg);
+     return asynError;
+     }
+
+  //Start time skew is the spread of estimated start times
+  for (g = 1; g < ngroups; g++)
+     if (count[g] && count[0])
+        skew = (fabs(epicsTimeDiffInSeconds(&start[g], &start[0])) > skew) ? fabs(epicsTimeDiffInSeconds(&start[g], &start[0])) : skew;
+  pC_->setDoubleParam(axisNo_, pC_->GalilCSMotorStartSkew_, skew * 1000.0);
+
+  move_started_ = true;
+
+  //Pause until the first motor on each controller begins moving
+  //Release lock so pollers can update motion status
+  pC_->unlock();
+  for (g = 0; g < ngroups && !fail; g++)
+     {
+     if (!count[g]) continue;
+     pAxis = ctrl[g]->getAxis(axes[g][0] - AASCII);
+     while (pAxis && !pAxis->inmotion_)
+        {
+        epicsThreadSleep(.001);
+        epicsTimeGetCurrent(&nowt);
+        //Calculate time begin has taken so far
+        begin_time = epicsTimeDiffInSeconds(&nowt, &start[g]);
+        if (begin_time > BEGIN_TIMEOUT)
+           {
+           fail = true;
+           break;  //Timeout, give up
+           }
+        }
+     }
+  pC_->lock();
+
+  if (fail)
+     {
+     sprintf(mesg, "%s begin failure axis %c", functionName, axisName_);
+     pC_->setCtrlError(mesg);
+     return asynError;
+     }
+
+  return asynSuccess;
+}
+
 /** Move the motor at a fixed velocity until told to stop.
   * \param[in] minVelocity The initial velocity, often called the base velocity. Units=steps/sec.
   * \param[in] maxVelocity The maximum velocity, often called the slew velocity. Units=steps/sec.
@@ -401,6 +754,12 @@ asynStatus GalilCSAxis::moveVelocity(double minVelocity, double maxVelocity, dou
   * \param[in] acceleration The acceleration value. Units=steps/sec/sec. */
 asynStatus GalilCSAxis::stop(double acceleration)
 {
+  GalilController *ctrl[MAX_GALIL_AXES];	//Controllers real axis belong to
+  char axes[MAX_GALIL_AXES][MAX_GALIL_AXES + 1];	//Real axis list for each controller
+  unsigned group[MAX_GALIL_AXES];		//Controller for each real axis
+  unsigned ngroups;				//Number of controllers
+  unsigned i;					//Looping
+
   if (deferredMode_)
      {
      //Stop the coordinate system S or T that this CSAxis started
@@ -413,9 +772,20 @@ asynStatus GalilCSAxis::stop(double acceleration)
   else if (strcmp(revaxes_, "") != 0)
      {
      //revaxes_ cannot be empty, else all threads on controller get killed
-     //Stop the real motors that this CSAxis started
-     sprintf(pC_->cmd_, "ST %s", revaxes_);
-     pC_->sync_writeReadController();
+     //Stop the real motors that this CSAxis started, on each controller they belong to
+     ngroups = groupRealAxes(ctrl, axes, group);
+     //Lock all controllers in port name order, this controller lock is released and taken again in order
+     if (ngroups > 1)
+        GalilController::lockControllers(ctrl, ngroups, pC_);
+     for (i = 0; i < ngroups; i++)
+        {
+        //Empty axis list would stop all threads on the controller
+        if (axes[i][0] == '\0') continue;
+        sprintf(ctrl[i]->cmd_, "ST %s", axes[i]);
+        ctrl[i]->sync_writeReadController();
+        }
+     if (ngroups > 1)
+        GalilController::unlockControllers(ctrl, ngroups, pC_);
      }
 
   //Always return success. Dont need more error mesgs
@@ -432,11 +802,15 @@ int GalilCSAxis::selectFreeCoordinateSystem(void)
   int current_coordsys;
   int status;
 
-  //Get profile execute status
-  pC_->getIntegerParam(0, pC_->profileExecuteState_, &profileExecuteStatus);
-  //Return error if profileExecuteStatus not done
-  if (profileExecuteStatus != PROFILE_EXECUTE_DONE)
-	return -1;
+  //Get profile execute status for profiles on S, and T
+  for (coordsys = 0; coordsys < COORDINATE_SYSTEMS; coordsys++)
+	{
+	profileExecuteStatus = PROFILE_EXECUTE_DONE;
+	pC_->getIntegerParam(coordsys, pC_->profileExecuteState_, &profileExecuteStatus);
+	//Return error if profileExecuteStatus not done
+	if (profileExecuteStatus != PROFILE_EXECUTE_DONE)
+		return -1;
+	}
   //Retrieve current coordinate system
   pC_->getIntegerParam(0, pC_->GalilCoordSys_, &current_coordsys);
   //Check if current coordinate system free
@@ -532,21 +906,36 @@ asynStatus GalilCSAxis::obtainAxisList(char axis, char *equation, char *axes)
   */
 asynStatus GalilCSAxis::substituteTransforms(char axis, char *equation)
 {
-  unsigned i, j;						//Looping
+  unsigned i;							//Looping
   bool forward = (axis >= 'I' && axis <='P') ? true : false;	//Transform direction forward or reverse
   string equation_s = equation;					//For string substitution
   char subst_transform[MAX_GALIL_STRING_SIZE];			//The substitute transform		
   char first = (forward) ? 'I' : 'A';				//Axis we substitute for complete transform
   char last = (forward) ? 'P' : 'H';				//Axis we substitute for complete transform
   char mesg[MAX_GALIL_STRING_SIZE];				//Controller error mesg
+  bool substituted;						//Substitution made this scan
+
+  //Walk dependency graph from this transform, rejecting circular references
+  //Records the transforms this cs axis depends on
+  if (transformCycle(axis, 0))
+     {
+     if (axisReady_)
+        {
+        sprintf(mesg, "%c transform has circular dependency", axis);
+        pC_->setCtrlError(mesg);
+        }
+     return asynError;
+     }
 
-  //Scan through transform equation
-  for (j = 0; j < MAX_GALIL_CSAXES + 1; j++)
+  //Substitute until no axis in range remain
+  //Terminates because the dependency graph is acyclic
+  do
+     {
+     substituted = false;
      for (i = 0; i < strlen(equation); i++)
         {
         equation[i] = toupper(equation[i]);
-        if ((equation[i] >= first && equation[i] <= last && !isalpha(equation[i+1]) && !i) ||
-            (i && equation[i] >= first && equation[i] <= last && !isalpha(equation[i+1]) && !isalpha(equation[i-1])))
+        if (isAxisLetter(equation, i, first, last))
            {
            //Found a motor we want to substitute with a complete transform
            //Retrieve the substitute transform
@@ -556,22 +945,84 @@ asynStatus GalilCSAxis::substituteTransforms(char axis, char *equation)
               pC_->getStringParam(axisNo_, pC_->GalilCSMotorReverseA_ + equation[i] - AASCII, MAX_GALIL_STRING_SIZE, subst_transform);
 
            //Substitute motor letter with complete transform
-           equation_s.replace(i,i+1, subst_transform);
-           strcpy(equation, equation_s.c_str());
-           //If we keep finding things to substitute by this time there are either
-           //Too many CS motors in forward equations or too many real motors in reverse equations 
-           if ((j == MAX_GALIL_CSAXES) && axisReady_)
+           //Parenthesise so substitute is evaluated before surrounding operators
+           equation_s.replace(i, 1, (strcmp(subst_transform, "")) ? "(" + string(subst_transform) + ")" : "");
+           if (equation_s.length() >= MAX_GALIL_STRING_SIZE)
               {
-              sprintf(mesg, "%c transform has too many substitutes", axis);
-              pC_->setCtrlError(mesg);
+              if (axisReady_)
+                 {
+                 sprintf(mesg, "%c transform too long after substitution", axis);
+                 pC_->setCtrlError(mesg);
+                 }
               return asynError;
               }
+           strcpy(equation, equation_s.c_str());
+           substituted = true;
+           break;
            }
         }
+     } while (substituted);
 
   return asynSuccess;
 }
 
+/** Depth first walk of the kinematic dependency graph from the given transform
+  * Forward transforms (I-P) depend on the forward transforms of cs axis they contain
+  * Reverse transforms (A-H) depend on the reverse transforms of real axis they contain
+  * Each transform visited is recorded as a dependency of this cs axis
+  * \param[in] axis - Axis whose transform to visit
+  * \param[in] path - Bit mask of axis on the current path from the root transform
+  * \return true if a circular dependency was found
+  */
+bool GalilCSAxis::transformCycle(char axis, unsigned path)
+{
+  unsigned i;							//Looping
+  bool forward = (axis >= 'I' && axis <='P') ? true : false;	//Transform direction forward or reverse
+  char transform[MAX_GALIL_STRING_SIZE];			//Transform for axis
+  char first = (forward) ? 'I' : 'A';				//Axis range that are dependencies
+  char last = (forward) ? 'P' : 'H';				//Axis range that are dependencies
+  unsigned bit = 1 << (axis - AASCII);				//Axis bit in path
+
+  //Axis already on path, transform refers back to itself
+  if (path & bit)
+     return true;
+
+  //Retrieve transform and record dependency
+  if (forward)
+     {
+     pC_->getStringParam(axis - AASCII, pC_->GalilCSMotorForward_ , MAX_GALIL_STRING_SIZE, transform);
+     fwddeps_ |= 1 << (axis - 'I');
+     }
+  else
+     {
+     pC_->getStringParam(axisNo_, pC_->GalilCSMotorReverseA_ + axis - AASCII, MAX_GALIL_STRING_SIZE, transform);
+     revdeps_ |= 1 << (axis - AASCII);
+     }
+
+  //Visit transforms this transform depends on
+  for (i = 0; i < strlen(transform); i++)
+     if (isAxisLetter(transform, i, first, last))
+        if (transformCycle(toupper(transform[i]), path | bit))
+           return true;
+
+  return false;
+}
+
+/** Does this cs axis depend on the given kinematic transform
+  * Used so only the cs axis affected by a changed transform are parsed again
+  * \param[in] addr - ParamList address of the changed transform
+  * \param[in] function - GalilCSMotorForward_ or GalilCSMotorReverseA_ - GalilCSMotorReverseH_
+  */
+bool GalilCSAxis::transformAffected(int addr, int function)
+{
+  //Forward transforms are stored at the cs axis address
+  if (function == pC_->GalilCSMotorForward_)
+     return (addr == axisNo_ || (addr >= MAX_GALIL_AXES && (fwddeps_ & (1 << (addr - MAX_GALIL_AXES)))));
+
+  //Reverse transforms are stored at the cs axis address they belong to
+  return (addr == axisNo_ && (revdeps_ & (1 << (function - pC_->GalilCSMotorReverseA_))));
+}
+
 /** Find kinematic variables Q-X and substitute them for variable in range A-P for sCalcPerform
   * \param[in] axis    	    - Axis that provided kinematic equation relates to (ie. axis=equation)
   * \param[in] equation     - Kinematic transform equation
@@ -693,21 +1144,31 @@ asynStatus GalilCSAxis::parseTransforms(void)
 
   //Flag kinematic error not yet reported
   kinematic_error_reported_ = false;
+  //Dependencies are recorded again while parsing
+  fwddeps_ = revdeps_ = 0;
+  //Forward transform result must be calculated again
+  fwdresultvalid_ = false;
 
   //Retrieve forward kinematic equation for this cs axis (eg. I=(A+B)/2)
   status = pC_->getStringParam(axisNo_, pC_->GalilCSMotorForward_ , MAX_GALIL_STRING_SIZE, forward_);
   //Parse forward transform into GalilCSAxis instance
   if (strcmp(forward_, ""))
      status |= parseTransform(axisName_, forward_, revaxes_, fwdvars_, fwdsubs_);
+  //Compile forward transform once, poll evaluates the compiled expression
+  status |= compileCalc(forward_, fwdcalc_);
  
   //Retrieve reverse kinematic equations for axes found in forward transform retrieved above
   for (i = 0; i < strlen(revaxes_); i++)
      {
      //Retrieve reverse transform for axis specified in revaxes_
      status |= pC_->getStringParam(axisNo_, pC_->GalilCSMotorReverseA_ + revaxes_[i] - AASCII, MAX_GALIL_STRING_SIZE, reverse_[i]);
+     //Reverse transform is a dependency even when empty, so entering it later parses this cs axis again
+     revdeps_ |= 1 << (revaxes_[i] - AASCII);
      //Parse reverse transform into GalilCSAxis instance
      if (strcmp(reverse_[i], ""))
         status |= parseTransform(revaxes_[i], reverse_[i], fwdaxes_, revvars_[i], revsubs_[i]);
+     //Compile reverse transform once, moves evaluate the compiled expression
+     status |= compileCalc(reverse_[i], &revcalc_[i]);
      //Concat axis list found in last reverse transform
      fwdaxes_s += fwdaxes_;
      //Sort the axes list
@@ -721,33 +1182,52 @@ asynStatus GalilCSAxis::parseTransforms(void)
   return asynStatus(status);
 }
 
-/* Given axis list, retrieve readbacks and pack into mrargs (motor readback args)
+/* Given axis list, retrieve readbacks from snapshot and pack into mrargs (motor readback args)
+ * \param[in] snap - Kinematic snapshot
  * \param[in] axes - Axis list
  * \param[out] mrargs - Motor readback arguments Units=EGU
 */
-asynStatus GalilCSAxis::packReadbackArgs(char *axes, double mrargs[])
+asynStatus GalilCSAxis::packReadbackArgs(const GalilKinematicSnapshot *snap, char *axes, double mrargs[])
 {
   unsigned i;			//Looping
-  double mpos, epos;		//Motor, and encoder readback data
-  double mres, eres;		//Motor record mres, eres
-  int ueip;			//Use encoder if present setting
   int status = asynSuccess;
 
-  //Retrieve readbacks for all axis and pack into mrargs
-  //equation provided by user
-  for (i = 0; i < strlen(axes); i++)
-     {
-     //Get the readbacks for the axis
-     status |= pC_->getDoubleParam(axes[i] - AASCII, pC_->motorEncoderPosition_, &epos);
-     status |= pC_->getDoubleParam(axes[i] - AASCII, pC_->motorPosition_, &mpos);
-     //Retrieve needed motor record fields
-     status |= pC_->getDoubleParam(axes[i] - AASCII, pC_->motorResolution_, &mres);
-     status |= pC_->getDoubleParam(axes[i] - AASCII, pC_->GalilEncoderResolution_, &eres);
-     status |= pC_->getIntegerParam(axes[i] - AASCII, pC_->GalilUseEncoder_, &ueip);
+  if (!snap->valid)
+     return asynError;
 
+  //Pack readbacks for all axis into mrargs
+  for (i = 0; axes[i] != '\0'; i++)
+     {
+     status |= snap->axisStatus[axes[i] - AASCII];
      //Pack motor readbacks for calc in egu dial coordinates
      if (!status)
-        mrargs[axes[i] - AASCII] = (ueip) ? (epos * eres) : (mpos * mres);
+        mrargs[axes[i] - AASCII] = snap->readback[axes[i] - AASCII];
+     }
+
+  return (asynStatus)status;
+}
+
+/* Given kinematic variable list, retrieve values from snapshot and pack into args at substitute positions
+ * \param[in] snap - Kinematic snapshot
+ * \param[in] vars - Kinematic variables Q-Z
+ * \param[in] subs - Substitutes A-P for the variables
+ * \param[out] args - Transform arguments
+*/
+asynStatus GalilCSAxis::packVariableArgs(const GalilKinematicSnapshot *snap, char *vars, char *subs, double args[])
+{
+  unsigned i;			//Looping
+  int status = asynSuccess;
+
+  if (!snap->valid)
+     return asynError;
+
+  for (i = 0; vars[i] != '\0'; i++)
+     {
+     //Q-Z variables stored in addr 0-9
+     status |= snap->varStatus[vars[i] - QASCII];
+     //Pack variable values for transform calc
+     if (!status)
+        args[subs[i] - AASCII] = snap->variables[vars[i] - QASCII];
      }
 
   return (asynStatus)status;
@@ -761,23 +1241,36 @@ asynStatus GalilCSAxis::packReadbackArgs(char *axes, double mrargs[])
  * \param[in] targets - Related CSAxis that have new setpoints too
  * \param[out] npos - Calculated motor positions for the real axis Units=Steps
  * \param[out] nvel - Calculated motor velocities for the real axis Units=steps/s
- * \param[out] naccel - Calculated motor accelerations for the real axis Units-Steps/s/s*/
+ * \param[out] naccel - Calculated motor accelerations for the real axis Units-Steps/s/s
+ * Real axis velocity, acceleration is the reverse transform Jacobian times the CSAxis velocity, acceleration
+ * Peak of the start and target points is used, so non-linear transforms are handled*/
 int GalilCSAxis::reverseTransform(double pos, double vel, double accel, CSTargets *targets, double npos[], double nvel[], double naccel[])
 {
-  double mres, eres;		//Motor record mres, eres
-  int ueip;			//Motor record use encoder if present setting
+  GalilKinematicSnapshot snap;	//Kinematic data used for this move
+  double res;			//Motor record mres, or eres depending on ueip
+  int axis;			//Axis number
   double ctargs[SCALCARGS];	//Coordinate transform arguments
+  double stargs[SCALCARGS];	//Coordinate transform arguments at start point
+  char csaxis[2] = {axisName_, '\0'};	//This CSAxis as an axis list
   double vtargs[SCALCARGS];	//Velocity transform arguments
   double atargs[SCALCARGS];	//Acceleration transform arguments
-  double value;			//Kinematic arg value
-  unsigned i, j;
+  unsigned i;
   int status = asynSuccess;
 
+  //Retrieve kinematic data once for the whole move so all transforms see consistent data
+  pC_->buildKinematicSnapshot(&snap);
+
   //Pack position readback args for reverse axes
-  status |= packReadbackArgs(revaxes_, ctargs);
+  status |= packReadbackArgs(&snap, revaxes_, ctargs);
 
   //Pack position readback args for forward axes
-  status |= packReadbackArgs(fwdaxes_, ctargs);
+  status |= packReadbackArgs(&snap, fwdaxes_, ctargs);
+
+  //Readbacks are the start point of the move
+  for (i = 0; i < SCALCARGS; i++)
+     stargs[i] = ctargs[i];
+  //Include readback for this CSAxis in start point
+  status |= packReadbackArgs(&snap, csaxis, stargs);
 
   //Default velocity, acceleration transform args to zero
   for (i = 0; i < SCALCARGS; i++)
@@ -791,132 +1284,182 @@ int GalilCSAxis::reverseTransform(double pos, double vel, double accel, CSTarget
      for (i = 0; i < strlen(targets->csaxes); i++)
         {
         //Retrieve needed motor record parameters for related CSAxis
-        status |= pC_->getDoubleParam(targets->csaxes[i] - AASCII, pC_->motorResolution_, &mres);
-        status |= pC_->getDoubleParam(targets->csaxes[i] - AASCII, pC_->GalilEncoderResolution_, &eres);
-        status |= pC_->getIntegerParam(targets->csaxes[i] - AASCII, pC_->GalilUseEncoder_, &ueip);
+        axis = targets->csaxes[i] - AASCII;
+        status |= snap.axisStatus[axis];
+        res = (snap.ueip[axis]) ? snap.eres[axis] : snap.mres[axis];
         //Add position for csaxis in egu
-        ctargs[targets->csaxes[i] - AASCII] = (ueip) ? (targets->ncspos[i] * eres) : (targets->ncspos[i] * mres);
+        ctargs[axis] = targets->ncspos[i] * res;
         //Add velocity for csaxis in egu
-        vtargs[targets->csaxes[i] - AASCII] = (ueip) ? (targets->ncsvel[i] * eres) : (targets->ncsvel[i] * mres);
+        vtargs[axis] = targets->ncsvel[i] * res;
         //Add acceleration for csaxis in egu
-        atargs[targets->csaxes[i] - AASCII] = (ueip) ? (targets->ncsaccel[i] * eres) : (targets->ncsaccel[i] * mres);
+        atargs[axis] = targets->ncsaccel[i] * res;
         }
 
   //Retrieve needed motor record parameters for this CSAxis
-  status |= pC_->getDoubleParam(axisName_ - AASCII, pC_->motorResolution_, &mres);
-  status |= pC_->getDoubleParam(axisName_ - AASCII, pC_->GalilEncoderResolution_, &eres);
-  status |= pC_->getIntegerParam(axisName_ - AASCII, pC_->GalilUseEncoder_, &ueip);
+  axis = axisName_ - AASCII;
+  status |= snap.axisStatus[axis];
+  res = (snap.ueip[axis]) ? snap.eres[axis] : snap.mres[axis];
 
   //Substitute new motor position received for this CSAxis, instead of using readback
   //Convert new position from steps into egu dial coordinates
-  ctargs[axisName_ - AASCII] = (ueip) ? (pos * eres) : (pos * mres);
+  ctargs[axis] = pos * res;
   //Add CSAXis velocity in egu
-  vtargs[axisName_ - AASCII] = (ueip) ? (vel * eres) : (vel * mres);
+  vtargs[axis] = vel * res;
   //Add CSAXis acceleration in egu
-  atargs[axisName_ - AASCII] = (ueip) ? (accel * eres) : (accel * mres);
+  atargs[axis] = accel * res;
 
   for (i = 0; i < strlen(revaxes_); i++)
 	{
 	//Get kinematic variable values specified
-	//and pack them in mrargs for the reverse transform calculation
-	for (j = 0; j < strlen(revvars_[i]); j++)
-		{
-		//Get the variable values. Q-Z variables stored in addr 0-9
-		status |= pC_->getDoubleParam(revvars_[i][j] - QASCII, pC_->GalilCSMotorVariable_, &value);
-		//Pack variable positions for motor calc
-		if (!status)
-			ctargs[revsubs_[i][j] - AASCII] = value;
-		}
+	//and pack them in ctargs, stargs for the reverse transform calculation
+	status |= packVariableArgs(&snap, revvars_[i], revsubs_[i], ctargs);
+	status |= packVariableArgs(&snap, revvars_[i], revsubs_[i], stargs);
 	//Retrieve needed motor record parameters
-	status |= pC_->getDoubleParam(revaxes_[i] - AASCII, pC_->motorResolution_, &mres);
+	status |= snap.axisStatus[revaxes_[i] - AASCII];
+	res = snap.mres[revaxes_[i] - AASCII];
 
 	if (!status)
 		{
 		//Perform reverse coordinate transform to derive the required real axis positions 
 		//given new csaxis position
-		status |= doCalc(reverse_[i], ctargs, &npos[i]);
+		status |= doCalc(reverse_[i], &revcalc_[i], KINEMATIC_REVERSE_POSITION, ctargs, &npos[i]);
 		//Convert dial position value back into steps for move
-		npos[i] = npos[i]/mres;
-		//Perform reverse velocity transform to derive the required real axis velocity 
-		//given csaxis move velocity
-		status |= doCalc(reverse_[i], vtargs, &nvel[i]);
+		npos[i] = npos[i]/res;
+		//Map csaxis move velocity through the reverse transform Jacobian
+		//to derive the required real axis velocity
+		status |= doDerivative(reverse_[i], &revcalc_[i], KINEMATIC_REVERSE_VELOCITY, stargs, ctargs, vtargs, &nvel[i]);
 		//Convert velocity value back into steps for move
-		nvel[i] = fabs(nvel[i]/mres);
-		//Perform reverse acceleration transform to derive the required real axis acceleration 
-		//given csaxis move acceleration
-		status |= doCalc(reverse_[i], atargs, &naccel[i]);
+		nvel[i] = fabs(nvel[i]/res);
+		//Map csaxis move acceleration through the reverse transform Jacobian
+		//to derive the required real axis acceleration
+		status |= doDerivative(reverse_[i], &revcalc_[i], KINEMATIC_REVERSE_ACCELERATION, stargs, ctargs, atargs, &naccel[i]);
 		//Convert acceleration value back into steps for move
-		naccel[i] = naccel[i]/mres;
+		naccel[i] = fabs(naccel[i]/res);
 		}
 	}
 	
   return status;
 }
 
-//Perform forward kinematic transform using readback data, variables and store results in GalilCSAxis as csaxis readback
-int GalilCSAxis::forwardTransform(void)
+/** Pack forward transform arguments for this poll cycle from the kinematic snapshot
+  * Called by GalilController::batchForwardTransforms before the cs axis are polled
+  * \param[out] args - Arguments to evaluate, NULL if evaluation not needed this cycle
+  * \return Compiled forward transform if evaluation needed, otherwise NULL
+  */
+const GalilTransform *GalilCSAxis::prepareForwardTransform(double **args)
 {
+  const GalilKinematicSnapshot *snap = &pC_->kinematics_;	//Kinematic data for this poll cycle
+  int axis = axisName_ - AASCII;	//Axis number
   unsigned i;
-  double mrargs[SCALCARGS];	//Motor readback args in egu used in the forward transform
-  double value;			//Kinematic arg value
-  double mres, eres;		//Motor record mres, and eres
-  int ueip;			//Motor record use encoder if present
-  int status = asynSuccess;	//Asyn paramList return code
+
+  *args = NULL;
+  fwdstatus_ = asynError;
+  if (!axisReady_)
+     return NULL;
+
+  for (i = 0; i < SCALCARGS; i++)
+     fwdpending_[i] = 0.0;
 
   //Pack position readback args for reverse axes
-  status |= packReadbackArgs(revaxes_, mrargs);
+  fwdstatus_ = packReadbackArgs(snap, revaxes_, fwdpending_);
 
   //Pack position readback args for forward axes
-  status |= packReadbackArgs(fwdaxes_, mrargs);
+  fwdstatus_ |= packReadbackArgs(snap, fwdaxes_, fwdpending_);
 
   //Get variable values specified
-  //and pack them in mrargs for the forward transform calculation
-  for (i = 0; i < strlen(fwdvars_); i++)
-	{
-	//Get the kinematic variable values. Q-Z variables stored in addr 0-9
-	status |= pC_->getDoubleParam(fwdvars_[i] - QASCII, pC_->GalilCSMotorVariable_, &value);
-	//Pack variable positions for transform calc
-	if (!status)
-		mrargs[fwdsubs_[i] - AASCII] = value;
-	}
+  //and pack them in fwdpending_ for the forward transform calculation
+  fwdstatus_ |= packVariableArgs(snap, fwdvars_, fwdsubs_, fwdpending_);
 
-  //Perform forward kinematic calc to get csaxis readback data
-  if (!status)
+  //Retrieve needed motor record fields
+  if (!fwdstatus_)
+     fwdstatus_ |= snap->axisStatus[axis];
+
+  //Evaluate only when transform inputs changed since last cycle
+  if (fwdstatus_ || (fwdresultvalid_ && !memcmp(fwdpending_, fwdargs_, sizeof(fwdargs_))))
+     return NULL;
+
+  *args = fwdpending_;
+  return fwdcalc_;
+}
+
+/** Store forward transform result evaluated by GalilController::batchForwardTransforms
+  * \param[in] done - Result was evaluated, otherwise evaluate here
+  * \param[in] result - Forward transform result in egu dial coordinates
+  */
+void GalilCSAxis::completeForwardTransform(bool done, double result)
+{
+  if (done)
+     fwdresult_ = result;
+  else
+     fwdstatus_ |= doCalc(forward_, fwdcalc_, KINEMATIC_FORWARD, fwdpending_, &fwdresult_);
+
+  memcpy(fwdargs_, fwdpending_, sizeof(fwdargs_));
+  fwdresultvalid_ = (fwdstatus_) ? false : true;
+}
+
+//Store forward kinematic transform result evaluated this poll cycle as csaxis readback
+//Uses the kinematic snapshot taken by the poller this cycle
+int GalilCSAxis::forwardTransform(void)
+{
+  const GalilKinematicSnapshot *snap = &pC_->kinematics_;	//Kinematic data for this poll cycle
+  int axis = axisName_ - AASCII;	//Axis number
+
+  if (!fwdstatus_)
 	{
-	//Retrieve needed motor record fields
-	status |= pC_->getDoubleParam(axisName_ - AASCII, pC_->motorResolution_, &mres);
-	status |= pC_->getDoubleParam(axisName_ - AASCII, pC_->GalilEncoderResolution_, &eres);
-	status |= pC_->getIntegerParam(axisName_ - AASCII, pC_->GalilUseEncoder_, &ueip);
-	//Calculate motor position readback data in dial coordinates
-	if (!status)
-		{
-		if (ueip)
-			{
-			status |= doCalc(forward_, mrargs, &encoder_position_);
-			//Convert from dial to steps for interaction with motor record
-			encoder_position_ = encoder_position_/eres;
-			}
-		else
-			{
-			status |= doCalc(forward_, mrargs, &motor_position_);
-			//Convert from dial to steps for interaction with motor record
-			motor_position_ = motor_position_/mres;
-			}
-		}
+	//Convert from dial to steps for interaction with motor record
+	if (snap->ueip[axis])
+		encoder_position_ = fwdresult_/snap->eres[axis];
+	else
+		motor_position_ = fwdresult_/snap->mres[axis];
 	}
 
-  return status;
+  return fwdstatus_;
+}
+
+//Compile kinematic expression
+//Expressions are compiled once when kinematics change, so poll and move only evaluate
+//\param[in] expr - Kinematic expression
+//\param[out] calc - Compiled expression
+asynStatus GalilCSAxis::compileCalc(const char *expr, GalilTransform *calc) {
+
+   char mesg[MAX_GALIL_STRING_SIZE];	//Controller error mesg
+
+   //For empty expressions discard any previous program, so it is never evaluated
+   if (!strcmp(expr, ""))
+      {
+      calc->clear();
+      return asynSuccess;
+      }
+
+   //We use sCalcPostfix and sCalcPerform because it can handle upto 16 args
+   //Expressions using arithmetic and common math functions are also compiled natively
+   if (!calc->compile(expr))
+      {
+      if (!kinematic_error_reported_)
+         {
+         sprintf(mesg, "%c Cannot evaluate expression %s", axisName_, expr);
+         pC_->setCtrlError(mesg);
+         kinematic_error_reported_ = true;
+         }
+      return asynError;
+      }
+
+   return asynSuccess;
 }
 
 //Perform kinematic calculations
-//Evaluate expression, return result
-asynStatus GalilCSAxis::doCalc(const char *expr, double args[], double *result) {
+//Evaluate compiled expression, return result
+//Failures are recorded in the kinematic error ring with the arguments that produced them
+//\param[in] expr - Kinematic expression, used for error reporting
+//\param[in] calc - Expression compiled by compileCalc
+//\param[in] path - Transform path, used for error reporting
+//\param[in] args - Expression arguments A-P
+//\param[out] result - Expression result
+asynStatus GalilCSAxis::doCalc(const char *expr, const GalilTransform *calc, kinematicPath path, double args[], double *result) {
    
-   unsigned char rpn[512];		//Expression is converted to reverse polish notation 
-   short err;
    bool error = false;			//Error status
+   kinematicErrorClass errorClass;	//Why evaluation failed
    char mesg[MAX_GALIL_STRING_SIZE];	//Controller error mesg
-   int precision = 6;			//Hard code precision for now
     
    *result = 0.0;
 
@@ -924,23 +1467,151 @@ asynStatus GalilCSAxis::doCalc(const char *expr, double args[], double *result)
    if (!strcmp(expr, ""))
       return asynSuccess;
 
-   //We use sCalcPostfix and sCalcPerform because it can handle upto 16 args
-   if (sCalcPostfix(expr, rpn, &err))
+   //Expression failed to compile
+   if (!calc->compiled())
+      {
+      error = true;
+      errorClass = KINEMATIC_ERROR_COMPILE;
+      }
+   else if (calc->evaluate(args, result))
+      {
       error = true;
-   else if (sCalcPerform(args, SCALCARGS, NULL, 0, result, NULL, 0, rpn, precision) && finite(*result))
+      errorClass = KINEMATIC_ERROR_EVALUATE;
+      }
+   else if (!finite(*result))
+      {
       error = true;
+      errorClass = (isnan(*result)) ? KINEMATIC_ERROR_NAN : KINEMATIC_ERROR_INF;
+      }
 
-   if (error && !kinematic_error_reported_)
+   if (error)
       {
-      sprintf(mesg, "%c Cannot evaluate expression %s", axisName_, expr);
-      pC_->setCtrlError(mesg);
-      kinematic_error_reported_ = true;
+      recordKinematicError(path, errorClass, expr, args, *result);
+      if (!kinematic_error_reported_)
+         {
+         sprintf(mesg, "%c Cannot evaluate expression %s", axisName_, expr);
+         pC_->setCtrlError(mesg);
+         kinematic_error_reported_ = true;
+         }
       return asynError;
       }
 
     return asynSuccess;
 }
 
+//Map csaxis rates through the Jacobian of a compiled expression
+//Jacobian is evaluated at the start and target points, and the peak magnitude returned
+//Acceleration contribution from curvature of the transform is neglected
+//\param[in] expr - Kinematic expression, used for error reporting
+//\param[in] calc - Expression compiled by compileCalc
+//\param[in] path - Transform path, used for error reporting
+//\param[in] start - Arguments at start point
+//\param[in] target - Arguments at target point
+//\param[in] rates - Rate of change of each argument
+//\param[out] result - Peak rate of change of expression
+asynStatus GalilCSAxis::doDerivative(const char *expr, const GalilTransform *calc, kinematicPath path, double start[], double target[], double rates[], double *result) {
+
+   double *failed = NULL;		//Arguments that could not be differentiated
+   char mesg[MAX_GALIL_STRING_SIZE];	//Controller error mesg
+   double sresult, tresult;		//Result at start and target
+
+   *result = 0.0;
+
+   //For empty expressions
+   if (!strcmp(expr, ""))
+      return asynSuccess;
+
+   //Expression failed to compile
+   if (!calc->compiled())
+      failed = start;
+   else if (calc->derivative(start, rates, &sresult))
+      failed = start;
+   else if (calc->derivative(target, rates, &tresult))
+      failed = target;
+   else
+      *result = (fabs(sresult) > fabs(tresult)) ? fabs(sresult) : fabs(tresult);
+
+   if (failed)
+      {
+      recordKinematicError(path, (calc->compiled()) ? KINEMATIC_ERROR_DERIVATIVE : KINEMATIC_ERROR_COMPILE, expr, failed, *result);
+      if (!kinematic_error_reported_)
+         {
+         sprintf(mesg, "%c Cannot differentiate expression %s", axisName_, expr);
+         pC_->setCtrlError(mesg);
+         kinematic_error_reported_ = true;
+         }
+      return asynError;
+      }
+
+    return asynSuccess;
+}
+
+/** Record kinematic evaluation error in the error ring
+  * Ring storage is part of GalilCSAxis, so recording does not allocate
+  * Only called when an evaluation fails
+  * \param[in] path - Transform path
+  * \param[in] errorClass - Why evaluation failed
+  * \param[in] expr - Kinematic expression
+  * \param[in] args - Arguments A-P that produced the error
+  * \param[in] result - Result produced
+  */
+void GalilCSAxis::recordKinematicError(kinematicPath path, kinematicErrorClass errorClass, const char *expr, const double args[], double result)
+{
+  GalilKinematicError *error;		//Ring entry
+
+  epicsMutexLock(errorsLock_);
+  //Overwrite oldest entry
+  error = &errors_[errorCount_ % KINEMATIC_ERROR_RING];
+  epicsTimeGetCurrent(&error->time);
+  error->path = path;
+  error->errorClass = errorClass;
+  strncpy(error->expr, expr, KINEMATIC_ERROR_EXPR - 1);
+  error->expr[KINEMATIC_ERROR_EXPR - 1] = '\0';
+  memcpy(error->args, args, sizeof(error->args));
+  error->result = result;
+  errorCount_++;
+  errorsPending_ = true;
+  epicsMutexUnlock(errorsLock_);
+}
+
+/** Publish kinematic error ring to ParamList, newest error first
+  * Called by poll, does nothing unless errors were recorded since last publish
+  */
+void GalilCSAxis::publishKinematicErrors(void)
+{
+  static const char *paths[] = {"forward", "reverse position", "reverse velocity", "reverse acceleration"};
+  static const char *classes[] = {"not compiled", "evaluate failed", "nan", "inf", "derivative failed"};
+  GalilKinematicError *error;		//Ring entry
+  char time[40];			//Error time
+  unsigned count;			//Errors recorded
+  unsigned entries;			//Ring entries used
+  unsigned i, j;			//Looping
+  size_t len = 0;			//Text length
+
+  if (!errorsPending_)
+     return;
+
+  epicsMutexLock(errorsLock_);
+  count = errorCount_;
+  entries = (count < KINEMATIC_ERROR_RING) ? count : KINEMATIC_ERROR_RING;
+  errorText_[0] = '\0';
+  for (i = 0; i < entries && len < sizeof(errorText_); i++)
+     {
+     error = &errors_[(count - 1 - i) % KINEMATIC_ERROR_RING];
+     epicsTimeToStrftime(time, sizeof(time), "%Y/%m/%d %H:%M:%S.%03f", &error->time);
+     len += epicsSnprintf(errorText_ + len, sizeof(errorText_) - len, "%s %c %s %s %s = %g", time, axisName_, paths[error->path], classes[error->errorClass], error->expr, error->result);
+     for (j = 0; j < TRANSFORM_ARGS && len < sizeof(errorText_); j++)
+        len += epicsSnprintf(errorText_ + len, sizeof(errorText_) - len, " %c=%g", j + AASCII, error->args[j]);
+     if (len < sizeof(errorText_))
+        len += epicsSnprintf(errorText_ + len, sizeof(errorText_) - len, "\n");
+     }
+  errorsPending_ = false;
+  epicsMutexUnlock(errorsLock_);
+
+  pC_->setStringParam(axisNo_, pC_->GalilCSMotorKinematicErrors_, errorText_);
+  pC_->setIntegerParam(axisNo_, pC_->GalilCSMotorKinematicErrorCount_, (int)count);
+}
+
 /** Polls the axis.
   * This function reads the controller position, encoder position, the limit status, the moving status, 
   * and the drive power-on status.  It does not current detect following error, etc. but this could be
@@ -959,6 +1630,8 @@ asynStatus GalilCSAxis::poll(bool *moving)
    int rmoving, csmoving;	//Real axis moving status, coordinate system axis moving status derived from real axis moving status
    int status;			//Communication status with controller
    bool reportlimits;		//Do we report limits for this csaxis under current circumstances
+   GalilAxisSample sample[MAX_GALIL_AXES];	//Real axis data
+   int axisNo;			//Real axis number on the controller it belongs to
    unsigned i;			//Looping
 
    //Default communication status
@@ -977,20 +1650,23 @@ asynStatus GalilCSAxis::poll(bool *moving)
    //store results in GalilCSAxis, or asyn ParamList
    if (axisReady_)
        status = forwardTransform();
+   //Publish any kinematic errors recorded since last cycle
+   publishKinematicErrors();
    if (status) goto skip;
 
    //Determine moving, and stall status
    for (i = 0; i < strlen(revaxes_); i++)
 	{
-	//Retrieve the axis
-	pAxis = pC_->getAxis(revaxes_[i] - AASCII);
+	//Retrieve the axis from this, or the controller it is bound to
+	pAxis = pC_->realController(revaxes_[i] - AASCII, &axisNo)->getAxis(axisNo);
 	if (!pAxis) continue;
-	//Retrieve moving status
-	status = pC_->getIntegerParam(revaxes_[i] - AASCII, pC_->motorStatusMoving_, &rmoving);
+	//Retrieve moving, and stall/following error status
+	pC_->getAxisSample(revaxes_[i] - AASCII, &sample[i]);
+	status = sample[i].status;
+	rmoving = sample[i].moving;
+	slipstall = sample[i].slipstall;
 	//Or moving status from all real axis to derive cs moving status
 	csmoving |= ((rmoving && !pAxis->deferredMove_) || deferredMove_);
-	//Retrieve stall/following error status
-	status |= pC_->getIntegerParam(revaxes_[i] - AASCII, pC_->motorStatusSlip_, &slipstall);
 	//Or slipstall from all real axis to derive cs slipstall status
 	csslipstall |= slipstall;
 	}
@@ -1012,8 +1688,8 @@ asynStatus GalilCSAxis::poll(bool *moving)
    //Get axis limits, and work out what to propagate to the cs axis
    for (i = 0; i < strlen(revaxes_); i++)
 	{
-	//Retrieve the axis
-	pAxis = pC_->getAxis(revaxes_[i] - AASCII);
+	//Retrieve the axis from this, or the controller it is bound to
+	pAxis = pC_->realController(revaxes_[i] - AASCII, &axisNo)->getAxis(axisNo);
 	if (!pAxis) continue;
 	//Check if real motor stopping on limit only if this cs axis started a move
 	if ((pAxis->stop_code_ == MOTOR_STOP_FWD && move_started_) || (pAxis->stop_code_ == MOTOR_STOP_REV && move_started_))
@@ -1021,8 +1697,9 @@ asynStatus GalilCSAxis::poll(bool *moving)
 	//Don't report limits if a real axis in csaxis is moving independently
 	stop_onlimit_ = (*moving && !move_started_) ? false : stop_onlimit_;
 	//Retrieve limit status
-	status |= pC_->getIntegerParam(revaxes_[i] - AASCII, pC_->motorStatusLowLimit_, &rev);
-	status |= pC_->getIntegerParam(revaxes_[i] - AASCII, pC_->motorStatusHighLimit_, &fwd);
+	status |= sample[i].status;
+	rev = sample[i].lowLimit;
+	fwd = sample[i].highLimit;
 	if (!status)
 		{
 		//Check cs axis reverse limit
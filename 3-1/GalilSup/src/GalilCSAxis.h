@@ -22,6 +22,36 @@
 
 #include "asynMotorController.h"
 #include "asynMotorAxis.h"
+#include <vector>
+
+//Kinematic error ring
+//Errors recorded per cs axis
+#define KINEMATIC_ERROR_RING 8
+//Expression characters kept for each error
+#define KINEMATIC_ERROR_EXPR 80
+//Size of text published for the ring
+#define KINEMATIC_ERROR_TEXT 4096
+
+//Transform path that failed
+enum kinematicPath {
+  KINEMATIC_FORWARD, KINEMATIC_REVERSE_POSITION, KINEMATIC_REVERSE_VELOCITY, KINEMATIC_REVERSE_ACCELERATION
+};
+
+//Why the transform failed
+enum kinematicErrorClass {
+  KINEMATIC_ERROR_COMPILE, KINEMATIC_ERROR_EVALUATE, KINEMATIC_ERROR_NAN, KINEMATIC_ERROR_INF, KINEMATIC_ERROR_DERIVATIVE
+};
+
+//Kinematic evaluation error, with the arguments that produced it
+struct GalilKinematicError
+	{
+	epicsTimeStamp time;			//Time of error
+	kinematicPath path;			//Transform path
+	kinematicErrorClass errorClass;		//Error class
+	char expr[KINEMATIC_ERROR_EXPR];	//Expression, truncated
+	double args[TRANSFORM_ARGS];			//Arguments A-P
+	double result;				//Result produced
+	};
 
 //Related CSAxis may have new setpoints too
 struct CSTargets 
@@ -32,6 +62,44 @@ struct CSTargets
         char csaxes[MAX_GALIL_CSAXES] = {0};	//List of related csaxis that also have new position setpoints
 	};
 
+//Kinematic data retrieved from ParamList once per poll cycle
+//All transforms evaluated in a cycle see the same consistent data
+struct GalilKinematicSnapshot
+	{
+	double readback[MAX_GALIL_AXES + MAX_GALIL_CSAXES];	//Axis readback in egu dial coordinates
+	double mres[MAX_GALIL_AXES + MAX_GALIL_CSAXES];		//Motor record mres
+	double eres[MAX_GALIL_AXES + MAX_GALIL_CSAXES];		//Motor record eres
+	int ueip[MAX_GALIL_AXES + MAX_GALIL_CSAXES];		//Motor record use encoder if present
+	int axisStatus[MAX_GALIL_AXES + MAX_GALIL_CSAXES];	//ParamList status retrieving axis data
+	double variables[MAX_GALIL_VARS];			//Kinematic variables Q-Z
+	int varStatus[MAX_GALIL_VARS];				//ParamList status retrieving variable
+	bool valid = false;					//Has snapshot been taken
+	};
+
+//Real axis bound to an axis on another controller
+struct GalilRemoteAxis
+	{
+	class GalilController *pC;	//Controller the axis belongs to, NULL if axis is on this controller
+	int axisNo;			//Axis number on that controller
+	};
+
+//Real axis data published each poll cycle for coordinate system axis on other controllers
+struct GalilAxisSample
+	{
+	double readback;		//Readback in egu dial coordinates
+	double velocity;		//Readback velocity estimated from last two samples egu/s
+	double mres;			//Motor record mres
+	double eres;			//Motor record eres
+	int ueip;			//Motor record use encoder if present
+	double vmax;			//Motor record vmax
+	int moving;			//Moving status
+	int slipstall;			//Encoder slip stall following error status
+	int lowLimit;			//Reverse limit status
+	int highLimit;			//Forward limit status
+	int status;			//ParamList status retrieving axis data
+	epicsTimeStamp time;		//Time of data record readback was taken from
+	};
+
 class GalilCSAxis : public asynMotorAxis
 {
 public:
@@ -46,24 +114,54 @@ public:
   asynStatus obtainAxisList(char axis, char *equation, char *axes);
   //Substitute transform equation in place of motor name
   asynStatus substituteTransforms(char axis, char *equation);
+  //Walk kinematic dependency graph, record dependencies and detect circular references
+  bool transformCycle(char axis, unsigned path);
+  //Does this cs axis depend on the given kinematic transform
+  bool transformAffected(int addr, int function);
   //Bring variables Q-X in range A-P for use with sCalcperform
   asynStatus substituteVariables(char axis, char *equation, char *axes, char *vars, char *subs);
   //Parse a kinematic transform equation and store results in GalilCSAxis instance
   asynStatus parseTransform(char axis, char *equation, char *axes, char *vars, char *subs);
   //Store kinematics when user changes them
   asynStatus parseTransforms(void);
-  //Calculate an expression with the given arguments
-  asynStatus doCalc(const char *expr, double args[], double *result);
-  //Get motor readbacks for kinematic transform, and pack into mrargs (motor readback args)
-  asynStatus packReadbackArgs(char *axes, double mrargs[]);
-  //Peform forward kinematic transform using real axis readback data, and store results in GalilCSAxis
+  //Compile a kinematic expression
+  asynStatus compileCalc(const char *expr, GalilTransform *calc);
+  //Calculate a compiled expression with the given arguments
+  asynStatus doCalc(const char *expr, const GalilTransform *calc, kinematicPath path, double args[], double *result);
+  //Calculate peak rate of change of a compiled expression between start and target
+  asynStatus doDerivative(const char *expr, const GalilTransform *calc, kinematicPath path, double start[], double target[], double rates[], double *result);
+  //Record kinematic evaluation error in the error ring
+  void recordKinematicError(kinematicPath path, kinematicErrorClass errorClass, const char *expr, const double args[], double result);
+  //Publish error ring to ParamList when errors were recorded
+  void publishKinematicErrors(void);
+  //Get motor readbacks for kinematic transform from snapshot, and pack into mrargs (motor readback args)
+  asynStatus packReadbackArgs(const GalilKinematicSnapshot *snap, char *axes, double mrargs[]);
+  //Get kinematic variables from snapshot, and pack into args
+  asynStatus packVariableArgs(const GalilKinematicSnapshot *snap, char *vars, char *subs, double args[]);
+  //Pack forward transform arguments from kinematic snapshot, returns transform if evaluation needed
+  const GalilTransform *prepareForwardTransform(double **args);
+  //Store forward transform result evaluated with other cs axis
+  void completeForwardTransform(bool done, double result);
+  //Store forward kinematic transform result in GalilCSAxis as csaxis readback
   int forwardTransform(void);
   //Perform reverse coordinate and velocity transform
   int reverseTransform(double pos, double vel, double accel, CSTargets *targets, double npos[], double nvel[], double naccel[]);
   //Selects a free coordinate system S or T and returns coordsys number, or -1 if none free
   int selectFreeCoordinateSystem(void);
-  //Uses vector mathematics to check requested real motor velocities
-  asynStatus checkMotorVelocities(double npos[], double nvel[]);
+  //Reverse transform all real axis at the given csaxis position
+  asynStatus pathPoint(const GalilKinematicSnapshot *snap, double cspos, double q[]);
+  //Forward transform csaxis at the given real axis positions
+  asynStatus pathForward(const GalilKinematicSnapshot *snap, const double q[], double *cspos);
+  //Move along subdivided path using linear interpolation of the real axis
+  asynStatus pathMove(double position, int relative, double tolerance, double nvel[], double naccel[]);
+  //Group real axis by the controller they belong to
+  unsigned groupRealAxes(GalilController *ctrl[], char axes[][MAX_GALIL_AXES + 1], unsigned group[]);
+  //Does this cs axis use real axis on other controllers
+  bool multiController(void);
+  //Start real axis on several controllers together
+  asynStatus multiControllerMove(double npos[], double nvel[], double naccel[]);
+  //Scales requested real motor velocities, accelerations within real motor limits
+  asynStatus checkMotorVelocities(double npos[], double nvel[], double naccel[]);
 
   /* These are the methods we override from the base class */
   asynStatus move(double position, int relative, double min_velocity, double max_velocity, double acceleration);
@@ -87,15 +185,29 @@ private:
   char *forward_;			//forward kinematic transform used to calculate the coordinate system (cs) motor position
   char *fwdvars_;			//Forward kinematic variables List of Q-Z
   char *fwdsubs_;			//Forward kinematic substitutes List of A-P
+  GalilTransform *fwdcalc_;		//Forward kinematic transform compiled
   char *revaxes_;			//List of real motors axis whose transforms should be treated as reverse transforms
   char **reverse_;			//Reverse transforms to calculate each axis position in the coordinate system
   char **revvars_;			//Reverse kinematic variables List of Q-Z
   char **revsubs_;			//Reverse kinematic substitutes List of A-P
+  GalilTransform *revcalc_;		//Reverse transforms compiled
+  unsigned fwddeps_;			//Forward transforms this cs axis depends on.  Bit 0 = I etc
+  unsigned revdeps_;			//Reverse transforms this cs axis depends on.  Bit 0 = A etc
+  double fwdargs_[SCALCARGS];		//Forward transform arguments last evaluated
+  double fwdpending_[SCALCARGS];	//Forward transform arguments this poll cycle
+  int fwdstatus_;			//Forward transform status this poll cycle
+  double fwdresult_;			//Forward transform result last evaluated in egu dial coordinates
+  bool fwdresultvalid_;			//Forward transform result valid for fwdargs_
   int coordsys_;			//The coordinate system S or T that we started when moving
   bool stop_onlimit_;			//Is a real motor in the cs axis stopping on a limit
   bool stop_issued_;			//CSAxis stop issued
   bool move_started_;			//Has a move been initiated from this cs axis
   bool kinematic_error_reported_;	//Kinematic error has been reported to user
+  GalilKinematicError errors_[KINEMATIC_ERROR_RING];	//Recent kinematic errors, oldest overwritten
+  unsigned errorCount_;			//Kinematic errors recorded
+  bool errorsPending_;			//Errors recorded since ring was last published
+  epicsMutexId errorsLock_;		//Protects error ring, taken only when errors are recorded or published
+  char errorText_[KINEMATIC_ERROR_TEXT];	//Error ring formatted for ParamList
   int last_done_;			//Done status stored from previous poll cycle
   double motor_position_;		//aux encoder or step count register
   double encoder_position_;		//main encoder register
@@ -0,0 +1,143 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Bounded append only buffer used by the code generator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "GalilCodeBuffer.h"
+
+//Constructor
+GalilCodeBuffer::GalilCodeBuffer(size_t maxLength)
+{
+	buf_ = NULL;
+	length_ = 0;
+	allocated_ = 0;
+	maxLength_ = maxLength;
+	overflow_ = false;
+}
+
+//Destructor
+GalilCodeBuffer::~GalilCodeBuffer()
+{
+	free(buf_);
+}
+
+//Ensure storage for length characters plus terminator
+//Storage doubles so appends are linear time overall
+bool GalilCodeBuffer::reserve(size_t length)
+{
+	size_t size;	//New storage size
+	char *buf;	//New storage
+
+	if (length > maxLength_)
+		return false;
+	if (length + 1 <= allocated_)
+		return true;
+	size = (allocated_ == 0) ? CODE_BUFFER_INITIAL_SIZE : allocated_;
+	while (size < length + 1)
+		size *= 2;
+	if (size > maxLength_ + 1)
+		size = maxLength_ + 1;
+	buf = (char *)realloc(buf_, size);
+	if (buf == NULL)
+		return false;
+	buf_ = buf;
+	allocated_ = size;
+	return true;
+}
+
+//Append string
+void GalilCodeBuffer::append(const char *str)
+{
+	size_t len = strlen(str);
+
+	if (overflow_ || !reserve(length_ + len))
+		{
+		overflow_ = true;
+		return;
+		}
+	memcpy(buf_ + length_, str, len + 1);
+	length_ += len;
+}
+
+//Append printf style formatted string
+void GalilCodeBuffer::appendf(const char *format, ...)
+{
+	va_list args;		//Format arguments
+	int len;		//Formatted length
+
+	if (overflow_)
+		return;
+	//Determine formatted length
+	va_start(args, format);
+	len = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+	if (len < 0 || !reserve(length_ + len))
+		{
+		overflow_ = true;
+		return;
+		}
+	//Format directly onto end of buffer
+	va_start(args, format);
+	vsnprintf(buf_ + length_, allocated_ - length_, format, args);
+	va_end(args);
+	length_ += len;
+}
+
+//Empty buffer, keeps storage
+void GalilCodeBuffer::clear(void)
+{
+	length_ = 0;
+	overflow_ = false;
+	if (buf_)
+		buf_[0] = '\0';
+}
+
+//Empty buffer, and free storage
+void GalilCodeBuffer::release(void)
+{
+	free(buf_);
+	buf_ = NULL;
+	allocated_ = 0;
+	clear();
+}
+
+const char *GalilCodeBuffer::c_str(void) const
+{
+	return (buf_) ? buf_ : "";
+}
+
+size_t GalilCodeBuffer::length(void) const
+{
+	return length_;
+}
+
+size_t GalilCodeBuffer::allocated(void) const
+{
+	return allocated_;
+}
+
+bool GalilCodeBuffer::overflow(void) const
+{
+	return overflow_;
+}
+
@@ -0,0 +1,60 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Bounded append only buffer used by the code generator
+// Length is tracked so appends are linear time, storage grows as needed up to the maximum length
+// Appends that would exceed the maximum length are discarded and flagged as overflow
+
+#ifndef GalilCodeBuffer_H
+#define GalilCodeBuffer_H
+
+#include <stddef.h>
+
+//Initial storage allocated on first append
+#define CODE_BUFFER_INITIAL_SIZE 4096
+
+class GalilCodeBuffer {
+public:
+  GalilCodeBuffer(size_t maxLength);
+  ~GalilCodeBuffer();
+  //Append string
+  void append(const char *str);
+  //Append printf style formatted string
+  void appendf(const char *format, ...);
+  //Empty buffer, keeps storage
+  void clear(void);
+  //Empty buffer, and free storage
+  void release(void);
+  const char *c_str(void) const;
+  size_t length(void) const;
+  //Storage allocated in bytes
+  size_t allocated(void) const;
+  //Has an append been discarded because maximum length would be exceeded
+  bool overflow(void) const;
+
+private:
+  bool reserve(size_t length);
+
+  char *buf_;			//Code storage, always null terminated
+  size_t length_;		//Length of code in buffer
+  size_t allocated_;		//Storage allocated
+  size_t maxLength_;		//Maximum length of code
+  bool overflow_;		//Overflow flag
+};
+
+#endif //GalilCodeBuffer_H
@@ -0,0 +1,204 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Controller program minification, and program memory usage
+
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+#include "GalilCodeMinify.h"
+
+//Is program line a label
+static bool isLabel(const string &line)
+{
+  return (!line.empty() && line[0] == '#') ? true : false;
+}
+
+//Is program line a comment
+static bool isComment(const string &line)
+{
+  return (line.compare(0, 3, "REM") == 0 || line[0] == '\'' || line == "NO" || line.compare(0, 3, "NO ") == 0) ? true : false;
+}
+
+//Does program line end with a trailing apostrophe comment
+static bool hasTrailingComment(const string &line)
+{
+  bool quoted = false;	//Inside string literal
+  size_t i;		//Looping
+
+  for (i = 0; i < line.length(); i++)
+     {
+     if (line[i] == '"')
+        quoted = !quoted;
+     else if (line[i] == '\'' && !quoted)
+        return true;
+     }
+  return false;
+}
+
+//Label name from label line (eg. #THREADA)
+static string labelName(const string &line)
+{
+  size_t end = line.find_first_of(";, ", 1);
+  return line.substr(0, end);
+}
+
+//Replace whole word occurrences of label in program line
+static string replaceLabel(const string &line, const string &label, const string &with)
+{
+  string result = line;	//Line with label replaced
+  size_t pos = 0;	//Search position
+  size_t end;		//End of label found
+
+  while ((pos = result.find(label, pos)) != string::npos)
+     {
+     end = pos + label.length();
+     if (end == result.length() || !isalnum((unsigned char)result[end]))
+        {
+        result.replace(pos, label.length(), with);
+        pos += with.length();
+        }
+     else
+        pos = end;
+     }
+  return result;
+}
+
+/** Minifies program prior to download
+  * Strips comment lines, leading/trailing whitespace and empty lines
+  * Subroutines identical to an earlier subroutine, apart from their own label, are replaced by a jump to the earlier subroutine
+  * Statements are merged onto shared lines separated by ; within the controller column limit.  Labels always start a line
+  * \param[in,out] prog      Program with \n separated lines
+  * \param[in] maxColumns    Maximum characters per program line
+*/
+void GalilMinifyCode(string *prog, unsigned maxColumns)
+{
+  vector<string> lines;			//Program lines after strip
+  vector<string> out;			//Program lines after deduplication
+  unordered_map<string, string> blocks;	//Subroutine bodies seen so far, and their label
+  istringstream in(*prog);		//Program input
+  string line;				//Current line
+  string name;				//Current label name
+  string body;				//Current subroutine body with own label normalized
+  string last;				//Last line of current subroutine
+  size_t i, j, end;			//Looping
+  size_t first, lastc;			//Trim positions
+
+  //Strip comments, and whitespace
+  while (getline(in, line))
+     {
+     first = line.find_first_not_of(" \t\r");
+     if (first == string::npos)
+        continue;
+     lastc = line.find_last_not_of(" \t\r;");
+     if (lastc == string::npos || lastc < first)
+        continue;
+     line = line.substr(first, lastc - first + 1);
+     if (!line.empty() && !isComment(line))
+        lines.push_back(line);
+     }
+
+  //Deduplicate identical subroutines
+  for (i = 0; i < lines.size(); i = end)
+     {
+     //Find end of this block
+     for (end = i + 1; end < lines.size() && !isLabel(lines[end]); end++);
+     //Copy block
+     for (j = i; j < end; j++)
+        out.push_back(lines[j]);
+     //Only subroutines with a plain label, and a body that ends in unconditional EN or JP
+     if (!isLabel(lines[i]) || lines[i] != labelName(lines[i]) || end - i < 2)
+        continue;
+     name = lines[i];
+     last = lines[end - 1];
+     if (last != "EN" && (last.compare(0, 4, "JP #") != 0 || last.find(',') != string::npos))
+        continue;
+     //Interrupt, and automatic subroutine labels are never replaced
+     if (name == "#AUTO" || name == "#LIMSWI" || name == "#ININT" || name == "#CMDERR" || name == "#POSERR" ||
+         name == "#TCPERR" || name == "#AMPERR" || name == "#AUTOERR" || name == "#MCTIME")
+        continue;
+     body.clear();
+     for (j = i + 1; j < end; j++)
+        body += replaceLabel(lines[j], name, "#") + "\n";
+     if (blocks.count(body))
+        {
+        //Replace body with jump to identical subroutine
+        out.resize(out.size() - (end - i - 1));
+        out.push_back("JP " + blocks[body]);
+        }
+     else
+        blocks[body] = name;
+     }
+
+  //Merge statements onto shared lines
+  prog->clear();
+  line.clear();
+  for (i = 0; i < out.size(); i++)
+     {
+     if (!line.empty() && !isLabel(line) && !isLabel(out[i]) && !hasTrailingComment(line) &&
+         line.length() + 1 + out[i].length() <= maxColumns)
+        line += ";" + out[i];
+     else
+        {
+        if (!line.empty())
+           *prog += line + "\n";
+        line = out[i];
+        }
+     }
+  if (!line.empty())
+     *prog += line + "\n";
+}
+
+/** Counts program lines, labels, and longest line
+  * \param[in] prog      Program with \r separated lines
+  * \param[out] lines    Program lines
+  * \param[out] labels   Program labels
+  * \param[out] columns  Longest line
+*/
+void GalilCodeUsage(const string &prog, unsigned *lines, unsigned *labels, unsigned *columns)
+{
+  unsigned length = 0;	//Current line length
+  size_t i;		//Looping
+
+  *lines = *labels = *columns = 0;
+  for (i = 0; i < prog.length(); i++)
+     {
+     if (prog[i] == '\r')
+        {
+        (*lines)++;
+        *columns = (length > *columns) ? length : *columns;
+        length = 0;
+        }
+     else
+        {
+        if (length == 0 && prog[i] == '#')
+           (*labels)++;
+        length++;
+        }
+     }
+  if (length)
+     {
+     (*lines)++;
+     *columns = (length > *columns) ? length : *columns;
+     }
+}
@@ -0,0 +1,33 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Controller program minification, and program memory usage
+// Minification strips comments, and whitespace, replaces duplicate subroutines with a jump, and merges statements
+// onto shared lines within the controller column limit, so generated code fits small program memory models
+
+#ifndef GalilCodeMinify_H
+#define GalilCodeMinify_H
+
+#include <string>
+
+//Minify program with \n separated lines, lines are kept within maxColumns where statements allow
+void GalilMinifyCode(std::string *prog, unsigned maxColumns);
+//Count lines, labels, and longest line of program with \r separated lines
+void GalilCodeUsage(const std::string &prog, unsigned *lines, unsigned *labels, unsigned *columns);
+
+#endif //GalilCodeMinify_H
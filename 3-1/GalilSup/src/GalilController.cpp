@@ -120,6 +120,7 @@ using namespace std; //cout ostringstream vector string
 #include <epicsString.h>
 #include <iocsh.h>
 #include <epicsThread.h>
+#include <epicsMutex.h>
 #include <epicsExit.h>
 #include <errlog.h>
 #include <initHooks.h>
@@ -144,6 +145,9 @@ static void GalilProfileThreadC(void *pPvt);
 //This change in behaviour is anticipated by the asyn record device layer and causes no error mesgs
 static bool dbInitialized = false;
 
+//Start requests queued by GalilQueueStartController
+static vector<GalilStartRequest> startQueue;
+
 //Static count of Musst controllers.  Used to derive communications port name L(controller num)
 static int controller_num = 0;
 
@@ -326,6 +330,38 @@ GalilController::GalilController(const char *portName, const char *address, doub
   createParam(GalilEthAddrString, asynParamOctet, &GalilEthAddr_);
   createParam(GalilSerialNumString, asynParamOctet, &GalilSerialNum_);
 
+  createParam(GalilLinkHeartbeatString, asynParamFloat64, &GalilLinkHeartbeat_);
+  createParam(GalilLinkStatusString, asynParamInt32, &GalilLinkStatus_);
+  createParam(GalilLinkRecordAgeString, asynParamFloat64, &GalilLinkRecordAge_);
+  createParam(GalilLinkCommandAgeString, asynParamFloat64, &GalilLinkCommandAge_);
+  createParam(GalilLinkRTTString, asynParamFloat64, &GalilLinkRTT_);
+  createParam(GalilLinkRTTMaxString, asynParamFloat64, &GalilLinkRTTMax_);
+  createParam(GalilLinkRTTMeanString, asynParamFloat64, &GalilLinkRTTMean_);
+
+  createParam(GalilCSMotorPathToleranceString, asynParamFloat64, &GalilCSMotorPathTolerance_);
+  createParam(GalilCSMotorPathDeviationString, asynParamFloat64, &GalilCSMotorPathDeviation_);
+  createParam(GalilCSMotorPathSegmentsString, asynParamInt32, &GalilCSMotorPathSegments_);
+  createParam(GalilCSMotorStartSkewString, asynParamFloat64, &GalilCSMotorStartSkew_);
+  createParam(GalilCSMotorVelocityScaleString, asynParamFloat64, &GalilCSMotorVelocityScale_);
+  createParam(GalilCSMotorAccelScaleString, asynParamFloat64, &GalilCSMotorAccelScale_);
+  createParam(GalilCSMotorKinematicErrorsString, asynParamOctet, &GalilCSMotorKinematicErrors_);
+  createParam(GalilCSMotorKinematicErrorCountString, asynParamInt32, &GalilCSMotorKinematicErrorCount_);
+  createParam(GalilProfileSegmentRateString, asynParamFloat64, &GalilProfileSegmentRate_);
+  createParam(GalilProfileLowWaterString, asynParamInt32, &GalilProfileLowWater_);
+  createParam(GalilProfileTypeString, asynParamInt32, &GalilProfileType_);
+  createParam(GalilProfileAccelLimitString, asynParamFloat64, &GalilProfileAccelLimit_);
+  createParam(GalilProfileJerkLimitString, asynParamFloat64, &GalilProfileJerkLimit_);
+  createParam(GalilProfileContourExponentString, asynParamInt32, &GalilProfileContourExponent_);
+  createParam(GalilProfileTimeScaleString, asynParamFloat64, &GalilProfileTimeScale_);
+  createParam(GalilProfileMergeToleranceString, asynParamFloat64, &GalilProfileMergeTolerance_);
+  createParam(GalilProfileCompressionString, asynParamFloat64, &GalilProfileCompression_);
+  createParam(GalilProfileMergeDeviationString, asynParamFloat64, &GalilProfileMergeDeviation_);
+  createParam(GalilProfileArmString, asynParamInt32, &GalilProfileArm_);
+  createParam(GalilProfileArmedString, asynParamInt32, &GalilProfileArmed_);
+  createParam(GalilProfileTriggerInputString, asynParamInt32, &GalilProfileTriggerInput_);
+  createParam(GalilProfileTriggerLevelString, asynParamInt32, &GalilProfileTriggerLevel_);
+  createParam(GalilProfileTriggerLatencyString, asynParamFloat64, &GalilProfileTriggerLatency_);
+
 //Add new parameters here
 
   createParam(GalilCommunicationErrorString, asynParamInt32, &GalilCommunicationError_);
@@ -336,8 +372,26 @@ GalilController::GalilController(const char *portName, const char *address, doub
   strcpy(model_, "Unknown");
   //Code for the controller has not been assembled yet
   code_assembled_ = false;
+  //Upload and compare full program at start, unless user requests fingerprint check
+  fingerprint_check_ = 0;
   //We have not recieved a timeout yet
   consecutive_timeouts_ = 0;
+  //No link round trip time measured yet
+  linkRTT_ = linkRTTMax_ = linkRTTMean_ = 0.0;
+  epicsTimeGetCurrent(&lastRecordTime_);
+  lastCommandTime_ = lastRecordTime_;
+  //No long operation holding lock yet
+  longOperation_ = false;
+  //All real axis are on this controller until GalilCreateRemoteAxis is called
+  for (i = 0; i < MAX_GALIL_AXES; i++)
+     {
+     remote_[i].pC = NULL;
+     remote_[i].axisNo = i;
+     memset(&samples_[i], 0, sizeof(GalilAxisSample));
+     samples_[i].status = asynError;
+     }
+  samplesLock_ = epicsMutexMustCreate();
+  publishSamples_ = false;
   //Store period in ms between data records
   updatePeriod_ = fabs(updatePeriod);
   //Assume sync tcp mode will be used for now
@@ -347,22 +401,39 @@ GalilController::GalilController(const char *portName, const char *address, doub
   //Code generator has not been initialized
   codegen_init_ = false;		
   digitalinput_init_ = false;
+  //Profile input trigger code is enabled by GalilCreateProfile
+  profileInputTrigger_ = false;
   //Deferred moves off at start-up
   movesDeferred_ = false;
   //Store the controller number for later use
   controller_number_ = controller_num;
   //Allocate memory for code buffers.  
   //We put all code for this controller in these buffers.
-  thread_code_ = (char *)calloc(MAX_GALIL_AXES * (THREAD_CODE_LEN),sizeof(char));	
-  limit_code_ = (char *)calloc(MAX_GALIL_AXES * (LIMIT_CODE_LEN),sizeof(char));
-  digital_code_ = (char *)calloc(MAX_GALIL_AXES * (INP_CODE_LEN),sizeof(char));
-  card_code_ = (char *)calloc(MAX_GALIL_AXES * (THREAD_CODE_LEN+LIMIT_CODE_LEN+INP_CODE_LEN),sizeof(char));
-  user_code_ = (char *)calloc(MAX_GALIL_AXES * (THREAD_CODE_LEN+LIMIT_CODE_LEN+INP_CODE_LEN),sizeof(char));
-  //zero code buffers
-  strcpy(thread_code_, "");
-  strcpy(limit_code_, "");
-  strcpy(digital_code_, "");
-  strcpy(card_code_, "");
+  //Buffers are bounded, storage grows only as code is generated
+  thread_code_ = new GalilCodeBuffer(MAX_GALIL_AXES * (THREAD_CODE_LEN));	
+  limit_code_ = new GalilCodeBuffer(MAX_GALIL_AXES * (LIMIT_CODE_LEN));
+  digital_code_ = new GalilCodeBuffer(MAX_GALIL_AXES * (INP_CODE_LEN));
+  card_code_ = new GalilCodeBuffer(MAX_GALIL_AXES * (THREAD_CODE_LEN+LIMIT_CODE_LEN+INP_CODE_LEN));
+  user_code_ = new GalilCodeBuffer(MAX_GALIL_AXES * (THREAD_CODE_LEN+LIMIT_CODE_LEN+INP_CODE_LEN));
+  //Profile storage is allocated by GalilCreateProfile
+  for (i = 0; i < COORDINATE_SYSTEMS; i++)
+	{
+	profiles_[i].index = profiles_[i].coordsys = i;
+	profiles_[i].pC = this;
+	profiles_[i].buffer = new GalilProfileBuffer();
+	profiles_[i].capture = new GalilProfileCapture();
+	profiles_[i].trigger = new GalilProfileTrigger();
+	profiles_[i].times = NULL;
+	profiles_[i].points = 0;
+	profiles_[i].abort = false;
+	profiles_[i].triggerInput = 0;
+	profiles_[i].triggerThread = -1;
+	profiles_[i].triggerStatus = asynSuccess;
+	strcpy(profiles_[i].begin, "");
+	}
+  captureLock_ = epicsMutexMustCreate();
+  streamLock_ = new GalilStreamLock(this);
+  streamTurns_ = new GalilProfileTurn(streamLock_, PROFILE_TURN_TIMEOUT);
  
   //Set defaults in Paramlist before connect
   setParamDefaults();
@@ -376,14 +447,18 @@ GalilController::GalilController(const char *portName, const char *address, doub
   //Create connector thread that manages connection status flags
   connector_ = new GalilConnector(this);
 
-  // Create the event that wakes up the thread for profile moves
-  profileExecuteEvent_ = epicsEventMustCreate(epicsEventEmpty);
-  
-  // Create the thread that will execute profile moves
-  epicsThreadCreate("GalilProfile", 
+  // Create the threads that will execute profile moves, one for each profile context
+  for (i = 0; i < COORDINATE_SYSTEMS; i++)
+	{
+	// Create the events that wake up the thread for profile moves
+	profiles_[i].executeEvent = epicsEventMustCreate(epicsEventEmpty);
+	profiles_[i].streamEvent = epicsEventMustCreate(epicsEventEmpty);
+	profiles_[i].triggerEvent = epicsEventMustCreate(epicsEventEmpty);
+	epicsThreadCreate((i) ? "GalilProfile1" : "GalilProfile0", 
                     epicsThreadPriorityLow,
                     epicsThreadGetStackSize(epicsThreadStackMedium),
-                    (EPICSTHREADFUNC)GalilProfileThreadC, (void *)this);
+                    (EPICSTHREADFUNC)GalilProfileThreadC, (void *)&profiles_[i]);
+	}
                     
   //Initialize the motor enables struct in GalilController instance
   for (i=0;i<8;i++)
@@ -556,7 +631,29 @@ void GalilController::shutdownController()
       }
 
    //Free the memory where card code is stored
-   free(card_code_);
+   delete card_code_;
+   card_code_ = NULL;
+   //Free code generator buffers if controller was never started
+   delete thread_code_;
+   delete limit_code_;
+   delete digital_code_;
+   delete user_code_;
+   thread_code_ = limit_code_ = digital_code_ = user_code_ = NULL;
+   //Free profile storage
+   for (i = 0; i < COORDINATE_SYSTEMS; i++)
+      {
+      delete profiles_[i].buffer;
+      profiles_[i].buffer = NULL;
+      delete profiles_[i].capture;
+      profiles_[i].capture = NULL;
+      delete profiles_[i].trigger;
+      profiles_[i].trigger = NULL;
+      free(profiles_[i].times);
+      profiles_[i].times = NULL;
+      }
+   epicsMutexDestroy(captureLock_);
+   delete streamTurns_;
+   delete streamLock_;
 
    //Free any GalilAxis, and GalilCSAxis instances
    for (i = 0; i < MAX_GALIL_AXES + MAX_GALIL_CSAXES; i++)
@@ -614,11 +711,62 @@ void GalilController::setParamDefaults(void)
 	setIntegerParam(i, GalilOutputCompareAxis_, 0);
   setStringParam(GalilSerialNum_, "");
   setStringParam(GalilEthAddr_, "");
+  //No PVT profile acceleration, or jerk limit beyond controller limit
+  for (i = 0; i < MAX_GALIL_AXES; i++)
+     {
+     setDoubleParam(i, GalilProfileAccelLimit_, 0.0);
+     setDoubleParam(i, GalilProfileJerkLimit_, 0.0);
+     }
   //Default all forward kinematics to null strings
+  //Path mode off
   for (i = MAX_GALIL_CSAXES; i < MAX_GALIL_AXES + MAX_GALIL_CSAXES; i++)
+     {
      setStringParam(i, GalilCSMotorForward_, "");
+     setDoubleParam(i, GalilCSMotorPathTolerance_, 0.0);
+     setDoubleParam(i, GalilCSMotorPathDeviation_, 0.0);
+     setIntegerParam(i, GalilCSMotorPathSegments_, 0);
+     setDoubleParam(i, GalilCSMotorStartSkew_, 0.0);
+     setDoubleParam(i, GalilCSMotorVelocityScale_, 1.0);
+     setDoubleParam(i, GalilCSMotorAccelScale_, 1.0);
+     setStringParam(i, GalilCSMotorKinematicErrors_, "");
+     setIntegerParam(i, GalilCSMotorKinematicErrorCount_, 0);
+     }
   //Default controller error message to null string
   setStringParam(0, GalilCtrlError_, "");
+  //Heartbeat off, link lost until connected
+  setDoubleParam(GalilLinkHeartbeat_, 0.0);
+  setIntegerParam(GalilLinkStatus_, LINK_LOST);
+  setDoubleParam(GalilLinkRecordAge_, 0.0);
+  setDoubleParam(GalilLinkCommandAge_, 0.0);
+  setDoubleParam(GalilLinkRTT_, 0.0);
+  setDoubleParam(GalilLinkRTTMax_, 0.0);
+  setDoubleParam(GalilLinkRTTMean_, 0.0);
+  //Profile on S, and T each have their own context at address 0, and 1
+  for (i = 0; i < COORDINATE_SYSTEMS; i++)
+     {
+     //No profile built, executed, or read back yet
+     setStringParam(i, GalilProfileFile_, "");
+     setIntegerParam(i, profileNumPoints_, 0);
+     setIntegerParam(i, profileBuildState_, PROFILE_BUILD_DONE);
+     setIntegerParam(i, profileExecuteState_, PROFILE_EXECUTE_DONE);
+     setIntegerParam(i, profileReadbackState_, PROFILE_READBACK_DONE);
+     setDoubleParam(i, GalilProfileSegmentRate_, 0.0);
+     setIntegerParam(i, GalilProfileLowWater_, 0);
+     setIntegerParam(i, GalilProfileType_, PROFILE_TYPE_LINEAR);
+     //Contour profile slice time 2^3 samples
+     setIntegerParam(i, GalilProfileContourExponent_, 3);
+     //No profile checked yet
+     setDoubleParam(i, GalilProfileTimeScale_, 1.0);
+     //Linear segments are not merged
+     setDoubleParam(i, GalilProfileMergeTolerance_, 0.0);
+     setDoubleParam(i, GalilProfileCompression_, 1.0);
+     setDoubleParam(i, GalilProfileMergeDeviation_, 0.0);
+     //Profiles begin on execute, rather than digital input, once armed
+     setIntegerParam(i, GalilProfileArmed_, 0);
+     setIntegerParam(i, GalilProfileTriggerInput_, 0);
+     setIntegerParam(i, GalilProfileTriggerLevel_, 1);
+     setDoubleParam(i, GalilProfileTriggerLatency_, 0.0);
+     }
 }
 
 // extract the controller ethernet address from the output of the galil TH command
@@ -645,6 +793,11 @@ void GalilController::connected(void)
   //Flag connected as true
   connected_ = true;
   setIntegerParam(GalilCommunicationError_, 0);
+  //Start link health tracking from now
+  epicsTimeGetCurrent(&lastRecordTime_);
+  lastCommandTime_ = lastRecordTime_;
+  linkRTT_ = linkRTTMax_ = linkRTTMean_ = 0.0;
+  setIntegerParam(GalilLinkStatus_, LINK_OK);
   //Load model, and firmware query into cmd structure
   strcpy(cmd_, RV);
   //Query model, and firmware version
@@ -740,7 +893,7 @@ void GalilController::connected(void)
      poller_->sleepPoller();
      lock();
      //Deliver and start the code on controller
-     GalilStartController(code_file_, burn_program_, 0, thread_mask_);
+     GalilStartController(code_file_, burn_program_, 0, thread_mask_, fingerprint_check_);
      }
 
   //Try async udp mode unless user specfically wants sync tcp mode
@@ -840,6 +993,286 @@ GalilCSAxis* GalilController::getCSAxis(int axisNo)
   return static_cast<GalilCSAxis*>(asynMotorController::getAxis(axisNo));
 }
 
+/** Retrieve kinematic data for all real and coordinate system axis, and kinematic variables
+  * One set of ParamList lookups serves every csaxis transform that uses the snapshot
+  * \param[out] snap - Kinematic snapshot
+  */
+void GalilController::buildKinematicSnapshot(GalilKinematicSnapshot *snap)
+{
+  double mpos, epos;	//Motor, and encoder readback data
+  GalilAxisSample sample;	//Real axis data from another controller
+  unsigned i;		//Looping
+
+  for (i = 0; i < MAX_GALIL_AXES + MAX_GALIL_CSAXES; i++)
+     {
+     //Get the readbacks for the axis
+     snap->axisStatus[i] = getDoubleParam(i, motorEncoderPosition_, &epos);
+     snap->axisStatus[i] |= getDoubleParam(i, motorPosition_, &mpos);
+     //Retrieve needed motor record fields
+     snap->axisStatus[i] |= getDoubleParam(i, motorResolution_, &snap->mres[i]);
+     snap->axisStatus[i] |= getDoubleParam(i, GalilEncoderResolution_, &snap->eres[i]);
+     snap->axisStatus[i] |= getIntegerParam(i, GalilUseEncoder_, &snap->ueip[i]);
+     //Readback in egu dial coordinates
+     snap->readback[i] = (snap->ueip[i]) ? (epos * snap->eres[i]) : (mpos * snap->mres[i]);
+     }
+
+  //Real axis bound to other controllers
+  //Readbacks are extrapolated to the time of this controller's data record
+  //so transforms see real axis positions at the same instant
+  for (i = 0; i < MAX_GALIL_AXES; i++)
+     {
+     if (!remote_[i].pC) continue;
+     getAxisSample(i, &sample);
+     snap->axisStatus[i] = sample.status;
+     snap->mres[i] = sample.mres;
+     snap->eres[i] = sample.eres;
+     snap->ueip[i] = sample.ueip;
+     snap->readback[i] = sample.readback + sample.velocity * epicsTimeDiffInSeconds(&lastRecordTime_, &sample.time);
+     }
+
+  //Kinematic variables Q-Z stored in addr 0-9
+  for (i = 0; i < MAX_GALIL_VARS; i++)
+     snap->varStatus[i] = getDoubleParam(i, GalilCSMotorVariable_, &snap->variables[i]);
+
+  snap->valid = true;
+}
+
+/** Evaluate forward kinematics for all cs axis together using this cycle's kinematic snapshot
+  * Transforms with the same program shape are evaluated in one pass
+  * Each GalilCSAxis::poll then only stores its result
+  */
+void GalilController::batchForwardTransforms(void)
+{
+  GalilCSAxis *pCSAxis[MAX_GALIL_CSAXES];	//Cs axis needing evaluation
+  const GalilTransform *calc[MAX_GALIL_CSAXES];	//Forward transforms to evaluate
+  double *args[MAX_GALIL_CSAXES];		//Arguments for each transform
+  double result[MAX_GALIL_CSAXES];		//Result for each transform
+  bool done[MAX_GALIL_CSAXES];			//Transform was evaluated in batch
+  unsigned n = 0;				//Number of transforms to evaluate
+  unsigned i;					//Looping
+
+  for (i = MAX_GALIL_AXES; i < MAX_GALIL_AXES + MAX_GALIL_CSAXES; i++)
+     {
+     pCSAxis[n] = getCSAxis(i);
+     if (!pCSAxis[n]) continue;
+     if ((calc[n] = pCSAxis[n]->prepareForwardTransform(&args[n])) != NULL)
+        n++;
+     }
+
+  GalilTransform::evaluateBatch(calc, args, result, done, n, batchRegisters_);
+
+  for (i = 0; i < n; i++)
+     pCSAxis[i]->completeForwardTransform(done[i], result[i]);
+}
+
+/** Bind a real axis letter on this controller to an axis on another controller
+  * Coordinate system axis on this controller may then use the axis in transforms
+  * Bindings must not form a cycle, directly or through other controllers
+  * \param[in] axis - Axis letter A-H on this controller, must not be created by GalilCreateAxis
+  * \param[in] remotePort - Asyn port of the other controller
+  * \param[in] remoteAxis - Axis letter A-H on the other controller, must be created by GalilCreateAxis
+  */
+asynStatus GalilController::createRemoteAxis(char axis, const char *remotePort, char remoteAxis)
+{
+  static const char *functionName = "createRemoteAxis";
+  GalilController *pRC;		//The other controller
+  int axisNo = toupper(axis) - AASCII;		//Axis number on this controller
+  int remoteNo = toupper(remoteAxis) - AASCII;	//Axis number on the other controller
+
+  if (axisNo < 0 || axisNo >= MAX_GALIL_AXES || remoteNo < 0 || remoteNo >= MAX_GALIL_AXES)
+     {
+     printf("%s:%s: Error axis must be A-H\n", driverName, functionName);
+     return asynError;
+     }
+
+  if (getAxis(axisNo))
+     {
+     printf("%s:%s: Error axis %c already created on port %s\n", driverName, functionName, axisNo + AASCII, portName);
+     return asynError;
+     }
+
+  //Retrieve the other controller
+  pRC = (GalilController*) findAsynPortDriver(remotePort);
+  if (!pRC || pRC == this)
+     {
+     printf("%s:%s: Error port %s not found, or same as %s\n", driverName, functionName, remotePort, portName);
+     return asynError;
+     }
+
+  if (!pRC->getAxis(remoteNo))
+     {
+     printf("%s:%s: Error axis %c not created on port %s\n", driverName, functionName, remoteNo + AASCII, remotePort);
+     return asynError;
+     }
+
+  //Other controller must not use axis on this controller, directly or through other controllers
+  if (pRC->usesController(this))
+     {
+     printf("%s:%s: Error port %s already uses axis on port %s, binding would form a cycle\n", driverName, functionName, remotePort, portName);
+     return asynError;
+     }
+
+  //Bind the axis
+  remote_[axisNo].pC = pRC;
+  remote_[axisNo].axisNo = remoteNo;
+  //Other controller now publishes axis data each poll cycle
+  pRC->publishSamples_ = true;
+
+  return asynSuccess;
+}
+
+/** Controller, and axis number on that controller, for a real axis on this controller
+  * \param[in] axis - Real axis number on this controller
+  * \param[out] axisNo - Axis number on returned controller
+  * \return Controller the axis belongs to
+  */
+GalilController *GalilController::realController(int axis, int *axisNo)
+{
+  if (axis >= 0 && axis < MAX_GALIL_AXES && remote_[axis].pC)
+     {
+     *axisNo = remote_[axis].axisNo;
+     return remote_[axis].pC;
+     }
+  *axisNo = axis;
+  return this;
+}
+
+/** Does this controller use axis on another controller, directly or through other controllers
+  * Bindings never form a cycle, so the search ends
+  * \param[in] pC - Controller to look for
+  */
+bool GalilController::usesController(GalilController *pC)
+{
+  unsigned i;	//Looping
+
+  for (i = 0; i < MAX_GALIL_AXES; i++)
+     if (remote_[i].pC && (remote_[i].pC == pC || remote_[i].pC->usesController(pC)))
+        return true;
+
+  return false;
+}
+
+//Sort controllers by port name, the global order controller locks are taken in
+static void sortControllers(GalilController *ctrl[], unsigned n, GalilController *sorted[])
+{
+  GalilController *pC;	//Controller being inserted
+  unsigned i, j;	//Looping
+
+  for (i = 0; i < n; i++)
+     {
+     pC = ctrl[i];
+     for (j = i; j > 0 && strcmp(sorted[j - 1]->portName, pC->portName) > 0; j--)
+        sorted[j] = sorted[j - 1];
+     sorted[j] = pC;
+     }
+}
+
+/** Lock several controllers in port name order
+  * Threads locking overlapping sets of controllers then never deadlock
+  * Lock of held controller is released, and taken again in order, so state read under it must be re-read
+  * \param[in] ctrl - Different controllers to lock, including the held controller
+  * \param[in] n - Number of controllers, at most MAX_GALIL_AXES
+  * \param[in] held - Controller whose lock the caller holds, or NULL
+  */
+void GalilController::lockControllers(GalilController *ctrl[], unsigned n, GalilController *held)
+{
+  GalilController *sorted[MAX_GALIL_AXES];	//Controllers in lock order
+  unsigned i;					//Looping
+
+  sortControllers(ctrl, n, sorted);
+  if (held)
+     held->unlock();
+  for (i = 0; i < n; i++)
+     sorted[i]->lock();
+}
+
+/** Unlock controllers locked by lockControllers, the caller keeps the lock of held controller
+  * \param[in] ctrl - Controllers to unlock, including the held controller
+  * \param[in] n - Number of controllers
+  * \param[in] held - Controller whose lock the caller keeps, or NULL
+  */
+void GalilController::unlockControllers(GalilController *ctrl[], unsigned n, GalilController *held)
+{
+  unsigned i;	//Looping
+
+  for (i = 0; i < n; i++)
+     if (ctrl[i] != held)
+        ctrl[i]->unlock();
+}
+
+/** Retrieve real axis data from ParamList
+  * \param[in] axis - Real axis number
+  * \param[out] sample - Axis data, velocity is not estimated
+  */
+void GalilController::sampleAxis(int axis, GalilAxisSample *sample)
+{
+  double mpos, epos;	//Motor, and encoder readback data
+
+  //Get the readbacks for the axis
+  sample->status = getDoubleParam(axis, motorEncoderPosition_, &epos);
+  sample->status |= getDoubleParam(axis, motorPosition_, &mpos);
+  //Retrieve needed motor record fields
+  sample->status |= getDoubleParam(axis, motorResolution_, &sample->mres);
+  sample->status |= getDoubleParam(axis, GalilEncoderResolution_, &sample->eres);
+  sample->status |= getIntegerParam(axis, GalilUseEncoder_, &sample->ueip);
+  sample->status |= getDoubleParam(axis, GalilMotorVmax_, &sample->vmax);
+  //Retrieve status
+  sample->status |= getIntegerParam(axis, motorStatusMoving_, &sample->moving);
+  sample->status |= getIntegerParam(axis, motorStatusSlip_, &sample->slipstall);
+  sample->status |= getIntegerParam(axis, motorStatusLowLimit_, &sample->lowLimit);
+  sample->status |= getIntegerParam(axis, motorStatusHighLimit_, &sample->highLimit);
+  //Readback in egu dial coordinates
+  sample->readback = (sample->ueip) ? (epos * sample->eres) : (mpos * sample->mres);
+  sample->velocity = 0.0;
+  sample->time = lastRecordTime_;
+}
+
+/** Retrieve real axis data for an axis on this controller, or the other controller it is bound to
+  * \param[in] axis - Real axis number
+  * \param[out] sample - Axis data
+  */
+void GalilController::getAxisSample(int axis, GalilAxisSample *sample)
+{
+  int axisNo;			//Axis number on controller axis belongs to
+  GalilController *pRC = realController(axis, &axisNo);
+
+  if (pRC == this)
+     {
+     //Axis is on this controller
+     sampleAxis(axis, sample);
+     return;
+     }
+
+  //Axis is on another controller, use data published by its poller
+  epicsMutexLock(pRC->samplesLock_);
+  *sample = pRC->samples_[axisNo];
+  epicsMutexUnlock(pRC->samplesLock_);
+}
+
+/** Publish real axis data for cs axis on other controllers
+  * Called by GalilPoller after real axis are polled, when another controller has bound an axis here
+  * Velocity is estimated from successive samples so readers can align readbacks in time
+  */
+void GalilController::publishAxisSamples(void)
+{
+  GalilAxisSample sample;	//New sample
+  double dt;			//Time between samples
+  unsigned i;			//Looping
+
+  for (i = 0; i < MAX_GALIL_AXES; i++)
+     {
+     sampleAxis(i, &sample);
+     epicsMutexLock(samplesLock_);
+     dt = epicsTimeDiffInSeconds(&sample.time, &samples_[i].time);
+     if (!sample.status && !samples_[i].status && dt > 0.0)
+        sample.velocity = (sample.readback - samples_[i].readback) / dt;
+     else if (dt == 0.0)
+        sample.velocity = samples_[i].velocity;
+     samples_[i] = sample;
+     epicsMutexUnlock(samplesLock_);
+     }
+}
+
 /** Returns true if any motor in the provided list is moving
   * \param[in] Motor list
   */
@@ -1079,351 +1512,1002 @@ asynStatus GalilController::setOutputCompare(int oc)
   return (asynStatus)comstatus;
 }
 
-//Creates a profile data file suitable for use with linear interpolation mode
-asynStatus GalilController::buildLinearProfile()
+/** Include armed profile input trigger code #PTRIG in controller code generated after this
+  * Input trigger code runs on the highest numbered controller thread, which must not be used by an axis
+  * \param[in] enable - Generate input trigger code
+  */
+void GalilController::setProfileInputTrigger(bool enable)
+{
+  profileInputTrigger_ = enable;
+}
+
+/** Allocate profile arrays, and storage for built profiles
+  * \param[in] maxPoints - Maximum number of profile points
+  */
+asynStatus GalilController::initializeProfile(size_t maxPoints)
+{
+  unsigned i;
+  static const char *functionName = "initializeProfile";
+
+  //Base class allocates profile time, position, and readback arrays
+  asynMotorController::initializeProfile(maxPoints);
+
+  for (i = 0; i < COORDINATE_SYSTEMS; i++)
+	{
+	//Built profile has a segment for each point after the first
+	//Point times are kept with the built profile for readback
+	free(profiles_[i].times);
+	profiles_[i].times = (double *)calloc(maxPoints, sizeof(double));
+	profiles_[i].points = 0;
+	if (!profiles_[i].times || !profiles_[i].buffer->allocate(maxPoints))
+		{
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s: %s failed to allocate profile storage for %lu points\n",
+			driverName, functionName, portName, (unsigned long)maxPoints);
+		return asynError;
+		}
+
+	//Data record capture for profile readback
+	epicsMutexLock(captureLock_);
+	if (!profiles_[i].capture->allocate(maxPoints * PROFILE_CAPTURE_RECORDS_PER_POINT))
+		{
+		epicsMutexUnlock(captureLock_);
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s: %s failed to allocate profile capture storage for %lu points\n",
+			driverName, functionName, portName, (unsigned long)maxPoints);
+		return asynError;
+		}
+	epicsMutexUnlock(captureLock_);
+	}
+
+  return asynSuccess;
+}
+
+//Builds profile segments suitable for use with linear interpolation mode
+//Segments are stored in the profile context buffer
+//ParamList is read once before the point loop, GalilProfileBuffer::buildLinear works on the profile axis list only
+asynStatus GalilController::buildLinearProfile(GalilProfileContext *prof)
 {
   GalilAxis *pAxis;				//GalilAxis instance
   int nPoints;					//Number of points in profile
-  double velocity[MAX_GALIL_AXES];		//Motor velocity
-  double maxAllowedVelocity[MAX_GALIL_AXES];    //Derived from MR VMAX to ensure motor velocities are within limits
-  double maxProfileVelocity[MAX_GALIL_AXES];    //The highest velocity for each motor in the profile data
-  double maxProfilePosition[MAX_GALIL_AXES];	//Maximum profile position in absolute mode
-  double minProfilePosition[MAX_GALIL_AXES];	//Minimum profile position in absolute mode
-  double maxProfileAcceleration[MAX_GALIL_AXES];//Maximum profile acceleration in any mode
-  double vectorVelocity;			//Segment vector velocity
-  double incmove = 0.0;				//Motor incremental move distance
-  double firstmove[MAX_GALIL_AXES];	//Used to normalize moves to relative, and prevent big jumps at profile start			
-  double apos[MAX_GALIL_AXES];		//Accumulated profile position calculated from integer rounded units (ie. steps/counts)
-  double aerr[MAX_GALIL_AXES];		//Accumulated error
-  int i, j;			        //Loop counters
-  int zm_count;				//Zero segment move counter
-  int num_motors;			//Number of motors in trajectory
-  char message[MAX_GALIL_STRING_SIZE];	//Profile build message
-  int useAxis[MAX_GALIL_AXES];		//Use axis flag for profile moves
-  int moveMode[MAX_GALIL_AXES];		//Move mode absolute or relative
-  char moves[MAX_GALIL_STRING_SIZE];	//Segment move command assembled for controller
-  char axes[MAX_GALIL_AXES];		//Motors involved in profile move
-  char startp[MAX_GALIL_STRING_SIZE];	//Profile start positions written to file
-  char fileName[MAX_FILENAME_LEN];	//Filename to write profile data to
-  FILE *profFile;			//File handle for above file
-  bool buildOK=true;			//Was the trajectory built successfully
+  GalilProfileMotor motors[MAX_GALIL_AXES];	//Motors in profile, limits, and statistics in steps
+  double startp[MAX_GALIL_AXES];		//Profile start positions
+  double tolerance;			//Segment merge tolerance, steps/counts.  0 no merge
+  double deviation = 0.0;		//Largest deviation of merged segments from profile, steps/counts
   double mres;				//Motor resolution
+  size_t segments;			//Segments before merge
+  int j, k;			        //Loop counters
+  int num_motors = 0;			//Number of motors in trajectory
+  char message[MAX_GALIL_STRING_SIZE];	//Profile build message
+  int useAxis;				//Use axis flag for profile moves
+  int moveMode;				//Move mode absolute or relative
+  char axes[MAX_GALIL_AXES + 1];	//Motors involved in profile move
+  bool buildOK;				//Was the trajectory built successfully
   
-  //No axis included yet
-  strcpy(axes, "");
+  // Retrieve required attributes from ParamList
+  getIntegerParam(prof->index, profileNumPoints_, &nPoints);
+  getDoubleParam(prof->index, GalilProfileMergeTolerance_, &tolerance);
+
+  //Construct axes list, and retrieve motor attributes once for the whole profile
+  for (j=0; j<MAX_GALIL_AXES; j++)
+	{
+	//Motor not in profile yet
+	startp[j] = 0.0;
+	//Retrieve GalilAxis
+	pAxis = getAxis(j);
+	//Retrieve profileUseAxis_ from ParamList
+	useAxis = 0;
+	getIntegerParam(j, profileUseAxis_, &useAxis);
+	//Decide to process this axis, or skip
+	if (!useAxis || !pAxis) continue;
+	k = num_motors++;
+	motors[k].axisNo = j;
+	axes[k] = (char)(j + AASCII);
+	motors[k].positions = pAxis->profilePositions_;
+	//Start position
+	startp[j] = rint(motors[k].positions[0]);
+	//Retrieve motor resolution
+	getDoubleParam(j, motorResolution_, &motors[k].mres);
+	//Retrieve the motor maxVelocity in egu, and calculate velocity in steps
+	getDoubleParam(j, GalilMotorVmax_, &motors[k].maxVelocity);
+	motors[k].maxVelocity = fabs(motors[k].maxVelocity / motors[k].mres);
+	//Retrieve GalilProfileMoveMode_ from ParamList
+	//Soft limits are checked in absolute move mode only
+	getIntegerParam(j, GalilProfileMoveMode_, &moveMode);
+	motors[k].lowLimit = (moveMode) ? pAxis->lowLimit_ : -DBL_MAX;
+	motors[k].highLimit = (moveMode) ? pAxis->highLimit_ : DBL_MAX;
+	}
+  axes[num_motors] = '\0';
 
-  //Start position list for all motors in the profile
-  strcpy(startp, "");
+  //Store axes list, and start positions
+  prof->buffer->setAxes(axes, startp);
 
-  // Retrieve required attributes from ParamList
-  getStringParam(GalilProfileFile_, (int)sizeof(fileName), fileName);
-  getIntegerParam(profileNumPoints_, &nPoints);
+  //Calculate motor segment velocities from profile positions, and common time base
+  buildOK = prof->buffer->buildLinear(motors, num_motors, prof->times, nPoints, message, sizeof(message));
 
-  //Check provided fileName
-  if (!abs(strcmp(fileName, "")))
+  //Build failed.  
+  if (!buildOK)
 	{
-	strcpy(message, "Bad trajectory file name");
+	//Update build message
+  	setStringParam(prof->index, profileBuildMessage_, message);
 	return asynError;
 	}
 
-  /* Create the profile file */
-  profFile =  fopen(fileName, "wt");
+  //Merge runs of segments within tolerance of a line, each merged segment saves a controller buffer slot
+  segments = prof->buffer->segments();
+  if (tolerance > 0)
+	deviation = prof->buffer->merge(tolerance);
+  //Compression ratio, and largest deviation from profile
+  setDoubleParam(prof->index, GalilProfileCompression_, (prof->buffer->segments()) ? (double)segments / prof->buffer->segments() : 1.0);
+  setDoubleParam(prof->index, GalilProfileMergeDeviation_, deviation);
+
+  //Update profile ParamList attributes, statistics are converted from steps to egu
+  for (k=0; k<num_motors; k++)
+	{
+	pAxis = getAxis(motors[k].axisNo);
+	mres = motors[k].mres;
+	pAxis->setDoubleParam(GalilProfileMinPosition_, (mres >= 0) ? motors[k].minPosition * mres : motors[k].maxPosition * mres);
+	pAxis->setDoubleParam(GalilProfileMaxPosition_, (mres >= 0) ? motors[k].maxPosition * mres : motors[k].minPosition * mres);
+	pAxis->setDoubleParam(GalilProfileMaxVelocity_, motors[k].maxProfileVelocity * fabs(mres));
+	pAxis->setDoubleParam(GalilProfileMaxAcceleration_, motors[k].maxProfileAcceleration * fabs(mres));
+	pAxis->callParamCallbacks();
+	}
+
+  //Profile is ready to execute
+  prof->buffer->setType(PROFILE_LINEAR);
+
+  return asynSuccess;
+}
+
+//Builds PVT profile segments for use with controller PVT mode, or contour mode
+//Positions, and times are taken from the profile arrays
+//Velocities at each point are derived from the adjacent segment slopes weighted by segment time
+//Profile starts, and ends at rest.  Motion between points is cubic, so velocity is continuous at every point
+//Segments are stored in the profile context buffer
+asynStatus GalilController::buildPVTProfile(GalilProfileContext *prof)
+{
+  GalilAxis *pAxis;				//GalilAxis instance
+  int nPoints;					//Number of points in profile
+  double maxAllowedVelocity[MAX_GALIL_AXES];    //Derived from MR VMAX, steps
+  double maxAllowedAcceleration[MAX_GALIL_AXES];//From controller, and GalilProfileAccelLimit_, steps
+  double maxAllowedJerk[MAX_GALIL_AXES];	//From GalilProfileJerkLimit_, steps.  0 no limit
+  double maxProfileVelocity[MAX_GALIL_AXES];    //The highest velocity for each motor in the profile data, steps
+  double maxProfilePosition[MAX_GALIL_AXES];	//Maximum profile position, steps
+  double minProfilePosition[MAX_GALIL_AXES];	//Minimum profile position, steps
+  double maxProfileAcceleration[MAX_GALIL_AXES];//Maximum profile acceleration, steps
+  double lowLimit[MAX_GALIL_AXES];		//Soft limits checked, absolute move mode only
+  double highLimit[MAX_GALIL_AXES];
+  double mres[MAX_GALIL_AXES];			//Motor resolution
+  const double *positions[MAX_GALIL_AXES];	//Profile positions for each motor
+  int axisNo[MAX_GALIL_AXES];			//Axis number of each motor in profile
+  double startp[MAX_GALIL_AXES];		//Profile start positions
+  double v0[MAX_GALIL_AXES];			//Segment start velocity
+  double v1[MAX_GALIL_AXES];			//Segment end velocity
+  double moves[MAX_GALIL_AXES];			//Segment, or segment piece move indexed by axis number
+  double velocities[MAX_GALIL_AXES];		//Segment, or segment piece end velocity indexed by axis number
+  double sent[MAX_GALIL_AXES];			//Position of segment pieces stored so far relative to segment start
+  double pieceMoves[MAX_GALIL_AXES];		//Segment piece move indexed by axis number
+  double pieceVelocities[MAX_GALIL_AXES];	//Segment piece end velocity indexed by axis number
+  double limit;					//Limit in egu
+  double sampleTime;				//Controller sample time
+  long samples, nextSamples;			//Segment time, and next segment time in samples
+  long minSamples = 0;				//Shortest segment in samples
+  long boundary, elapsed;			//Segment piece end, and segment pieces stored so far in samples
+  int pieces, piece;				//Pieces segment is split into to suit controller PVT time limit
+  double h, hn;					//Segment, and next segment time in seconds
+  double delta, deltan;				//Segment, and next segment move
+  double c, d;					//Segment cubic coefficients
+  double t;					//Time within segment
+  double acc, jerk, peak;			//Segment max acceleration, jerk, and velocity
+  int exponent;					//Contour slice time exponent
+  int i, j, k;					//Loop counters
+  int num_motors = 0;				//Number of motors in trajectory
+  char message[MAX_GALIL_STRING_SIZE];		//Profile build message
+  int useAxis;					//Use axis flag for profile moves
+  int moveMode;					//Move mode absolute or relative
+  char axes[MAX_GALIL_AXES + 1];		//Motors involved in profile move
+  bool buildOK = true;				//Was the trajectory built successfully
+
+  // Retrieve required attributes from ParamList
+  getIntegerParam(prof->index, profileNumPoints_, &nPoints);
 
-  //Write profile type
-  fprintf(profFile,"LINEAR\n");
+  //Controller sample time, segment times are whole samples
+  sampleTime = controllerSampleTime();
+  prof->buffer->setSampleTime(sampleTime);
 
-  //Zero variables, contruct axes, start position, and maxVelocity lists 
+  //Construct axes list, and retrieve motor attributes once for the whole profile
   for (j=0; j<MAX_GALIL_AXES; j++)
 	{
+	//Motor not in profile yet
+	moves[j] = velocities[j] = pieceMoves[j] = pieceVelocities[j] = startp[j] = 0.0;
 	//Retrieve GalilAxis
 	pAxis = getAxis(j);
 	//Retrieve profileUseAxis_ from ParamList
-	getIntegerParam(j, profileUseAxis_, &useAxis[j]);
+	useAxis = 0;
+	getIntegerParam(j, profileUseAxis_, &useAxis);
 	//Decide to process this axis, or skip
-	if (!useAxis[j] || !pAxis) continue;
-	//Initialize accumulated position, and error
-	apos[j] = aerr[j] = velocity[j] = 0;
-	//Construct axis list
-	sprintf(axes,"%s%c", axes, (char)(j + AASCII));
-	//Construct start positions list
-	sprintf(startp,"%s%.0lf,", startp, rint(pAxis->profilePositions_[0]));
-	//Retrieve the motor maxVelocity in egu
-	getDoubleParam(j, GalilMotorVmax_, &maxAllowedVelocity[j]);
+	if (!useAxis || !pAxis) continue;
+	k = num_motors++;
+	axisNo[k] = j;
+	axes[k] = (char)(j + AASCII);
+	positions[k] = pAxis->profilePositions_;
+	//Start position
+	startp[j] = rint(positions[k][0]);
 	//Retrieve motor resolution
-	getDoubleParam(j, motorResolution_, &mres);
-	//Calculate velocity in steps
-	maxAllowedVelocity[j] = maxAllowedVelocity[j] / mres;
+	getDoubleParam(j, motorResolution_, &mres[k]);
+	//Retrieve the motor maxVelocity in egu, and calculate velocity in steps
+	getDoubleParam(j, GalilMotorVmax_, &maxAllowedVelocity[k]);
+	maxAllowedVelocity[k] = fabs(maxAllowedVelocity[k] / mres[k]);
+	//Acceleration limit is the controller limit, or user limit if lower
+	maxAllowedAcceleration[k] = (double)modelMaxAcceleration();
+	getDoubleParam(j, GalilProfileAccelLimit_, &limit);
+	if (limit > 0 && fabs(limit / mres[k]) < maxAllowedAcceleration[k])
+		maxAllowedAcceleration[k] = fabs(limit / mres[k]);
+	//Jerk limit, 0 no limit
+	getDoubleParam(j, GalilProfileJerkLimit_, &limit);
+	maxAllowedJerk[k] = fabs(limit / mres[k]);
 	//Retrieve GalilProfileMoveMode_ from ParamList
-	getIntegerParam(j, GalilProfileMoveMode_, &moveMode[j]);
-	//Initialize max profile velocity, position, and acceleration
-	maxProfileVelocity[j] = maxProfilePosition[j] = maxProfileAcceleration[j] = 0;
-	//Initialize min profile position
-	minProfilePosition[j] = DBL_MAX;
+	//Soft limits are checked in absolute move mode only
+	getIntegerParam(j, GalilProfileMoveMode_, &moveMode);
+	lowLimit[k] = (moveMode) ? pAxis->lowLimit_ : -DBL_MAX;
+	highLimit[k] = (moveMode) ? pAxis->highLimit_ : DBL_MAX;
+	//Profile starts at rest
+	v0[k] = v1[k] = 0.0;
+	//Initialize profile statistics
+	//Position range is set from the first point
+	maxProfileVelocity[k] = maxProfileAcceleration[k] = 0.0;
+	maxProfilePosition[k] = minProfilePosition[k] = (nPoints > 0) ? positions[k][0] : 0.0;
+	if (nPoints > 0 && (positions[k][0] < lowLimit[k] || positions[k][0] > highLimit[k]))
+		{
+		sprintf(message, "Motor %c position beyond soft limits in segment %d", axes[k], 0);
+		buildOK = false;
+		}
 	}
+  axes[num_motors] = '\0';
 
-  //Write axes list
-  fprintf(profFile,"%s\n", axes);
-
-  //Write start positions list
-  fprintf(profFile,"%s\n", startp);
+  //Store axes list, and start positions
+  prof->buffer->setAxes(axes, startp);
 
-  //Determine number of motors in profile move
-  num_motors = (int)strlen(axes);
+  //Segment times are an even number of samples so contour slices end exactly on the profile end
+  nextSamples = (nPoints > 1) ? 2 * (long)rint(prof->times[1] / sampleTime / 2.0) : 0;
 
-  //Calculate motor segment velocities from profile positions, and common time base
-  for (i=0; i<nPoints; i++)
-  	{
-	//No controller moves assembled yet for this segment
-  	strcpy(moves, "");
-	//velocity for this segment
-	vectorVelocity = 0.0;
-	//motors with zero moves for this segment
-	zm_count = 0;
-	//Calculate motor incremental move distance, and velocity
-    	for (j=0; j<MAX_GALIL_AXES; j++)
+  //Calculate segment end velocities, and check limits
+  for (i=1; i<nPoints && buildOK; i++)
+	{
+	samples = nextSamples;
+	if (samples < 2)
 		{
-		//Retrieve GalilAxis
-		pAxis = getAxis(j);
-		//Retrieve profileUseAxis_ from ParamList
-		getIntegerParam(j, profileUseAxis_, &useAxis[j]);
-		//Decide to process this axis, or skip
-		if (!useAxis[j] || !pAxis)
-			{
-			if (j < MAX_GALIL_AXES - 1)
-				sprintf(moves,  "%s,", moves);	 //Add axis relative move separator character ',' as needed
-			//Skip the rest, this axis is not in the profile move
-			continue;
-			}
+		sprintf(message, "Seg %d: Time shorter than 2 controller samples, increase time", i);
+		buildOK = false;
+		break;
+		}
+	minSamples = (!minSamples || samples < minSamples) ? samples : minSamples;
+	h = samples * sampleTime;
+	nextSamples = (i < nPoints - 1) ? 2 * (long)rint(prof->times[i+1] / sampleTime / 2.0) : 0;
+	hn = nextSamples * sampleTime;
 
-		if (i==0)
+	for (k=0; k<num_motors; k++)
+		{
+		//Segment move using rounded positions, so integer deltas sum exactly to the profile end
+		delta = rint(positions[k][i]) - rint(positions[k][i-1]);
+		moves[axisNo[k]] = delta;
+		//End velocity, weighted average of adjacent segment slopes.  Profile ends at rest
+		if (i < nPoints - 1 && hn > 0)
 			{
-			//First segment incremental move distance
-			firstmove[j] = pAxis->profilePositions_[i];
-			//Velocity set to 0 for first increment
-			incmove = velocity[j] = 0.0;
+			deltan = rint(positions[k][i+1]) - rint(positions[k][i]);
+			v1[k] = rint((delta / h * hn + deltan / hn * h) / (h + hn));
 			}
 		else
+			v1[k] = 0.0;
+		velocities[axisNo[k]] = v1[k];
+		//Cubic coefficients, position = v0 t + c t^2 + d t^3 from segment start
+		c = (3.0 * delta - h * (2.0 * v0[k] + v1[k])) / (h * h);
+		d = (-2.0 * delta + h * (v0[k] + v1[k])) / (h * h * h);
+		//Acceleration is linear in segment, largest at an end
+		acc = (fabs(2.0 * c) > fabs(2.0 * c + 6.0 * d * h)) ? fabs(2.0 * c) : fabs(2.0 * c + 6.0 * d * h);
+		jerk = fabs(6.0 * d);
+		//Velocity is largest at an end, or where acceleration is zero
+		peak = (fabs(v0[k]) > fabs(v1[k])) ? fabs(v0[k]) : fabs(v1[k]);
+		if (d != 0.0)
 			{
-			//Segment incremental move distance
-			if (i == 1)
-				incmove = pAxis->profilePositions_[i] - firstmove[j];
-			else
-				incmove = (pAxis->profilePositions_[i] - firstmove[j]) - (pAxis->profilePositions_[i-1] - firstmove[j]);
-			//Accumulated position calculated using integer rounded positions (units=steps/counts)
-			apos[j] += rint(incmove);
-			//Accumulated error caused by integer rounding
-			aerr[j] = apos[j] - (pAxis->profilePositions_[i] - firstmove[j]);
-			//If accumlated error due to rounding greater than 1 step/count, apply correction
-			if (fabs(aerr[j]) > 1)
-				{
-				//Apply correction to segment incremental move distance
-				incmove = incmove - aerr[j];
-				//Apply correction to accumulated position calculated using integer rounded positions
-				apos[j] = apos[j] - aerr[j];
-				}
-			//Calculate required velocity for this motor given move distance and time
-			velocity[j] = incmove / profileTimes_[i];
+			t = -c / (3.0 * d);
+			if (t > 0.0 && t < h && fabs(v0[k] + 2.0 * c * t + 3.0 * d * t * t) > peak)
+				peak = fabs(v0[k] + 2.0 * c * t + 3.0 * d * t * t);
 			}
-
-		//Retrieve motor resolution
-		getDoubleParam(j, motorResolution_, &mres);
-
 		//Check profile velocity less than mr vmax for this motor
-		if (fabs(velocity[j]) > fabs(maxAllowedVelocity[j]))
+		if (peak > maxAllowedVelocity[k])
 			{
-			sprintf(message, "Seg %d: Velocity too high motor %c %2.2f > %2.2f, increase time, check profile", 
-                                          i,  pAxis->axisName_, fabs(velocity[j]*mres), maxAllowedVelocity[j]*mres);
+			sprintf(message, "Seg %d: Velocity too high motor %c %2.2f > %2.2f, increase time, check profile",
+			        i, axes[k], peak*fabs(mres[k]), maxAllowedVelocity[k]*fabs(mres[k]));
+			buildOK = false;
+			}
+		//Check acceleration, and jerk limits
+		if (acc > maxAllowedAcceleration[k])
+			{
+			sprintf(message, "Seg %d: Acceleration too high motor %c %2.2f > %2.2f, increase time, check profile",
+			        i, axes[k], acc*fabs(mres[k]), maxAllowedAcceleration[k]*fabs(mres[k]));
+			buildOK = false;
+			}
+		if (maxAllowedJerk[k] > 0 && jerk > maxAllowedJerk[k])
+			{
+			sprintf(message, "Seg %d: Jerk too high motor %c %2.2f > %2.2f, increase time, check profile",
+			        i, axes[k], jerk*fabs(mres[k]), maxAllowedJerk[k]*fabs(mres[k]));
 			buildOK = false;
 			}
-
-		//Find max profile velocity for this motor
-		if (fabs(velocity[j]*mres) > maxProfileVelocity[j])
-			maxProfileVelocity[j] = fabs(velocity[j]*mres);
-
-		//Find max profile position for this motor
-		if ((pAxis->profilePositions_[i]*mres) > maxProfilePosition[j])
-			 maxProfilePosition[j] = pAxis->profilePositions_[i]*mres;
-
-		//Find min profile position for this motor
-		if ((pAxis->profilePositions_[i]*mres) < minProfilePosition[j])
-			 minProfilePosition[j] = pAxis->profilePositions_[i]*mres;
-
-		//Find max profile acceleration for this motor
-		if (fabs(velocity[j]*mres)/profileTimes_[i] > maxProfileAcceleration[j])
-			maxProfileAcceleration[j] = fabs(velocity[j]*mres)/profileTimes_[i];
-
 		//Check position against software limits
-		if (pAxis->profilePositions_[i] < pAxis->lowLimit_ || 
-		    pAxis->profilePositions_[i] > pAxis->highLimit_)
+		if (positions[k][i] < lowLimit[k] || positions[k][i] > highLimit[k])
 			{
-			//Only if move mode = Absolute
-			if (moveMode[j])
-				{
-				sprintf(message, "Motor %c position beyond soft limits in segment %d", pAxis->axisName_, i);
-				buildOK = false;
-				}
+			sprintf(message, "Motor %c position beyond soft limits in segment %d", axes[k], i);
+			buildOK = false;
 			}
-
-		//Add this motors' contribution to vector velocity for this segment
-		vectorVelocity += pow(velocity[j], 2);
-
-		//Store motor incremental move distance for this segment
-		sprintf(moves, "%s%.0lf", moves, rint(incmove));
-		
-		//Detect zero moves in this segment
-                zm_count =  (rint(incmove) == 0) ? zm_count+1 : zm_count;
-
-		if (j < MAX_GALIL_AXES - 1)
-			sprintf(moves,  "%s,", moves);	 //Add axis relative move separator character ',' as needed
-		}
-
-	//Determine vector velocity for this segment
-	vectorVelocity = sqrt(vectorVelocity);
-
-	//Check for segment too short error
-	if (rint(vectorVelocity) == 0 && i != 0)
-		{
-		sprintf(message, "Seg %d: Vector velocity zero, reduce time, add motors, and check profile", i);
-		buildOK = false;
-		}
-	if (zm_count == num_motors && i != 0)
-		{
-		sprintf(message, "Seg %d: Vector zero move distance, reduce time, add motors, and check profile", i);
-		buildOK = false;
+		//Profile statistics
+		maxProfileVelocity[k] = (peak > maxProfileVelocity[k]) ? peak : maxProfileVelocity[k];
+		maxProfileAcceleration[k] = (acc > maxProfileAcceleration[k]) ? acc : maxProfileAcceleration[k];
+		maxProfilePosition[k] = (positions[k][i] > maxProfilePosition[k]) ? positions[k][i] : maxProfilePosition[k];
+		minProfilePosition[k] = (positions[k][i] < minProfilePosition[k]) ? positions[k][i] : minProfilePosition[k];
 		}
 
-	//Trim trailing ',' characters from moves string
-	for (j=(int)strlen(moves)-1; j>0; j--)
+	//Split segments longer than the controller PVT time limit into pieces on the same cubic
+	pieces = (int)((samples + PVT_MAX_SAMPLES - 1) / PVT_MAX_SAMPLES);
+	for (k=0; k<num_motors; k++)
+		sent[k] = 0.0;
+	for (piece=1, elapsed=0; piece<pieces && buildOK; piece++)
 		{
-		if (moves[j] != ',')
+		//Even number of samples in each piece
+		boundary = 2 * ((samples / 2) * piece / pieces);
+		t = boundary * sampleTime;
+		for (k=0; k<num_motors; k++)
 			{
-			//Terminate moves string
-			moves[j+1] = '\0';
-			break;
+			delta = moves[axisNo[k]];
+			c = (3.0 * delta - h * (2.0 * v0[k] + v1[k])) / (h * h);
+			d = (-2.0 * delta + h * (v0[k] + v1[k])) / (h * h * h);
+			pieceMoves[axisNo[k]] = rint(v0[k] * t + c * t * t + d * t * t * t) - sent[k];
+			pieceVelocities[axisNo[k]] = v0[k] + 2.0 * c * t + 3.0 * d * t * t;
+			sent[k] += pieceMoves[axisNo[k]];
+			}
+		if (!prof->buffer->appendPVT(pieceMoves, pieceVelocities, boundary - elapsed))
+			{
+			sprintf(message, "Seg %d: Profile buffer full, increase GalilCreateProfile max points", i);
+			buildOK = false;
 			}
+		elapsed = boundary;
 		}
 
-	//Add segment velocity
-	sprintf(moves, "%s<%.0lf", moves, rint(vectorVelocity));
-	//Add second segment and above
-	//First segment is the "relative" offset or start position for the profile
-	//This is done to prevent jumps in the motor
-	if (i > 0)
+	//Store the segment, or last piece in the profile buffer
+	for (k=0; k<num_motors; k++)
 		{
-		//Write the segment command to profile file
-		fprintf(profFile,"%s\n", moves);
+		moves[axisNo[k]] -= sent[k];
+		v0[k] = v1[k];
 		}
-  	}
-  
-  //Profile written to file now close the file
-  fclose(profFile);
+	if (buildOK && !prof->buffer->appendPVT(moves, velocities, samples - elapsed))
+		{
+		sprintf(message, "Seg %d: Profile buffer full, increase GalilCreateProfile max points", i);
+		buildOK = false;
+		}
+	}
 
   //Build failed.  
   if (!buildOK)
 	{
-	//Delete profile file because its not valid
-	remove(fileName);
 	//Update build message
-  	setStringParam(profileBuildMessage_, message);
+  	setStringParam(prof->index, profileBuildMessage_, message);
 	return asynError;
 	}
-  else
+
+  //Contour slice time used if controller has no PVT mode
+  //Largest slice up to a quarter of the shortest segment
+  for (exponent = CONTOUR_MAX_EXPONENT; exponent > CONTOUR_MIN_EXPONENT && (4L << exponent) > minSamples; exponent--);
+  prof->buffer->setContourExponent(exponent);
+
+  //Update profile ParamList attributes, statistics are converted from steps to egu
+  for (k=0; k<num_motors; k++)
 	{
-	//Update profile ParamList attributes if buildOK
-	for (j=0; j<MAX_GALIL_AXES; j++)
-		{
-		//Retrieve GalilAxis
-		pAxis = getAxis(j);
-		//Decide to process this axis, or skip
-		if (!useAxis[j] || !pAxis) continue;
-		pAxis->setDoubleParam(GalilProfileMinPosition_, minProfilePosition[j]);
-		pAxis->setDoubleParam(GalilProfileMaxPosition_, maxProfilePosition[j]);
-		pAxis->setDoubleParam(GalilProfileMaxVelocity_, maxProfileVelocity[j]);
-		pAxis->setDoubleParam(GalilProfileMaxAcceleration_, maxProfileAcceleration[j]);
-		pAxis->callParamCallbacks();
-		}
+	pAxis = getAxis(axisNo[k]);
+	pAxis->setDoubleParam(GalilProfileMinPosition_, (mres[k] >= 0) ? minProfilePosition[k] * mres[k] : maxProfilePosition[k] * mres[k]);
+	pAxis->setDoubleParam(GalilProfileMaxPosition_, (mres[k] >= 0) ? maxProfilePosition[k] * mres[k] : minProfilePosition[k] * mres[k]);
+	pAxis->setDoubleParam(GalilProfileMaxVelocity_, maxProfileVelocity[k] * fabs(mres[k]));
+	pAxis->setDoubleParam(GalilProfileMaxAcceleration_, maxProfileAcceleration[k] * fabs(mres[k]));
+	pAxis->callParamCallbacks();
 	}
 
+  //Profile is ready to execute
+  prof->buffer->setType(PROFILE_PVT);
+
   return asynSuccess;
 }
 
-/* Function to build, install and verify trajectory */ 
-asynStatus GalilController::buildProfile()
+//Builds contour profile for fly scans
+//Positions, and times are taken from the profile arrays, motion between points is at constant velocity
+//Points are stored with times in whole controller samples, and resampled onto fixed 2^n sample
+//contour slices as the profile is streamed, so slices are never all held in memory
+//Segments are stored in the profile context buffer
+asynStatus GalilController::buildContourProfile(GalilProfileContext *prof)
 {
-  int status;				//asynStatus
-  char message[MAX_GALIL_STRING_SIZE];	//Profile build message
-  static const char *functionName = "buildProfile";
+  GalilAxis *pAxis;				//GalilAxis instance
+  int nPoints;					//Number of points in profile
+  double maxAllowedVelocity[MAX_GALIL_AXES];    //Derived from MR VMAX, steps
+  double maxAllowedAcceleration[MAX_GALIL_AXES];//From controller, and GalilProfileAccelLimit_, steps
+  double maxProfileVelocity[MAX_GALIL_AXES];    //The highest velocity for each motor in the profile data, steps
+  double maxProfilePosition[MAX_GALIL_AXES];	//Maximum profile position, steps
+  double minProfilePosition[MAX_GALIL_AXES];	//Minimum profile position, steps
+  double maxProfileAcceleration[MAX_GALIL_AXES];//Maximum profile acceleration, steps
+  double lowLimit[MAX_GALIL_AXES];		//Soft limits checked, absolute move mode only
+  double highLimit[MAX_GALIL_AXES];
+  double mres[MAX_GALIL_AXES];			//Motor resolution
+  const double *positions[MAX_GALIL_AXES];	//Profile positions for each motor
+  int axisNo[MAX_GALIL_AXES];			//Axis number of each motor in profile
+  double startp[MAX_GALIL_AXES];		//Profile start positions
+  double moves[MAX_GALIL_AXES];			//Segment move indexed by axis number
+  double velocity[MAX_GALIL_AXES];		//Previous segment velocity
+  double limit;					//Limit in egu
+  double sampleTime;				//Controller sample time
+  double slice;					//Contour slice time in seconds
+  double time = 0.0;				//Profile time at end of segment
+  long end, last = 0;				//Segment end, and segment start in samples
+  double h;					//Segment time in seconds
+  double vel, acc;				//Segment velocity, and acceleration at segment start
+  int exponent;					//Contour slice time exponent
+  int i, j, k;					//Loop counters
+  int num_motors = 0;				//Number of motors in trajectory
+  char message[MAX_GALIL_STRING_SIZE];		//Profile build message
+  int useAxis;					//Use axis flag for profile moves
+  int moveMode;					//Move mode absolute or relative
+  char axes[MAX_GALIL_AXES + 1];		//Motors involved in profile move
+  bool moving;					//Segment has a move
+  bool buildOK = true;				//Was the trajectory built successfully
 
-  asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
-            "%s:%s: entry\n",
-            driverName, functionName);
-            
-  //Call the base class method which will build the time array if needed
-  asynMotorController::buildProfile();
+  // Retrieve required attributes from ParamList
+  getIntegerParam(prof->index, profileNumPoints_, &nPoints);
+  getIntegerParam(prof->index, GalilProfileContourExponent_, &exponent);
 
-  //Update profile build status
-  strcpy(message, "");
-  setStringParam(profileBuildMessage_, message);
-  setIntegerParam(profileBuildState_, PROFILE_BUILD_BUSY);
-  setIntegerParam(profileBuildStatus_, PROFILE_STATUS_UNDEFINED);
-  callParamCallbacks();
+  //Slice time is 2^exponent samples
+  exponent = (exponent < CONTOUR_MIN_EXPONENT) ? CONTOUR_MIN_EXPONENT : exponent;
+  exponent = (exponent > CONTOUR_MAX_EXPONENT) ? CONTOUR_MAX_EXPONENT : exponent;
+  prof->buffer->setContourExponent(exponent);
 
-  //Short delay showing status busy so user knows work actually happened
-  epicsThreadSleep(.1);
-  
-  //Build profile data for use with linear interpolation mode
-  status = buildLinearProfile();
+  //Controller sample time, segment times are whole samples
+  sampleTime = controllerSampleTime();
+  prof->buffer->setSampleTime(sampleTime);
+  slice = (1L << exponent) * sampleTime;
 
-  //Update profile build state
-  setIntegerParam(profileBuildState_, PROFILE_BUILD_DONE);
-  //Update profile build status
-  if (status)
-	setIntegerParam(profileBuildStatus_, PROFILE_STATUS_FAILURE);
-  else
-	setIntegerParam(profileBuildStatus_, PROFILE_STATUS_SUCCESS);
-  callParamCallbacks();
+  //Construct axes list, and retrieve motor attributes once for the whole profile
+  for (j=0; j<MAX_GALIL_AXES; j++)
+	{
+	//Motor not in profile yet
+	moves[j] = startp[j] = 0.0;
+	//Retrieve GalilAxis
+	pAxis = getAxis(j);
+	//Retrieve profileUseAxis_ from ParamList
+	useAxis = 0;
+	getIntegerParam(j, profileUseAxis_, &useAxis);
+	//Decide to process this axis, or skip
+	if (!useAxis || !pAxis) continue;
+	k = num_motors++;
+	axisNo[k] = j;
+	axes[k] = (char)(j + AASCII);
+	positions[k] = pAxis->profilePositions_;
+	//Start position
+	startp[j] = rint(positions[k][0]);
+	//Retrieve motor resolution
+	getDoubleParam(j, motorResolution_, &mres[k]);
+	//Retrieve the motor maxVelocity in egu, and calculate velocity in steps
+	getDoubleParam(j, GalilMotorVmax_, &maxAllowedVelocity[k]);
+	maxAllowedVelocity[k] = fabs(maxAllowedVelocity[k] / mres[k]);
+	//Acceleration limit is the controller limit, or user limit if lower
+	maxAllowedAcceleration[k] = (double)modelMaxAcceleration();
+	getDoubleParam(j, GalilProfileAccelLimit_, &limit);
+	if (limit > 0 && fabs(limit / mres[k]) < maxAllowedAcceleration[k])
+		maxAllowedAcceleration[k] = fabs(limit / mres[k]);
+	//Retrieve GalilProfileMoveMode_ from ParamList
+	//Soft limits are checked in absolute move mode only
+	getIntegerParam(j, GalilProfileMoveMode_, &moveMode);
+	lowLimit[k] = (moveMode) ? pAxis->lowLimit_ : -DBL_MAX;
+	highLimit[k] = (moveMode) ? pAxis->highLimit_ : DBL_MAX;
+	//Profile starts at rest
+	velocity[k] = 0.0;
+	//Initialize profile statistics
+	//Position range is set from the first point
+	maxProfileVelocity[k] = maxProfileAcceleration[k] = 0.0;
+	maxProfilePosition[k] = minProfilePosition[k] = (nPoints > 0) ? positions[k][0] : 0.0;
+	if (nPoints > 0 && (positions[k][0] < lowLimit[k] || positions[k][0] > highLimit[k]))
+		{
+		sprintf(message, "Motor %c position beyond soft limits in segment %d", axes[k], 0);
+		buildOK = false;
+		}
+	}
+  axes[num_motors] = '\0';
+
+  //Store axes list, and start positions
+  prof->buffer->setAxes(axes, startp);
+
+  //Store segments, and check limits
+  for (i=1; i<nPoints && buildOK; i++)
+	{
+	//Segment end is rounded from the profile time, so rounding never accumulates
+	//Contour slices are at least 2 samples, so segment ends are an even sample
+	time += prof->times[i];
+	end = 2 * (long)rint(time / sampleTime / 2.0);
+	h = (end - last) * sampleTime;
+
+	moving = false;
+	for (k=0; k<num_motors; k++)
+		{
+		//Segment move using rounded positions, so integer deltas sum exactly to the profile end
+		moves[axisNo[k]] = rint(positions[k][i]) - rint(positions[k][i-1]);
+		moving = (moves[axisNo[k]] != 0.0) ? true : moving;
+		}
+
+	//Segment rounded to no time
+	if (end <= last)
+		{
+		if (moving)
+			{
+			sprintf(message, "Seg %d: Time shorter than 2 controller samples, increase time", i);
+			buildOK = false;
+			}
+		//Segment without a move is dropped, its time is carried into the next segment
+		continue;
+		}
+
+	for (k=0; k<num_motors; k++)
+		{
+		vel = moves[axisNo[k]] / h;
+		//Velocity changes over one contour slice at each point, profile starts, and ends at rest
+		acc = fabs(vel - velocity[k]) / slice;
+		if (i == nPoints - 1 && fabs(vel) / slice > acc)
+			acc = fabs(vel) / slice;
+		velocity[k] = vel;
+		//Check profile velocity less than mr vmax for this motor
+		if (fabs(vel) > maxAllowedVelocity[k])
+			{
+			sprintf(message, "Seg %d: Velocity too high motor %c %2.2f > %2.2f, increase time, check profile",
+			        i, axes[k], fabs(vel)*fabs(mres[k]), maxAllowedVelocity[k]*fabs(mres[k]));
+			buildOK = false;
+			}
+		//Check acceleration limit
+		if (acc > maxAllowedAcceleration[k])
+			{
+			sprintf(message, "Seg %d: Acceleration too high motor %c %2.2f > %2.2f, add ramp points, check profile",
+			        i, axes[k], acc*fabs(mres[k]), maxAllowedAcceleration[k]*fabs(mres[k]));
+			buildOK = false;
+			}
+		//Check position against software limits
+		if (positions[k][i] < lowLimit[k] || positions[k][i] > highLimit[k])
+			{
+			sprintf(message, "Motor %c position beyond soft limits in segment %d", axes[k], i);
+			buildOK = false;
+			}
+		//Profile statistics
+		maxProfileVelocity[k] = (fabs(vel) > maxProfileVelocity[k]) ? fabs(vel) : maxProfileVelocity[k];
+		maxProfileAcceleration[k] = (acc > maxProfileAcceleration[k]) ? acc : maxProfileAcceleration[k];
+		maxProfilePosition[k] = (positions[k][i] > maxProfilePosition[k]) ? positions[k][i] : maxProfilePosition[k];
+		minProfilePosition[k] = (positions[k][i] < minProfilePosition[k]) ? positions[k][i] : minProfilePosition[k];
+		}
+
+	//Store the segment in the profile buffer
+	if (buildOK && !prof->buffer->appendContour(moves, end - last))
+		{
+		sprintf(message, "Seg %d: Profile buffer full, increase GalilCreateProfile max points", i);
+		buildOK = false;
+		}
+	last = end;
+	}
+
+  //Contour needs at least one slice
+  if (buildOK && prof->buffer->totalSamples() < 2)
+	{
+	strcpy(message, "Profile time shorter than 2 controller samples, increase time");
+	buildOK = false;
+	}
+
+  //Build failed.  
+  if (!buildOK)
+	{
+	//Update build message
+  	setStringParam(prof->index, profileBuildMessage_, message);
+	return asynError;
+	}
+
+  //Update profile ParamList attributes, statistics are converted from steps to egu
+  for (k=0; k<num_motors; k++)
+	{
+	pAxis = getAxis(axisNo[k]);
+	pAxis->setDoubleParam(GalilProfileMinPosition_, (mres[k] >= 0) ? minProfilePosition[k] * mres[k] : maxProfilePosition[k] * mres[k]);
+	pAxis->setDoubleParam(GalilProfileMaxPosition_, (mres[k] >= 0) ? maxProfilePosition[k] * mres[k] : minProfilePosition[k] * mres[k]);
+	pAxis->setDoubleParam(GalilProfileMaxVelocity_, maxProfileVelocity[k] * fabs(mres[k]));
+	pAxis->setDoubleParam(GalilProfileMaxAcceleration_, maxProfileAcceleration[k] * fabs(mres[k]));
+	pAxis->callParamCallbacks();
+	}
+
+  //Profile is ready to execute
+  prof->buffer->setType(PROFILE_CONTOUR);
+
+  return asynSuccess;
+}
+
+/* Check built profile can be streamed over the link faster than the controller executes it
+ * Controller buffer occupancy is simulated over the whole profile using measured command round trip time
+ * Rejects the profile with the first segment the buffer runs dry at, and the minimum time scaling that can be streamed
+ * Profile is accepted if the controller is not connected, as the link cant be measured */
+asynStatus GalilController::checkProfileStream(GalilProfileContext *prof)
+{
+  char message[MAX_GALIL_STRING_SIZE];	//Profile build message
+  GalilStreamModel model;		//Link model
+  double failTime;			//Profile time streaming falls behind at
+  double scale;				//Minimum time scaling that can be streamed
+  long fail;				//Controller buffer segment streaming falls behind at
+  long seg;				//Profile segment streaming falls behind at, before merge
+
+  //Profile is checked at the time scale it was built with
+  setDoubleParam(prof->index, GalilProfileTimeScale_, 1.0);
+
+  if (!connected_)
+     return asynSuccess;
+
+  //Link model
+  model.rtt = measureLinkRTT();
+  model.wait = updatePeriod_ / 1000.0;
+  model.minBuffered = PROFILE_MIN_BUFFERED;
+  model.lineLength = MAX_GALIL_LINE;
+  if (prof->buffer->type() == PROFILE_LINEAR)
+     {
+     //Linear segments, coordsys select, and free space query CA S;MG _LMS
+     model.contour = false;
+     model.bufferSize = MAX_SEGMENTS;
+     model.queryLength = 12;
+     }
+  else
+     {
+     //PVT segments, free space query MG _PVA.  Or contour slices, free space query MG _CM
+     model.contour = (prof->buffer->type() == PROFILE_CONTOUR || !modelPVT());
+     model.bufferSize = (model.contour) ? CONTOUR_SEGMENTS : PVT_SEGMENTS;
+     model.queryLength = (model.contour) ? 6 : 7;
+     }
+
+  fail = prof->buffer->simulateStream(&model, 1.0, &failTime);
+  if (fail < 0)
+     return asynSuccess;
+
+  //Find minimum time scaling that can be streamed, 0 if none found
+  scale = prof->buffer->streamTimeScale(&model, PROFILE_MAX_TIME_SCALE);
+
+  setDoubleParam(prof->index, GalilProfileTimeScale_, scale);
+
+  //Update build message, linear segments are reported as built from the profile points
+  seg = (prof->buffer->type() == PROFILE_LINEAR) ? (long)prof->buffer->sourceSegment(fail) + 1 : 0;
+  if (prof->buffer->type() == PROFILE_LINEAR && scale > 0.0)
+     sprintf(message, "Seg %ld: Time base too fast for link, scale time by %.2f", seg, scale);
+  else if (prof->buffer->type() == PROFILE_LINEAR)
+     sprintf(message, "Seg %ld: Time base too fast for link, increase time", seg);
+  else if (scale > 0.0)
+     sprintf(message, "Time base too fast for link at %.3fs, scale time by %.2f", failTime, scale);
+  else
+     sprintf(message, "Time base too fast for link at %.3fs, increase time", failTime);
+  setStringParam(prof->index, profileBuildMessage_, message);
+
+  return asynError;
+}
+
+/* Function to build, install and verify trajectory
+ * Called by asynMotorController for the profile at address 0 */
+asynStatus GalilController::buildProfile()
+{
+  return buildProfile(&profiles_[0]);
+}
+
+/* Function to build, install and verify trajectory for a profile context
+ * Profile control, and status are at the context ParamList address */
+asynStatus GalilController::buildProfile(GalilProfileContext *prof)
+{
+  int status;				//asynStatus
+  char message[MAX_GALIL_STRING_SIZE];	//Profile build message
+  char fileName[MAX_FILENAME_LEN];	//Optional filename to export profile data to
+  int executeState = PROFILE_EXECUTE_DONE;	//Profile execute state
+  int profileType = PROFILE_TYPE_LINEAR;	//Requested profile type
+  int timeMode = PROFILE_TIME_MODE_ARRAY;	//Profile time mode fixed, or array
+  double fixedTime = 0.0;		//Profile fixed time
+  int nPoints = 0;			//Number of points in profile
+  int i;				//Looping
+  static const char *functionName = "buildProfile";
+
+  asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+            "%s:%s: entry\n",
+            driverName, functionName);
+            
+  //Update profile build status
+  strcpy(message, "");
+  setStringParam(prof->index, profileBuildMessage_, message);
+  setIntegerParam(prof->index, profileBuildState_, PROFILE_BUILD_BUSY);
+  setIntegerParam(prof->index, profileBuildStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks(prof->index);
+
+  //Short delay showing status busy so user knows work actually happened
+  epicsThreadSleep(.1);
+
+  //No export file unless specified
+  strcpy(fileName, "");
+
+  // Retrieve required attributes from ParamList
+  getStringParam(prof->index, GalilProfileFile_, (int)sizeof(fileName), fileName);
+  getIntegerParam(prof->index, profileExecuteState_, &executeState);
+  getIntegerParam(prof->index, GalilProfileType_, &profileType);
+  getIntegerParam(prof->index, profileTimeMode_, &timeMode);
+  getDoubleParam(prof->index, profileFixedTime_, &fixedTime);
+  getIntegerParam(prof->index, profileNumPoints_, &nPoints);
+
+  //Profile thread reads the profile buffer whilst executing
+  if (executeState != PROFILE_EXECUTE_DONE)
+	{
+	strcpy(message, "Profile executing, build rejected");
+	setStringParam(prof->index, profileBuildMessage_, message);
+	status = asynError;
+	}
+  else
+	{
+	//Point times are kept with the profile, as the time array is shared by both profile contexts
+	nPoints = (nPoints < 0) ? 0 : nPoints;
+	nPoints = (nPoints > maxProfilePoints_) ? maxProfilePoints_ : nPoints;
+	for (i = 0; i < nPoints && prof->times; i++)
+		prof->times[i] = (timeMode == PROFILE_TIME_MODE_FIXED) ? fixedTime : profileTimes_[i];
+	prof->points = (prof->times) ? nPoints : 0;
+	//Discard previous profile
+	prof->buffer->clear();
+	//Segments are merged by linear build only
+	setDoubleParam(prof->index, GalilProfileCompression_, 1.0);
+	setDoubleParam(prof->index, GalilProfileMergeDeviation_, 0.0);
+	//Build profile data for requested profile type
+	if (profileType == PROFILE_TYPE_PVT)
+		status = buildPVTProfile(prof);
+	else if (profileType == PROFILE_TYPE_CONTOUR)
+		status = buildContourProfile(prof);
+	else
+		status = buildLinearProfile(prof);
+	//Check profile can be streamed over the link before motors are moved
+	if (!status)
+		status = checkProfileStream(prof);
+	//Export profile to file if requested
+	if (!status && strcmp(fileName, "") && !prof->buffer->exportFile(fileName))
+		{
+		epicsSnprintf(message, sizeof(message), "Can't write trajectory file %s", fileName);
+		setStringParam(prof->index, profileBuildMessage_, message);
+		status = asynError;
+		}
+	//Build failed
+	if (status)
+		{
+		//Discard profile because its not valid
+		prof->buffer->clear();
+		//Delete export file because its not valid
+		if (strcmp(fileName, ""))
+			remove(fileName);
+		}
+	}
+
+  //Update profile build state
+  setIntegerParam(prof->index, profileBuildState_, PROFILE_BUILD_DONE);
+  //Update profile build status
+  if (status)
+	setIntegerParam(prof->index, profileBuildStatus_, PROFILE_STATUS_FAILURE);
+  else
+	setIntegerParam(prof->index, profileBuildStatus_, PROFILE_STATUS_SUCCESS);
+  callParamCallbacks(prof->index);
 
   return asynSuccess;
 }
 
-/* Function to execute trajectory */ 
+/* Function to execute trajectory
+ * Called by asynMotorController for the profile at address 0 */
 asynStatus GalilController::executeProfile()
 {
-  epicsEventSignal(profileExecuteEvent_);
+  return executeProfile(&profiles_[0]);
+}
+
+/* Function to execute trajectory for a profile context
+ * Profiles on S, and T can execute at the same time if they share no motors
+ * Linear profiles execute on the selected coordinate system, or the other one if its in use by the other profile
+ * Controller has one contour buffer, so only one profile can use contour mode at a time
+ * Execute whilst the profile is armed, or arming, triggers the profile */
+asynStatus GalilController::executeProfile(GalilProfileContext *prof, bool arm)
+{
+  GalilProfileContext *other = &profiles_[(prof->index + 1) % COORDINATE_SYSTEMS];
+  char message[MAX_GALIL_STRING_SIZE];	//Profile execute message
+  int executeState = PROFILE_EXECUTE_DONE;	//Profile execute state
+  int otherState = PROFILE_EXECUTE_DONE;	//Other profile execute state
+  int coordsys;				//Selected coordinate system
+  bool contour, otherContour;		//Profile uses contour mode
+  const char *axes;			//Motors involved in profile move
+  unsigned i;				//Looping
+
+  getIntegerParam(prof->index, profileExecuteState_, &executeState);
+  getIntegerParam(other->index, profileExecuteState_, &otherState);
+  //Retrieve currently selected coordinate system
+  getIntegerParam(GalilCoordSys_, &coordsys);
+
+  //Execute is the trigger for an armed profile
+  if (executeState != PROFILE_EXECUTE_DONE && prof->trigger->arm())
+	return triggerProfile(prof);
+
+  //Profile already executing
+  if (executeState != PROFILE_EXECUTE_DONE)
+	return asynError;
+
+  strcpy(message, "");
+  if (otherState != PROFILE_EXECUTE_DONE)
+	{
+	//Other profile owns its buffer whilst executing, and only reads it
+	axes = prof->buffer->axes();
+	for (i = 0; i < strlen(axes); i++)
+		if (strchr(other->buffer->axes(), axes[i]))
+			sprintf(message, "Motor %c in use by other profile, execute rejected", axes[i]);
+	contour = (prof->buffer->type() == PROFILE_CONTOUR || (prof->buffer->type() == PROFILE_PVT && !modelPVT()));
+	otherContour = (other->buffer->type() == PROFILE_CONTOUR || (other->buffer->type() == PROFILE_PVT && !modelPVT()));
+	if (contour && otherContour)
+		strcpy(message, "Contour mode in use by other profile, execute rejected");
+	//Linear profile uses the other coordinate system if the selected one is in use
+	if (other->buffer->type() == PROFILE_LINEAR && other->coordsys == coordsys)
+		coordsys = (coordsys) ? 0 : 1;
+	}
+
+  if (strcmp(message, ""))
+	{
+	setStringParam(prof->index, profileExecuteMessage_, message);
+	setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+	callParamCallbacks(prof->index);
+	return asynError;
+	}
+
+  //Profile thread owns the profile buffer from now until execute done
+  prof->coordsys = coordsys;
+  prof->trigger->start(arm);
+  prof->triggerStatus = asynSuccess;
+  //Execute to begin latency is reported for profiles that arent armed
+  epicsTimeGetCurrent(&prof->triggerTime);
+  setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_MOVE_START);
+  epicsEventSignal(prof->executeEvent);
+  return asynSuccess;
+}
+
+/* Function to arm trajectory for a profile context
+ * Profile executes until motors are at start, and controller buffer is full, then waits
+ * Execute, or the digital input selected by GalilProfileTriggerInput_ then begins the profile
+ * Input trigger code runs on the highest numbered controller thread, so it must not be used by an axis
+ * Input trigger code is generated if enabled by GalilCreateProfile, and is used by one profile at a time */
+asynStatus GalilController::armProfile(GalilProfileContext *prof)
+{
+  int executeState = PROFILE_EXECUTE_DONE;	//Profile execute state
+  int otherState = PROFILE_EXECUTE_DONE;	//Other profile execute state
+  int input;				//Digital input that triggers profile, 0 for execute only
+  const char *message = "";		//Profile execute message
+  GalilProfileContext *other = &profiles_[(prof->index + 1) % COORDINATE_SYSTEMS];
+
+  getIntegerParam(prof->index, profileExecuteState_, &executeState);
+  getIntegerParam(other->index, profileExecuteState_, &otherState);
+  getIntegerParam(prof->index, GalilProfileTriggerInput_, &input);
+
+  //Profile already executing, or armed
+  if (executeState != PROFILE_EXECUTE_DONE)
+	return asynError;
+
+  //Input trigger code begins a coordinate system, PVT, and contour begin need the profile motors
+  if (input > 0 && prof->buffer->type() != PROFILE_LINEAR)
+	message = "Input trigger supports linear profiles only, arm rejected";
+  if (input > 0 && (numThreads_ < 2 || getAxis(numThreads_ - 1) != NULL))
+	message = "No free controller thread for input trigger, arm rejected";
+  if (input > 0 && !profileInputTrigger_)
+	message = "Input trigger not enabled by GalilCreateProfile, arm rejected";
+  //Input trigger code, and its variables are shared by both profiles
+  if (input > 0 && otherState != PROFILE_EXECUTE_DONE && other->trigger->arm() && other->triggerInput > 0)
+	message = "Input trigger in use by other profile, arm rejected";
+
+  if (strcmp(message, ""))
+	{
+	setStringParam(prof->index, profileExecuteMessage_, message);
+	setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+	callParamCallbacks(prof->index);
+	return asynError;
+	}
+
+  prof->triggerInput = input;
+  return executeProfile(prof, true);
+}
+
+/* Function to trigger an armed profile from execute
+ * Begin is sent here rather than by the profile thread, so trigger latency is one command round trip
+ * Execute whilst the profile is still arming begins the profile as soon as its armed */
+asynStatus GalilController::triggerProfile(GalilProfileContext *prof)
+{
+  asynStatus status = asynSuccess;
+  bool begun = false;			//Input trigger began the profile already
+  profileTriggerAction action;		//Begin now, once armed, or reject
+
+  //Profile already triggered, or aborted
+  action = prof->trigger->execute();
+  if (action == TRIGGER_REJECT)
+	return asynError;
+
+  epicsTimeGetCurrent(&prof->triggerTime);
+  if (action == TRIGGER_BEGIN)
+	{
+	if (prof->triggerThread >= 0)
+		{
+		//Stop input trigger code, and check if input began the profile already
+		sprintf(cmd_, "HX%d;MG ptfired", prof->triggerThread);
+		status = sync_writeReadController();
+		if (status == asynSuccess && atof(resp_) >= 0.0)
+			{
+			setProfileCaptureStart(prof, (unsigned)atof(resp_));
+			begun = true;
+			}
+		prof->triggerThread = -1;
+		}
+	if (status == asynSuccess && !begun)
+		status = beginProfile(prof, prof->begin);
+	prof->triggerStatus = status;
+	}
+
+  //Wake profile thread
+  epicsEventSignal(prof->triggerEvent);
   return asynSuccess;
 }
 
 /* C Function which runs the profile thread */ 
 static void GalilProfileThreadC(void *pPvt)
 {
-  GalilController *pC = (GalilController*)pPvt;
-  pC->profileThread();
+  GalilProfileContext *prof = (GalilProfileContext*)pPvt;
+  prof->pC->profileThread(prof);
 }
 
-/* Function which runs in its own thread to execute profiles */ 
-void GalilController::profileThread()
+/* Function which runs in its own thread to execute profiles for one profile context */ 
+void GalilController::profileThread(GalilProfileContext *prof)
 {
   while (true) {
-    epicsEventWait(profileExecuteEvent_);
-    runProfile();
+    epicsEventWait(prof->executeEvent);
+    runProfile(prof);
   }
 }
 
+/* Function to abort trajectory
+ * Called by asynMotorController for the profile at address 0 */
 asynStatus GalilController::abortProfile()
+{
+  return abortProfile(&profiles_[0]);
+}
+
+/* Function to abort trajectory for a profile context
+ * Only the coordinate system, or motors used by this profile are stopped */
+asynStatus GalilController::abortProfile(GalilProfileContext *prof)
 {
   int moving;
-  int coordsys;
+  int coordsys = prof->coordsys;	//Coordinate system linear profile executes on
+  int executeState = PROFILE_EXECUTE_DONE;	//Profile execute state
+  char axes[MAX_GALIL_AXES + 1];	//Motors involved in profile move
 
-  //Retrieve currently selected coordinate system 
-  getIntegerParam(GalilCoordSys_, &coordsys);
   //Coordsys moving status
   getIntegerParam(coordsys, GalilCoordSysMoving_, &moving);
+  //Coordsys may be in use by the other profile unless this profile is executing
+  getIntegerParam(prof->index, profileExecuteState_, &executeState);
 
   //Request the thread that buffers/executes the profile to abort the process
-  profileAbort_ = true;
+  prof->abort = true;
+  //Armed profile that hasnt begun never begins, even if execute follows
+  prof->trigger->abort();
+  //Wake profile thread if armed
+  epicsEventSignal(prof->triggerEvent);
+
+  //PVT, and contour profiles run on the motors rather than a coordinate system
+  if (prof->buffer->type() == PROFILE_PVT || prof->buffer->type() == PROFILE_CONTOUR)
+	{
+	strcpy(axes, prof->buffer->axes());
+	if (strcmp(axes, "") && executeState != PROFILE_EXECUTE_DONE && anyMotorMoving(axes))
+		{
+		sprintf(cmd_, "ST %s", axes);
+		sync_writeReadController();
+		}
+	return asynSuccess;
+	}
 
   //Stop the coordinate system if its moving
-  if (moving)
+  if (moving && executeState != PROFILE_EXECUTE_DONE)
 	{
         //Stop the coordinate system  
 	sprintf(cmd_, "ST %c", (coordsys == 0) ? 'S' : 'T');
@@ -1433,6 +2517,105 @@ asynStatus GalilController::abortProfile()
   return asynSuccess;
 }
 
+/* Function to readback trajectory
+ * Called by asynMotorController for the profile at address 0 */
+asynStatus GalilController::readbackProfile()
+{
+  return readbackProfile(&profiles_[0]);
+}
+
+/* Function to readback trajectory for a profile context
+ * Data records captured whilst the last profile executed are aligned with the point times the profile was built with
+ * and published in the profile readback, and following error arrays */
+asynStatus GalilController::readbackProfile(GalilProfileContext *prof)
+{
+  GalilAxis *pAxis;				//GalilAxis instance
+  char message[MAX_GALIL_STRING_SIZE];		//Profile readback message
+  char axes[MAX_GALIL_AXES + 1];		//Motors involved in captured profile
+  int nPoints;					//Number of points in profile
+  int executeState = PROFILE_EXECUTE_DONE;	//Profile execute state
+  captureSource source;				//Captured position used for readback
+  double sampleTime;				//Controller sample time
+  double time;					//Profile point time from profile start
+  bool readbackOK = true;			//Was the readback successful
+  int axisNo;					//Axis number
+  unsigned index;				//looping
+  int i;
+  static const char *functionName = "readbackProfile";
+
+  asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+            "%s:%s: entry\n",
+            driverName, functionName);
+
+  //Update profile readback status
+  strcpy(message, "");
+  setStringParam(prof->index, profileReadbackMessage_, message);
+  setIntegerParam(prof->index, profileReadbackState_, PROFILE_READBACK_BUSY);
+  setIntegerParam(prof->index, profileReadbackStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks(prof->index);
+
+  // Retrieve required attributes from ParamList
+  nPoints = prof->points;
+  getIntegerParam(prof->index, profileExecuteState_, &executeState);
+
+  //Data record sample counter counts controller samples
+  sampleTime = controllerSampleTime();
+
+  epicsMutexLock(captureLock_);
+  strcpy(axes, prof->capture->axes());
+  if (executeState != PROFILE_EXECUTE_DONE)
+	{
+	//Capture is still being filled
+	strcpy(message, "Profile executing, readback rejected");
+	readbackOK = false;
+	}
+  else if (!prof->capture->started() || prof->capture->records() < 2)
+	{
+	strcpy(message, "No profile data captured");
+	readbackOK = false;
+	}
+  else
+	{
+	//Interpolate captured data records at each profile point time
+	for (index = 0; index < strlen(axes); index++)
+		{
+		axisNo = axes[index] - AASCII;
+		pAxis = getAxis(axisNo);
+		if (!pAxis) continue;
+		//If motor is servo and ueip_ = 1 then controller uses encoder_position_ for positioning
+		source = (pAxis->ueip_ && (pAxis->motorType_ == 0 || pAxis->motorType_ == 1)) ? CAPTURE_TP : CAPTURE_TD;
+		for (i = 0, time = 0.0; i < nPoints; i++)
+			{
+			time += (i) ? prof->times[i] : 0.0;
+			pAxis->profileReadbacks_[i] = prof->capture->value(source, axisNo, time / sampleTime);
+			pAxis->profileFollowingErrors_[i] = prof->capture->value(CAPTURE_TE, axisNo, time / sampleTime);
+			}
+		}
+	}
+  epicsMutexUnlock(captureLock_);
+
+  if (readbackOK)
+	{
+	//Readbacks are in steps/counts, GalilAxis converts to user units and does array callbacks
+	//Readback count is published at this context address only
+	setIntegerParam(prof->index, profileNumReadbacks_, nPoints);
+	for (index = 0; index < strlen(axes); index++)
+		{
+		pAxis = getAxis(axes[index] - AASCII);
+		if (pAxis)
+			pAxis->readbackProfile(nPoints);
+		}
+	}
+
+  //Update profile readback status
+  setStringParam(prof->index, profileReadbackMessage_, message);
+  setIntegerParam(prof->index, profileReadbackState_, PROFILE_READBACK_DONE);
+  setIntegerParam(prof->index, profileReadbackStatus_, (readbackOK) ? PROFILE_STATUS_SUCCESS : PROFILE_STATUS_FAILURE);
+  callParamCallbacks(prof->index);
+
+  return asynSuccess;
+}
+
 //Execute prem for motor list
 //Obtain lock before calling
 void GalilController::executePrem(const char *axes)
@@ -1558,7 +2741,7 @@ void GalilController::executeAutoOnBrakeOff(const char *axes)
 
 /* For profile moves.  Convenience function to move motors to start or stop them moving to start
 */
-asynStatus GalilController::motorsToProfileStartPosition(FILE *profFile, char *axes, double startp[], bool move = true)
+asynStatus GalilController::motorsToProfileStartPosition(GalilProfileContext *prof, const char *axes, double startp[], bool move = true)
 {
   GalilAxis *pAxis;			//GalilAxis
   int j;				//Axis looping
@@ -1574,19 +2757,19 @@ asynStatus GalilController::motorsToProfileStartPosition(FILE *profFile, char *a
 	{
 	//Update status
 	strcpy(message, "Moving motors to start position and buffering profile data...");
-	setStringParam(profileExecuteMessage_, message);
-	callParamCallbacks();
+	setStringParam(prof->index, profileExecuteMessage_, message);
+	callParamCallbacks(prof->index);
 	}
 
   //If mode absolute, send motors to start position or stop them moving to start position
   for (j = 0; j < (int)strlen(axes); j++)
   	{
-	//Determine the axis number mentioned in profFile
+	//Determine the axis number mentioned in profile
 	axisNo = axes[j] - AASCII;
 	//Retrieve GalilProfileMoveMode_ from ParamList
 	getIntegerParam(axisNo, GalilProfileMoveMode_, &moveMode[axisNo]);
-	if (move) //Read profile start positions from file
-		fscanf(profFile, "%lf,", &startp[axisNo]);
+	if (move) //Retrieve profile start positions from profile buffer
+		startp[axisNo] = prof->buffer->startPosition(axisNo);
 	//If moveMode = Relative skip move to start
 	if (!moveMode[axisNo]) continue;
 	//Retrieve axis instance
@@ -1615,25 +2798,25 @@ asynStatus GalilController::motorsToProfileStartPosition(FILE *profFile, char *a
 		{
 		//Store message in paramList
 		sprintf(message, "Failed to move profile motor %c toward start position", pAxis->axisName_);
-		setStringParam(profileExecuteMessage_, message);
+		setStringParam(prof->index, profileExecuteMessage_, message);
 		//break from the loop
 		break;
 		}
 	}
 
-  if (move)  //Move file pointer down a line
-	fscanf(profFile, "\n");
-
   return (asynStatus)status;
 }
 
 /* Convenience function to begin linear profile using specified coordinate system
    Called after filling the linear buffer
 */
-asynStatus GalilController::startLinearProfileCoordsys(int coordsys, char coordName, const char *axes)
+asynStatus GalilController::startLinearProfileCoordsys(GalilProfileContext *prof, char coordName, const char *axes)
 {
   char message[MAX_GALIL_STRING_SIZE];	//Profile execute message
+  char begin[MAX_GALIL_STRING_SIZE];	//Command that begins profile
+  asynStatus status;			//Begin status
   double begin_time;			//Time taken to begin
+  epicsTimeStamp beginTime, nowTime;	//Used to track length of time begin takes
   int segprocessed = 0;			//Segments processed by the coordsys
   bool fail = false;			//Fail flag
 
@@ -1643,28 +2826,29 @@ asynStatus GalilController::startLinearProfileCoordsys(int coordsys, char coordN
   //Execute motor record prem
   executePrem(axes);
 
-  //Begin the move
-  //Get time when attempt motor begin
-  epicsTimeGetCurrent(&begin_begint_);
-  sprintf(cmd_, "BG %c", coordName);
-  if (sync_writeReadController() == asynSuccess)
+  //Begin the move now, or when armed profile is triggered
+  sprintf(begin, "BG %c", coordName);
+  status = (prof->trigger->arm()) ? waitProfileTrigger(prof, begin) : beginProfile(prof, begin);
+  //Get time when motor begin attempted
+  epicsTimeGetCurrent(&beginTime);
+  if (status == asynSuccess)
      {
-     unlock();
-     while (segprocessed < 1 && !profileAbort_) //Pause until 1 segment processed
+     unlockProfileStream(prof);
+     while (segprocessed < 1 && !prof->abort) //Pause until 1 segment processed
         {
         epicsThreadSleep(.001);
-        epicsTimeGetCurrent(&begin_nowt_);
+        epicsTimeGetCurrent(&nowTime);
         //Calculate time begin has taken so far
-        begin_time = epicsTimeDiffInSeconds(&begin_nowt_, &begin_begint_);
+        begin_time = epicsTimeDiffInSeconds(&nowTime, &beginTime);
         if (begin_time > BEGIN_TIMEOUT)
            {
            fail = true;
            break;  //Timeout, give up
            }
         //Segments processed
-	getIntegerParam(coordsys, GalilCoordSysSegments_, &segprocessed);
+	getIntegerParam(prof->coordsys, GalilCoordSysSegments_, &segprocessed);
         }
-     lock();
+     lockProfileStream(prof);
      }
   else  //Controller gave error at begin
      fail = true;
@@ -1673,51 +2857,96 @@ asynStatus GalilController::startLinearProfileCoordsys(int coordsys, char coordN
      {
      strcpy(message, "Profile start failed...\n");
      //Store message in ParamList
-     setStringParam(profileExecuteMessage_, message);
-     callParamCallbacks();
+     setStringParam(prof->index, profileExecuteMessage_, message);
+     callParamCallbacks(prof->index);
      return asynError;	//Return error
      }
 
   //Start success
-  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_EXECUTING);
+  setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_EXECUTING);
   strcpy(message, "Profile executing...");
   //Store message in ParamList
-  setStringParam(profileExecuteMessage_, message);
-  callParamCallbacks();
+  setStringParam(prof->index, profileExecuteMessage_, message);
+  callParamCallbacks(prof->index);
   //Return success
   return asynSuccess;
 }
 
+/* Pack linear interpolation segments from the profile buffer into cmd_
+ * As many segments as fit on one controller command line are packed, up to maxSegments
+ * Coordsys is selected first on every line, as a profile on the other coordsys may select its own between lines
+ * Free space query for the coordsys buffer is placed next so response reports space before these segments
+ * query is false if the first segment alone does not fit with the query
+ * Returns number of segments packed */
+unsigned GalilController::packLinearSegments(GalilProfileContext *prof, char coordName, size_t segment, int maxSegments, bool *query)
+{
+  char text[MAX_GALIL_STRING_SIZE];	//Formatted segment
+  size_t segments = prof->buffer->segments();	//Segments in profile buffer
+  size_t len, tlen;			//Line, and segment length
+  unsigned packed = 0;			//Segments packed
+
+  //Select coordsys, and free space query
+  len = sprintf(cmd_, "CA %c;MG _LM%c", coordName, coordName);
+  *query = true;
+  while ((int)packed < maxSegments && segment + packed < segments)
+	{
+	tlen = prof->buffer->format(segment + packed, text, sizeof(text));
+	if (len + tlen + 4 > MAX_GALIL_LINE)
+		{
+		if (packed)
+			break;
+		//First segment alone is too long for the query, send segment without it
+		len = sprintf(cmd_, "CA %c", coordName);
+		*query = false;
+		}
+	len += sprintf(cmd_ + len, ";LI %s", text);
+	packed++;
+	if (!*query)
+		break;
+	}
+
+  return packed;
+}
+
 /* Function to run trajectory.  It runs in a dedicated thread, so it's OK to block.
  * It needs to lock and unlock when it accesses class data. */ 
-asynStatus GalilController::runLinearProfile(FILE *profFile)
+asynStatus GalilController::runLinearProfile(GalilProfileContext *prof)
 {
   long maxAcceleration;			//Max acceleration for this controller
   int segsent;				//Segments loaded to controller so far
-  char moves[MAX_GALIL_STRING_SIZE];	//Segment move command assembled for controller
   char message[MAX_GALIL_STRING_SIZE];	//Profile execute message
-  char axes[MAX_GALIL_AXES];		//Motors involved in profile move
+  char axes[MAX_GALIL_AXES + 1];	//Motors involved in profile move
   int coordsys;				//Coordinate system S(0) or T(1)
+  int selected;				//Coordinate system selected by user S(0) or T(1)
   int coordName;			//Coordinate system S or T
   bool profStarted = false;		//Has profile execution started
   bool atStart = false;			//Have the motors arrived at the start position
   int segprocessed;			//Segments processed by coordsys
   int csmoving;				//Moving status of coordinate system
-  int retval;				//Return value from file read
-  bool bufferNext = true;		//Controller ready to buffer next segment
+  size_t segment = 0;			//Next segment in profile buffer
+  size_t segments;			//Segments in profile buffer
+  unsigned sent;			//Segments sent on last command line
+  int freeSpace;			//Free space in controller segment buffer
+  int bufferSize;			//Controller segment buffer size
+  int buffered = 0;			//Segments in controller buffer waiting to be processed
+  int lowWater;				//Lowest buffered segments whilst executing
+  bool query = false;			//Free space was read on last command line
+  double sendTime = 0.0;		//Time spent downloading segments
+  epicsTimeStamp sendBegin, sendEnd;	//Segment download times
   GalilAxis *pAxis;			//GalilAxis
   unsigned index;			//looping
-  double startp[MAX_GALIL_AXES];	//Motor start positions from file
+  double startp[MAX_GALIL_AXES];	//Motor start positions from profile buffer
   asynStatus status;			//Error status
 
-  //Retrieve currently selected coordinate system 
-  getIntegerParam(GalilCoordSys_, &coordsys);
+  //Coordinate system chosen when profile execute was requested
+  coordsys = prof->coordsys;
 
   //Selected coordinate system name
   coordName = (coordsys == 0 ) ? 'S' : 'T';
 
-  //Read profFile and determine which motors are involved
-  retval = fscanf(profFile, "%s\n", axes);
+  //Determine which motors are involved
+  strcpy(axes, prof->buffer->axes());
+  segments = prof->buffer->segments();
   //Update coordinate system motor list at record layer
   setStringParam(coordsys, GalilCoordSysMotors_, axes);
   //Loop through the axes list for this coordinate system
@@ -1731,21 +2960,19 @@ asynStatus GalilController::runLinearProfile(FILE *profFile)
         {
         //Show disabled message in profile message area
         sprintf(message, "%c disabled due to digital input", pAxis->axisName_);
-        setStringParam(profileExecuteMessage_, message);
-        setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_FAILURE);
-        setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
-        callParamCallbacks();
+        setStringParam(prof->index, profileExecuteMessage_, message);
+        setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+        setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_DONE);
+        callParamCallbacks(prof->index);
         return asynSuccess;  //Nothing to do
         }
      }
 
   //Set vector acceleration/decceleration
-  maxAcceleration = 67107840;
-  if (model_[0] == 'D' && model_[3] == '4')
-	maxAcceleration = 1073740800;
+  maxAcceleration = modelMaxAcceleration();
 
   //Called without lock, and we need it to call sync_writeReadController
-  lock();
+  lockProfileStream(prof);
 
   //Set vector acceleration/decceleration
   sprintf(cmd_, "VA%c=%ld;VD%c=%ld", coordName, maxAcceleration, coordName, maxAcceleration);
@@ -1760,152 +2987,185 @@ asynStatus GalilController::runLinearProfile(FILE *profFile)
   //Number of segments processed by coordsys
   segprocessed = 0;
   //Profile has not been aborted
-  profileAbort_ = false;
+  prof->abort = false;
 
   //Set linear interpolation mode and include motor list provided
-  sprintf(cmd_, "LM %s", axes);
+  sprintf(cmd_, "CA %c;LM %s", coordName, axes);
+  sync_writeReadController();
+
+  //Free space in coordsys buffer now its clear
+  sprintf(cmd_, "MG _LM%c", coordName);
   sync_writeReadController();
+  bufferSize = freeSpace = atoi(resp_);
+  if (bufferSize <= 0)
+	bufferSize = freeSpace = MAX_SEGMENTS;
+  //No download statistics yet
+  lowWater = bufferSize;
+  setDoubleParam(prof->index, GalilProfileSegmentRate_, 0.0);
+  setIntegerParam(prof->index, GalilProfileLowWater_, lowWater);
 
   //Move motors to start position, and return start position values here
-  status = motorsToProfileStartPosition(profFile, axes, startp);
+  status = motorsToProfileStartPosition(prof, axes, startp);
 
-  unlock();
+  unlockProfileStream(prof);
 
   //Execute the profile
-  //Loop till file downloaded to buffer, or error, or abort
-  while (retval != EOF && !status && !profileAbort_)
+  //Loop till profile buffer downloaded to controller, or error, or abort
+  //Controller buffer is topped up as soon as there is space
+  //Free space is read on the same line as the segments, and is not stale like the data record segment count
+  while (segment < segments && !status && !prof->abort)
 	{
-	if (bufferNext)		//Read the segment
-		retval = fscanf(profFile, "%s\n", moves);
-	lock();
-	//Process segment if didnt hit EOF
-	if (retval != EOF)
+	lockProfileStream(prof);
+	//Coordsys moving status
+	getIntegerParam(coordsys, GalilCoordSysMoving_, &csmoving);
+
+	//Case where profile has started, but then stopped
+	if ((profStarted && !csmoving))
 		{
-		//Segments processed
-		getIntegerParam(coordsys, GalilCoordSysSegments_, &segprocessed);
-		//Coordsys moving status
-		getIntegerParam(coordsys, GalilCoordSysMoving_, &csmoving);
+		unlockProfileStream(prof);
+		break;	//break from loop
+		}
 
-		//Case where profile has started, but then stopped
-		if ((profStarted && !csmoving))
+	//Check if motors arrived at start position
+	if (!profStarted && !atStart)
+		{
+		//Abort if motor stopped and not at start position, or limit
+		if (!allMotorsMoving(axes))
+			status = motorsAtStart(axes, startp) ? asynSuccess : asynError;
+		if (!anyMotorMoving(axes))
 			{
-			unlock();
-			//Give other threads a chance to get the lock
-			epicsThreadSleep(0.001);
-			break;	//break from loop
+			status = motorsAtStart(axes, startp) ? asynSuccess : asynError;
+			atStart = (status) ? false : true;
 			}
+		}
 
-		//Check if motors arrived at start position
-		if (!profStarted && !atStart)
+	//Buffer next segments if no error, user hasnt pressed abort, there is buffer space
+	if (!status && !prof->abort && freeSpace > 0)
+		{
+		//Pack as many segments as fit on one command line
+		sent = packLinearSegments(prof, coordName, segment, freeSpace, &query);
+		epicsTimeGetCurrent(&sendBegin);
+		status = sync_writeReadController();
+		epicsTimeGetCurrent(&sendEnd);
+		//Time spent downloading, used to calculate achievable segment rate
+		sendTime += epicsTimeDiffInSeconds(&sendEnd, &sendBegin);
+		if (status)
 			{
-			//Abort if motor stopped and not at start position, or limit
-			if (!allMotorsMoving(axes))
-				status = motorsAtStart(axes, startp) ? asynSuccess : asynError;
-			if (!anyMotorMoving(axes))
-				{
-				status = motorsAtStart(axes, startp) ? asynSuccess : asynError;
-				atStart = (status) ? false : true;
-				}
+			unlockProfileStream(prof);
+			epicsThreadSleep(.2);
+			lockProfileStream(prof);
+			abortProfile(prof);
+			strcpy(message, "Error downloading segment");
+			setStringParam(prof->index, profileExecuteMessage_, message);
 			}
-
-		//Buffer next segment if no error, user hasnt pressed abort, there is buffer space
-		if (!status && !profileAbort_ && bufferNext)
+		else
 			{
-			//Proceed to send next segment to controller
-			sprintf(cmd_, "LI %s", moves);
-			status = sync_writeReadController();
-			if (status)
+			//Increment segments sent to controller
+			segsent += sent;
+			segment += sent;
+			//Free space before these segments is reported first on the line
+			if (query)
 				{
-				unlock();
-				epicsThreadSleep(.2);
-				lock();
-				abortProfile();
-				strcpy(message, "Error downloading segment");
-				setStringParam(profileExecuteMessage_, message);
+				buffered = bufferSize - atoi(resp_);
+				freeSpace = atoi(resp_) - sent;
 				}
-			else	//Increment segments sent to controller
-				segsent++;
+			else
+				freeSpace -= sent;
+			//Let a profile streaming on the other coordinate system send its next command line
+			yieldProfileStream(prof);
 			}
+		}
 
-		//Ensure segs are being sent faster than can be processed by controller
-		if (((segsent - segprocessed) <= 5) && profStarted && !status && !profileAbort_)
+	//Ensure segs are being sent faster than can be processed by controller
+	if (query && profStarted && !status && !prof->abort)
+		{
+		//Track buffer low water mark
+		lowWater = (buffered < lowWater) ? buffered : lowWater;
+		if (buffered <= PROFILE_MIN_BUFFERED)
 			{
-			unlock();
-			epicsThreadSleep(.2);
-			lock();
-			abortProfile();
+			abortProfile(prof);
 			strcpy(message, "Profile time base too fast\n");
-			setStringParam(profileExecuteMessage_, message);
+			setStringParam(prof->index, profileExecuteMessage_, message);
 			//break loop
 			status = asynError;
 			}
+		}
+	query = false;
 
-		//Default bufferNext true before checking buffer
-		bufferNext = true;
-		//Check buffer, and abort status
-		if ((segsent - segprocessed) >= MAX_SEGMENTS && !status && !profileAbort_)
+	//Check buffer, and abort status
+	if (freeSpace <= 0 && !status && !prof->abort)
+		{
+		//Segment buffer is full, and user has not pressed abort
+		if (!profStarted && atStart)
 			{
-			//Segment buffer is full, and user has not pressed abort
-
-			//Dont buffer next segment	
-			//Give time for motors to arrive at start, or
-			//Give time for controller to process a segment
-			if ((anyMotorMoving(axes) && !profStarted) || profStarted)
-				{
-				unlock();
-				epicsThreadSleep(.01);
-				bufferNext = false;
-				lock();
-				}
-
 			//Case where motors were moving to start position, and now complete, profile is not started.
-			if (!profStarted && atStart && !status && !profileAbort_)
+			//Start the profile
+			status = startLinearProfileCoordsys(prof, coordName, axes);
+			profStarted = (status) ? false : true;
+			}
+		else
+			{
+			//Publish download statistics whilst waiting
+			setDoubleParam(prof->index, GalilProfileSegmentRate_, (sendTime > 0) ? segsent / sendTime : 0.0);
+			setIntegerParam(prof->index, GalilProfileLowWater_, lowWater);
+			callParamCallbacks(prof->index);
+			//Give time for motors to arrive at start, or
+			//Give time for controller to process segments
+			//Wait for next data record
+			unlockProfileStream(prof);
+			epicsEventWaitWithTimeout(prof->streamEvent, BEGIN_TIMEOUT);
+			lockProfileStream(prof);
+			//Read free space once profile is executing
+			if (profStarted)
 				{
-				//Start the profile
-				status = startLinearProfileCoordsys(coordsys, coordName, axes);
-				profStarted = (status) ? false : true;
-				//Buffer next if started ok
-				if (!status)
-					bufferNext = true;
+				sprintf(cmd_, "MG _LM%c", coordName);
+				if (sync_writeReadController() == asynSuccess)
+					{
+					freeSpace = atoi(resp_);
+					buffered = bufferSize - freeSpace;
+					query = true;
+					}
 				}
 			}
 		}
 
-	unlock();
-	//Give other threads a chance to get the lock
-	epicsThreadSleep(0.001);
+	unlockProfileStream(prof);
 	}
 
-  lock();
+  lockProfileStream(prof);
 
   //All segments have been sent to controller
   //End linear interpolation mode
-  strcpy(cmd_, "LE");
+  sprintf(cmd_, "CA %c;LE", coordName);
+  sync_writeReadController();
+  //Restore selected coordinate system
+  getIntegerParam(GalilCoordSys_, &selected);
+  sprintf(cmd_, "CA %c", (selected) ? 'T' : 'S');
   sync_writeReadController();
 
   //Check if motors still moving to start position
-  if (!profStarted && !status && !profileAbort_)
+  if (!profStarted && !status && !prof->abort)
 	{
 	//Pause till motors stop
 	while (anyMotorMoving(axes))
 		{
-		unlock();
+		unlockProfileStream(prof);
 		epicsThreadSleep(.01);
-		lock();
+		lockProfileStream(prof);
 		}
 	
 	//Start short profiles that fit entirely in the controller buffer <= MAX_SEGMENTS
 	//If motors at start position, begin profile
 	if (motorsAtStart(axes, startp))
 		{
-		status = startLinearProfileCoordsys(coordsys, coordName, axes);
+		status = startLinearProfileCoordsys(prof, coordName, axes);
 		profStarted = (status) ? false : true;
 		}
 	}
  
   //Profile not started, and motors still moving, stop them
   if (!profStarted && anyMotorMoving(axes))
-  	motorsToProfileStartPosition(profFile, axes, startp, false);  //Stop motors moving to start position
+  	motorsToProfileStartPosition(prof, axes, startp, false);  //Stop motors moving to start position
 
   //Finish up
   if (!status)
@@ -1918,9 +3178,9 @@ asynStatus GalilController::runLinearProfile(FILE *profFile)
 			{
 			getIntegerParam(coordsys, GalilCoordSysMoving_, &csmoving);
 			//Restrict loop frequency
-			unlock();
+			unlockProfileStream(prof);
 			epicsThreadSleep(.01);
-			lock();
+			lockProfileStream(prof);
 			}
 		}
 
@@ -1930,74 +3190,634 @@ asynStatus GalilController::runLinearProfile(FILE *profFile)
 	//Were all segments processed by controller
 	if (segprocessed == segsent)
 		{
-		setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_SUCCESS);
+		setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_SUCCESS);
 		strcpy(message, "Profile completed successfully");
-		setStringParam(profileExecuteMessage_, message);
+		setStringParam(prof->index, profileExecuteMessage_, message);
 		}
 	else
 		{
 		//Not all segments were processed
-		setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_FAILURE);
-		if (profileAbort_)
+		setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+		if (prof->abort)
 			strcpy(message, "Profile was stopped by user");
 		else
 			strcpy(message, "Profile was stopped by limit switch or other motor/encoder problem");
-		setStringParam(profileExecuteMessage_, message);
+		setStringParam(prof->index, profileExecuteMessage_, message);
 		}
 	}
   else  //Coordinate system didnt start, or aborted by user
-	setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+	setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+
+  //Download statistics
+  setDoubleParam(prof->index, GalilProfileSegmentRate_, (sendTime > 0) ? segsent / sendTime : 0.0);
+  setIntegerParam(prof->index, GalilProfileLowWater_, lowWater);
 
   //Update status
-  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
-  callParamCallbacks();
-  unlock();
+  setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_DONE);
+  callParamCallbacks(prof->index);
+  unlockProfileStream(prof);
+
+  return asynSuccess;
+}
+
+/* Convenience function to begin profile motion on a motor list, rather than a coordinate system
+   Called after filling the controller buffer
+   \param[in] begin - Command that begins motion (eg. BT ABC, or DT 3)
+   \param[in] axes - Motor list
+*/
+asynStatus GalilController::startProfileAxes(GalilProfileContext *prof, const char *begin, char *axes)
+{
+  char message[MAX_GALIL_STRING_SIZE];	//Profile execute message
+  asynStatus status;			//Begin status
+  double begin_time;			//Time taken to begin
+  epicsTimeStamp beginTime, nowTime;	//Used to track length of time begin takes
+  bool fail = false;			//Fail flag
+
+  //Execute motor auto on and brake off function
+  executeAutoOnBrakeOff(axes);
+
+  //Execute motor record prem
+  executePrem(axes);
+
+  //Begin the move now, or when armed profile is triggered
+  status = (prof->trigger->arm()) ? waitProfileTrigger(prof, begin) : beginProfile(prof, begin);
+  //Get time when motor begin attempted
+  epicsTimeGetCurrent(&beginTime);
+  if (status == asynSuccess)
+     {
+     unlockProfileStream(prof);
+     while (!prof->abort) //Pause until motors are moving
+        {
+        epicsThreadSleep(.001);
+        epicsTimeGetCurrent(&nowTime);
+        //Calculate time begin has taken so far
+        begin_time = epicsTimeDiffInSeconds(&nowTime, &beginTime);
+        if (begin_time > BEGIN_TIMEOUT)
+           {
+           fail = true;
+           break;  //Timeout, give up
+           }
+        lockProfileStream(prof);
+        if (anyMotorMoving(axes))
+           {
+           unlockProfileStream(prof);
+           break;
+           }
+        unlockProfileStream(prof);
+        }
+     lockProfileStream(prof);
+     }
+  else  //Controller gave error at begin
+     fail = true;
+
+  if (fail)
+     {
+     strcpy(message, "Profile start failed...\n");
+     //Store message in ParamList
+     setStringParam(prof->index, profileExecuteMessage_, message);
+     callParamCallbacks(prof->index);
+     return asynError;	//Return error
+     }
+
+  //Start success
+  setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_EXECUTING);
+  strcpy(message, "Profile executing...");
+  //Store message in ParamList
+  setStringParam(prof->index, profileExecuteMessage_, message);
+  callParamCallbacks(prof->index);
+  //Return success
+  return asynSuccess;
+}
+
+/* Function to run PVT, or contour trajectory.  It runs in a dedicated thread, so it's OK to block.
+ * PVT profiles use controller PVT mode where the model supports it, otherwise contour mode with slices interpolated here
+ * Contour profiles always use contour mode, with slices resampled here
+ * Motors are moved to the start position first, as PVT and contour mode need the motors stopped
+ * It needs to lock and unlock when it accesses class data. */ 
+asynStatus GalilController::runPVTProfile(GalilProfileContext *prof)
+{
+  char message[MAX_GALIL_STRING_SIZE];	//Profile execute message
+  char axes[MAX_GALIL_AXES + 1];	//Motors involved in profile move
+  char text[MAX_GALIL_STRING_SIZE];	//Next command to send
+  char query[MAX_GALIL_STRING_SIZE];	//Free buffer space query
+  char begin[MAX_GALIL_STRING_SIZE];	//Command to begin motion
+  GalilProfileCursor cursor;		//Position in profile whilst generating commands
+  bool contour;				//Use contour mode
+  bool pending;				//Command in text waiting to be sent
+  bool slot;				//Pending command uses a controller buffer segment
+  bool profStarted = false;		//Has profile execution started
+  bool queried;				//Free space was read on last command line
+  int freeSpace = 0;			//Free space in controller buffer
+  int bufferSize = 0;			//Controller buffer size
+  int buffered;				//Segments in controller buffer waiting to be processed
+  int lowWater;				//Lowest buffered segments whilst executing
+  int segsent = 0;			//Segments loaded to controller so far
+  int sent;				//Segments sent on last command line
+  int executed = 0;			//Segments executed by controller
+  size_t len;				//Command line length
+  double sendTime = 0.0;		//Time spent downloading segments
+  epicsTimeStamp sendBegin, sendEnd;	//Segment download times
+  GalilAxis *pAxis;			//GalilAxis
+  unsigned index;			//looping
+  double startp[MAX_GALIL_AXES];	//Motor start positions from profile buffer
+  asynStatus status;			//Error status
+
+  //Determine which motors are involved
+  strcpy(axes, prof->buffer->axes());
+  //Contour mode for contour profiles, and PVT profiles on models without PVT mode
+  contour = (prof->buffer->type() == PROFILE_CONTOUR || !modelPVT());
+  //Loop through the axes list
+  //Ensure all motors are enabled
+  for (index = 0; index < strlen(axes); index++)
+     {
+     //Retrieve axis specified in axes list
+     pAxis = getAxis(axes[index] - AASCII);
+     if (!pAxis) continue;
+     if (!pAxis->motor_enabled())
+        {
+        //Show disabled message in profile message area
+        sprintf(message, "%c disabled due to digital input", pAxis->axisName_);
+        setStringParam(prof->index, profileExecuteMessage_, message);
+        setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+        setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_DONE);
+        callParamCallbacks(prof->index);
+        return asynSuccess;  //Nothing to do
+        }
+     }
+
+  //Called without lock, and we need it to call sync_writeReadController
+  lockProfileStream(prof);
+
+  //Profile has not been aborted
+  prof->abort = false;
+
+  //Move motors to start position, and return start position values here
+  status = motorsToProfileStartPosition(prof, axes, startp);
+
+  //Wait for motors to arrive at start
+  while (!status && !prof->abort && anyMotorMoving(axes))
+	{
+	unlockProfileStream(prof);
+	epicsEventWaitWithTimeout(prof->streamEvent, BEGIN_TIMEOUT);
+	lockProfileStream(prof);
+	}
+  if (!status && !prof->abort && !motorsAtStart(axes, startp))
+	status = asynError;
+
+  //Enter profile mode, and read buffer size
+  if (!status && !prof->abort)
+	{
+	if (contour)
+		{
+		//Contour mode, paused until buffer is filled
+		sprintf(cmd_, "CM %s;DT -1", axes);
+		status = sync_writeReadController();
+		strcpy(query, "MG _CM");
+		sprintf(begin, "DT %d", prof->buffer->contourExponent());
+		}
+	else
+		{
+		//PVT segments are buffered per axis, first axis is always sent first so has least free space
+		sprintf(query, "MG _PV%c", axes[0]);
+		sprintf(begin, "BT %s", axes);
+		}
+	strcpy(cmd_, query);
+	if (!status && sync_writeReadController() == asynSuccess)
+		bufferSize = freeSpace = atoi(resp_);
+	if (bufferSize <= 0)
+		{
+		strcpy(message, (contour) ? "Contour mode not available" : "PVT mode not available");
+		setStringParam(prof->index, profileExecuteMessage_, message);
+		status = asynError;
+		}
+	}
+
+  //No download statistics yet
+  lowWater = bufferSize;
+  buffered = 0;
+  setDoubleParam(prof->index, GalilProfileSegmentRate_, 0.0);
+  setIntegerParam(prof->index, GalilProfileLowWater_, lowWater);
+
+  //Generate first command
+  prof->buffer->startCursor(&cursor, contour, prof->buffer->contourExponent());
+  pending = prof->buffer->nextCommand(&cursor, text, sizeof(text), &slot);
+
+  //Execute the profile
+  //Loop till all commands downloaded to controller, or error, or abort
+  //Controller buffer is topped up as soon as there is space
+  while (pending && !status && !prof->abort)
+	{
+	//Case where profile has started, but then stopped
+	if (profStarted && !anyMotorMoving(axes))
+		break;
+
+	//Buffer next commands if there is buffer space
+	if (freeSpace > 0 || !slot)
+		{
+		//Free space query first, then as many commands as fit on one command line
+		len = sprintf(cmd_, "%s", query);
+		queried = true;
+		if (len + strlen(text) + 1 > MAX_GALIL_LINE)
+			{
+			//Command alone is too long for the query, send command without it
+			len = 0;
+			queried = false;
+			}
+		sent = 0;
+		do
+			{
+			len += sprintf(cmd_ + len, "%s%s", (len) ? ";" : "", text);
+			sent += (slot) ? 1 : 0;
+			pending = prof->buffer->nextCommand(&cursor, text, sizeof(text), &slot);
+			}
+		while (queried && pending && (!slot || sent < freeSpace) && len + strlen(text) + 1 <= MAX_GALIL_LINE);
+		epicsTimeGetCurrent(&sendBegin);
+		status = sync_writeReadController();
+		epicsTimeGetCurrent(&sendEnd);
+		//Time spent downloading, used to calculate achievable segment rate
+		sendTime += epicsTimeDiffInSeconds(&sendEnd, &sendBegin);
+		if (status)
+			{
+			abortProfile(prof);
+			strcpy(message, "Error downloading segment");
+			setStringParam(prof->index, profileExecuteMessage_, message);
+			break;
+			}
+		segsent += sent;
+		//Free space before these commands is reported first on the line
+		if (queried)
+			{
+			buffered = bufferSize - atoi(resp_);
+			freeSpace = atoi(resp_) - sent;
+			}
+		else
+			freeSpace -= sent;
+		//Ensure segs are being sent faster than can be processed by controller
+		if (queried && profStarted)
+			{
+			//Track buffer low water mark
+			lowWater = (buffered < lowWater) ? buffered : lowWater;
+			if (buffered <= PROFILE_MIN_BUFFERED)
+				{
+				abortProfile(prof);
+				strcpy(message, "Profile time base too fast\n");
+				setStringParam(prof->index, profileExecuteMessage_, message);
+				status = asynError;
+				break;
+				}
+			}
+		//Let a profile streaming on the other coordinate system send its next command line
+		yieldProfileStream(prof);
+		}
+
+	//Buffer full
+	if (pending && slot && freeSpace <= 0 && !prof->abort)
+		{
+		if (!profStarted)
+			{
+			//Motors are at start, and buffer is full.  Start the profile
+			status = startProfileAxes(prof, begin, axes);
+			profStarted = (status) ? false : true;
+			}
+		else
+			{
+			//Publish download statistics whilst waiting
+			setDoubleParam(prof->index, GalilProfileSegmentRate_, (sendTime > 0) ? segsent / sendTime : 0.0);
+			setIntegerParam(prof->index, GalilProfileLowWater_, lowWater);
+			callParamCallbacks(prof->index);
+			//Give time for controller to process segments
+			//Wait for next data record
+			unlockProfileStream(prof);
+			epicsEventWaitWithTimeout(prof->streamEvent, BEGIN_TIMEOUT);
+			lockProfileStream(prof);
+			//Read free space
+			strcpy(cmd_, query);
+			if (sync_writeReadController() == asynSuccess)
+				{
+				freeSpace = atoi(resp_);
+				buffered = bufferSize - freeSpace;
+				lowWater = (buffered < lowWater) ? buffered : lowWater;
+				}
+			}
+		}
+	}
+
+  //Start short profiles that fit entirely in the controller buffer
+  if (!profStarted && !status && !prof->abort)
+	{
+	status = startProfileAxes(prof, begin, axes);
+	profStarted = (status) ? false : true;
+	}
+
+  //Loop until motors stop
+  while (profStarted && anyMotorMoving(axes))
+	{
+	unlockProfileStream(prof);
+	epicsEventWaitWithTimeout(prof->streamEvent, BEGIN_TIMEOUT);
+	lockProfileStream(prof);
+	}
+
+  //Finish up
+  if (!status && profStarted)
+	{
+	//Were all segments executed by controller
+	if (contour)
+		{
+		//Contour buffer is empty when all slices have executed
+		strcpy(cmd_, query);
+		if (sync_writeReadController() == asynSuccess)
+			executed = (atoi(resp_) == bufferSize) ? segsent : 0;
+		}
+	else
+		{
+		//PVT segments executed
+		sprintf(cmd_, "MG _BT%c", axes[0]);
+		if (sync_writeReadController() == asynSuccess)
+			executed = atoi(resp_);
+		}
+	//Contour slice count differs from the profile segment count, all slices sent must have executed
+	if (!pending && !prof->abort && ((contour) ? (executed == segsent) : (executed >= (int)prof->buffer->segments())))
+		{
+		setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_SUCCESS);
+		strcpy(message, "Profile completed successfully");
+		setStringParam(prof->index, profileExecuteMessage_, message);
+		}
+	else
+		{
+		//Not all segments were processed
+		setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+		if (prof->abort)
+			strcpy(message, "Profile was stopped by user");
+		else
+			strcpy(message, "Profile was stopped by limit switch or other motor/encoder problem");
+		setStringParam(prof->index, profileExecuteMessage_, message);
+		}
+	}
+  else  //Profile didnt start, or aborted by user
+	{
+	//Stop motors moving to start position
+	if (anyMotorMoving(axes))
+		motorsToProfileStartPosition(prof, axes, startp, false);
+	setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+	}
+
+  //Download statistics
+  setDoubleParam(prof->index, GalilProfileSegmentRate_, (sendTime > 0) ? segsent / sendTime : 0.0);
+  setIntegerParam(prof->index, GalilProfileLowWater_, lowWater);
+
+  //Update status
+  setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_DONE);
+  callParamCallbacks(prof->index);
+  unlockProfileStream(prof);
 
   return asynSuccess;
 }
 
 /* Function to run trajectory.  It runs in a dedicated thread, so it's OK to block.
  * It needs to lock and unlock when it accesses class data. */ 
-asynStatus GalilController::runProfile()
+asynStatus GalilController::runProfile(GalilProfileContext *prof)
 {
   int status = asynError;		//Execute status
-  char fileName[MAX_FILENAME_LEN];	//Filename to read profile data from
-  char profType[MAX_GALIL_STRING_SIZE];	//Segment move command assembled for controller
   char message[MAX_GALIL_STRING_SIZE];	//Profile run message
-  FILE *profFile;			//File handle for above file
 
-  //Retrieve required attributes from ParamList
-  getStringParam(GalilProfileFile_, (int)sizeof(fileName), fileName);
+  //Update execute profile status
+  setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_MOVE_START);
+  setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks(prof->index);
+    
+  //Call appropriate method to handle the built profile type
+  if (prof->buffer->type() == PROFILE_LINEAR)
+	status = runLinearProfile(prof);
+  else if (prof->buffer->type() == PROFILE_PVT || prof->buffer->type() == PROFILE_CONTOUR)
+	status = runPVTProfile(prof);
+  else
+	{
+	strcpy(message, "No trajectory built\n");
+	setStringParam(prof->index, profileExecuteMessage_, message);
+	setIntegerParam(prof->index, profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+	setIntegerParam(prof->index, profileExecuteState_, PROFILE_EXECUTE_DONE);
+	callParamCallbacks(prof->index);
+	}
+
+  //Profile finished, keep captured data records for readback
+  stopProfileCapture(prof);
+
+  return (asynStatus)status;
+}
+
+/* Send the command that begins a profile, and align capture with the sample counter at begin
+ * Reports execute, or trigger to begin latency.  Begin is taken to reach the controller half way through its round trip
+ * Called with lock */
+asynStatus GalilController::beginProfile(GalilProfileContext *prof, const char *begin)
+{
+  epicsTimeStamp sendTime, ackTime;	//Begin sent, and acknowledged
+  double latency;			//Execute, or trigger to begin latency
+  asynStatus status;
+
+  //Capture data records for profile readback from just before begin
+  startProfileCapture(prof, prof->buffer->axes());
+
+  epicsTimeGetCurrent(&sendTime);
+  //Sample counter at begin aligns captured data records with the profile time base
+  sprintf(cmd_, "MG TIME;%s", begin);
+  status = sync_writeReadController();
+  epicsTimeGetCurrent(&ackTime);
+  if (status == asynSuccess)
+     {
+     setProfileCaptureStart(prof, (unsigned)atol(resp_));
+     latency = epicsTimeDiffInSeconds(&sendTime, &prof->triggerTime);
+     latency += epicsTimeDiffInSeconds(&ackTime, &sendTime) / 2.0;
+     setDoubleParam(prof->index, GalilProfileTriggerLatency_, latency * 1000.0);
+     }
+
+  return status;
+}
+
+/* Armed profile waits here with motors at start, and controller buffer full
+ * Execute sends begin from triggerProfile, or controller code sends begin when the trigger input changes
+ * Called with lock
+ * \param[in] begin - Command that begins motion (eg. BG S, BT ABC, or DT 3) */
+asynStatus GalilController::waitProfileTrigger(GalilProfileContext *prof, const char *begin)
+{
+  char message[MAX_GALIL_STRING_SIZE];	//Profile execute message
+  int input, level;			//Digital input, and level that triggers profile
+  int moving = 0;			//Coordinate system moving
+  int thread;				//Controller thread running input trigger code
+  profileTriggerAction action;		//Begin now, wait for trigger, or abort
+
+  //Execute arrived whilst arming, begin now.  Abort whilst arming, dont begin
+  action = prof->trigger->ready();
+  if (action == TRIGGER_BEGIN)
+     return beginProfile(prof, begin);
+  if (action != TRIGGER_WAIT)
+     return asynError;
+
+  strcpy(prof->begin, begin);
+  input = prof->triggerInput;
+  getIntegerParam(prof->index, GalilProfileTriggerLevel_, &level);
+
+  if (input > 0)
+     {
+     //Capture must be running before controller code begins the profile
+     startProfileCapture(prof, prof->buffer->axes());
+     //Start controller code that waits for the input, then begins the coordinate system
+     thread = numThreads_ - 1;
+     sprintf(cmd_, "ptin=%d;ptlvl=%d;ptcs=%d;ptfired=-1;XQ #PTRIG,%d", input, (level) ? 1 : 0, prof->coordsys, thread);
+     if (sync_writeReadController() != asynSuccess)
+        {
+        strcpy(message, "Input trigger code not found on controller, profile not armed\n");
+        setStringParam(prof->index, profileExecuteMessage_, message);
+        callParamCallbacks(prof->index);
+        prof->trigger->abort();
+        return asynError;
+        }
+     prof->triggerThread = thread;
+     }
+
+  setIntegerParam(prof->index, GalilProfileArmed_, 1);
+  strcpy(message, "Profile armed, waiting for trigger\n");
+  setStringParam(prof->index, profileExecuteMessage_, message);
+  callParamCallbacks(prof->index);
+
+  //Wait for execute, trigger input, or abort
+  while (prof->trigger->waiting() && !prof->abort)
+     {
+     //Coordinate system moving, input trigger began the profile
+     if (prof->triggerThread >= 0)
+        {
+        getIntegerParam(prof->coordsys, GalilCoordSysMoving_, &moving);
+        if (moving)
+           {
+           prof->trigger->inputBegan();
+           break;
+           }
+        }
+     unlockProfileStream(prof);
+     epicsEventWaitWithTimeout(prof->triggerEvent, updatePeriod_ / 1000.0);
+     lockProfileStream(prof);
+     }
+
+  setIntegerParam(prof->index, GalilProfileArmed_, 0);
+
+  if (prof->triggerThread >= 0)
+     {
+     //Stop input trigger code, and align capture with the sample counter when input began the profile
+     sprintf(cmd_, "HX%d;MG ptfired", prof->triggerThread);
+     if (sync_writeReadController() == asynSuccess && atof(resp_) >= 0.0)
+        {
+        setProfileCaptureStart(prof, (unsigned)atof(resp_));
+        strcpy(message, "Profile triggered by input\n");
+        setStringParam(prof->index, profileExecuteMessage_, message);
+        }
+     prof->triggerThread = -1;
+     }
+  callParamCallbacks(prof->index);
+
+  if (prof->abort || prof->trigger->aborted())
+     return asynError;
+
+  return prof->triggerStatus;
+}
+
+//Start capturing data records for profile readback, discards previous capture
+void GalilController::startProfileCapture(GalilProfileContext *prof, const char *axes)
+{
+  epicsMutexLock(captureLock_);
+  prof->capture->start(axes);
+  epicsMutexUnlock(captureLock_);
+}
+
+//Store data record sample counter at profile begin, from MG TIME response
+void GalilController::setProfileCaptureStart(GalilProfileContext *prof, unsigned time)
+{
+  epicsMutexLock(captureLock_);
+  prof->capture->setStart(time);
+  epicsMutexUnlock(captureLock_);
+}
+
+//Stop capturing data records, capture is kept for readback
+void GalilController::stopProfileCapture(GalilProfileContext *prof)
+{
+  epicsMutexLock(captureLock_);
+  prof->capture->stop();
+  epicsMutexUnlock(captureLock_);
+}
+
+//Capture profile axis positions, and errors from the last data record
+//Called by GalilPoller after each data record whilst a profile executes
+//Each executing profile captures its own axes
+void GalilController::captureProfileRecord(void)
+{
+  int tp[MAX_GALIL_AXES];		//Encoder positions indexed by axis number
+  int td[MAX_GALIL_AXES];		//Aux encoder, or step positions
+  int te[MAX_GALIL_AXES];		//Position errors
+  char src[MAX_GALIL_STRING_SIZE];	//Data source to retrieve
+  GalilProfileCapture *capture;		//Profile capture
+  const char *axes;			//Captured axis list
+  int axisNo;				//Axis number
+  unsigned i, j;
+
+  if (recstatus_ != asynSuccess || !connected_)
+     return;
+
+  for (j = 0; j < COORDINATE_SYSTEMS; j++)
+     {
+     capture = profiles_[j].capture;
+     //Nothing to do unless capturing.  Checked without lock so poller isnt held up
+     if (!capture->active())
+        continue;
+
+     for (i = 0; i < MAX_GALIL_AXES; i++)
+        tp[i] = td[i] = te[i] = 0;
+
+     epicsMutexLock(captureLock_);
+     axes = capture->axes();
+     for (i = 0; axes[i] != '\0'; i++)
+        {
+        axisNo = axes[i] - AASCII;
+        sprintf(src, "_TP%c", axes[i]);
+        tp[axisNo] = (int)sourceValue(recdata_, src);
+        sprintf(src, "_TD%c", axes[i]);
+        td[axisNo] = (int)sourceValue(recdata_, src);
+        sprintf(src, "_TE%c", axes[i]);
+        te[axisNo] = (int)sourceValue(recdata_, src);
+        }
+     capture->add((unsigned)sourceValue(recdata_, "TIME"), tp, td, te);
+     epicsMutexUnlock(captureLock_);
+     }
+}
+
+//Controller lock profile streams take turns with
+void GalilStreamLock::lock(void)
+{
+  pC_->lock();
+}
+
+void GalilStreamLock::unlock(void)
+{
+  pC_->unlock();
+}
 
-  //Update execute profile status
-  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_MOVE_START);
-  setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_UNDEFINED);
-  callParamCallbacks();
-    
-  //Open the profile file
-  profFile =  fopen(fileName, "rt");
+//Obtain lock for a profile thread
+//Other profile thread yields to this one after its next command line
+void GalilController::lockProfileStream(GalilProfileContext *prof)
+{
+  streamTurns_->lock(prof->index);
+}
 
-  if (profFile != NULL)
-	{
-	//Read file header
-	//LINEAR or PVT type
-	fscanf(profFile, "%s\n", profType);
-	//Call appropriate method to handle this profile type
-	if (!abs(strcmp(profType, "LINEAR")))
-		status = runLinearProfile(profFile);
-	//Done, close the file
-	fclose(profFile);
-	}
-  else
-	{
-	strcpy(message, "Can't open trajectory file\n");
-	setStringParam(profileExecuteMessage_, message);
-	setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_FAILURE);
-	setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
-	callParamCallbacks();
-	}
+//Release lock for a profile thread
+//Wakes the other profile thread if its waiting for this one to send a command line
+void GalilController::unlockProfileStream(GalilProfileContext *prof)
+{
+  streamTurns_->unlock(prof->index);
+}
 
-  return (asynStatus)status;
+//Called by a profile thread with lock after sending a command line
+//If the other profile thread is waiting to send, it is given the connection for one command line
+//So profiles streaming on S, and T at the same time take turns, rather than the first to lock filling its buffer
+void GalilController::yieldProfileStream(GalilProfileContext *prof)
+{
+  streamTurns_->yield(prof->index);
 }
 
 /**
@@ -2013,7 +3833,21 @@ asynStatus GalilController::runProfile()
  */
 asynStatus GalilController::executeSyncStartStopDeferredMove(int coordsys, char *axes, char *moves, double acceleration, double velocity)
 {
-  const char *functionName = "executeSyncStartStopDeferredMove";
+  vector<string> segments(1, moves);	//Deferred moves are a single segment
+
+  return executeLinearSegments(coordsys, axes, segments, acceleration, velocity);
+}
+
+/** Execute a contiguous sequence of linear interpolation (LI) segments on a coordinate system
+  * \param[in] coordsys - Coordinate system 0 (S) or 1 (T)
+  * \param[in] axes - Axis list in the coordinate system
+  * \param[in] segments - Comma list of relative moves for each LI segment, positional A-H
+  * \param[in] acceleration - Vector acceleration
+  * \param[in] velocity - Vector velocity
+  */
+asynStatus GalilController::executeLinearSegments(int coordsys, char *axes, const vector<string> &segments, double acceleration, double velocity)
+{
+  const char *functionName = "executeLinearSegments";
   GalilAxis *pAxis;		//GalilAxis pointer
   char coordName;		//Coordinate system name
   int csmoving = 0;		//Coordinate system moving status
@@ -2059,9 +3893,12 @@ asynStatus GalilController::executeSyncStartStopDeferredMove(int coordsys, char
   sprintf(cmd_, "VS%c=%.0lf", coordName, velocity);
   sync_writeReadController();
  
-  //Specify 1 segment
-  sprintf(cmd_, "LI %s", moves);
-  sync_writeReadController();
+  //Specify the segments
+  for (index = 0; index < segments.size(); index++)
+     {
+     epicsSnprintf(cmd_, sizeof(cmd_), "LI %s", segments[index].c_str());
+     sync_writeReadController();
+     }
 
   //End linear mode
   sprintf(cmd_, "LE");
@@ -2304,6 +4141,67 @@ asynStatus GalilController::prepareSyncStartOnlyDeferredMoves(void)
    return asynSuccess;
 }
 
+/** Prepare real axis on this controller for a sync start with axis on other controllers
+  * Sets velocity, acceleration, and position, but does not begin motion
+  * \param[in] axes - Axis list on this controller
+  * \param[in] npos - Absolute positions in axis list order Units=Steps
+  * \param[in] nvel - Velocities in axis list order Units=Steps/s
+  * \param[in] naccel - Accelerations in axis list order Units=Steps/s/s
+  */
+asynStatus GalilController::prepareSyncStart(const char *axes, double npos[], double nvel[], double naccel[])
+{
+  static const char *functionName = "prepareSyncStart";
+  GalilAxis *pAxis;		//GalilAxis instance
+  unsigned i;			//Looping
+
+  for (i = 0; i < strlen(axes); i++)
+     {
+     pAxis = getAxis(axes[i] - AASCII);
+     //Ensure motor is enabled
+     if (!pAxis || !pAxis->motor_enabled())
+        return asynError;
+     //Check velocity and wlp protection
+     if (pAxis->beginCheck(functionName, nvel[i]))
+        return asynError;
+     //Set the acceleration and velocity for this axis
+     pAxis->setAccelVelocity(naccel[i], nvel[i]);
+     //Set limits decel given velocity
+     pAxis->setLimitDecel(nvel[i]);
+     //Set position
+     sprintf(cmd_, "PA%c=%.0lf", pAxis->axisName_, npos[i]);
+     if (sync_writeReadController())
+        return asynError;
+     }
+
+  //Execute motor auto on and brake off function
+  executeAutoOnBrakeOff(axes);
+
+  //Execute motor record prem
+  executePrem(axes);
+
+  return asynSuccess;
+}
+
+/** Begin motion prepared by prepareSyncStart
+  * Controller begins motion when it receives the command, estimated as half the command round trip
+  * \param[in] axes - Axis list on this controller
+  * \param[out] start - Estimated time motion began
+  */
+asynStatus GalilController::beginSyncStart(const char *axes, epicsTimeStamp *start)
+{
+  epicsTimeStamp endt;		//Time begin acknowledged
+  asynStatus status;		//Begin status
+
+  epicsTimeGetCurrent(&begin_begint_);
+  sprintf(cmd_, "BG %s", axes);
+  status = sync_writeReadController();
+  epicsTimeGetCurrent(&endt);
+  *start = begin_begint_;
+  epicsTimeAddSeconds(start, epicsTimeDiffInSeconds(&endt, &begin_begint_) / 2.0);
+
+  return status;
+}
+
 /**
  * Process deferred moves for a controller
  * @return motor driver status code.
@@ -2836,6 +4734,21 @@ asynStatus GalilController::writeInt32(asynUser *pasynUser, epicsInt32 value)
 	{
 	status = setOutputCompare(addr);
 	}
+  else if (addr < COORDINATE_SYSTEMS && (function == profileBuild_ || function == profileExecute_ ||
+           function == profileAbort_ || function == profileReadback_ || function == GalilProfileArm_))
+	{
+	//Profile at address 0, and 1 each have their own context, so profiles on S, and T can run together
+	if (function == profileBuild_)
+		status = buildProfile(&profiles_[addr]);
+	else if (function == profileExecute_)
+		status = executeProfile(&profiles_[addr]);
+	else if (function == profileAbort_)
+		status = abortProfile(&profiles_[addr]);
+	else if (function == GalilProfileArm_)
+		status = (value) ? armProfile(&profiles_[addr]) : asynSuccess;
+	else
+		status = readbackProfile(&profiles_[addr]);
+	}
   else 
 	{
 	/* Call base class method */
@@ -2963,12 +4876,13 @@ asynStatus GalilController::writeOctet(asynUser *pasynUser, const char*  value,
   else if (function >= GalilCSMotorForward_ && function <= GalilCSMotorReverseH_)
      {
      //User has entered a new kinematic transform equation
-     //We MUST loop through all the cs axis
+     //Loop through all the cs axis, parsing only those that depend on the changed transform
      for (i = MAX_GALIL_AXES; i < MAX_GALIL_CSAXES + MAX_GALIL_AXES; i++)
         {
         //Retrieve the cs axis instance
         pCSAxis = getCSAxis(i);
         if (!pCSAxis) continue;
+        if (!pCSAxis->transformAffected(addr, function)) continue;
         //Parse the transforms and place results in GalilCSAxis instance(s)
         status |= pCSAxis->parseTransforms();
         }
@@ -3072,7 +4986,7 @@ void GalilController::getStatus(void)
    char src[MAX_GALIL_STRING_SIZE]="\0";	//data source to retrieve
    int addr;					//addr or byte of IO
    int start, end;				//start, and end of analog numbering for this controller
-   int coordsys;				//Coordinate system currently selected
+   int context;					//Profile context
    int profstate;				//Profile running state
    double paramDouble;				//For passing asynFloat64 to ParamList
    unsigned paramUDig;				//For passing UInt32Digital to ParamList
@@ -3158,12 +5072,6 @@ void GalilController::getStatus(void)
 	//Process unsolicited mesgs from controller
 	processUnsolicitedMesgs();
 
-	//Retrieve currently selected coordinate system 
-	getIntegerParam(GalilCoordSys_, &coordsys);
-
-	//Retrieve profile execute status
-	getIntegerParam(profileExecuteState_, &profstate);
-
 	//Coordinate system status
 	for (addr=0;addr<COORDINATE_SYSTEMS;addr++)
 		{
@@ -3175,11 +5083,13 @@ void GalilController::getStatus(void)
 		sprintf(src, "_CS%c", (addr) ? 'T' : 'S');
 		setIntegerParam(addr, GalilCoordSysSegments_, (int)sourceValue(recdata_, src));
 
-		//Update profile current point in ParamList
-		if ((addr == coordsys) && (profstate))
+		//Update current point in ParamList for linear profile executing on this coordinate system
+		for (context = 0; context < COORDINATE_SYSTEMS; context++)
 			{
-			//Update profile current point in ParamList
-			setIntegerParam(0, profileCurrentPoint_, (int)sourceValue(recdata_, src));
+			profstate = PROFILE_EXECUTE_DONE;
+			getIntegerParam(context, profileExecuteState_, &profstate);
+			if (profstate && profiles_[context].coordsys == addr && profiles_[context].buffer->type() == PROFILE_LINEAR)
+				setIntegerParam(context, profileCurrentPoint_, (int)sourceValue(recdata_, src));
 			}
 
 		//Coordinate system stopping status
@@ -3203,6 +5113,9 @@ asynStatus GalilController::poll(void)
 	//Extract controller data from data record, store in GalilController, and ParamList
 	getStatus();
 
+	//Check link health using age of last data record, and last command response
+	checkLinkHealth();
+
 	//Return value is not monitored by asynMotorController
 	return asynSuccess;
 }
@@ -3365,6 +5278,11 @@ void GalilController::acquireDataRecord(string cmd)
      {
      //No errors
      consecutive_timeouts_ = 0;
+     //Store data record receive time for link health check
+     lastRecordTime_ = endt_;
+     //Synchronous data record is also a command response
+     if (cmd == "QR")
+        lastCommandTime_ = endt_;
      //Clear contents from last cycle
      recdata_.clear();
      //Copy the returned data record into GalilController
@@ -3501,7 +5419,10 @@ asynStatus GalilController::sync_writeReadController(const char *output, char *i
   int target_terminators = (int)count(out_string.begin(), out_string.end(), ';') + 1;
   int found_terminators = 0;	//Terminator characters found so far
   unsigned char value;		//Used to identify unsolicited traffic
+  epicsTimeStamp begint;	//Command write time, used for link round trip time
  
+  //Command write time
+  epicsTimeGetCurrent(&begint);
   //Write the command
   status = pasynOctetSyncIO->write(pasynUserSyncGalil_, output, strlen(output), timeout_, &nwrite);
 
@@ -3564,9 +5485,133 @@ asynStatus GalilController::sync_writeReadController(const char *output, char *i
         sendUnsolicitedMessage(mesg);
      }
 
+  //Controller responded to every command, even if it could not honour them, so link is alive
+  if (found_terminators == target_terminators)
+     updateLinkRTT(&begint);
+
   return status;
 }
 
+/** Maximum acceleration, and deceleration for this model
+  * Units=counts/s/s
+  */
+long GalilController::modelMaxAcceleration(void)
+{
+  if (model_[0] == 'D' && model_[3] == '4')
+     return 1073740800;
+  return 67107840;
+}
+
+/** Does the controller model support PVT mode (eg. DMC-40x0, DMC-41x3)
+  */
+bool GalilController::modelPVT(void)
+{
+  return (model_[0] == 'D' && model_[3] == '4');
+}
+
+/** Controller servo sample time in seconds, from TM
+  * Obtain lock before calling
+  */
+double GalilController::controllerSampleTime(void)
+{
+  double tm = 0.0;	//Sample time in us
+
+  strcpy(cmd_, "MG _TM");
+  if (sync_writeReadController() == asynSuccess)
+     tm = atof(resp_);
+  //Controller default if TM cant be read
+  return (tm > 0.0) ? tm / 1000000.0 : 0.001;
+}
+
+/** Measures command round trip time on the live connection
+  * \return Round trip time in seconds, the longer of the measured time and the running mean
+  */
+double GalilController::measureLinkRTT(void)
+{
+  double rtt = 0.0;	//Measured round trip time in ms
+  int i;
+
+  for (i = 0; i < LINK_RTT_PROBES; i++)
+     {
+     strcpy(cmd_, "MG TIME");
+     sync_writeReadController();
+     rtt += linkRTT_;
+     }
+  rtt /= LINK_RTT_PROBES;
+  //Running mean includes round trips whilst link was busy
+  rtt = (linkRTTMean_ > rtt) ? linkRTTMean_ : rtt;
+  return rtt / 1000.0;
+}
+
+/** Updates link round trip time statistics, and time controller last responded to a command
+  * \param[in] begint Time command was written to controller
+  */
+void GalilController::updateLinkRTT(epicsTimeStamp *begint)
+{
+  double rtt;		//Round trip time in ms
+
+  epicsTimeGetCurrent(&lastCommandTime_);
+  rtt = epicsTimeDiffInSeconds(&lastCommandTime_, begint) * 1000.0;
+  GalilLinkRTTUpdate(rtt, &linkRTT_, &linkRTTMax_, &linkRTTMean_);
+}
+
+/** Heartbeat link health check.  Called by GalilPoller each cycle
+  * Tracks age of last data record, and last command response independently
+  * Probes the controller when no command has been sent for a heartbeat period
+  * Link is degraded when either age exceeds 2 heartbeat periods, and lost after 4 heartbeat periods
+  * Lost link forces disconnect, GalilConnector then re-establishes the connection
+  */
+void GalilController::checkLinkHealth(void)
+{
+  epicsTimeStamp nowt;		//Time now
+  double period;		//Heartbeat period in seconds.  0 = heartbeat off
+  double recordAge;		//Age of last data record in seconds
+  double commandAge;		//Age of last command response in seconds
+  int linkStatus = LINK_OK;	//Link status
+  char mesg[MAX_GALIL_STRING_SIZE];	//Disconnect reason
+
+  //Dont wait for lock held by long operation, command, and record ages are refreshed when it completes
+  if (longOperation_)
+     return;
+
+  lock();
+  getDoubleParam(GalilLinkHeartbeat_, &period);
+  if (connected_)
+     {
+     epicsTimeGetCurrent(&nowt);
+     commandAge = epicsTimeDiffInSeconds(&nowt, &lastCommandTime_);
+     //Probe controller with cheap command if idle
+     if (GalilLinkProbeDue(period, commandAge))
+        {
+        strcpy(cmd_, "WH");
+        sync_writeReadController();
+        epicsTimeGetCurrent(&nowt);
+        commandAge = epicsTimeDiffInSeconds(&nowt, &lastCommandTime_);
+        }
+     recordAge = epicsTimeDiffInSeconds(&nowt, &lastRecordTime_);
+     //Determine link status
+     linkStatus = GalilLinkStatus(period, recordAge, commandAge);
+     setDoubleParam(GalilLinkRecordAge_, recordAge);
+     setDoubleParam(GalilLinkCommandAge_, commandAge);
+     setDoubleParam(GalilLinkRTT_, linkRTT_);
+     setDoubleParam(GalilLinkRTTMax_, linkRTTMax_);
+     setDoubleParam(GalilLinkRTTMean_, linkRTTMean_);
+     }
+  else
+     linkStatus = LINK_LOST;
+  setIntegerParam(GalilLinkStatus_, linkStatus);
+
+  //Force disconnect if link lost
+  if (linkStatus == LINK_LOST && connected_)
+     {
+     disconnect();
+     //Replace disconnect message with the reason
+     sprintf(mesg, "Heartbeat lost, forced disconnect from %s at %s", model_, address_);
+     setCtrlError(mesg);
+     }
+  unlock();
+}
+
 /** Writes a string to the controller and reads the response.
   * Calls async_writeReadController() with default locations of the input and output strings
   * and default timeout. */ 
@@ -3617,6 +5662,10 @@ asynStatus GalilController::programDownload(string prog)
 
   if (connected_)
      {
+     //Fingerprint variable belongs to the program being replaced, clear it so an incomplete
+     //download, or a later download of other code cant be mistaken for this program
+     sprintf(cmd_, "%s=0", GALIL_CODE_HASH_VAR);
+     sync_writeReadController();
      //Request download
      status = pasynOctetSyncIO->write(pasynUserSyncGalil_, "DL", 2, timeout_, &nwrite);
      //Insert download terminate character at program end
@@ -3630,6 +5679,9 @@ asynStatus GalilController::programDownload(string prog)
         if (buf[0] == '?' || buf[1] == '?')
            status = asynError;  //Controller didn't like the program
         }
+     //Controller responded, refresh link health command age
+     if (!status)
+        epicsTimeGetCurrent(&lastCommandTime_);
      return status;
      }
   return status;
@@ -3665,6 +5717,8 @@ asynStatus GalilController::programUpload(string *prog)
            prog->assign(buf);
            //Trim uploaded program
            prog->erase(prog->length()-2);
+           //Controller responded, refresh link health command age
+           epicsTimeGetCurrent(&lastCommandTime_);
            }
         }
      }
@@ -3673,10 +5727,125 @@ asynStatus GalilController::programUpload(string *prog)
    return status;
 }
 
+/** Calculates fingerprint (FNV-1a hash) of program, and embeds it in the program
+  * Fingerprint is assigned to controller variable after first line of program
+  * so it is set when thread 0 is started (eg. by XQ 0,0 or #AUTO at power on)
+  * \param[in,out] prog      Program with \r separated lines
+  * Returns fingerprint limited to 31 bits so it fits in a Galil variable
+*/
+unsigned GalilController::programFingerprint(string *prog)
+{
+  unsigned hash = 2166136261u;	//FNV-1a offset basis
+  size_t i;			//Looping
+  size_t pos;			//Insert position of fingerprint line
+  char line[MAX_GALIL_STRING_SIZE];	//Fingerprint line
+
+  //Hash the program
+  for (i = 0; i < prog->length(); i++)
+     {
+     hash ^= (unsigned char)(*prog)[i];
+     hash *= 16777619u;		//FNV-1a prime
+     }
+  //Galil variables are 32 bit signed integer part
+  hash &= 0x7FFFFFFF;
+
+  //Insert fingerprint after first line if it is a label (eg. #AUTO), else at program start
+  pos = 0;
+  if ((*prog)[0] == '#')
+     {
+     pos = prog->find('\r');
+     pos = (pos == string::npos) ? prog->length() : pos + 1;
+     }
+  sprintf(line, "%s=%u\r", GALIL_CODE_HASH_VAR, hash);
+  prog->insert(pos, line);
+
+  return hash;
+}
+
+/** Checks the fingerprint line in the controller program image matches the code to download
+  * Lists only the fingerprint line, so the program is not uploaded
+  * \param[in] prog      Program with embedded fingerprint, \r separated lines
+  * \param[in] hash      Fingerprint of program
+  * Returns true if program image holds the fingerprint line
+*/
+bool GalilController::programFingerprintMatch(string prog, unsigned hash)
+{
+  char line[MAX_GALIL_STRING_SIZE];	//Fingerprint line
+  int lineNo;				//Fingerprint line number
+  size_t len;				//Response length
+
+  //Fingerprint is inserted after first line if it is a label, else at program start
+  lineNo = (prog[0] == '#') ? 1 : 0;
+  sprintf(cmd_, "LS %d,%d", lineNo, lineNo);
+  if (sync_writeReadController() != asynSuccess)
+     return false;
+
+  //Listing is line number followed by line
+  sprintf(line, " %s=%u", GALIL_CODE_HASH_VAR, hash);
+  len = strlen(resp_);
+  if (len < strlen(line))
+     return false;
+  return (strcmp(resp_ + len - strlen(line), line) == 0) ? true : false;
+}
+
+/** Retrieves program memory limits of the connected controller model
+  * \param[out] maxLines    Maximum number of program lines
+  * \param[out] maxColumns  Maximum characters per program line
+  * \param[out] maxLabels   Maximum number of program labels
+*/
+void GalilController::codeLimits(unsigned *maxLines, unsigned *maxColumns, unsigned *maxLabels)
+{
+  //Safe default
+  *maxLines = 1000;
+  *maxColumns = 80;
+  *maxLabels = 254;
+  if (rio_)
+     {
+     //RIO
+     *maxLines = 400;
+     *maxColumns = 40;
+     *maxLabels = 62;
+     }
+  else if (model_[0] == 'D' && model_[3] == '4')
+     {
+     //DMC4 range
+     *maxLines = 4000;
+     *maxLabels = 510;
+     }
+  else if (model_[0] == 'D' && model_[3] == '3')
+     {
+     //DMC3 range
+     *maxLines = 2000;
+     *maxLabels = 510;
+     }
+}
+
+/** Reports program size, line, and label usage against controller limits
+  * \param[in] prog      Program with \r separated lines
+  * Returns asynError if any controller limit is exceeded
+*/
+asynStatus GalilController::reportCodeUsage(const string &prog)
+{
+  unsigned maxLines, maxColumns, maxLabels;	//Controller limits
+  unsigned lines, labels, columns;		//Program usage
+
+  codeLimits(&maxLines, &maxColumns, &maxLabels);
+  GalilCodeUsage(prog, &lines, &labels, &columns);
+
+  printf("Program for model %s, address %s: %u bytes, lines %u/%u, labels %u/%u, longest line %u/%u\n",
+         model_, address_, (unsigned)prog.length(), lines, maxLines, labels, maxLabels, columns, maxColumns);
+  if (lines > maxLines || labels > maxLabels || columns > maxColumns)
+     {
+     errlogPrintf("Program exceeds controller limits model %s, address %s\n", model_, address_);
+     return asynError;
+     }
+  return asynSuccess;
+}
+
 /*--------------------------------------------------------------*/
 /* Start the card requested by user   */
 /*--------------------------------------------------------------*/
-void GalilController::GalilStartController(char *code_file, int burn_program, int display_code, unsigned thread_mask)
+asynStatus GalilController::GalilStartController(char *code_file, int burn_program, int display_code, unsigned thread_mask, int fingerprint_check)
 {
 	asynStatus status;				//Status
 	GalilAxis *pAxis;				//GalilAxis
@@ -3686,6 +5855,11 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 	bool download_ok = true;			//Was user specified code delivered successfully
 	string uc;					//Uploaded code from controller
 	string dc;					//Code to download to controller
+	unsigned code_hash = 0;				//Fingerprint of code to download
+	bool code_match = false;			//Does code on controller match code to download
+	bool code_exists = false;			//Does code exist on controller
+	bool code_fits = true;				//Does code to download fit controller program memory
+	unsigned maxLines, maxColumns, maxLabels;	//Controller program memory limits
 
 	//Backup parameters used by developer for later re-start attempts of this controller
 	//This allows full recovery after disconnect of controller
@@ -3693,6 +5867,7 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 	code_file_[sizeof(code_file_) - 1] = '\0';
 	burn_program_ = burn_program;
         thread_mask_ = thread_mask;
+	fingerprint_check_ = fingerprint_check;
 
 	//Assemble code for download to controller.  This is generated, or user specified code.
         if (!code_assembled_)
@@ -3705,9 +5880,9 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 			gen_card_codeend();
 	
 			/*Assemble the sections of generated code for this card */
-			strcat(card_code_, thread_code_);
-			strcat(card_code_, limit_code_);
-			strcat(card_code_, digital_code_);
+			card_code_->append(thread_code_->c_str());
+			card_code_->append(limit_code_->c_str());
+			card_code_->append(digital_code_->c_str());
 			// dump generated codefile, which we may or may not actually use
 			write_gen_codefile("_gen");
 			}
@@ -3717,11 +5892,20 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 			{
 			//Copy the user code into card code buffer
 			//Ready for delivery to controller
-			strcpy(card_code_, user_code_);
+			card_code_->clear();
+			card_code_->append(user_code_->c_str());
 			}
 		else
 			thread_mask_ = 0;  //Forced to use generated code
 
+		//Dont deliver truncated code
+		if (thread_code_->overflow() || limit_code_->overflow() || digital_code_->overflow() || user_code_->overflow() || card_code_->overflow())
+			{
+			errlogPrintf("\nCode buffer overflow, code not delivered to model %s, address %s\n\n", model_, address_);
+			setCtrlError("Code buffer overflow, code not delivered");
+			card_code_->clear();
+			}
+
 		//Dump card_code_ to file
 		write_gen_codefile("");
 		}
@@ -3730,7 +5914,7 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 	if ((display_code == 1) || (display_code == 3))
 		{
 		printf("\nGenerated/User code is\n\n");
-		cout << card_code_ << endl;
+		cout << card_code_->c_str() << endl;
 		}
 
 	//If connected, then proceed
@@ -3739,40 +5923,78 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 		{
 		//Increase timeout whilst manipulating controller code
 		timeout_ = 5;
+		//Lock is held for the whole code transfer, link health check waits until done
+		longOperation_ = true;
 
-		/*Upload code currently in controller for comparison to generated/user code */
-		status = programUpload(&uc);
-                if (status) //Upload failed
-                   printf("\nError uploading code model %s, address %s\n",model_, address_);
-	
-		if ((display_code == 2) || (display_code == 3))
-			{
-			//print out the uploaded code from the controller
-			printf("\nUploaded code is\n\n");
-			cout << uc << endl;
-			}
-
-		//Uploaded code
-		//Remove the \r characters - \r\n is returned by galil controller
-		uc.erase (std::remove(uc.begin(), uc.end(), '\r'), uc.end());
-		//Change \n to \r (Galil Communications Library expects \r separated lines)
-		std::replace(uc.begin(), uc.end(), '\n', '\r');
-		//Some controllers dont finish upload with \r\n, ensure buffer ends in carriage return
-		if (uc.back() != 13)
-			uc.push_back('\r');
 		//Download code
 		//Copy card_code_ into download code buffer
-		dc = card_code_;
+		dc = card_code_->c_str();
+		//Minify code within controller line length
+		codeLimits(&maxLines, &maxColumns, &maxLabels);
+		GalilMinifyCode(&dc, maxColumns);
 		//Change \n to \r (Galil Communications Library expects \r separated lines)
 		std::replace(dc.begin(), dc.end(), '\n', '\r');
+		//Embed program fingerprint in download code
+		if (dc.compare("") != 0)
+			code_hash = programFingerprint(&dc);
+
+		//Query fingerprint of program on controller, if fingerprint check requested
+		//Fingerprint variable is set when thread 0 starts, but survives download of other code (eg. by GalilTools)
+		//So fingerprint line in the program image must match too
+		if (fingerprint_check && dc.compare("") != 0)
+			{
+			sprintf(cmd_, "MG %s", GALIL_CODE_HASH_VAR);
+			if (sync_writeReadController() == asynSuccess)
+				code_match = ((unsigned)atof(resp_) == code_hash) ? true : false;
+			if (code_match)
+				code_match = programFingerprintMatch(dc, code_hash);
+			}
+
+		//Full upload unless fingerprint check passed, or if user wants to see the uploaded code
+		if (!code_match || (display_code == 2) || (display_code == 3))
+			{
+			/*Upload code currently in controller for comparison to generated/user code */
+			status = programUpload(&uc);
+			if (status) //Upload failed
+			   printf("\nError uploading code model %s, address %s\n",model_, address_);
+	
+			if ((display_code == 2) || (display_code == 3))
+				{
+				//print out the uploaded code from the controller
+				printf("\nUploaded code is\n\n");
+				cout << uc << endl;
+				}
+
+			//Uploaded code
+			//Remove the \r characters - \r\n is returned by galil controller
+			uc.erase (std::remove(uc.begin(), uc.end(), '\r'), uc.end());
+			//Change \n to \r (Galil Communications Library expects \r separated lines)
+			std::replace(uc.begin(), uc.end(), '\n', '\r');
+			//Some controllers dont finish upload with \r\n, ensure buffer ends in carriage return
+			if (uc.back() != 13)
+				uc.push_back('\r');
+			//Compare full program
+			code_match = (dc.compare(uc) == 0) ? true : false;
+			}
 
 		/*If code we wish to download differs from controller current code then download the new code*/
-		if (dc.compare(uc) != 0 && dc.compare("") != 0)
+		if (!code_match && dc.compare("") != 0)
 			{
-			printf("\nTransferring code to model %s, address %s\n",model_, address_);		
-			//Do the download
-			status = programDownload(dc);
-			if (status)
+			//Report program size, lines and labels against controller limits
+			//Dont deliver a program the controller cant hold
+			if (reportCodeUsage(dc) != asynSuccess)
+				{
+				errlogPrintf("\nProgram exceeds controller limits, code not delivered to model %s, address %s\n\n", model_, address_);
+				setCtrlError("Program exceeds controller limits, code not delivered");
+				code_fits = download_ok = false;
+				}
+			else
+				{
+				printf("\nTransferring code to model %s, address %s\n",model_, address_);
+				//Do the download
+				status = programDownload(dc);
+				}
+			if (code_fits && status)
 				{
 				//Donwload failed
 				printf("\nError downloading code model %s, address %s\n",model_, address_);
@@ -3848,16 +6070,24 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 				}
 			}
 
-		/*Upload code currently in controller to see whats there now*/              
-		status = programUpload(&uc);
-		if (!status)   //Remove the \r characters - \r\n is returned by galil controller
-			uc.erase (std::remove(uc.begin(), uc.end(), '\r'), uc.end());
+		//Fingerprint matched, or download succeeded, so we know code exists on controller
+		//Otherwise, or if fingerprint check not requested, upload to see whats there now
+		if (!download_ok || !fingerprint_check || dc.compare("") == 0)
+			{
+			/*Upload code currently in controller to see whats there now*/              
+			status = programUpload(&uc);
+			if (!status)   //Remove the \r characters - \r\n is returned by galil controller
+				uc.erase (std::remove(uc.begin(), uc.end(), '\r'), uc.end());
+			else
+				printf("\nError uploading code model %s, address %s\n",model_, address_);
+			code_exists = ((int)uc.length()>2) ? true : false;
+			}
 		else
-			printf("\nError uploading code model %s, address %s\n",model_, address_);
+			code_exists = true;
 
-		//Start thread 0 if upload reveals code exists on controller
+		//Start thread 0 if code exists on controller, and isnt older code left by a download that didnt fit
 		//Its assumed that thread 0 starts any other required threads on controller
-		if ((int)uc.length()>2)
+		if (code_exists && code_fits)
 			{
 			sprintf(cmd_, "XQ 0,0");
 			if (sync_writeReadController() != asynSuccess)
@@ -3917,6 +6147,9 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 
 		//Decrease timeout now finished manipulating controller code
 		timeout_ = 1;
+		//Code transfer done, controller responded to last command now
+		epicsTimeGetCurrent(&lastCommandTime_);
+		longOperation_ = false;
 		//Wake poller, and re-start async records if needed
 		poller_->wakePoller();
 
@@ -3928,13 +6161,19 @@ void GalilController::GalilStartController(char *code_file, int burn_program, in
 	if (!code_assembled_)
 		{
 		//free RAM
-		free(thread_code_);
-		free(limit_code_);
-		free(digital_code_);
-		free(user_code_);
+		delete thread_code_;
+		delete limit_code_;
+		delete digital_code_;
+		delete user_code_;
+		thread_code_ = limit_code_ = digital_code_ = user_code_ = NULL;
 		//The GalilController code is fully assembled, and stored in GalilController::card_code_
 		code_assembled_ = true;
 		}
+
+	//Return outcome to caller
+	if (!connected_)
+		return asynDisconnected;
+	return (download_ok && start_ok) ? asynSuccess : asynError;
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -3966,7 +6205,7 @@ void GalilController::gen_card_codeend(void)
 		if (digports==0)
 			{
 			/* EPS home and away function */
-			strcat(card_code_,"II 1,8\n");		/*code to enable dig input interrupt must be internal to G21X3*/
+			card_code_->append("II 1,8\n");		/*code to enable dig input interrupt must be internal to G21X3*/
 			}
 		else
 			{
@@ -3982,19 +6221,25 @@ void GalilController::gen_card_codeend(void)
 		// Add galil program termination code
 		if (digitalinput_init_ == true)
 			{
-			strcat(limit_code_, "RE 1\n");	/*we have written limit code, and we are done with LIMSWI but not prog end*/
+			limit_code_->append("RE 1\n");	/*we have written limit code, and we are done with LIMSWI but not prog end*/
 			//Add controller wide motor interlock code to #ININT
 			if (digports != 0)
 				gen_motor_enables_code();
 	
 			// Add code to end digital port interrupt routine, and end the prog
-			strcat(digital_code_, "RI 1\nEN\n");	
+			digital_code_->append("RI 1\nEN\n");	
 			}
 		else
-			strcat(limit_code_, "RE 1\nEN\n");   /*we have written limit code, and we are done with LIMSWI and is prog end*/
+			limit_code_->append("RE 1\nEN\n");   /*we have written limit code, and we are done with LIMSWI and is prog end*/
 					
 		//Add command error handler
-		sprintf(thread_code_, "%s#CMDERR\nerrstr=_ED;errcde=_TC;cmderr=cmderr+1\nEN\n", thread_code_);
+		thread_code_->append("#CMDERR\nerrstr=_ED;errcde=_TC;cmderr=cmderr+1\nEN\n");
+
+		//Add armed linear profile input trigger if enabled by GalilCreateProfile
+		//Started by the profile thread on a thread not used by an axis
+		//Waits for input ptin to reach level ptlvl, then begins coordinate system ptcs
+		if (profileInputTrigger_)
+			thread_code_->append("#PTRIG\nJP #PTRIG,@IN[ptin]<>ptlvl\nptfired=TIME\nJP #PTRIGT,ptcs=1\nBG S\nEN\n#PTRIGT\nBG T\nEN\n");
 		
 		//Set cmderr counter to 0
 		sprintf(cmd_, "cmderr=0");
@@ -4027,24 +6272,24 @@ void GalilController::gen_motor_enables_code(void)
 		if (strlen(motor_enables->motors) > 0)
 			{
 			any = true;
-			sprintf(digital_code_,"%sIF ((@IN[%d]=%d)\n", digital_code_, (i + 1), (int)motor_enables->disablestates[0]);
+			digital_code_->appendf("IF ((@IN[%d]=%d)\n", (i + 1), (int)motor_enables->disablestates[0]);
 			// Scan through all motors associated with the port
 			for (j=0;j<(int)strlen(motor_enables->motors);j++)
 				{
 				//Add code to stop the motors when digital input state matches that specified
 				if (j == (int)strlen(motor_enables->motors) - 1)
-					sprintf(digital_code_,"%sST%c\n", digital_code_, motor_enables->motors[j]);
+					digital_code_->appendf("ST%c\n", motor_enables->motors[j]);
 				else
-					sprintf(digital_code_,"%sST%c;", digital_code_, motor_enables->motors[j]);
+					digital_code_->appendf("ST%c;", motor_enables->motors[j]);
 				}
 			//Manipulate interrupt flag to turn off the interrupt on this port for one threadA cycle
-			sprintf(digital_code_,"%sdpoff=dpoff-%d\nENDIF\n", digital_code_, (int)pow(2.0,i));
+			digital_code_->appendf("dpoff=dpoff-%d\nENDIF\n", (int)pow(2.0,i));
 			}
 		}
 	/* Re-enable input interrupt for all except the digital port(s) just serviced during interrupt routine*/
 	/* ThreadA will re-enable the interrupt for the serviced digital ports(s) after 1 cycle */
 	if (any)
-		strcat(digital_code_,"II ,,dpoff,dvalues\n");
+		digital_code_->append("II ,,dpoff,dvalues\n");
 }
 
 /*-----------------------------------------------------------------------------------*/
@@ -4054,7 +6299,6 @@ void GalilController::gen_motor_enables_code(void)
 void GalilController::write_gen_codefile(const char* suffix)
 {
 	FILE *fp;
-	int i = 0;
 	char filename[100];
 	
 	sprintf(filename,"./%s%s.gmc",address_, suffix);
@@ -4064,11 +6308,7 @@ void GalilController::write_gen_codefile(const char* suffix)
 	if (fp != NULL)
 		{
 		//Dump generated galil code from the GalilController instance
-		while (card_code_[i]!='\0')
-			{
-			fputc(card_code_[i],fp);
-			i++;
-			}
+		fputs(card_code_->c_str(), fp);
 		fclose(fp);
 		}
 	else
@@ -4092,7 +6332,7 @@ asynStatus GalilController::read_codefile(const char *code_file)
 		return asynError;
 	}
 	//Empty the user code buffer
-	user_code_[0] = '\0';
+	user_code_->clear();
 	if (strchr(code_file, ';') == NULL)
 	{
 		return read_codefile_part(code_file, NULL); // only one part (whole code file specified)
@@ -4155,6 +6395,7 @@ asynStatus GalilController::read_codefile(const char *code_file)
 asynStatus GalilController::read_codefile_part(const char *code_file, MAC_HANDLE* mac_handle)
 {
 	int i = 0;
+	int len;	//Length of code read
 	char file[MAX_FILENAME_LEN];
 	FILE *fp;
 	//local temp code buffers
@@ -4180,7 +6421,8 @@ asynStatus GalilController::read_codefile_part(const char *code_file, MAC_HANDLE
 			user_code[i] = '\0';
 	
 			//Filter code
-			for (i=0;i<(int)strlen(user_code);i++)
+			len = (int)strlen(user_code);
+			for (i=0;i<len;i++)
 				{
 				//Filter out any REM lines
 				if (user_code[i]=='R' && user_code[i+1]=='E' && user_code[i+2]=='M')
@@ -4197,12 +6439,12 @@ asynStatus GalilController::read_codefile_part(const char *code_file, MAC_HANDLE
 				{
 				macExpandString(mac_handle, user_code, user_code_exp, max_size);
 				//Copy code into GalilController temporary area
-				strcat(user_code_, user_code_exp);
+				user_code_->append(user_code_exp);
 				}
 			else
 				{
 				//Copy code into GalilController temporary area
-				strcat(user_code_, user_code);
+				user_code_->append(user_code);
 				}
 			}
 		else
@@ -5187,6 +7429,41 @@ extern "C" asynStatus GalilCreateCSAxes(const char *portName)
   return asynSuccess;
 }
 
+/** Binds a real axis letter on a controller to an axis on another controller
+  * Coordinate system axis may then span several controllers
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName          The name of the asyn port for the controller using the axis
+  * \param[in] axisname          Axis name A-H on portName, not created by GalilCreateAxis
+  * \param[in] remotePortName    The name of the asyn port for the controller the axis is on
+  * \param[in] remoteAxisname    Axis name A-H on remotePortName, created by GalilCreateAxis
+  */
+extern "C" asynStatus GalilCreateRemoteAxis(const char *portName, const char *axisname, const char *remotePortName, const char *remoteAxisname)
+{
+  GalilController *pC;			//The GalilController
+  asynStatus status;			//Result
+  static const char *functionName = "GalilCreateRemoteAxis";
+
+  //Retrieve the asynPort specified
+  pC = (GalilController*) findAsynPortDriver(portName);
+
+  if (!pC) {
+    printf("%s:%s: Error port %s not found\n",
+           driverName, functionName, portName);
+    return asynError;
+  }
+
+  if (!axisname || !remoteAxisname || !remotePortName) {
+    printf("%s:%s: Error axis names, and remote port required\n", driverName, functionName);
+    return asynError;
+  }
+
+  pC->lock();
+  status = pC->createRemoteAxis(axisname[0], remotePortName, remoteAxisname[0]);
+  pC->unlock();
+
+  return status;
+}
+
 /** Starts a GalilController hardware.  Delivers dmc code, and starts it.
   * Configuration command, called directly or from iocsh
   * \param[in] portName          The name of the asyn port that has already been created for this driver
@@ -5194,15 +7471,18 @@ extern "C" asynStatus GalilCreateCSAxes(const char *portName)
   * \param[in] burn_program      Burn program to EEPROM
   * \param[in] display_code	 Display code options
   * \param[in] thread_mask	 Indicates which threads to expect running after code file has been delivered and thread 0 has been started. Bit 0 = thread 0 etc.
+  * \param[in] fingerprint_check	 0 = Upload and compare full program, 1 = Compare program fingerprint, full program only if it differs
   */
 extern "C" asynStatus GalilStartController(const char *portName,        	//specify which controller by port name
 					   const char *code_file,
 					   int burn_program,
 					   int display_code, 
-					   unsigned thread_mask)
+					   unsigned thread_mask,
+					   int fingerprint_check)
 {
   GalilController *pC;
   static const char *functionName = "GalilStartController";
+  asynStatus status;
 
   //Retrieve the asynPort specified
   pC = (GalilController*) findAsynPortDriver(portName);
@@ -5214,15 +7494,123 @@ extern "C" asynStatus GalilStartController(const char *portName,        	//speci
   }
   pC->lock();
   //Call GalilController::GalilStartController to do the work
-  pC->GalilStartController((char *)code_file, burn_program, display_code, thread_mask);
+  status = pC->GalilStartController((char *)code_file, burn_program, display_code, thread_mask, fingerprint_check);
   pC->unlock();
+  return status;
+}
+
+/** Queues start of a GalilController hardware.  Same parameters as GalilStartController.
+  * Queued controllers are started concurrently by GalilStartQueuedControllers
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName          The name of the asyn port that has already been created for this driver
+  * \param[in] code_file      	 Code file to deliver to hardware
+  * \param[in] burn_program      Burn program to EEPROM
+  * \param[in] display_code	 Display code options
+  * \param[in] thread_mask	 Indicates which threads to expect running after code file has been delivered and thread 0 has been started. Bit 0 = thread 0 etc.
+  * \param[in] fingerprint_check	 0 = Upload and compare full program, 1 = Compare program fingerprint, full program only if it differs
+  */
+extern "C" asynStatus GalilQueueStartController(const char *portName,        	//specify which controller by port name
+						const char *code_file,
+						int burn_program,
+						int display_code, 
+						unsigned thread_mask,
+						int fingerprint_check)
+{
+  GalilStartRequest request;		//Start request
+  static const char *functionName = "GalilQueueStartController";
+
+  //Check the asynPort specified
+  if (!findAsynPortDriver(portName)) {
+    printf("%s:%s: Error port %s not found\n",
+           driverName, functionName, portName);
+    return asynError;
+  }
+
+  //Store the request
+  strncpy(request.portName, portName, sizeof(request.portName));
+  request.portName[sizeof(request.portName) - 1] = '\0';
+  strncpy(request.code_file, (code_file) ? code_file : "", sizeof(request.code_file));
+  request.code_file[sizeof(request.code_file) - 1] = '\0';
+  request.burn_program = burn_program;
+  request.display_code = display_code;
+  request.thread_mask = thread_mask;
+  request.fingerprint_check = fingerprint_check;
+  request.status = asynError;
+  request.connected = 0;
+  request.seconds = 0.0;
+  startQueue.push_back(request);
+
   return asynSuccess;
 }
 
+/** Starts all GalilController hardware queued by GalilQueueStartController concurrently
+  * Prints summary of results and timings once all controllers have been started
+  * Configuration command, called directly or from iocsh
+  * \param[in] maxWorkers        Maximum number of controllers started at the same time
+  */
+extern "C" asynStatus GalilStartQueuedControllers(int maxWorkers)
+{
+  vector<GalilStarter *> workers;	//Worker threads
+  epicsMutexId queueLock;		//Protects next request index
+  unsigned next = 0;			//Next request to be taken from queue
+  unsigned numWorkers;			//Number of worker threads
+  unsigned failed = 0;			//Number of controllers that failed to start
+  unsigned i;				//Looping
+  epicsTimeStamp begint;		//Start time
+  epicsTimeStamp endt;			//End time
+  const char *result;			//Result string for summary
+  static const char *functionName = "GalilStartQueuedControllers";
+
+  if (startQueue.empty()) {
+    printf("%s:%s: No controllers queued, use GalilQueueStartController\n",
+           driverName, functionName);
+    return asynError;
+  }
+
+  //Bound the worker pool
+  numWorkers = (maxWorkers < 1) ? 1 : (unsigned)maxWorkers;
+  numWorkers = MIN(numWorkers, (unsigned)startQueue.size());
+
+  queueLock = epicsMutexCreate();
+  epicsTimeGetCurrent(&begint);
+  //Create the workers, they start taking requests immediately
+  for (i = 0; i < numWorkers; i++)
+     workers.push_back(new GalilStarter(&startQueue, &next, queueLock));
+  //Wait for workers to empty the queue
+  for (i = 0; i < numWorkers; i++)
+     delete workers[i];
+  epicsTimeGetCurrent(&endt);
+  epicsMutexDestroy(queueLock);
+
+  //Print summary
+  printf("\n%s: %u controllers, %u workers, %.3f s\n", functionName, (unsigned)startQueue.size(), numWorkers, epicsTimeDiffInSeconds(&endt, &begint));
+  printf("%-20s %-16s %10s\n", "Port", "Result", "Time (s)");
+  for (i = 0; i < startQueue.size(); i++)
+     {
+     if (startQueue[i].status == asynSuccess)
+        result = "Started";
+     else if (!startQueue[i].connected)
+        result = "Not connected";
+     else
+        result = "Failed";
+     if (startQueue[i].status != asynSuccess)
+        failed++;
+     printf("%-20s %-16s %10.3f\n", startQueue[i].portName, result, startQueue[i].seconds);
+     }
+  printf("\n");
+
+  //Requests have been processed
+  startQueue.clear();
+
+  return (failed) ? asynError : asynSuccess;
+}
+
 extern "C" asynStatus GalilCreateProfile(const char *portName,         /* specify which controller by port name */
-                            		 int maxPoints)                /* maximum number of profile points */
+                            		 int maxPoints,                /* maximum number of profile points */
+                            		 int inputTrigger)             /* generate armed profile input trigger code */
 {
   GalilController *pC;
+  asynStatus status;
   static const char *functionName = "GalilCreateProfile";
 
   //Retrieve the asynPort specified
@@ -5233,9 +7621,10 @@ extern "C" asynStatus GalilCreateProfile(const char *portName,         /* specif
     return asynError;
   }
   pC->lock();
-  pC->initializeProfile(maxPoints);
+  status = pC->initializeProfile(maxPoints);
+  pC->setProfileInputTrigger(inputTrigger != 0);
   pC->unlock();
-  return asynSuccess;
+  return status;
 }
 
 //Register the above IocShell functions
@@ -5286,17 +7675,37 @@ static void GalilCreateCSAxesCallFunc(const iocshArgBuf *args)
   GalilCreateCSAxes(args[0].sval);
 }
 
+//GalilCreateRemoteAxis iocsh function
+static const iocshArg GalilCreateRemoteAxisArg0 = {"Controller Port name", iocshArgString};
+static const iocshArg GalilCreateRemoteAxisArg1 = {"Specified Axis Name", iocshArgString};
+static const iocshArg GalilCreateRemoteAxisArg2 = {"Remote Controller Port name", iocshArgString};
+static const iocshArg GalilCreateRemoteAxisArg3 = {"Remote Axis Name", iocshArgString};
+
+static const iocshArg * const GalilCreateRemoteAxisArgs[] =  {&GalilCreateRemoteAxisArg0,
+                                                              &GalilCreateRemoteAxisArg1,
+                                                              &GalilCreateRemoteAxisArg2,
+                                                              &GalilCreateRemoteAxisArg3};
+
+static const iocshFuncDef GalilCreateRemoteAxisDef = {"GalilCreateRemoteAxis", 4, GalilCreateRemoteAxisArgs};
+
+static void GalilCreateRemoteAxisCallFunc(const iocshArgBuf *args)
+{
+  GalilCreateRemoteAxis(args[0].sval, args[1].sval, args[2].sval, args[3].sval);
+}
+
 //GalilCreateProfile iocsh function
 static const iocshArg GalilCreateProfileArg0 = {"Controller Port name", iocshArgString};
 static const iocshArg GalilCreateProfileArg1 = {"Max points", iocshArgInt};
+static const iocshArg GalilCreateProfileArg2 = {"Input trigger", iocshArgInt};
 static const iocshArg * const GalilCreateProfileArgs[] = {&GalilCreateProfileArg0,
-                                                          &GalilCreateProfileArg1};
+                                                          &GalilCreateProfileArg1,
+                                                          &GalilCreateProfileArg2};
                                                              
-static const iocshFuncDef GalilCreateProfileDef = {"GalilCreateProfile", 2, GalilCreateProfileArgs};
+static const iocshFuncDef GalilCreateProfileDef = {"GalilCreateProfile", 3, GalilCreateProfileArgs};
 
 static void GalilCreateProfileCallFunc(const iocshArgBuf *args)
 {
-  GalilCreateProfile(args[0].sval, args[1].ival);
+  GalilCreateProfile(args[0].sval, args[1].ival, args[2].ival);
 }
 
 //GalilStartController iocsh function
@@ -5305,17 +7714,51 @@ static const iocshArg GalilStartControllerArg1 = {"Code file", iocshArgString};
 static const iocshArg GalilStartControllerArg2 = {"Burn program", iocshArgInt};
 static const iocshArg GalilStartControllerArg3 = {"Display code", iocshArgInt};
 static const iocshArg GalilStartControllerArg4 = {"Thread mask", iocshArgInt};
+static const iocshArg GalilStartControllerArg5 = {"Fingerprint check", iocshArgInt};
 static const iocshArg * const GalilStartControllerArgs[] = {&GalilStartControllerArg0,
                                                             &GalilStartControllerArg1,
                                                             &GalilStartControllerArg2,
                                                             &GalilStartControllerArg3,
-                                                            &GalilStartControllerArg4};
+                                                            &GalilStartControllerArg4,
+                                                            &GalilStartControllerArg5};
                                                              
-static const iocshFuncDef GalilStartControllerDef = {"GalilStartController", 5, GalilStartControllerArgs};
+static const iocshFuncDef GalilStartControllerDef = {"GalilStartController", 6, GalilStartControllerArgs};
 
 static void GalilStartControllerCallFunc(const iocshArgBuf *args)
 {
-  GalilStartController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, (unsigned)args[4].ival);
+  GalilStartController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, (unsigned)args[4].ival, args[5].ival);
+}
+
+//GalilQueueStartController iocsh function
+static const iocshArg GalilQueueStartControllerArg0 = {"Controller Port name", iocshArgString};
+static const iocshArg GalilQueueStartControllerArg1 = {"Code file", iocshArgString};
+static const iocshArg GalilQueueStartControllerArg2 = {"Burn program", iocshArgInt};
+static const iocshArg GalilQueueStartControllerArg3 = {"Display code", iocshArgInt};
+static const iocshArg GalilQueueStartControllerArg4 = {"Thread mask", iocshArgInt};
+static const iocshArg GalilQueueStartControllerArg5 = {"Fingerprint check", iocshArgInt};
+static const iocshArg * const GalilQueueStartControllerArgs[] = {&GalilQueueStartControllerArg0,
+                                                                 &GalilQueueStartControllerArg1,
+                                                                 &GalilQueueStartControllerArg2,
+                                                                 &GalilQueueStartControllerArg3,
+                                                                 &GalilQueueStartControllerArg4,
+                                                                 &GalilQueueStartControllerArg5};
+                                                             
+static const iocshFuncDef GalilQueueStartControllerDef = {"GalilQueueStartController", 6, GalilQueueStartControllerArgs};
+
+static void GalilQueueStartControllerCallFunc(const iocshArgBuf *args)
+{
+  GalilQueueStartController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, (unsigned)args[4].ival, args[5].ival);
+}
+
+//GalilStartQueuedControllers iocsh function
+static const iocshArg GalilStartQueuedControllersArg0 = {"Max workers", iocshArgInt};
+static const iocshArg * const GalilStartQueuedControllersArgs[] = {&GalilStartQueuedControllersArg0};
+                                                             
+static const iocshFuncDef GalilStartQueuedControllersDef = {"GalilStartQueuedControllers", 1, GalilStartQueuedControllersArgs};
+
+static void GalilStartQueuedControllersCallFunc(const iocshArgBuf *args)
+{
+  GalilStartQueuedControllers(args[0].ival);
 }
 
 //Construct GalilController iocsh function register
@@ -5324,8 +7767,11 @@ static void GalilSupportRegister(void)
   iocshRegister(&GalilCreateControllerDef, GalilCreateContollerCallFunc);
   iocshRegister(&GalilCreateAxisDef, GalilCreateAxisCallFunc);
   iocshRegister(&GalilCreateCSAxesDef, GalilCreateCSAxesCallFunc);
+  iocshRegister(&GalilCreateRemoteAxisDef, GalilCreateRemoteAxisCallFunc);
   iocshRegister(&GalilCreateProfileDef, GalilCreateProfileCallFunc);
   iocshRegister(&GalilStartControllerDef, GalilStartControllerCallFunc);
+  iocshRegister(&GalilQueueStartControllerDef, GalilQueueStartControllerCallFunc);
+  iocshRegister(&GalilStartQueuedControllersDef, GalilStartQueuedControllersCallFunc);
 }
 
 //Finally do the registration
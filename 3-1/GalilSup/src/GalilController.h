@@ -41,8 +41,29 @@
 #define MAX_GALIL_CSAXES 8
 #define MAX_FILENAME_LEN 2048
 #define MAX_SEGMENTS 511
+//Controller PVT, and contour mode buffer sizes
+#define PVT_SEGMENTS 255
+#define CONTOUR_SEGMENTS 511
+//Maximum command line length accepted by controller
+#define MAX_GALIL_LINE 80
+//Profile is aborted if the controller segment buffer falls to this many segments whilst executing
+#define PROFILE_MIN_BUFFERED 2
+//Data records captured per profile point before capture is decimated
+#define PROFILE_CAPTURE_RECORDS_PER_POINT 4
+//Largest profile time scaling searched for when a profile cant be streamed
+#define PROFILE_MAX_TIME_SCALE 64.0
+//Command round trips measured when checking a profile can be streamed
+#define LINK_RTT_PROBES 5
+//Longest a profile waits for the other profile to send a command line before streaming again
+#define PROFILE_TURN_TIMEOUT 0.1
+//Profile types selected by GalilProfileType_
+#define PROFILE_TYPE_LINEAR 0
+#define PROFILE_TYPE_PVT 1
+#define PROFILE_TYPE_CONTOUR 2
 #define COORDINATE_SYSTEMS 2
 #define ANALOG_PORTS 8
+//Controller variable holding fingerprint of program set by thread 0
+#define GALIL_CODE_HASH_VAR "codehash"
 #define BINARYIN_BYTES 7
 #define BINARYOUT_WORDS 5
 #define LIMIT_CODE_LEN 80000
@@ -54,14 +75,25 @@
 #define MOTOR_STOP_REV 3
 
 #include "macLib.h"
+#include "GalilCodeBuffer.h"
+#include "GalilCodeMinify.h"
+#include "GalilLinkHealth.h"
+#include "GalilProfileBuffer.h"
+#include "GalilProfileCapture.h"
+#include "GalilProfileTrigger.h"
+#include "GalilProfileTurn.h"
+#include "GalilTransform.h"
+#include "GalilPath.h"
 #include "GalilAxis.h"
 #include "GalilCSAxis.h"
 #include "GalilConnector.h"
 #include "GalilPoller.h"
 #include "epicsMessageQueue.h"
+#include "epicsMutex.h"
 
 #include <unordered_map> //used for data record features
 #include <vector>
+#include "GalilStarter.h"
 
 // drvInfo strings for extra parameters that the Galil controller supports
 #define GalilAddressString		"CONTROLLER_ADDRESS"
@@ -168,6 +200,38 @@
 #define GalilEthAddrString	  	"CONTROLLER_ETHADDR"
 #define GalilSerialNumString	  	"CONTROLLER_SERIALNUM"
 
+#define GalilLinkHeartbeatString	"CONTROLLER_HEARTBEAT"
+#define GalilLinkStatusString		"CONTROLLER_LINK_STATUS"
+#define GalilLinkRecordAgeString	"CONTROLLER_RECORD_AGE"
+#define GalilLinkCommandAgeString	"CONTROLLER_COMMAND_AGE"
+#define GalilLinkRTTString		"CONTROLLER_RTT"
+#define GalilLinkRTTMaxString		"CONTROLLER_RTT_MAX"
+#define GalilLinkRTTMeanString		"CONTROLLER_RTT_MEAN"
+
+#define GalilCSMotorPathToleranceString	"CSMOTOR_PATH_TOLERANCE"
+#define GalilCSMotorPathDeviationString	"CSMOTOR_PATH_DEVIATION"
+#define GalilCSMotorPathSegmentsString	"CSMOTOR_PATH_SEGMENTS"
+#define GalilCSMotorStartSkewString	"CSMOTOR_START_SKEW"
+#define GalilCSMotorVelocityScaleString	"CSMOTOR_VELOCITY_SCALE"
+#define GalilCSMotorAccelScaleString	"CSMOTOR_ACCEL_SCALE"
+#define GalilCSMotorKinematicErrorsString	"CSMOTOR_KINEMATIC_ERRORS"
+#define GalilCSMotorKinematicErrorCountString	"CSMOTOR_KINEMATIC_ERROR_COUNT"
+#define GalilProfileSegmentRateString	"GALIL_PROFILE_SEGMENT_RATE"
+#define GalilProfileLowWaterString	"GALIL_PROFILE_LOW_WATER"
+#define GalilProfileTypeString		"GALIL_PROFILE_TYPE"
+#define GalilProfileAccelLimitString	"GALIL_PROFILE_ACCEL_LIMIT"
+#define GalilProfileJerkLimitString	"GALIL_PROFILE_JERK_LIMIT"
+#define GalilProfileContourExponentString	"GALIL_PROFILE_CONTOUR_EXPONENT"
+#define GalilProfileTimeScaleString	"GALIL_PROFILE_TIME_SCALE"
+#define GalilProfileMergeToleranceString	"GALIL_PROFILE_MERGE_TOLERANCE"
+#define GalilProfileCompressionString	"GALIL_PROFILE_COMPRESSION"
+#define GalilProfileMergeDeviationString	"GALIL_PROFILE_MERGE_DEVIATION"
+#define GalilProfileArmString		"GALIL_PROFILE_ARM"
+#define GalilProfileArmedString		"GALIL_PROFILE_ARMED"
+#define GalilProfileTriggerInputString	"GALIL_PROFILE_TRIGGER_INPUT"
+#define GalilProfileTriggerLevelString	"GALIL_PROFILE_TRIGGER_LEVEL"
+#define GalilProfileTriggerLatencyString	"GALIL_PROFILE_TRIGGER_LATENCY"
+
 /* For each digital input, we maintain a list of motors, and the state the input should be in*/
 /* To disable the motor */
 struct Galilmotor_enables {
@@ -190,6 +254,40 @@ struct Source //each data record source key (e.g. "_RPA") maps to one of these,
 	{ /*ctor just initializes values*/ }
 };
 
+class GalilController;
+
+//Profile context.  One per coordinate system, so profiles on S and T can be built and executed at the same time
+//Context index is the ParamList address profile control, and status is published at
+struct GalilProfileContext {
+  int index;				//Context number, and ParamList address
+  int coordsys;				//Coordinate system linear profile executes on S(0) or T(1)
+  GalilController *pC;			//Controller, used by profile thread entry
+  GalilProfileBuffer *buffer;		//Built profile.  Owned by profile thread whilst executing
+  GalilProfileCapture *capture;		//Data records captured whilst last profile executed.  Protected by captureLock_
+  double *times;			//Profile point times the profile was built with, used for readback
+  int points;				//Profile points the profile was built with
+  bool abort;				//Abort profile request flag.  Aborts profile when set true
+  epicsEventId executeEvent;		//Event for executing this profile
+  epicsEventId streamEvent;		//Signalled by poller each cycle, wakes profile thread waiting for buffer space
+  GalilProfileTrigger *trigger;		//Armed profile trigger state.  Used with lock
+  int triggerInput;			//Digital input armed profile waits for, 0 for execute only
+  int triggerThread;			//Controller thread waiting for digital input trigger, -1 if none
+  asynStatus triggerStatus;		//Status of begin sent by trigger
+  char begin[MAX_GALIL_STRING_SIZE];	//Command that begins armed profile
+  epicsTimeStamp triggerTime;		//Time execute, or trigger was received
+  epicsEventId triggerEvent;		//Signalled when armed profile is triggered, or aborted
+};
+
+//Controller lock profile streams take turns with
+class GalilStreamLock : public GalilTurnLock {
+public:
+  GalilStreamLock(GalilController *pC) : pC_(pC) {}
+  void lock(void);
+  void unlock(void);
+private:
+  GalilController *pC_;
+};
+
 class GalilController : public asynMotorController {
 public:
   //These variables need to be accessible from static callbacks
@@ -210,6 +308,10 @@ public:
   bool my_isascii(int c);
   asynStatus programUpload(string *prog);
   asynStatus programDownload(string prog);
+  unsigned programFingerprint(string *prog);
+  bool programFingerprintMatch(string prog, unsigned hash);
+  void codeLimits(unsigned *maxLines, unsigned *maxColumns, unsigned *maxLabels);
+  asynStatus reportCodeUsage(const string &prog);
   
   /* These are the methods that we override from asynMotorController */
   asynStatus poll(void);
@@ -230,20 +332,52 @@ public:
   //Coordinate system axis
   GalilCSAxis* getCSAxis(asynUser *pasynUser);
   GalilCSAxis* getCSAxis(int axisNo);
+  //Retrieve kinematic data for all axis from ParamList
+  void buildKinematicSnapshot(GalilKinematicSnapshot *snap);
+  //Evaluate forward kinematics for all cs axis together
+  void batchForwardTransforms(void);
+  //Bind real axis on this controller to an axis on another controller
+  asynStatus createRemoteAxis(char axis, const char *remotePort, char remoteAxis);
+  //Controller, and axis number on that controller, for real axis
+  GalilController *realController(int axis, int *axisNo);
+  //Does this controller use axis on another controller, directly or through other controllers
+  bool usesController(GalilController *pC);
+  //Lock, and unlock several controllers in port name order.  Caller holds lock of held controller
+  static void lockControllers(GalilController *ctrl[], unsigned n, GalilController *held);
+  static void unlockControllers(GalilController *ctrl[], unsigned n, GalilController *held);
+  //Retrieve real axis data from ParamList
+  void sampleAxis(int axis, GalilAxisSample *sample);
+  //Retrieve real axis data for axis on this or another controller
+  void getAxisSample(int axis, GalilAxisSample *sample);
+  //Publish real axis data for cs axis on other controllers
+  void publishAxisSamples(void);
 
   /* These are the methods that we override from asynPortDriver */
   asynStatus writeUInt32Digital(asynUser *pasynUser, epicsUInt32 value, epicsUInt32 mask);
 
   /* These are the functions for profile moves */
-  //asynStatus initializeProfile(size_t maxPoints, const char* ftpUsername, const char* ftpPassword);
+  asynStatus initializeProfile(size_t maxPoints);
+  //Include armed profile input trigger code #PTRIG in code generated after this
+  void setProfileInputTrigger(bool enable);
   asynStatus buildProfile();
-  asynStatus buildLinearProfile();
   asynStatus executeProfile();
   asynStatus abortProfile();
-  //asynStatus readbackProfile();
+  asynStatus readbackProfile();
+  //Profile on S, and T each have their own context
+  asynStatus buildProfile(GalilProfileContext *prof);
+  asynStatus buildLinearProfile(GalilProfileContext *prof);
+  asynStatus buildPVTProfile(GalilProfileContext *prof);
+  asynStatus buildContourProfile(GalilProfileContext *prof);
+  asynStatus checkProfileStream(GalilProfileContext *prof);
+  asynStatus executeProfile(GalilProfileContext *prof, bool arm = false);
+  asynStatus abortProfile(GalilProfileContext *prof);
+  //Arm profile to begin on execute, or digital input, with minimum delay
+  asynStatus armProfile(GalilProfileContext *prof);
+  asynStatus triggerProfile(GalilProfileContext *prof);
+  asynStatus readbackProfile(GalilProfileContext *prof);
 
   /* These are the methods that are new to this class */
-  void GalilStartController(char *code_file, int eeprom_write, int display_code, unsigned thread_mask);
+  asynStatus GalilStartController(char *code_file, int eeprom_write, int display_code, unsigned thread_mask, int fingerprint_check);
   void connect(void);
   void disconnect(void);
   void connected(void);
@@ -258,15 +392,28 @@ public:
   asynStatus read_codefile_part(const char *code_file, MAC_HANDLE* mac_handle);
   asynStatus get_integer(int function, epicsInt32 *value, int axisNo);
   asynStatus get_double(int function, epicsFloat64 *value, int axisNo);
-  void profileThread();
+  void profileThread(GalilProfileContext *prof);
   asynStatus setOutputCompare(int oc);
-  asynStatus runProfile();
-  asynStatus runLinearProfile(FILE *profFile);
+  asynStatus runProfile(GalilProfileContext *prof);
+  asynStatus runLinearProfile(GalilProfileContext *prof);
+  unsigned packLinearSegments(GalilProfileContext *prof, char coordName, size_t segment, int maxSegments, bool *query);
+  asynStatus runPVTProfile(GalilProfileContext *prof);
+  asynStatus startProfileAxes(GalilProfileContext *prof, const char *begin, char *axes);
+  asynStatus beginProfile(GalilProfileContext *prof, const char *begin);
+  asynStatus waitProfileTrigger(GalilProfileContext *prof, const char *begin);
+  void startProfileCapture(GalilProfileContext *prof, const char *axes);
+  void setProfileCaptureStart(GalilProfileContext *prof, unsigned time);
+  void stopProfileCapture(GalilProfileContext *prof);
+  void captureProfileRecord(void);
+  //Share the connection fairly between profiles streaming on S, and T
+  void lockProfileStream(GalilProfileContext *prof);
+  void unlockProfileStream(GalilProfileContext *prof);
+  void yieldProfileStream(GalilProfileContext *prof);
   bool anyMotorMoving(char *axes);
   bool allMotorsMoving(char *axes);
   bool motorsAtStart(char *axes, double startp[]);
-  asynStatus startLinearProfileCoordsys(int coordsys, char coordName, const char *axes);
-  asynStatus motorsToProfileStartPosition(FILE *profFile, char *axes, double startp[], bool move);
+  asynStatus startLinearProfileCoordsys(GalilProfileContext *prof, char coordName, const char *axes);
+  asynStatus motorsToProfileStartPosition(GalilProfileContext *prof, const char *axes, double startp[], bool move);
   //Execute motor record prem function for motor list
   void executePrem(const char *axes);
   //Execute auto motor power on, and brake off 
@@ -274,6 +421,13 @@ public:
   void processUnsolicitedMesgs(void);
   static std::string extractEthAddr(const char* str);
   void setCtrlError(const char* mesg);
+  void updateLinkRTT(epicsTimeStamp *begint);
+  //Maximum acceleration, and deceleration for this model
+  long modelMaxAcceleration(void);
+  bool modelPVT(void);
+  double controllerSampleTime(void);
+  double measureLinkRTT(void);
+  void checkLinkHealth(void);
 
   void InitializeDataRecord(void);
   double sourceValue(const std::vector<char>& record, const std::string& source);
@@ -291,9 +445,13 @@ public:
 
   /* Deferred moves functions.*/
   asynStatus executeSyncStartStopDeferredMove(int coordsys, char *axes, char *moves, double acceleration, double velocity);
+  asynStatus executeLinearSegments(int coordsys, char *axes, const vector<string> &segments, double acceleration, double velocity);
   asynStatus executeSyncStartOnlyDeferredMove(char *axes);
   asynStatus prepareSyncStartStopDeferredMoves(void);
   asynStatus prepareSyncStartOnlyDeferredMoves(void);
+  //Sync start for real axis on several controllers
+  asynStatus prepareSyncStart(const char *axes, double npos[], double nvel[], double naccel[]);
+  asynStatus beginSyncStart(const char *axes, epicsTimeStamp *start);
 
   void shutdownController();
   ~GalilController();
@@ -398,6 +556,36 @@ protected:
   int GalilUserVar_;
   int GalilEthAddr_;
   int GalilSerialNum_;
+  int GalilLinkHeartbeat_;
+  int GalilLinkStatus_;
+  int GalilLinkRecordAge_;
+  int GalilLinkCommandAge_;
+  int GalilLinkRTT_;
+  int GalilLinkRTTMax_;
+  int GalilLinkRTTMean_;
+  int GalilCSMotorPathTolerance_;
+  int GalilCSMotorPathDeviation_;
+  int GalilCSMotorPathSegments_;
+  int GalilCSMotorStartSkew_;
+  int GalilCSMotorVelocityScale_;
+  int GalilCSMotorAccelScale_;
+  int GalilCSMotorKinematicErrors_;
+  int GalilCSMotorKinematicErrorCount_;
+  int GalilProfileSegmentRate_;
+  int GalilProfileLowWater_;
+  int GalilProfileType_;
+  int GalilProfileAccelLimit_;
+  int GalilProfileJerkLimit_;
+  int GalilProfileContourExponent_;
+  int GalilProfileTimeScale_;
+  int GalilProfileMergeTolerance_;
+  int GalilProfileCompression_;
+  int GalilProfileMergeDeviation_;
+  int GalilProfileArm_;
+  int GalilProfileArmed_;
+  int GalilProfileTriggerInput_;
+  int GalilProfileTriggerLevel_;
+  int GalilProfileTriggerLatency_;
 //Add new parameters here
 
   int GalilCommunicationError_;
@@ -419,8 +607,15 @@ private:
   char code_file_[MAX_FILENAME_LEN];	//Code file(s) that user gave to GalilStartController
 
   int burn_program_;			//Burn program options that user gave to GalilStartController
+  int fingerprint_check_;		//Fingerprint, rather than full program compare requested by user in GalilStartController
 					
   int consecutive_timeouts_;		//Used for connection management
+  epicsTimeStamp lastRecordTime_;	//Time last data record was received.  Used for link health check
+  epicsTimeStamp lastCommandTime_;	//Time controller last responded to a command.  Used for link health check
+  double linkRTT_;			//Last command round trip time in ms
+  double linkRTTMax_;			//Maximum command round trip time in ms since connect
+  double linkRTTMean_;			//Mean command round trip time in ms since connect
+  bool longOperation_;			//Lock held by long operation (eg. code download, burn).  Link health check skipped.  Read without lock
   bool code_assembled_;			//Has code for the GalilController hardware been assembled (ie. is card_code_ all set to send)
   double updatePeriod_;			//Period between data records in ms
   bool async_records_;			//Are the data records obtained async(DR), or sync (QR)
@@ -432,9 +627,17 @@ private:
   bool movesDeferred_;			//Should moves be deferred for this controller
 
   bool coordSysStopping_[2];		//Coordinate system stopping status.  Used to process limit status for csaxes
-
-  epicsEventId profileExecuteEvent_;	//Event for executing motion profiles
-  bool profileAbort_;			//Abort profile request flag.  Aborts profile when set true
+  GalilKinematicSnapshot kinematics_;	//Kinematic data taken by poller each cycle, used by csaxis forward transforms
+  double batchRegisters_[MAX_TRANSFORM_NODES * TRANSFORM_BATCH];	//Scratch registers for batchForwardTransforms
+  GalilRemoteAxis remote_[MAX_GALIL_AXES];	//Real axis bound to axis on other controllers
+  GalilAxisSample samples_[MAX_GALIL_AXES];	//Real axis data published for cs axis on other controllers
+  epicsMutexId samplesLock_;			//Protects samples_.  Never held while taking another lock
+  bool publishSamples_;				//Another controller has bound an axis on this controller
+
+  GalilProfileContext profiles_[COORDINATE_SYSTEMS];	//Profile contexts for profiles on S, and T
+  epicsMutexId captureLock_;		//Protects profile captures.  Never held while taking another lock
+  GalilStreamLock *streamLock_;		//Controller lock profile streams take turns with
+  GalilProfileTurn *streamTurns_;	//Profiles streaming on S, and T at the same time take turns sending command lines
   unsigned thread_mask_;		//Mask detailing which threads are expected to be running after program download Bit 0 = thread 0 etc
 
   vector<char> recdata_;		//Data record from controller
@@ -444,11 +647,12 @@ private:
   unsigned numThreads_;			//Number of threads the controller supports
   bool codegen_init_;			//Has the code generator been initialised for this controller
   bool digitalinput_init_;		//Has the digital input label #ININT been included for this controller
-  char *thread_code_;			//Code generated for every axis on this controller (eg. home code, stepper pos maintenance)
-  char *limit_code_;			//Code generated for limit switches on this controller
-  char *digital_code_;			//Code generated for digital inputs on this controller
-  char *card_code_;			//All code generated for the controller.  This is the buffer actually sent to controller
-  char *user_code_;			//Code supplied by user for the controller.  This is copied to card_code_ above if all goes well
+  bool profileInputTrigger_;		//Generated code includes armed profile input trigger #PTRIG
+  GalilCodeBuffer *thread_code_;	//Code generated for every axis on this controller (eg. home code, stepper pos maintenance)
+  GalilCodeBuffer *limit_code_;		//Code generated for limit switches on this controller
+  GalilCodeBuffer *digital_code_;	//Code generated for digital inputs on this controller
+  GalilCodeBuffer *card_code_;		//All code generated for the controller.  This is the buffer actually sent to controller
+  GalilCodeBuffer *user_code_;		//Code supplied by user for the controller.  This is copied to card_code_ above if all goes well
 
   char asynccmd_[MAX_GALIL_STRING_SIZE];	//holds the assembled Galil cmd string
   char asyncresp_[MAX_GALIL_DATAREC_SIZE];	//For asynchronous messages including datarecord
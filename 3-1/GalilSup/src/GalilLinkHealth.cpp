@@ -0,0 +1,62 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Controller link health
+
+#include "GalilLinkHealth.h"
+
+/** Link status from heartbeat period, and ages
+  * Link is degraded when either age exceeds 2 heartbeat periods, and lost after 4 heartbeat periods
+  * \param[in] period      Heartbeat period in seconds.  0 = heartbeat off, link always ok
+  * \param[in] recordAge   Age of last data record in seconds
+  * \param[in] commandAge  Age of last command response in seconds
+  * \return LINK_OK, LINK_DEGRADED, or LINK_LOST
+  */
+int GalilLinkStatus(double period, double recordAge, double commandAge)
+{
+  if (period > 0.0)
+     {
+     if (recordAge >= 4.0 * period || commandAge >= 4.0 * period)
+        return LINK_LOST;
+     if (recordAge >= 2.0 * period || commandAge >= 2.0 * period)
+        return LINK_DEGRADED;
+     }
+  return LINK_OK;
+}
+
+/** Is idle probe due.  Controller is probed when no command has been answered for a heartbeat period
+  * \param[in] period      Heartbeat period in seconds.  0 = heartbeat off
+  * \param[in] commandAge  Age of last command response in seconds
+  */
+bool GalilLinkProbeDue(double period, double commandAge)
+{
+  return (period > 0.0 && commandAge >= period) ? true : false;
+}
+
+/** Updates running round trip time statistics, mean is exponentially weighted
+  * \param[in] rtt       Round trip time in ms
+  * \param[in,out] last  Last round trip time in ms
+  * \param[in,out] max   Maximum round trip time in ms
+  * \param[in,out] mean  Mean round trip time in ms.  0 = no samples yet
+  */
+void GalilLinkRTTUpdate(double rtt, double *last, double *max, double *mean)
+{
+  *last = rtt;
+  *max = (rtt > *max) ? rtt : *max;
+  *mean = (*mean == 0.0) ? rtt : *mean + (rtt - *mean) / LINK_RTT_WEIGHT;
+}
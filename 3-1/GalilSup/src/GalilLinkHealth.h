@@ -0,0 +1,40 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Controller link health
+// Link status is derived from the age of the last data record, and last command response against the
+// heartbeat period, so a silent stall on either path is detected within a bounded time
+
+#ifndef GalilLinkHealth_H
+#define GalilLinkHealth_H
+
+//Link health status
+#define LINK_OK 0
+#define LINK_DEGRADED 1
+#define LINK_LOST 2
+//Weight of newest sample in link round trip time mean is 1/LINK_RTT_WEIGHT
+#define LINK_RTT_WEIGHT 16.0
+
+//Link status given heartbeat period, and ages in seconds.  Period 0 = heartbeat off
+int GalilLinkStatus(double period, double recordAge, double commandAge);
+//Is idle probe due given heartbeat period, and age of last command response in seconds
+bool GalilLinkProbeDue(double period, double commandAge);
+//Update round trip time statistics with new round trip time in ms
+void GalilLinkRTTUpdate(double rtt, double *last, double *max, double *mean);
+
+#endif //GalilLinkHealth_H
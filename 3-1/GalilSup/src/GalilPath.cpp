@@ -0,0 +1,180 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Path mode subdivision
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "GalilPath.h"
+
+using namespace std;
+
+//Constructor
+GalilPath::GalilPath()
+{
+	kinematics_ = NULL;
+	axes_[0] = '\0';
+	naxes_ = 0;
+	tolerance_ = 0.0;
+	maxdev_ = 0.0;
+}
+
+/** Subdivide csaxis path
+  * \param[in] kinematics - Reverse, and forward transforms of the csaxis
+  * \param[in] axes - Real axis list
+  * \param[in] cs0 - CSAxis position at path start
+  * \param[in] cs1 - CSAxis position at path end
+  * \param[in] tolerance - Maximum midpoint deviation
+  * \return 0 on success */
+int GalilPath::build(GalilPathKinematics *kinematics, const char *axes, double cs0, double cs1, double tolerance)
+{
+	double q0[PATH_AXES] = {0};		//Real axis start positions
+	double q1[PATH_AXES] = {0};		//Real axis end positions
+	unsigned splits = PATH_MAX_SEGMENTS - 1;	//Bisections allowed
+	int status;
+
+	kinematics_ = kinematics;
+	strncpy(axes_, axes, PATH_AXES);
+	axes_[PATH_AXES] = '\0';
+	naxes_ = strlen(axes_);
+	tolerance_ = tolerance;
+	maxdev_ = 0.0;
+	points_.clear();
+
+	//Real axis positions at start and end of path
+	status = kinematics_->reverse(cs0, q0);
+	status |= kinematics_->reverse(cs1, q1);
+	if (status)
+		return status;
+
+	return subdivide(cs0, q0, cs1, q1, 0, &splits);
+}
+
+size_t GalilPath::points(void) const
+{
+	return points_.size() / PATH_AXES;
+}
+
+const double *GalilPath::point(size_t k) const
+{
+	return &points_[k * PATH_AXES];
+}
+
+double GalilPath::deviation(void) const
+{
+	return maxdev_;
+}
+
+/** Deviation of forward transformed segment midpoint from the straight csaxis path
+  * \param[in] cs0, q0 - Segment start csaxis position, and real axis positions
+  * \param[in] cs1, q1 - Segment end csaxis position, and real axis positions
+  * \param[out] deviation - Midpoint deviation
+  * \return 0 on success */
+int GalilPath::midpointDeviation(double cs0, const double q0[], double cs1, const double q1[], double *deviation)
+{
+	double qm[PATH_AXES] = {0};	//Real axis segment midpoint
+	double midpoint = 0.0;		//CSAxis position at real axis midpoint
+	unsigned i;			//Looping
+	int status;
+
+	//Real axis move linearly, so the segment midpoint is the mean of the end points
+	for (i = 0; i < naxes_; i++)
+		qm[i] = (q0[i] + q1[i]) / 2.0;
+	status = kinematics_->forward(qm, &midpoint);
+
+	*deviation = fabs(midpoint - (cs0 + cs1) / 2.0);
+	return status;
+}
+
+/** Bisect path segment until midpoint deviation is within tolerance
+  * Accepted segment end points are appended to points_ in path order
+  * \param[in] cs0, q0 - Segment start csaxis position, and real axis positions
+  * \param[in] cs1, q1 - Segment end csaxis position, and real axis positions
+  * \param[in] depth - Bisection depth of this segment
+  * \param[in,out] splits - Bisections remaining before PATH_MAX_SEGMENTS reached
+  * \return 0 on success */
+int GalilPath::subdivide(double cs0, const double q0[], double cs1, const double q1[], unsigned depth, unsigned *splits)
+{
+	double csm = (cs0 + cs1) / 2.0;	//CSAxis position at segment midpoint
+	double qm[PATH_AXES] = {0};	//Real axis positions at segment midpoint
+	double deviation;		//Midpoint deviation
+	int status;
+
+	status = midpointDeviation(cs0, q0, cs1, q1, &deviation);
+	if (status)
+		return status;
+
+	if (deviation > tolerance_ && depth < PATH_MAX_DEPTH && *splits > 0)
+		{
+		//Split segment at csaxis midpoint
+		(*splits)--;
+		status = kinematics_->reverse(csm, qm);
+		if (!status)
+			status |= subdivide(cs0, q0, csm, qm, depth + 1, splits);
+		if (!status)
+			status |= subdivide(csm, qm, cs1, q1, depth + 1, splits);
+		return status;
+		}
+
+	//Accept segment
+	maxdev_ = (deviation > maxdev_) ? deviation : maxdev_;
+	points_.insert(points_.end(), q1, q1 + PATH_AXES);
+	return 0;
+}
+
+/** Construct linear interpolation segments
+  * \param[in] res - Real axis resolution, egu per step/count
+  * \param[in,out] last - Real axis position at path start, updated to path end Units=Steps
+  * \param[out] segments - Comma list of axis increments, one entry per axis A-H */
+void GalilPath::segments(const double res[], long last[], vector<string> &segments) const
+{
+	char move[PATH_AXES * 22 + 1];	//Constructed comma list of axis increments, sign and 20 digits plus separator per axis
+	const char *found;		//Real axis found in axes_
+	long target;			//Real axis position at end of segment Units=Steps
+	long increment;			//Real axis increment in segment Units=Steps
+	bool moving;			//Does a real axis move in segment
+	size_t k, len;			//Looping, length of constructed move
+	unsigned i, a;			//Looping
+
+	for (k = 0; k < points(); k++)
+		{
+		moving = false;
+		len = 0;
+		for (a = 0; a < PATH_AXES; a++)
+			{
+			found = strchr(axes_, (int)('A' + a));
+			if (found)
+				{
+				i = found - axes_;
+				target = lrint(point(k)[i] / res[i]);
+				increment = target - last[i];
+				last[i] = target;
+				moving = (increment) ? true : moving;
+				len += sprintf(move + len, "%ld", increment);
+				}
+			//Add axis increment separator character ',' as needed
+			if (a < PATH_AXES - 1)
+				len += sprintf(move + len, ",");
+			}
+		//Skip segments where no real axis moves
+		if (moving)
+			segments.push_back(move);
+		}
+}
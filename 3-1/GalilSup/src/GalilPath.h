@@ -0,0 +1,77 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Path mode subdivision
+// A csaxis move is split into linear real axis segments, so real axis follow the csaxis path within a tolerance
+// Segments are bisected until the forward transform of each segment midpoint is within tolerance of the straight csaxis path
+// Kinematics are supplied by the caller, so paths can be built without a controller
+
+#ifndef GalilPath_H
+#define GalilPath_H
+
+#include <vector>
+#include <string>
+
+//Real axis A-H, same as MAX_GALIL_AXES
+#define PATH_AXES 8
+//Maximum bisection depth of a path move
+#define PATH_MAX_DEPTH 8
+//Maximum linear segments in a path move
+#define PATH_MAX_SEGMENTS 64
+
+//Kinematics a path is built with.  Real axis positions are in path axis order
+class GalilPathKinematics {
+public:
+  virtual ~GalilPathKinematics() {}
+  //Real axis positions at csaxis position.  Returns 0 on success
+  virtual int reverse(double cspos, double q[]) = 0;
+  //CSAxis position at real axis positions.  Returns 0 on success
+  virtual int forward(const double q[], double *cspos) = 0;
+};
+
+class GalilPath {
+public:
+  GalilPath();
+  //Subdivide csaxis path from cs0 to cs1 for real axis list axes (eg. "AB")
+  //Returns 0 on success
+  int build(GalilPathKinematics *kinematics, const char *axes, double cs0, double cs1, double tolerance);
+  //Accepted segment end points, in path order
+  size_t points(void) const;
+  //Real axis positions at end of segment, in path axis order
+  const double *point(size_t k) const;
+  //Largest midpoint deviation of accepted segments
+  double deviation(void) const;
+  //Construct linear interpolation segments (eg. 100,,-25) in steps/counts
+  //res, and last are in path axis order.  last is the position in steps/counts at path start, and is updated
+  //Increments are taken between rounded positions so rounding does not accumulate
+  //Segments where no real axis moves are skipped
+  void segments(const double res[], long last[], std::vector<std::string> &segments) const;
+
+private:
+  int subdivide(double cs0, const double q0[], double cs1, const double q1[], unsigned depth, unsigned *splits);
+  int midpointDeviation(double cs0, const double q0[], double cs1, const double q1[], double *deviation);
+
+  GalilPathKinematics *kinematics_;	//Kinematics path is built with
+  char axes_[PATH_AXES + 1];		//Real axis list
+  unsigned naxes_;			//Number of real axis
+  double tolerance_;			//Maximum midpoint deviation
+  double maxdev_;			//Largest midpoint deviation of accepted segments
+  std::vector<double> points_;		//Real axis positions at accepted segment end points, PATH_AXES per point
+};
+
+#endif //GalilPath_H
@@ -57,6 +57,7 @@ void GalilPoller::run(void)
   asynMotorAxis *pAxis; //Axis structure
   double time_taken;	//Time taken last polll cycle
   double sleep_time;	//Calculated time to sleep in synchronous mode
+  bool snapshot;	//Kinematic snapshot taken this cycle
 
   //Read current time
   epicsTimeGetCurrent(&pollnowt_);
@@ -74,6 +75,11 @@ void GalilPoller::run(void)
                    {
                    //Get the data record, update controller related information in GalilController, and ParamList.  callBacks not called
                    pC_->poll();
+                   //Capture data record if a profile is executing
+                   pC_->captureProfileRecord();
+                   //New data record, wake profile threads if waiting for segment buffer space
+                   for (i=0; i<COORDINATE_SYSTEMS; i++)
+                      epicsEventSignal(pC_->profiles_[i].streamEvent);
                    //Read current time
                    epicsTimeGetCurrent(&pollnowt_);
                    //Calculate cycle time
@@ -91,6 +97,7 @@ void GalilPoller::run(void)
                    //Do callbacks for GalilController, GalilAxis records
                    //Do all ParamLists/axis whether user called GalilCreateAxis or not
                    //because analog/binary IO data are stored/organized in ParamList just same as axis data 
+                   snapshot = false;
                    for (i=0; i<MAX_GALIL_AXES + MAX_GALIL_CSAXES; i++)
                       {
                       if (i < MAX_GALIL_AXES)
@@ -100,8 +107,19 @@ void GalilPoller::run(void)
                          }
                       else
                          {
+                         //Real axis are done, publish them for cs axis on other controllers
+                         if (i == MAX_GALIL_AXES && pC_->publishSamples_)
+                            pC_->publishAxisSamples();
                          //Retrieve GalilCSAxis instance i
                          pAxis = pC_->getCSAxis(i);
+                         //Real axis are done, take one kinematic snapshot for all csaxis transforms this cycle
+                         //and evaluate all csaxis forward transforms together
+                         if (pAxis && !snapshot)
+                            {
+                            pC_->buildKinematicSnapshot(&pC_->kinematics_);
+                            pC_->batchForwardTransforms();
+                            snapshot = true;
+                            }
                          }
 					
                       //Tolerate null GalilAxis object pointers
@@ -193,6 +211,11 @@ void GalilPoller::wakePoller(bool restart_async)
 	//Only if poller sleeping now
 	if (pollerSleep_)
 		{
+		//Data records were stopped whilst sleeping, restart link health record age from now
+		//Record age is read by checkLinkHealth with lock
+		pC_->lock();
+		epicsTimeGetCurrent(&pC_->lastRecordTime_);
+		pC_->unlock();
 		//Wake up poller
 		pollerSleep_ = false;
 		epicsEventSignal(pollerWakeEventId_);
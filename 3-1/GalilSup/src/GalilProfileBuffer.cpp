@@ -0,0 +1,867 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Built profile storage
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "GalilProfileBuffer.h"
+
+//Largest formatted segment, sign and 10 digits plus separator per axis, speed and terminator
+#define PROFILE_SEGMENT_TEXT (PROFILE_AXES * 12 + 16)
+
+//Write integer as decimal text, returns length written
+static size_t formatInt(char *buf, int value)
+{
+	char digits[12];		//Digits in reverse order
+	unsigned long magnitude;	//Magnitude of value
+	size_t n = 0, len = 0;
+
+	magnitude = (value < 0) ? 0UL - (unsigned long)value : (unsigned long)value;
+	do
+		{
+		digits[n++] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+		}
+	while (magnitude);
+	if (value < 0)
+		buf[len++] = '-';
+	while (n)
+		buf[len++] = digits[--n];
+	return len;
+}
+
+//Constructor
+GalilProfileBuffer::GalilProfileBuffer()
+{
+	deltas_ = NULL;
+	speeds_ = NULL;
+	velocities_ = NULL;
+	samples_ = NULL;
+	sources_ = NULL;
+	maxSegments_ = 0;
+	sampleTime_ = 0.001;
+	contourExponent_ = CONTOUR_MIN_EXPONENT;
+	clear();
+}
+
+//Destructor
+GalilProfileBuffer::~GalilProfileBuffer()
+{
+	free(deltas_);
+	free(speeds_);
+	free(velocities_);
+	free(samples_);
+	free(sources_);
+}
+
+//Allocate storage for maxSegments segments
+bool GalilProfileBuffer::allocate(size_t maxSegments)
+{
+	free(deltas_);
+	free(speeds_);
+	free(velocities_);
+	free(samples_);
+	free(sources_);
+	deltas_ = (int *)calloc(maxSegments * PROFILE_AXES, sizeof(int));
+	speeds_ = (int *)calloc(maxSegments, sizeof(int));
+	velocities_ = (int *)calloc(maxSegments * PROFILE_AXES, sizeof(int));
+	samples_ = (int *)calloc(maxSegments, sizeof(int));
+	sources_ = (size_t *)calloc(maxSegments, sizeof(size_t));
+	maxSegments_ = (deltas_ && speeds_ && velocities_ && samples_ && sources_) ? maxSegments : 0;
+	clear();
+	return (maxSegments_ == maxSegments);
+}
+
+//Empty buffer, keeps storage
+void GalilProfileBuffer::clear(void)
+{
+	int j;
+
+	segments_ = 0;
+	totalSamples_ = 0;
+	type_ = PROFILE_NONE;
+	axes_[0] = '\0';
+	lastAxis_ = -1;
+	for (j = 0; j < PROFILE_AXES; j++)
+		{
+		used_[j] = false;
+		startp_[j] = 0.0;
+		}
+}
+
+//Set axis list, and start positions indexed by axis number
+void GalilProfileBuffer::setAxes(const char *axes, const double startp[])
+{
+	int i, axisNo;
+
+	strncpy(axes_, axes, PROFILE_AXES);
+	axes_[PROFILE_AXES] = '\0';
+	lastAxis_ = -1;
+	for (i = 0; i < PROFILE_AXES; i++)
+		used_[i] = false;
+	for (i = 0; axes_[i] != '\0'; i++)
+		{
+		axisNo = axes_[i] - 'A';
+		if (axisNo < 0 || axisNo >= PROFILE_AXES)
+			continue;
+		used_[axisNo] = true;
+		startp_[axisNo] = startp[axisNo];
+		if (axisNo > lastAxis_)
+			lastAxis_ = axisNo;
+		}
+}
+
+//Append segment, deltas and speed are rounded to integer steps/counts
+bool GalilProfileBuffer::append(const double deltas[], double speed)
+{
+	int *seg;	//Segment storage
+	int j;
+
+	if (segments_ >= maxSegments_)
+		return false;
+	seg = deltas_ + segments_ * PROFILE_AXES;
+	for (j = 0; j < PROFILE_AXES; j++)
+		seg[j] = (used_[j]) ? (int)rint(deltas[j]) : 0;
+	speeds_[segments_] = (int)rint(speed);
+	sources_[segments_] = segments_;
+	segments_++;
+	return true;
+}
+
+//Append PVT segment, deltas and velocities are rounded to integer steps/counts
+bool GalilProfileBuffer::appendPVT(const double deltas[], const double velocities[], long samples)
+{
+	int *seg;	//Segment deltas
+	int *vel;	//Segment velocities
+	int j;
+
+	if (segments_ >= maxSegments_)
+		return false;
+	seg = deltas_ + segments_ * PROFILE_AXES;
+	vel = velocities_ + segments_ * PROFILE_AXES;
+	for (j = 0; j < PROFILE_AXES; j++)
+		{
+		seg[j] = (used_[j]) ? (int)rint(deltas[j]) : 0;
+		vel[j] = (used_[j]) ? (int)rint(velocities[j]) : 0;
+		}
+	samples_[segments_] = (int)samples;
+	totalSamples_ += samples;
+	sources_[segments_] = segments_;
+	segments_++;
+	return true;
+}
+
+//Append contour segment, deltas are rounded to integer steps/counts
+bool GalilProfileBuffer::appendContour(const double deltas[], long samples)
+{
+	int *seg;	//Segment deltas
+	int *vel;	//Segment velocities
+	int j;
+
+	if (segments_ >= maxSegments_)
+		return false;
+	seg = deltas_ + segments_ * PROFILE_AXES;
+	vel = velocities_ + segments_ * PROFILE_AXES;
+	for (j = 0; j < PROFILE_AXES; j++)
+		{
+		seg[j] = (used_[j]) ? (int)rint(deltas[j]) : 0;
+		vel[j] = 0;
+		}
+	samples_[segments_] = (int)samples;
+	totalSamples_ += samples;
+	sources_[segments_] = segments_;
+	segments_++;
+	return true;
+}
+
+//Build linear segments from motor positions, and segment times
+//Motor velocity, position, and acceleration statistics, and limits are checked in the same pass
+//Rounding error accumulated over the profile is kept within 1 step/count
+bool GalilProfileBuffer::buildLinear(GalilProfileMotor motors[], int nmotors, const double times[], int nPoints, char *message, size_t size)
+{
+	GalilProfileMotor *m;			//Motor
+	double moves[PROFILE_AXES] = {0};	//Segment incremental move for each motor indexed by axis number
+	double apos[PROFILE_AXES];		//Accumulated profile position calculated from integer rounded units
+	double vectorVelocity;			//Segment vector velocity
+	double segmentTime;			//Segment time
+	double incmove;				//Motor incremental move distance
+	double velocity;			//Motor velocity
+	double position;			//Motor profile position
+	double aerr;				//Accumulated error
+	int zm_count;				//Zero segment move counter
+	bool buildOK = true;			//Was the trajectory built successfully
+	int i, k;
+
+	//First point is the profile start position, velocity zero
+	for (k = 0; k < nmotors; k++)
+		{
+		m = &motors[k];
+		apos[k] = 0.0;
+		m->maxProfileVelocity = m->maxProfileAcceleration = 0.0;
+		m->maxPosition = m->minPosition = (nPoints > 0) ? m->positions[0] : 0.0;
+		if (nPoints > 0 && (m->positions[0] < m->lowLimit || m->positions[0] > m->highLimit))
+			{
+			snprintf(message, size, "Motor %c position beyond soft limits in segment %d", axes_[k], 0);
+			buildOK = false;
+			}
+		}
+
+	//Calculate motor segment velocities from profile positions, and common time base
+	for (i = 1; i < nPoints && buildOK; i++)
+		{
+		segmentTime = times[i];
+		//velocity for this segment
+		vectorVelocity = 0.0;
+		//motors with zero moves for this segment
+		zm_count = 0;
+		//Calculate motor incremental move distance, and velocity
+		for (k = 0; k < nmotors; k++)
+			{
+			m = &motors[k];
+			position = m->positions[i];
+			//Segment incremental move distance
+			incmove = position - m->positions[i - 1];
+			//Accumulated position calculated using integer rounded positions (units=steps/counts)
+			apos[k] += rint(incmove);
+			//Accumulated error caused by integer rounding
+			aerr = apos[k] - (position - m->positions[0]);
+			//If accumlated error due to rounding greater than 1 step/count, apply correction
+			if (fabs(aerr) > 1)
+				{
+				//Apply correction to segment incremental move distance
+				incmove -= aerr;
+				//Apply correction to accumulated position calculated using integer rounded positions
+				apos[k] -= aerr;
+				}
+			//Calculate required velocity for this motor given move distance and time
+			velocity = fabs(incmove / segmentTime);
+			//Add this motors' contribution to vector velocity for this segment
+			vectorVelocity += velocity * velocity;
+			//Store motor incremental move distance for this segment
+			moves[m->axisNo] = rint(incmove);
+			//Detect zero moves in this segment
+			zm_count += (moves[m->axisNo] == 0);
+			//Check profile velocity less than mr vmax for this motor
+			if (velocity > m->maxVelocity)
+				{
+				snprintf(message, size, "Seg %d: Velocity too high motor %c %2.2f > %2.2f, increase time, check profile",
+				         i, axes_[k], velocity * fabs(m->mres), m->maxVelocity * fabs(m->mres));
+				buildOK = false;
+				}
+			//Check position against software limits
+			if (position < m->lowLimit || position > m->highLimit)
+				{
+				snprintf(message, size, "Motor %c position beyond soft limits in segment %d", axes_[k], i);
+				buildOK = false;
+				}
+			//Profile statistics
+			m->maxProfileVelocity = (velocity > m->maxProfileVelocity) ? velocity : m->maxProfileVelocity;
+			m->maxProfileAcceleration = (velocity / segmentTime > m->maxProfileAcceleration) ? velocity / segmentTime : m->maxProfileAcceleration;
+			m->maxPosition = (position > m->maxPosition) ? position : m->maxPosition;
+			m->minPosition = (position < m->minPosition) ? position : m->minPosition;
+			}
+
+		//Determine vector velocity for this segment
+		vectorVelocity = sqrt(vectorVelocity);
+
+		//Check for segment too short error
+		if (rint(vectorVelocity) == 0)
+			{
+			snprintf(message, size, "Seg %d: Vector velocity zero, reduce time, add motors, and check profile", i);
+			buildOK = false;
+			}
+		if (zm_count == nmotors)
+			{
+			snprintf(message, size, "Seg %d: Vector zero move distance, reduce time, add motors, and check profile", i);
+			buildOK = false;
+			}
+
+		//Store the segment
+		if (buildOK && !append(moves, vectorVelocity))
+			{
+			snprintf(message, size, "Seg %d: Profile buffer full, increase GalilCreateProfile max points", i);
+			buildOK = false;
+			}
+		}
+
+	return buildOK;
+}
+
+void GalilProfileBuffer::setType(profileType type)
+{
+	type_ = type;
+}
+
+profileType GalilProfileBuffer::type(void) const
+{
+	return type_;
+}
+
+const char *GalilProfileBuffer::axes(void) const
+{
+	return axes_;
+}
+
+double GalilProfileBuffer::startPosition(int axisNo) const
+{
+	return startp_[axisNo];
+}
+
+int GalilProfileBuffer::delta(size_t segment, int axisNo) const
+{
+	return deltas_[segment * PROFILE_AXES + axisNo];
+}
+
+int GalilProfileBuffer::speed(size_t segment) const
+{
+	return speeds_[segment];
+}
+
+size_t GalilProfileBuffer::sourceSegment(size_t segment) const
+{
+	return sources_[segment];
+}
+
+int GalilProfileBuffer::velocity(size_t segment, int axisNo) const
+{
+	return velocities_[segment * PROFILE_AXES + axisNo];
+}
+
+int GalilProfileBuffer::samples(size_t segment) const
+{
+	return samples_[segment];
+}
+
+long GalilProfileBuffer::totalSamples(void) const
+{
+	return totalSamples_;
+}
+
+void GalilProfileBuffer::setSampleTime(double sampleTime)
+{
+	sampleTime_ = sampleTime;
+}
+
+double GalilProfileBuffer::sampleTime(void) const
+{
+	return sampleTime_;
+}
+
+void GalilProfileBuffer::setContourExponent(int exponent)
+{
+	contourExponent_ = exponent;
+}
+
+int GalilProfileBuffer::contourExponent(void) const
+{
+	return contourExponent_;
+}
+
+size_t GalilProfileBuffer::segments(void) const
+{
+	return segments_;
+}
+
+size_t GalilProfileBuffer::maxSegments(void) const
+{
+	return maxSegments_;
+}
+
+//Format segment as linear interpolation arguments
+//Axis not in axis list are left empty, trailing separators are omitted
+size_t GalilProfileBuffer::format(size_t segment, char *buf, size_t size) const
+{
+	const int *seg = deltas_ + segment * PROFILE_AXES;	//Segment storage
+	size_t len = 0;						//Formatted length
+	int j;
+
+	if (size < PROFILE_SEGMENT_TEXT || segment >= segments_)
+		{
+		if (size)
+			buf[0] = '\0';
+		return 0;
+		}
+	for (j = 0; j <= lastAxis_; j++)
+		{
+		if (used_[j])
+			len += formatInt(buf + len, seg[j]);
+		if (j < lastAxis_)
+			buf[len++] = ',';
+		}
+	buf[len++] = '<';
+	len += formatInt(buf + len, speeds_[segment]);
+	buf[len] = '\0';
+	return len;
+}
+
+//Start generating commands for a PVT, or contour profile
+void GalilProfileBuffer::startCursor(GalilProfileCursor *cursor, bool contour, int exponent) const
+{
+	int j;
+
+	cursor->contour = contour;
+	cursor->exponent = exponent;
+	cursor->segment = 0;
+	cursor->axis = 0;
+	cursor->segmentStart = 0;
+	cursor->time = 0;
+	cursor->terminated = false;
+	for (j = 0; j < PROFILE_AXES; j++)
+		cursor->start[j] = cursor->sent[j] = 0.0;
+}
+
+//Position relative to profile start at profile time t samples
+//Cubic hermite between segment end points for PVT profiles, using segment start and end velocities
+//Linear between segment end points for contour profiles
+//t must be within the cursor segment
+double GalilProfileBuffer::position(const GalilProfileCursor *cursor, int axisNo, double t) const
+{
+	size_t seg = cursor->segment;			//Segment
+	double h = samples_[seg];			//Segment time in samples
+	double s = (t - cursor->segmentStart) / h;	//Normalized time in segment
+	double v0, v1;					//Start, and end velocity in steps/counts per segment time
+	double d = deltas_[seg * PROFILE_AXES + axisNo];	//Segment delta
+
+	if (type_ == PROFILE_CONTOUR)
+		return cursor->start[axisNo] + s * d;
+	v0 = (seg) ? velocities_[(seg - 1) * PROFILE_AXES + axisNo] * sampleTime_ * h : 0.0;
+	v1 = velocities_[seg * PROFILE_AXES + axisNo] * sampleTime_ * h;
+	return cursor->start[axisNo] + (s * s * (3.0 - 2.0 * s)) * d + (s * (s - 1.0) * (s - 1.0)) * v0 + (s * s * (s - 1.0)) * v1;
+}
+
+//Format contour slice, slice time exponent is omitted if it equals the default
+size_t GalilProfileBuffer::formatContour(const int deltas[], int exponent, int defaultExponent, char *buf, size_t size) const
+{
+	size_t len = 0;		//Formatted length
+	int j;
+
+	if (size < PROFILE_SEGMENT_TEXT)
+		{
+		if (size)
+			buf[0] = '\0';
+		return 0;
+		}
+	buf[len++] = 'C';
+	buf[len++] = 'D';
+	buf[len++] = ' ';
+	for (j = 0; j <= lastAxis_; j++)
+		{
+		if (used_[j])
+			len += formatInt(buf + len, deltas[j]);
+		if (j < lastAxis_)
+			buf[len++] = ',';
+		}
+	if (exponent != defaultExponent)
+		{
+		buf[len++] = '=';
+		len += formatInt(buf + len, exponent);
+		}
+	buf[len] = '\0';
+	return len;
+}
+
+//Generate next controller command for a PVT, or contour profile
+bool GalilProfileBuffer::nextCommand(GalilProfileCursor *cursor, char *buf, size_t size, bool *slot) const
+{
+	int deltas[PROFILE_AXES];	//Contour slice deltas
+	long remaining;			//Profile time remaining, samples
+	long slice;			//Contour slice time, samples
+	int exponent;			//Contour slice time exponent
+	double pos;			//Rounded position at slice end
+	size_t seg;			//Segment
+	int axisNo;			//Axis number
+	int j;
+
+	*slot = false;
+	if (size < PROFILE_SEGMENT_TEXT)
+		return false;
+
+	if (!cursor->contour)
+		{
+		//PVT command for each axis in each segment, then PV with zero time for each axis ends PVT mode
+		if (cursor->segment >= segments_ && cursor->terminated)
+			return false;
+		axisNo = axes_[cursor->axis] - 'A';
+		seg = cursor->segment;
+		if (seg < segments_)
+			sprintf(buf, "PV%c=%d,%d,%d", axes_[cursor->axis], deltas_[seg * PROFILE_AXES + axisNo],
+			        velocities_[seg * PROFILE_AXES + axisNo], samples_[seg]);
+		else
+			sprintf(buf, "PV%c=0,0,0", axes_[cursor->axis]);
+		//First axis command of each segment uses a buffer segment on every axis
+		*slot = (cursor->axis == 0);
+		if (axes_[++cursor->axis] == '\0')
+			{
+			cursor->axis = 0;
+			if (cursor->segment < segments_)
+				cursor->segment++;
+			else
+				cursor->terminated = true;
+			}
+		return true;
+		}
+
+	//Contour slices
+	if (cursor->terminated)
+		return false;
+	remaining = totalSamples_ - cursor->time;
+	if (remaining < 2)
+		{
+		//Slice with zero time exponent ends contour mode
+		for (j = 0; j < PROFILE_AXES; j++)
+			deltas[j] = 0;
+		formatContour(deltas, 0, -1, buf, size);
+		cursor->terminated = true;
+		*slot = true;
+		return true;
+		}
+	//Default slice time, or largest power of 2 that fits in the remaining time
+	exponent = cursor->exponent;
+	while (exponent > CONTOUR_MIN_EXPONENT && (1L << exponent) > remaining)
+		exponent--;
+	slice = 1L << exponent;
+	cursor->time += slice;
+	//Move to segment containing slice end
+	while (cursor->segment < segments_ - 1 && cursor->time > cursor->segmentStart + samples_[cursor->segment])
+		{
+		for (j = 0; j < PROFILE_AXES; j++)
+			cursor->start[j] += deltas_[cursor->segment * PROFILE_AXES + j];
+		cursor->segmentStart += samples_[cursor->segment];
+		cursor->segment++;
+		}
+	//Slice deltas from rounded positions, so rounding never accumulates
+	for (j = 0; j < PROFILE_AXES; j++)
+		{
+		deltas[j] = 0;
+		if (!used_[j])
+			continue;
+		pos = rint(position(cursor, j, (double)cursor->time));
+		deltas[j] = (int)(pos - cursor->sent[j]);
+		cursor->sent[j] = pos;
+		}
+	formatContour(deltas, exponent, cursor->exponent, buf, size);
+	*slot = true;
+	return true;
+}
+
+//Write profile to file in text format
+bool GalilProfileBuffer::exportFile(const char *fileName) const
+{
+	char text[PROFILE_SEGMENT_TEXT];	//Formatted segment
+	FILE *profFile;				//Export file
+	size_t i;				//Looping
+	int j;
+	bool ok;
+
+	profFile = fopen(fileName, "wt");
+	if (profFile == NULL)
+		return false;
+
+	//Profile type, axis list, and start positions
+	fprintf(profFile, "%s\n%s\n", (type_ == PROFILE_PVT) ? "PVT" : (type_ == PROFILE_CONTOUR) ? "CONTOUR" : "LINEAR", axes_);
+	for (i = 0; axes_[i] != '\0'; i++)
+		fprintf(profFile, "%.0lf,", startp_[axes_[i] - 'A']);
+	fprintf(profFile, "\n");
+
+	//Segments
+	for (i = 0; i < segments_; i++)
+		{
+		if (type_ == PROFILE_PVT)
+			{
+			//Delta, and end velocity for each axis, then time in samples
+			for (j = 0; axes_[j] != '\0'; j++)
+				fprintf(profFile, "%d,%d,", delta(i, axes_[j] - 'A'), velocity(i, axes_[j] - 'A'));
+			fprintf(profFile, "%d\n", samples_[i]);
+			}
+		else if (type_ == PROFILE_CONTOUR)
+			{
+			//Delta for each axis, then time in samples
+			for (j = 0; axes_[j] != '\0'; j++)
+				fprintf(profFile, "%d,", delta(i, axes_[j] - 'A'));
+			fprintf(profFile, "%d\n", samples_[i]);
+			}
+		else
+			{
+			format(i, text, sizeof(text));
+			fprintf(profFile, "%s\n", text);
+			}
+		}
+
+	ok = !ferror(profFile);
+	if (fclose(profFile))
+		ok = false;
+	return ok;
+}
+
+//Next command streamed to controller, and the time controller takes to execute it in seconds
+//Linear profiles stream LI commands, PVT and contour profiles stream commands from nextCommand
+bool GalilProfileBuffer::streamCommand(GalilProfileCursor *cursor, bool contour, char *buf, size_t size, bool *slot, double *duration) const
+{
+	size_t segment;		//Segment before command
+	long time;		//Profile time before command, samples
+	bool more;		//Command generated
+
+	*duration = 0.0;
+	if (type_ == PROFILE_LINEAR)
+		{
+		*slot = false;
+		if (cursor->segment >= segments_ || size < PROFILE_SEGMENT_TEXT + 3)
+			return false;
+		strcpy(buf, "LI ");
+		format(cursor->segment, buf + 3, size - 3);
+		*duration = segmentTime(cursor->segment);
+		*slot = true;
+		cursor->segment++;
+		return true;
+		}
+
+	segment = cursor->segment;
+	time = cursor->time;
+	more = nextCommand(cursor, buf, size, slot);
+	if (more && *slot)
+		{
+		if (contour)
+			*duration = (cursor->time - time) * sampleTime_;
+		else if (segment < segments_)
+			*duration = samples_[segment] * sampleTime_;
+		}
+	return more;
+}
+
+//Advance controller consumption of streamed segments to time t
+//consumeEnd is the time the segment controller is executing ends
+void GalilProfileBuffer::consumeStream(GalilProfileCursor *cursor, bool contour, double t, double timeScale, long sent, long *consumed, double *consumeEnd) const
+{
+	char text[PROFILE_SEGMENT_TEXT + 4];	//Command text, unused
+	double duration;			//Segment execute time
+	bool slot;				//Command uses a buffer segment
+
+	while (*consumed < sent && *consumeEnd <= t)
+		{
+		(*consumed)++;
+		//Find next buffer segment
+		slot = false;
+		while (!slot && streamCommand(cursor, contour, text, sizeof(text), &slot, &duration));
+		*consumeEnd += (slot) ? duration * timeScale : 0.0;
+		}
+}
+
+//Simulate streaming the profile over a link
+//Command lines are sent back to back, each taking one round trip, with the free space query first
+//Controller buffer is filled before profile starts
+long GalilProfileBuffer::simulateStream(const GalilStreamModel *model, double timeScale, double *failTime) const
+{
+	GalilProfileCursor send, consume;	//Commands sent, and consumed by controller
+	char text[PROFILE_SEGMENT_TEXT + 4];	//Next command to send
+	bool pending, slot;			//Command waiting to be sent, and uses a buffer segment
+	bool started = false;			//Profile started
+	bool first;				//First command on line
+	double duration;			//Segment execute time
+	double t = 0.0;				//Time since profile start, seconds
+	double consumeEnd = 0.0;		//Time the segment controller is executing ends
+	long sent = 0, consumed = 0;		//Buffer segments sent, and consumed
+	long freeSpace;				//Free space in controller buffer
+	long lineSlots;				//Buffer segments on command line
+	size_t len;				//Command line length
+
+	*failTime = 0.0;
+	if (model->bufferSize <= 0 || (type_ != PROFILE_LINEAR && type_ != PROFILE_PVT && type_ != PROFILE_CONTOUR))
+		return -1;
+	startCursor(&send, model->contour, contourExponent_);
+	startCursor(&consume, model->contour, contourExponent_);
+	//Controller executes first buffer segment at start
+	slot = false;
+	while (!slot && streamCommand(&consume, model->contour, text, sizeof(text), &slot, &duration));
+	consumeEnd = (slot) ? duration * timeScale : 0.0;
+
+	pending = streamCommand(&send, model->contour, text, sizeof(text), &slot, &duration);
+	while (pending)
+		{
+		freeSpace = model->bufferSize - (sent - consumed);
+		if (started && slot && freeSpace <= 0)
+			{
+			//Buffer full, wait for controller to finish a segment, then notice space and query it
+			t = (consumeEnd > t) ? consumeEnd : t;
+			t += model->wait + model->rtt;
+			consumeStream(&consume, model->contour, t, timeScale, sent, &consumed, &consumeEnd);
+			continue;
+			}
+		if (started)
+			{
+			//Line takes a round trip, free space query reports segments buffered before this line
+			t += model->rtt;
+			consumeStream(&consume, model->contour, t, timeScale, sent, &consumed, &consumeEnd);
+			if (sent - consumed <= model->minBuffered)
+				{
+				*failTime = t;
+				return consumed;
+				}
+			freeSpace = model->bufferSize - (sent - consumed);
+			}
+		//Pack command line
+		len = model->queryLength;
+		lineSlots = 0;
+		first = true;
+		while (pending && (!slot || lineSlots < freeSpace))
+			{
+			//First command alone is sent without the query if too long
+			if (!first && len + strlen(text) + 1 > model->lineLength)
+				break;
+			len += strlen(text) + 1;
+			lineSlots += (slot) ? 1 : 0;
+			first = false;
+			pending = streamCommand(&send, model->contour, text, sizeof(text), &slot, &duration);
+			}
+		sent += lineSlots;
+		//Profile starts once buffer is full, or profile is all sent
+		if (!started && (sent >= model->bufferSize || !pending))
+			started = true;
+		}
+
+	return -1;
+}
+
+//Smallest segment time scale the profile can be streamed at
+double GalilProfileBuffer::streamTimeScale(const GalilStreamModel *model, double maxScale) const
+{
+	double lo = 1.0, hi = maxScale;	//Scale search bounds, hi can be streamed
+	double scale;			//Scale tried
+	double t;			//Profile time streaming falls behind at
+	int i;
+
+	if (simulateStream(model, lo, &t) < 0)
+		return lo;
+	if (simulateStream(model, hi, &t) >= 0)
+		return 0.0;
+	//Bisect to 1%
+	for (i = 0; i < 20 && hi - lo > 0.01; i++)
+		{
+		scale = (lo + hi) / 2.0;
+		if (simulateStream(model, scale, &t) < 0)
+			hi = scale;
+		else
+			lo = scale;
+		}
+	return hi;
+}
+
+//Linear segment time in seconds, vector speed is along the segment vector
+double GalilProfileBuffer::segmentTime(size_t segment) const
+{
+	const int *seg = deltas_ + segment * PROFILE_AXES;	//Segment deltas
+	double length = 0.0;					//Segment vector length
+	int j;
+
+	for (j = 0; j < PROFILE_AXES; j++)
+		length += (double)seg[j] * seg[j];
+	return (speeds_[segment] > 0) ? sqrt(length) / speeds_[segment] : 0.0;
+}
+
+//Merge consecutive linear segments
+//Runs of segments are merged in place.  Merged deltas are sums of the integer deltas, so end points are exact
+//Merged speed is the run vector length over the run time, so run time is kept to speed rounding
+//Segment speeds arent compared, rounded deltas change the speed of short segments by more than speed rounding
+//Deviation alone decides a merge, except runs arent extended to a segment that doesnt move, or rounds to speed 0
+double GalilProfileBuffer::merge(double tolerance)
+{
+	double run[PROFILE_AXES];	//Run deltas
+	double next[PROFILE_AXES];	//Run deltas with next segment
+	double point[PROFILE_AXES];	//Original segment end relative to run start
+	double runTime, nextTime;	//Run time, and run time with next segment
+	double t;			//Original segment end time relative to run start
+	double dev, runDev;		//Deviation from original segment ends
+	double maxDev = 0.0;		//Largest deviation of merged segments
+	double length;			//Merged segment vector length
+	size_t w = 0;			//Next merged segment stored
+	size_t r = 0;			//First segment in run
+	size_t i, k;
+	int j;
+
+	if (type_ != PROFILE_NONE && type_ != PROFILE_LINEAR)
+		return 0.0;
+
+	while (r < segments_)
+		{
+		for (j = 0; j < PROFILE_AXES; j++)
+			run[j] = deltas_[r * PROFILE_AXES + j];
+		runTime = segmentTime(r);
+		runDev = 0.0;
+		for (i = r + 1; i < segments_ && i - r < PROFILE_MERGE_MAX; i++)
+			{
+			nextTime = runTime + segmentTime(i);
+			if (nextTime <= 0.0)
+				break;
+			for (j = 0; j < PROFILE_AXES; j++)
+				{
+				next[j] = run[j] + deltas_[i * PROFILE_AXES + j];
+				point[j] = 0.0;
+				}
+			//Merged deltas must fit segment storage
+			for (j = 0; j < PROFILE_AXES && fabs(next[j]) < INT_MAX; j++);
+			if (j < PROFILE_AXES)
+				break;
+			//Merged segment must move at a speed the controller accepts (eg. a reversal can merge to 0<0)
+			length = 0.0;
+			for (j = 0; j < PROFILE_AXES; j++)
+				length += next[j] * next[j];
+			if (length == 0.0 || rint(sqrt(length) / nextTime) < 1.0)
+				break;
+			//Deviation of every original segment end in run from the merged segment at the same time
+			dev = 0.0;
+			t = 0.0;
+			for (k = r; k < i && dev <= tolerance; k++)
+				{
+				t += segmentTime(k);
+				for (j = 0; j < PROFILE_AXES; j++)
+					{
+					point[j] += deltas_[k * PROFILE_AXES + j];
+					if (fabs(point[j] - next[j] * t / nextTime) > dev)
+						dev = fabs(point[j] - next[j] * t / nextTime);
+					}
+				}
+			if (dev > tolerance)
+				break;
+			//Extend run
+			for (j = 0; j < PROFILE_AXES; j++)
+				run[j] = next[j];
+			runTime = nextTime;
+			runDev = dev;
+			}
+
+		//Store run as one segment.  Run segments have been read, and w <= r
+		length = 0.0;
+		for (j = 0; j < PROFILE_AXES; j++)
+			{
+			deltas_[w * PROFILE_AXES + j] = (int)run[j];
+			length += run[j] * run[j];
+			}
+		speeds_[w] = (i - r > 1) ? (int)rint(sqrt(length) / runTime) : speeds_[r];
+		sources_[w] = sources_[r];
+		maxDev = (runDev > maxDev) ? runDev : maxDev;
+		w++;
+		r = i;
+		}
+	segments_ = w;
+
+	return maxDev;
+}
@@ -0,0 +1,181 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Built profile storage
+// Linear segments are stored as integer step/count deltas for axis A-H plus vector speed
+// PVT segments are stored as integer step/count deltas, end velocities for axis A-H, and time in samples
+// PVT profiles are streamed as controller PVT commands, or as contour mode slices interpolated on the host
+// Contour profiles are stored as integer step/count deltas for axis A-H, and time in samples
+// Contour profiles are streamed as contour mode slices resampled on the host at constant velocity between points
+// Storage for the maximum number of segments is allocated once, so build and execute do no allocation
+// Profiles can be exported to the text file format used by earlier releases
+// Streaming a profile over a link can be simulated, to check the controller buffer never runs dry
+// Consecutive linear segments can be merged where the merged segment stays within a tolerance of the original points
+
+#ifndef GalilProfileBuffer_H
+#define GalilProfileBuffer_H
+
+#include <stddef.h>
+
+//Axis A-H, same as MAX_GALIL_AXES
+#define PROFILE_AXES 8
+
+//Built profile types
+enum profileType {PROFILE_NONE, PROFILE_LINEAR, PROFILE_PVT, PROFILE_CONTOUR};
+
+//Most linear segments merged into one segment
+#define PROFILE_MERGE_MAX 256
+
+//Longest PVT segment time in samples accepted by controller
+#define PVT_MAX_SAMPLES 2048
+//Contour slice time exponent range, slice is 2^n samples
+#define CONTOUR_MIN_EXPONENT 1
+#define CONTOUR_MAX_EXPONENT 8
+
+//Position in a profile whilst generating controller commands to stream
+struct GalilProfileCursor {
+  bool contour;			//Generate contour slices rather than PVT segments
+  int exponent;			//Contour slice time 2^exponent samples
+  size_t segment;		//Segment containing next command
+  int axis;			//Next axis in axis list, PVT only
+  long segmentStart;		//Profile time at start of segment, samples
+  long time;			//Profile time at end of last contour slice, samples
+  double start[PROFILE_AXES];	//Position at start of segment relative to profile start
+  double sent[PROFILE_AXES];	//Position sent so far as contour slices
+  bool terminated;		//Terminating commands generated
+};
+
+//Motor in a linear profile build, in steps/counts.  Limits are inputs, statistics are outputs
+struct GalilProfileMotor {
+  const double *positions;	//Profile positions
+  int axisNo;			//Axis number
+  double mres;			//Motor resolution, messages report velocity in egu
+  double maxVelocity;		//Velocity limit per second
+  double lowLimit;		//Soft limits
+  double highLimit;
+  double maxProfileVelocity;	//Highest velocity in profile
+  double maxProfileAcceleration;	//Highest acceleration in profile
+  double maxPosition;		//Position range in profile
+  double minPosition;
+};
+
+//Link model used to simulate streaming a profile to the controller
+struct GalilStreamModel {
+  double rtt;			//Command line round trip time, seconds
+  double wait;			//Time to notice buffer space once controller buffer is full, seconds
+  int bufferSize;		//Controller buffer size, segments
+  int minBuffered;		//Profile is aborted if buffered segments falls to this whilst streaming
+  size_t lineLength;		//Longest command line
+  size_t queryLength;		//Free space query placed first on each command line
+  bool contour;			//PVT profile is streamed as contour slices
+};
+
+class GalilProfileBuffer {
+public:
+  GalilProfileBuffer();
+  ~GalilProfileBuffer();
+  //Allocate storage for maxSegments segments, discards any profile held
+  bool allocate(size_t maxSegments);
+  //Empty buffer, keeps storage.  Profile type is set to PROFILE_NONE
+  void clear(void);
+  //Set axis list, and start positions indexed by axis number
+  void setAxes(const char *axes, const double startp[]);
+  //Append segment.  deltas are indexed by axis number, unused axis are ignored
+  //Returns false if storage is full
+  bool append(const double deltas[], double speed);
+  //Append PVT segment.  velocities are segment end velocities in steps/counts per second
+  //Returns false if storage is full
+  bool appendPVT(const double deltas[], const double velocities[], long samples);
+  //Append contour segment, motion is at constant velocity within segment
+  //Returns false if storage is full
+  bool appendContour(const double deltas[], long samples);
+  //Build linear segments from motor positions, and segment times in seconds, after setAxes
+  //motors are in axis list order.  Returns false with a message naming the failing segment
+  bool buildLinear(GalilProfileMotor motors[], int nmotors, const double times[], int nPoints, char *message, size_t size);
+  //Mark profile complete
+  void setType(profileType type);
+  profileType type(void) const;
+  const char *axes(void) const;
+  double startPosition(int axisNo) const;
+  int delta(size_t segment, int axisNo) const;
+  int speed(size_t segment) const;
+  //Appended segment a segment starts at, segments keep their append order when merged
+  size_t sourceSegment(size_t segment) const;
+  //PVT segment end velocity, and time in samples
+  int velocity(size_t segment, int axisNo) const;
+  int samples(size_t segment) const;
+  //PVT, or contour profile duration in samples
+  long totalSamples(void) const;
+  //Controller sample time in seconds PVT segment times are based on
+  void setSampleTime(double sampleTime);
+  double sampleTime(void) const;
+  //Contour slice time exponent used when profile is streamed in contour mode
+  void setContourExponent(int exponent);
+  int contourExponent(void) const;
+  size_t segments(void) const;
+  size_t maxSegments(void) const;
+  //Merge consecutive linear segments, where the merged segment passes within
+  //tolerance steps/counts of every original segment end at its original time.  Segment end points are kept exact
+  //Deviation alone decides a merge, segment speeds arent compared.  Runs are not merged to a segment that
+  //doesnt move, or whose speed rounds to 0
+  //Returns the largest deviation of a merged segment from the original segment ends
+  double merge(double tolerance);
+  //Format segment as linear interpolation arguments (eg. 1000,,-1000<5000)
+  //Returns formatted length
+  size_t format(size_t segment, char *buf, size_t size) const;
+  //Start generating commands for a PVT, or contour profile, as PVT commands or contour slices
+  void startCursor(GalilProfileCursor *cursor, bool contour, int exponent) const;
+  //Generate next controller command for a PVT, or contour profile, ending with the terminating commands
+  //slot is true if the command uses a segment in the controller buffer
+  //Returns false when all commands have been generated
+  bool nextCommand(GalilProfileCursor *cursor, char *buf, size_t size, bool *slot) const;
+  //Write profile to file in text format.  Returns false if file cant be written
+  bool exportFile(const char *fileName) const;
+  //Simulate streaming the profile with segment times scaled by timeScale
+  //Returns the first controller buffer segment streaming falls behind at, and its profile time
+  //Returns -1 if the profile can be streamed
+  long simulateStream(const GalilStreamModel *model, double timeScale, double *failTime) const;
+  //Smallest segment time scale from 1 to maxScale the profile can be streamed at, found to 1% by bisection
+  //Returns 0 if the profile cant be streamed at maxScale
+  double streamTimeScale(const GalilStreamModel *model, double maxScale) const;
+
+private:
+  double segmentTime(size_t segment) const;
+  bool streamCommand(GalilProfileCursor *cursor, bool contour, char *buf, size_t size, bool *slot, double *duration) const;
+  void consumeStream(GalilProfileCursor *cursor, bool contour, double t, double timeScale, long sent, long *consumed, double *consumeEnd) const;
+  double position(const GalilProfileCursor *cursor, int axisNo, double t) const;
+  size_t formatContour(const int deltas[], int exponent, int defaultExponent, char *buf, size_t size) const;
+
+  int *deltas_;			//Segment deltas, PROFILE_AXES per segment
+  int *speeds_;			//Segment vector speed
+  int *velocities_;		//PVT segment end velocities, PROFILE_AXES per segment
+  int *samples_;		//PVT segment time in samples
+  size_t *sources_;		//Appended segment each segment starts at
+  long totalSamples_;		//PVT profile duration in samples
+  double sampleTime_;		//Controller sample time in seconds
+  int contourExponent_;		//Contour slice time exponent
+  size_t segments_;		//Segments in buffer
+  size_t maxSegments_;		//Storage allocated in segments
+  profileType type_;		//Profile type, PROFILE_NONE until profile complete
+  char axes_[PROFILE_AXES + 1];	//Axis list
+  bool used_[PROFILE_AXES];	//Axis in axis list, indexed by axis number
+  int lastAxis_;		//Highest axis number in axis list
+  double startp_[PROFILE_AXES];	//Start positions indexed by axis number
+};
+
+#endif //GalilProfileBuffer_H
@@ -0,0 +1,188 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Profile data record capture
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "GalilProfileCapture.h"
+
+//Data record sample counter is 16 bit
+#define CAPTURE_TIME_MASK 0xFFFF
+#define CAPTURE_TIME_HALF 0x8000
+
+//Constructor
+GalilProfileCapture::GalilProfileCapture()
+{
+	times_ = NULL;
+	values_ = NULL;
+	maxRecords_ = 0;
+	active_ = false;
+	start("");
+	stop();
+}
+
+//Destructor
+GalilProfileCapture::~GalilProfileCapture()
+{
+	free(times_);
+	free(values_);
+}
+
+//Allocate storage for maxRecords records
+bool GalilProfileCapture::allocate(size_t maxRecords)
+{
+	free(times_);
+	free(values_);
+	//Decimation keeps every second record, so storage is at least 2 records
+	maxRecords = (maxRecords < 2) ? 2 : maxRecords;
+	times_ = (long *)calloc(maxRecords, sizeof(long));
+	values_ = (int *)calloc(maxRecords * CAPTURE_SOURCES * PROFILE_AXES, sizeof(int));
+	maxRecords_ = (times_ && values_) ? maxRecords : 0;
+	start("");
+	stop();
+	return (maxRecords_ == maxRecords);
+}
+
+//Discard capture held, and start capturing
+void GalilProfileCapture::start(const char *axes)
+{
+	strncpy(axes_, axes, PROFILE_AXES);
+	axes_[PROFILE_AXES] = '\0';
+	records_ = 0;
+	seen_ = 0;
+	stride_ = 1;
+	firstTime_ = lastTime_ = 0;
+	elapsed_ = 0;
+	startTime_ = 0;
+	started_ = false;
+	active_ = (maxRecords_ > 0);
+}
+
+void GalilProfileCapture::stop(void)
+{
+	active_ = false;
+}
+
+bool GalilProfileCapture::active(void) const
+{
+	return active_;
+}
+
+//Set data record sample counter at profile start
+void GalilProfileCapture::setStart(unsigned time)
+{
+	startTime_ = time & CAPTURE_TIME_MASK;
+	started_ = true;
+}
+
+bool GalilProfileCapture::started(void) const
+{
+	return started_;
+}
+
+//Add data record, decimating once storage is full
+void GalilProfileCapture::add(unsigned time, const int tp[], const int td[], const int te[])
+{
+	int *rec;	//Record storage
+	size_t i;
+	int j;
+
+	if (!active_)
+		return;
+	time &= CAPTURE_TIME_MASK;
+	//Sample counter wraps, track samples since first record
+	if (!seen_)
+		firstTime_ = time;
+	else
+		elapsed_ += (long)((time - lastTime_) & CAPTURE_TIME_MASK);
+	lastTime_ = time;
+	//Store every stride record
+	if (seen_++ % stride_)
+		return;
+	//Storage full, keep every second record and halve the rate records are stored
+	if (records_ >= maxRecords_)
+		{
+		for (i = 0; 2 * i < records_; i++)
+			{
+			times_[i] = times_[2 * i];
+			memcpy(values_ + i * CAPTURE_SOURCES * PROFILE_AXES, values_ + 2 * i * CAPTURE_SOURCES * PROFILE_AXES,
+			       CAPTURE_SOURCES * PROFILE_AXES * sizeof(int));
+			}
+		records_ = i;
+		stride_ *= 2;
+		//This record is kept only if it falls on the new stride
+		if ((seen_ - 1) % stride_)
+			return;
+		}
+	times_[records_] = elapsed_;
+	rec = values_ + records_ * CAPTURE_SOURCES * PROFILE_AXES;
+	for (j = 0; j < PROFILE_AXES; j++)
+		{
+		rec[CAPTURE_TP * PROFILE_AXES + j] = tp[j];
+		rec[CAPTURE_TD * PROFILE_AXES + j] = td[j];
+		rec[CAPTURE_TE * PROFILE_AXES + j] = te[j];
+		}
+	records_++;
+}
+
+const char *GalilProfileCapture::axes(void) const
+{
+	return axes_;
+}
+
+size_t GalilProfileCapture::records(void) const
+{
+	return records_;
+}
+
+//Captured value at time t samples from profile start
+double GalilProfileCapture::value(captureSource source, int axisNo, double t) const
+{
+	size_t lo, hi, mid;	//Binary search bounds
+	long offset;		//Profile start from first record, samples
+	double v0, v1;		//Values either side of t
+	double s;		//Fraction of record interval
+
+	if (!records_)
+		return 0.0;
+	//Profile start relative to first record, within half the sample counter range either side
+	offset = (started_) ? (long)((startTime_ - firstTime_ + CAPTURE_TIME_HALF) & CAPTURE_TIME_MASK) - CAPTURE_TIME_HALF : 0;
+	t += offset;
+	//Outside capture
+	if (t <= times_[0])
+		return values_[source * PROFILE_AXES + axisNo];
+	if (t >= times_[records_ - 1])
+		return values_[(records_ - 1) * CAPTURE_SOURCES * PROFILE_AXES + source * PROFILE_AXES + axisNo];
+	//Find records either side of t
+	lo = 0;
+	hi = records_ - 1;
+	while (hi - lo > 1)
+		{
+		mid = (lo + hi) / 2;
+		if (times_[mid] <= t)
+			lo = mid;
+		else
+			hi = mid;
+		}
+	v0 = values_[lo * CAPTURE_SOURCES * PROFILE_AXES + source * PROFILE_AXES + axisNo];
+	v1 = values_[hi * CAPTURE_SOURCES * PROFILE_AXES + source * PROFILE_AXES + axisNo];
+	s = (times_[hi] > times_[lo]) ? (t - times_[lo]) / (double)(times_[hi] - times_[lo]) : 0.0;
+	return v0 + s * (v1 - v0);
+}
@@ -0,0 +1,74 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Profile data record capture
+// Encoder (_TP), aux encoder/step (_TD), and position error (_TE) for axis A-H are stored with the data record
+// sample counter for each data record received whilst a profile executes
+// Storage is allocated once.  When full, every second record is discarded and later records are decimated
+// to match, so capture never allocates and always spans the whole profile
+
+#ifndef GalilProfileCapture_H
+#define GalilProfileCapture_H
+
+#include <stddef.h>
+
+#include "GalilProfileBuffer.h"
+
+//Captured data record values
+enum captureSource {CAPTURE_TP, CAPTURE_TD, CAPTURE_TE, CAPTURE_SOURCES};
+
+class GalilProfileCapture {
+public:
+  GalilProfileCapture();
+  ~GalilProfileCapture();
+  //Allocate storage for maxRecords records, discards any capture held
+  bool allocate(size_t maxRecords);
+  //Discard capture held, and start capturing data records for axis list
+  void start(const char *axes);
+  //Stop capturing data records
+  void stop(void);
+  bool active(void) const;
+  //Set data record sample counter value at profile start
+  void setStart(unsigned time);
+  //Profile start time known, capture can be aligned with profile time base
+  bool started(void) const;
+  //Add data record.  time is the data record sample counter, values are indexed by axis number
+  void add(unsigned time, const int tp[], const int td[], const int te[]);
+  const char *axes(void) const;
+  size_t records(void) const;
+  //Captured value at time t samples from profile start, interpolated between records
+  //Times outside the capture use the first or last record
+  double value(captureSource source, int axisNo, double t) const;
+
+private:
+  long *times_;			//Record time in samples from first record
+  int *values_;			//Record values, CAPTURE_SOURCES * PROFILE_AXES per record
+  size_t records_;		//Records in buffer
+  size_t maxRecords_;		//Storage allocated in records
+  unsigned long seen_;		//Records offered since start
+  unsigned long stride_;	//Records offered per record stored
+  unsigned firstTime_;		//Sample counter of first record offered
+  unsigned lastTime_;		//Sample counter of last record offered
+  long elapsed_;		//Samples from first record to last record offered
+  unsigned startTime_;		//Sample counter at profile start
+  bool started_;		//Profile start time known
+  bool active_;			//Capturing data records
+  char axes_[PROFILE_AXES + 1];	//Axis list
+};
+
+#endif //GalilProfileCapture_H
@@ -0,0 +1,106 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Armed profile trigger sequencing
+
+#include "GalilProfileTrigger.h"
+
+//Constructor
+GalilProfileTrigger::GalilProfileTrigger()
+{
+	state_ = TRIGGER_IDLE;
+	arm_ = false;
+}
+
+//Profile execute accepted
+void GalilProfileTrigger::start(bool arm)
+{
+	arm_ = arm;
+	state_ = (arm) ? TRIGGER_ARMING : TRIGGER_IDLE;
+}
+
+//Execute received whilst profile executes
+profileTriggerAction GalilProfileTrigger::execute(void)
+{
+	switch (state_)
+		{
+		case TRIGGER_ARMING:
+			//Profile begins once armed
+			state_ = TRIGGER_PENDING;
+			return TRIGGER_WAIT;
+		case TRIGGER_ARMED:
+			state_ = TRIGGER_BEGUN;
+			return TRIGGER_BEGIN;
+		default:
+			//Not armed, already triggered, or aborted
+			return TRIGGER_REJECT;
+		}
+}
+
+//Profile thread has motors at start, and controller buffer full
+profileTriggerAction GalilProfileTrigger::ready(void)
+{
+	switch (state_)
+		{
+		case TRIGGER_ARMING:
+			state_ = TRIGGER_ARMED;
+			return TRIGGER_WAIT;
+		case TRIGGER_PENDING:
+			//Execute arrived whilst arming, begin now
+			state_ = TRIGGER_BEGUN;
+			return TRIGGER_BEGIN;
+		case TRIGGER_ABORTED:
+			return TRIGGER_ABORT;
+		default:
+			return TRIGGER_REJECT;
+		}
+}
+
+//Trigger input began the armed profile
+void GalilProfileTrigger::inputBegan(void)
+{
+	if (state_ == TRIGGER_ARMED)
+		state_ = TRIGGER_BEGUN;
+}
+
+//Abort request.  Profile that has begun is stopped by the caller
+void GalilProfileTrigger::abort(void)
+{
+	if (state_ == TRIGGER_ARMING || state_ == TRIGGER_PENDING || state_ == TRIGGER_ARMED)
+		state_ = TRIGGER_ABORTED;
+}
+
+profileTriggerState GalilProfileTrigger::state(void) const
+{
+	return state_;
+}
+
+bool GalilProfileTrigger::arm(void) const
+{
+	return arm_;
+}
+
+bool GalilProfileTrigger::waiting(void) const
+{
+	return (state_ == TRIGGER_ARMED);
+}
+
+bool GalilProfileTrigger::aborted(void) const
+{
+	return (state_ == TRIGGER_ABORTED);
+}
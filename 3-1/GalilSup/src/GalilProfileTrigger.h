@@ -0,0 +1,73 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Armed profile trigger sequencing
+// An armed profile moves to start, and fills the controller buffer, then waits for execute, or a digital input
+// Execute may arrive whilst arming, whilst armed, or after the input began the profile.  Abort may arrive at any time
+// Begin is sent at most once, and never after abort.  Methods are called with the controller lock
+
+#ifndef GalilProfileTrigger_H
+#define GalilProfileTrigger_H
+
+//Armed profile trigger states
+enum profileTriggerState {
+  TRIGGER_IDLE,		//Profile isnt armed
+  TRIGGER_ARMING,	//Profile moving to start, and filling controller buffer
+  TRIGGER_PENDING,	//Execute arrived whilst arming, profile begins once armed
+  TRIGGER_ARMED,	//Profile waiting for execute, or input
+  TRIGGER_BEGUN,	//Execute, or input began the profile
+  TRIGGER_ABORTED	//Profile aborted before it began
+};
+
+//What the caller does after a trigger event
+enum profileTriggerAction {
+  TRIGGER_WAIT,		//Nothing to send, profile waits for trigger, or begins once armed
+  TRIGGER_BEGIN,	//Caller sends begin now
+  TRIGGER_REJECT,	//Event rejected
+  TRIGGER_ABORT		//Profile aborted, caller doesnt begin
+};
+
+class GalilProfileTrigger {
+public:
+  GalilProfileTrigger();
+  //Profile execute accepted.  arm is true if profile waits for trigger
+  void start(bool arm);
+  //Execute received whilst profile executes
+  //TRIGGER_BEGIN when armed, TRIGGER_WAIT when arming, otherwise TRIGGER_REJECT
+  profileTriggerAction execute(void);
+  //Profile thread has motors at start, and controller buffer full
+  //TRIGGER_BEGIN if execute arrived whilst arming, TRIGGER_ABORT if aborted, TRIGGER_WAIT when now armed
+  profileTriggerAction ready(void);
+  //Trigger input began the armed profile
+  void inputBegan(void);
+  //Abort request.  Profile that hasnt begun never begins
+  void abort(void);
+  profileTriggerState state(void) const;
+  //Profile was started armed
+  bool arm(void) const;
+  //Profile is armed, waiting for execute, or input
+  bool waiting(void) const;
+  //Profile was aborted before it began
+  bool aborted(void) const;
+
+private:
+  profileTriggerState state_;	//Trigger state
+  bool arm_;			//Profile was started armed
+};
+
+#endif //GalilProfileTrigger_H
@@ -0,0 +1,99 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Profile stream turn taking
+
+#include "GalilProfileTurn.h"
+
+//Constructor
+GalilProfileTurn::GalilProfileTurn(GalilTurnLock *connection, double timeout)
+{
+	int i;
+
+	connection_ = connection;
+	timeout_ = timeout;
+	flagLock_ = epicsMutexMustCreate();
+	for (i = 0; i < PROFILE_TURN_STREAMS; i++)
+		{
+		ready_[i] = wait_[i] = false;
+		turnEvent_[i] = epicsEventMustCreate(epicsEventEmpty);
+		}
+}
+
+//Destructor
+GalilProfileTurn::~GalilProfileTurn()
+{
+	int i;
+
+	for (i = 0; i < PROFILE_TURN_STREAMS; i++)
+		epicsEventDestroy(turnEvent_[i]);
+	epicsMutexDestroy(flagLock_);
+}
+
+//Obtain connection lock for stream
+//Other stream yields to this one after its next command line
+void GalilProfileTurn::lock(int stream)
+{
+	epicsMutexLock(flagLock_);
+	ready_[stream] = true;
+	epicsMutexUnlock(flagLock_);
+	connection_->lock();
+	epicsMutexLock(flagLock_);
+	ready_[stream] = false;
+	epicsMutexUnlock(flagLock_);
+}
+
+//Release connection lock
+//Wakes the other stream if its waiting for this one to send a command line
+void GalilProfileTurn::unlock(int stream)
+{
+	int other = (stream + 1) % PROFILE_TURN_STREAMS;	//Other stream
+	bool wait;						//Other stream is waiting for this one
+
+	epicsMutexLock(flagLock_);
+	wait = wait_[other];
+	epicsMutexUnlock(flagLock_);
+	if (wait)
+		epicsEventSignal(turnEvent_[other]);
+	connection_->unlock();
+}
+
+//Called by a stream with connection lock after sending a command line
+//If the other stream is waiting to send, it is given the connection for one command line
+bool GalilProfileTurn::yield(int stream)
+{
+	int other = (stream + 1) % PROFILE_TURN_STREAMS;	//Other stream
+	bool waiting;						//Other stream is waiting to send
+
+	//Flag this stream is waiting before releasing the lock, so the other stream signals it
+	epicsMutexLock(flagLock_);
+	waiting = (ready_[other] || wait_[other]);
+	wait_[stream] = waiting;
+	epicsMutexUnlock(flagLock_);
+	if (!waiting)
+		return false;
+
+	//Wait for other stream to send a command line
+	unlock(stream);
+	epicsEventWaitWithTimeout(turnEvent_[stream], timeout_);
+	epicsMutexLock(flagLock_);
+	wait_[stream] = false;
+	epicsMutexUnlock(flagLock_);
+	lock(stream);
+	return true;
+}
@@ -0,0 +1,65 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Profile stream turn taking
+// Profiles streaming on S, and T at the same time share one controller connection
+// After each command line a profile gives the connection to the other profile if it is waiting to send
+// So profiles take turns, rather than the first to lock filling its buffer first
+// The connection lock is supplied by the caller, so turn taking can be run without a controller
+
+#ifndef GalilProfileTurn_H
+#define GalilProfileTurn_H
+
+#include <epicsMutex.h>
+#include <epicsEvent.h>
+
+//Profile streams taking turns, same as COORDINATE_SYSTEMS
+#define PROFILE_TURN_STREAMS 2
+
+//Connection lock streams take turns with
+class GalilTurnLock {
+public:
+  virtual ~GalilTurnLock() {}
+  virtual void lock(void) = 0;
+  virtual void unlock(void) = 0;
+};
+
+class GalilProfileTurn {
+public:
+  //timeout is the longest a stream waits for the other to send a command line, seconds
+  GalilProfileTurn(GalilTurnLock *connection, double timeout);
+  ~GalilProfileTurn();
+  //Obtain connection lock for stream.  Other stream yields to this one after its next command line
+  void lock(int stream);
+  //Release connection lock.  Wakes the other stream if its waiting for this one
+  void unlock(int stream);
+  //Called with connection lock after sending a command line
+  //If the other stream is waiting to send, it is given the connection for one command line
+  //Returns true if stream waited for the other stream
+  bool yield(int stream);
+
+private:
+  GalilTurnLock *connection_;			//Connection lock
+  double timeout_;				//Longest wait for other stream, seconds
+  epicsMutexId flagLock_;			//Protects ready_, and wait_.  Never held while taking another lock
+  bool ready_[PROFILE_TURN_STREAMS];		//Stream is waiting for the connection lock
+  bool wait_[PROFILE_TURN_STREAMS];		//Stream is waiting for the other stream to send a command line
+  epicsEventId turnEvent_[PROFILE_TURN_STREAMS];	//Signalled by the other stream once it has sent a command line
+};
+
+#endif //GalilProfileTurn_H
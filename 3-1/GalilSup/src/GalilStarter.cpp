@@ -0,0 +1,92 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Worker thread to start several GalilController hardware concurrently
+// Each GalilController is locked only by the worker starting it, so controllers start in parallel
+
+#include <string.h>
+#include <iostream>  //cout
+#include <sstream>   //ostringstream istringstream
+#include <epicsThread.h>
+#include <epicsMutex.h>
+
+using namespace std; //cout ostringstream vector string
+
+#include "GalilController.h"
+
+//Constructor
+GalilStarter::GalilStarter(vector<GalilStartRequest> *requests, unsigned *next, epicsMutexId queueLock)
+   :  thread(*this,"GalilStarter",epicsThreadGetStackSize(epicsThreadStackBig),epicsThreadPriorityMedium)
+{
+	//Store the shared request queue
+	requests_ = requests;
+	next_ = next;
+	queueLock_ = queueLock;
+	//Start GalilStarter thread
+	thread.start();
+}
+
+//Destructor
+GalilStarter::~GalilStarter()
+{
+	//Wait for run thread to exit
+	thread.exitWait();
+}
+
+//GalilStarter thread
+//Take start requests from the shared queue until it is empty
+void GalilStarter::run(void)
+{
+	GalilController *pC;		//GalilController to start
+	GalilStartRequest *request;	//Request taken from queue
+	unsigned i;			//Index of request taken from queue
+	epicsTimeStamp begint;		//Start time of request
+	epicsTimeStamp endt;		//End time of request
+
+	while ( true )
+		{
+		//Take next request from queue
+		epicsMutexLock(queueLock_);
+		i = (*next_)++;
+		epicsMutexUnlock(queueLock_);
+		if (i >= requests_->size())
+			break; // queue empty, exit while loop
+
+		request = &(*requests_)[i];
+		epicsTimeGetCurrent(&begint);
+		//Retrieve the asynPort specified
+		pC = (GalilController*) findAsynPortDriver(request->portName);
+		if (pC)
+			{
+			pC->lock();
+			//Call GalilController::GalilStartController to do the work
+			request->status = pC->GalilStartController(request->code_file, request->burn_program, request->display_code, request->thread_mask, request->fingerprint_check);
+			request->connected = pC->connected_;
+			pC->unlock();
+			}
+		else
+			{
+			printf("GalilStarter: Error port %s not found\n", request->portName);
+			request->status = asynError;
+			request->connected = 0;
+			}
+		epicsTimeGetCurrent(&endt);
+		request->seconds = epicsTimeDiffInSeconds(&endt, &begint);
+		}
+}
+
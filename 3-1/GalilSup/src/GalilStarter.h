@@ -0,0 +1,47 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Worker thread to start several GalilController hardware concurrently
+// Workers share a queue of start requests, each worker takes the next request until queue is empty
+
+//Start request queued by GalilQueueStartController
+struct GalilStartRequest {
+  char portName[MAX_GALIL_STRING_SIZE];	//Controller asyn port name
+  char code_file[MAX_FILENAME_LEN];	//Code file(s) to deliver to controller
+  int burn_program;			//Burn program options
+  int display_code;			//Display code options
+  unsigned thread_mask;			//Threads expected to be running after code start
+  int fingerprint_check;		//Fingerprint, rather than full program compare requested
+  asynStatus status;			//Outcome of GalilStartController
+  int connected;			//Controller connected status after start
+  double seconds;			//Time taken to start controller
+};
+
+class GalilStarter: public epicsThreadRunable {
+public:
+  GalilStarter(std::vector<GalilStartRequest> *requests, unsigned *next, epicsMutexId queueLock);
+  virtual void run();
+  epicsThread thread;
+  ~GalilStarter();
+
+private:
+  std::vector<GalilStartRequest> *requests_;	//Shared queue of start requests
+  unsigned *next_;				//Index of next request to be taken from queue
+  epicsMutexId queueLock_;			//Protects next_
+};
+
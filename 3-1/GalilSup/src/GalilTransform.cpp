@@ -0,0 +1,829 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Compiled kinematic transform expression
+// Native compiler accepts a subset of the sCalc expression language
+// Numbers, arguments A-P, PI, D2R, R2D, + - * / ^ **, unary minus, parentheses
+// and functions ABS SQR SQRT EXP LOG LN LOGE SIN COS TAN ASIN ACOS ATAN SINH COSH TANH CEIL FLOOR MIN MAX
+// Anything else, including forms where sCalc operator precedence is ambiguous
+// such as -A^2 and A^B^C, is left to sCalcPerform
+// Partial derivatives are appended to the native program, sharing registers with the expression
+
+#if defined _WIN32 || _WIN64
+#define _USE_MATH_DEFINES
+#define finite(x) _finite(x)
+#endif /* _WIN32/_WIN64 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <float.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+extern "C" {
+#include "sCalcPostfix.h"
+}
+
+#include "GalilTransform.h"
+
+//Function names accepted by native compiler
+struct transformFunction {
+  const char *name;	//Function name
+  transformOp op;	//Operation
+  bool variadic;	//Accepts one or more arguments
+};
+
+static const transformFunction transformFunctions[] = {
+  {"ABS", TRANSFORM_ABS, false}, {"SQR", TRANSFORM_SQRT, false}, {"SQRT", TRANSFORM_SQRT, false},
+  {"EXP", TRANSFORM_EXP, false}, {"LOG", TRANSFORM_LOG10, false}, {"LN", TRANSFORM_LN, false},
+  {"LOGE", TRANSFORM_LN, false}, {"SIN", TRANSFORM_SIN, false}, {"COS", TRANSFORM_COS, false},
+  {"TAN", TRANSFORM_TAN, false}, {"ASIN", TRANSFORM_ASIN, false}, {"ACOS", TRANSFORM_ACOS, false},
+  {"ATAN", TRANSFORM_ATAN, false}, {"SINH", TRANSFORM_SINH, false}, {"COSH", TRANSFORM_COSH, false},
+  {"TANH", TRANSFORM_TANH, false}, {"CEIL", TRANSFORM_CEIL, false}, {"FLOOR", TRANSFORM_FLOOR, false},
+  {"MIN", TRANSFORM_MIN, true}, {"MAX", TRANSFORM_MAX, true}
+};
+
+//Constructor
+GalilTransform::GalilTransform()
+{
+	tree_ = NULL;
+	ntree_ = 0;
+	pos_ = NULL;
+	clear();
+}
+
+/** Discard compiled expression
+  * Cleared transform is not compiled, evaluate fails and evaluateBatch leaves it to the caller
+  */
+void GalilTransform::clear(void)
+{
+	compiled_ = false;
+	native_ = false;
+	symbolic_ = false;
+	ncode_ = 0;
+	nmain_ = 0;
+	argsUsed_ = 0;
+}
+
+/** Compile expression
+  * sCalcPostfix compile must succeed, native compile is optional
+  * \param[in] expr - Kinematic expression
+  * \return true if expression compiled
+  */
+bool GalilTransform::compile(const char *expr)
+{
+	short err;
+
+	clear();
+	compiled_ = (sCalcPostfix(expr, rpn_, &err) == 0);
+	//Native program must agree with sCalcPostfix about valid expressions
+	if (compiled_)
+		native_ = compileNative(expr);
+
+	return compiled_;
+}
+
+/** Evaluate compiled expression
+  * Native program is used when available, sCalcPerform otherwise
+  * Non finite native results are recalculated by sCalcPerform so error behaviour is unchanged
+  * \param[in] args - Arguments A-P
+  * \param[out] result - Expression result
+  * \return 0 on success, sCalcPerform status otherwise
+  */
+long GalilTransform::evaluate(double args[], double *result) const
+{
+	double reg[MAX_TRANSFORM_NODES];	//Instruction results
+
+	if (!compiled_)
+		return -1;
+
+	if (native_)
+		{
+		//Expression only, partial derivatives follow it in the program
+		run(args, reg, nmain_);
+		*result = reg[nmain_ - 1];
+		if (finite(*result))
+			return 0;
+		}
+
+	//Precision only applies to string results, hard code as doCalc did
+	return sCalcPerform(args, TRANSFORM_ARGS, NULL, 0, result, NULL, 0, rpn_, 6);
+}
+
+/** Directional derivative of compiled expression
+  * Symbolic partial derivatives are used when available, central difference otherwise
+  * \param[in] args - Arguments A-P at which derivative is calculated
+  * \param[in] dir - Rate of change of each argument
+  * \param[out] result - Sum of partial derivative times rate of change over all arguments
+  * \return 0 on success
+  */
+long GalilTransform::derivative(double args[], double dir[], double *result) const
+{
+	double reg[MAX_TRANSFORM_NODES];	//Instruction results
+	double x[TRANSFORM_ARGS];		//Arguments stepped along direction
+	double xmax = 1.0;			//Largest argument magnitude that is changing
+	double dmax = 0.0;			//Largest rate of change
+	double fplus, fminus;			//Expression either side of args
+	double h;				//Central difference step
+	unsigned i;
+	long status;
+
+	*result = 0.0;
+
+	if (!compiled_)
+		return -1;
+
+	if (symbolic_)
+		{
+		run(args, reg, ncode_);
+		for (i = 0; i < TRANSFORM_ARGS; i++)
+			if (droot_[i] >= 0 && dir[i] != 0.0)
+				*result += reg[droot_[i]] * dir[i];
+		if (finite(*result))
+			return 0;
+		*result = 0.0;
+		}
+
+	//Central difference along direction
+	for (i = 0; i < TRANSFORM_ARGS; i++)
+		if (dir[i] != 0.0)
+			{
+			xmax = (fabs(args[i]) > xmax) ? fabs(args[i]) : xmax;
+			dmax = (fabs(dir[i]) > dmax) ? fabs(dir[i]) : dmax;
+			}
+	//Nothing is changing
+	if (dmax == 0.0)
+		return 0;
+	h = TRANSFORM_DIFF_STEP * xmax / dmax;
+
+	for (i = 0; i < TRANSFORM_ARGS; i++)
+		x[i] = args[i] + h * dir[i];
+	status = evaluate(x, &fplus);
+	for (i = 0; i < TRANSFORM_ARGS; i++)
+		x[i] = args[i] - h * dir[i];
+	status |= evaluate(x, &fminus);
+	if (status)
+		return status;
+
+	*result = (fplus - fminus) / (2.0 * h);
+	return (finite(*result)) ? 0 : -1;
+}
+
+/** Evaluate several natively compiled expressions together
+  * Expressions whose programs have the same shape are evaluated in one pass over the program
+  * with each instruction applied across all lanes, so the inner loops vectorise
+  * \param[in] calc - Compiled expressions, at most TRANSFORM_BATCH
+  * \param[in] args - Arguments A-P for each expression
+  * \param[out] result - Result for each expression
+  * \param[out] done - Result is valid, false where caller must evaluate expression itself, or transform is cleared
+  * \param[in] n - Number of expressions
+  * \param[in] reg - Scratch registers, MAX_TRANSFORM_NODES * TRANSFORM_BATCH doubles
+  */
+void GalilTransform::evaluateBatch(const GalilTransform *calc[], double *args[], double result[], bool done[], unsigned n, double reg[])
+{
+	bool grouped[TRANSFORM_BATCH];		//Expression evaluated in an earlier group
+	unsigned lane[TRANSFORM_BATCH];		//Expressions in this group
+	unsigned lanes;				//Number of expressions in this group
+	const GalilTransform *first;		//First expression in group, provides program shape
+	unsigned i, j, k, l;
+	double *r, *ra, *rb;			//Result, and operand registers for instruction
+
+	for (k = 0; k < n; k++)
+		{
+		done[k] = false;
+		grouped[k] = false;
+		}
+
+	for (k = 0; k < n; k++)
+		{
+		if (grouped[k] || !calc[k]->compiled_ || !calc[k]->native_)
+			continue;
+		//Gather expressions with the same program shape
+		first = calc[k];
+		lanes = 0;
+		for (j = k; j < n; j++)
+			if (!grouped[j] && calc[j]->compiled_ && calc[j]->native_ && first->sameShape(calc[j]))
+				{
+				grouped[j] = true;
+				lane[lanes++] = j;
+				}
+
+		//Run program once across all lanes
+		for (i = 0; i < first->nmain_; i++)
+			{
+			const transformInstr &in = first->code_[i];
+			r = &reg[i * TRANSFORM_BATCH];
+			ra = &reg[in.a * TRANSFORM_BATCH];
+			rb = (in.b >= 0) ? &reg[in.b * TRANSFORM_BATCH] : ra;
+			switch (in.op)
+				{
+				case TRANSFORM_CONST:
+					for (l = 0; l < lanes; l++)
+						r[l] = calc[lane[l]]->code_[i].value;
+					break;
+				case TRANSFORM_ARG:
+					for (l = 0; l < lanes; l++)
+						r[l] = args[lane[l]][calc[lane[l]]->code_[i].a];
+					break;
+				case TRANSFORM_ADD:
+					for (l = 0; l < lanes; l++)
+						r[l] = ra[l] + rb[l];
+					break;
+				case TRANSFORM_SUB:
+					for (l = 0; l < lanes; l++)
+						r[l] = ra[l] - rb[l];
+					break;
+				case TRANSFORM_MUL:
+					for (l = 0; l < lanes; l++)
+						r[l] = ra[l] * rb[l];
+					break;
+				case TRANSFORM_DIV:
+					for (l = 0; l < lanes; l++)
+						r[l] = ra[l] / rb[l];
+					break;
+				case TRANSFORM_NEG:
+					for (l = 0; l < lanes; l++)
+						r[l] = -ra[l];
+					break;
+				default:
+					for (l = 0; l < lanes; l++)
+						r[l] = first->calculate(in.op, ra[l], rb[l]);
+					break;
+				}
+			}
+
+		for (l = 0; l < lanes; l++)
+			{
+			result[lane[l]] = reg[(first->nmain_ - 1) * TRANSFORM_BATCH + l];
+			done[lane[l]] = finite(result[lane[l]]);
+			}
+		}
+}
+
+//Do programs have the same shape
+//Same operations on the same registers, constant values and argument numbers may differ
+bool GalilTransform::sameShape(const GalilTransform *other) const
+{
+	unsigned i;
+
+	if (other->nmain_ != nmain_)
+		return false;
+	for (i = 0; i < nmain_; i++)
+		{
+		if (code_[i].op != other->code_[i].op)
+			return false;
+		if (code_[i].op != TRANSFORM_CONST && code_[i].op != TRANSFORM_ARG &&
+		    (code_[i].a != other->code_[i].a || code_[i].b != other->code_[i].b))
+			return false;
+		}
+
+	return true;
+}
+
+//Run native program instructions 0 to length - 1
+void GalilTransform::run(double args[], double reg[], unsigned length) const
+{
+	unsigned i;
+
+	for (i = 0; i < length; i++)
+		{
+		const transformInstr &in = code_[i];
+		if (in.op == TRANSFORM_CONST)
+			reg[i] = in.value;
+		else if (in.op == TRANSFORM_ARG)
+			reg[i] = args[in.a];
+		else
+			reg[i] = calculate(in.op, reg[in.a], (in.b >= 0) ? reg[in.b] : 0.0);
+		}
+}
+
+bool GalilTransform::compiled(void) const
+{
+	return compiled_;
+}
+
+bool GalilTransform::native(void) const
+{
+	return native_;
+}
+
+unsigned GalilTransform::argsUsed(void) const
+{
+	return argsUsed_;
+}
+
+bool GalilTransform::symbolic(void) const
+{
+	return symbolic_;
+}
+
+unsigned GalilTransform::length(void) const
+{
+	return ncode_;
+}
+
+//Calculate operation result
+//Used for both constant folding and evaluation so folded results are identical
+double GalilTransform::calculate(transformOp op, double x, double y) const
+{
+	switch (op)
+		{
+		case TRANSFORM_ADD: return x + y;
+		case TRANSFORM_SUB: return x - y;
+		case TRANSFORM_MUL: return x * y;
+		case TRANSFORM_DIV: return x / y;
+		case TRANSFORM_POW: return pow(x, y);
+		//MIN, MAX propagate NaN so the result is recalculated by sCalcPerform
+		case TRANSFORM_MIN: return (x < y || x != x) ? x : y;
+		case TRANSFORM_MAX: return (x > y || x != x) ? x : y;
+		case TRANSFORM_NEG: return -x;
+		case TRANSFORM_ABS: return fabs(x);
+		case TRANSFORM_SQRT: return sqrt(x);
+		case TRANSFORM_EXP: return exp(x);
+		case TRANSFORM_LOG10: return log10(x);
+		case TRANSFORM_LN: return log(x);
+		case TRANSFORM_SIN: return sin(x);
+		case TRANSFORM_COS: return cos(x);
+		case TRANSFORM_TAN: return tan(x);
+		case TRANSFORM_ASIN: return asin(x);
+		case TRANSFORM_ACOS: return acos(x);
+		case TRANSFORM_ATAN: return atan(x);
+		case TRANSFORM_SINH: return sinh(x);
+		case TRANSFORM_COSH: return cosh(x);
+		case TRANSFORM_TANH: return tanh(x);
+		case TRANSFORM_CEIL: return ceil(x);
+		case TRANSFORM_FLOOR: return floor(x);
+		default: return 0.0;
+		}
+}
+
+//Add node to expression tree
+//Identical nodes are shared, so common subexpressions are calculated once
+//Returns node index, or -1 if tree is full
+int GalilTransform::node(transformOp op, int a, int b, double value)
+{
+	unsigned i;
+
+	for (i = 0; i < ntree_; i++)
+		if (tree_[i].op == op && tree_[i].a == a && tree_[i].b == b &&
+		    !memcmp(&tree_[i].value, &value, sizeof(double)))
+			return i;
+
+	if (ntree_ == MAX_TRANSFORM_NODES)
+		return -1;
+
+	tree_[ntree_].op = op;
+	tree_[ntree_].a = a;
+	tree_[ntree_].b = b;
+	tree_[ntree_].value = value;
+	return ntree_++;
+}
+
+//Add operation node to expression tree
+//Operations on constants are folded into a constant
+//b is -1 for unary operations
+int GalilTransform::fold(transformOp op, int a, int b)
+{
+	bool unary = (op >= TRANSFORM_NEG);
+
+	if (a < 0 || (!unary && b < 0))
+		return -1;
+
+	if (tree_[a].op == TRANSFORM_CONST && (unary || tree_[b].op == TRANSFORM_CONST))
+		return node(TRANSFORM_CONST, 0, -1, calculate(op, tree_[a].value, (unary) ? 0.0 : tree_[b].value));
+
+	return node(op, a, (unary) ? -1 : b, 0.0);
+}
+
+void GalilTransform::skipSpace(void)
+{
+	while (*pos_ == ' ' || *pos_ == '\t')
+		pos_++;
+}
+
+//expression := term (('+' | '-') term)*
+int GalilTransform::parseExpression(void)
+{
+	int n;		//Expression node
+	char op;	//Operator
+
+	n = parseTerm();
+	skipSpace();
+	while (n >= 0 && (*pos_ == '+' || *pos_ == '-'))
+		{
+		op = *pos_++;
+		n = fold((op == '+') ? TRANSFORM_ADD : TRANSFORM_SUB, n, parseTerm());
+		skipSpace();
+		}
+
+	return n;
+}
+
+//term := unary (('*' | '/') unary)*
+int GalilTransform::parseTerm(void)
+{
+	int n;		//Term node
+	char op;	//Operator
+	bool power;	//Operand was a power
+
+	n = parseUnary(&power);
+	skipSpace();
+	//** is power, not multiply
+	while (n >= 0 && (*pos_ == '/' || (*pos_ == '*' && pos_[1] != '*')))
+		{
+		op = *pos_++;
+		n = fold((op == '*') ? TRANSFORM_MUL : TRANSFORM_DIV, n, parseUnary(&power));
+		skipSpace();
+		}
+
+	return n;
+}
+
+//unary := '-' unary | power
+//Negated powers are rejected, sCalc precedence of unary minus and power differs from convention
+int GalilTransform::parseUnary(bool *power)
+{
+	bool inner;	//Negated operand was a power
+
+	skipSpace();
+	*power = false;
+	if (*pos_ == '-')
+		{
+		pos_++;
+		int n = parseUnary(&inner);
+		if (inner)
+			return -1;
+		return fold(TRANSFORM_NEG, n, -1);
+		}
+
+	return parsePower(power);
+}
+
+//power := primary (('^' | '**') unary)?
+//Chained powers are rejected, sCalc associativity of power is not relied upon
+int GalilTransform::parsePower(bool *power)
+{
+	int n;		//Base node
+	int e;		//Exponent node
+	bool inner;	//Exponent was a power
+
+	n = parsePrimary();
+	skipSpace();
+	if (n >= 0 && (*pos_ == '^' || (*pos_ == '*' && pos_[1] == '*')))
+		{
+		pos_ += (*pos_ == '^') ? 1 : 2;
+		e = parseUnary(&inner);
+		if (inner)
+			return -1;
+		*power = true;
+		return fold(TRANSFORM_POW, n, e);
+		}
+
+	return n;
+}
+
+//primary := number | argument | constant | function '(' expression [',' expression]* ')' | '(' expression ')'
+int GalilTransform::parsePrimary(void)
+{
+	const char *start;			//Start of token
+	char token[MAX_TRANSFORM_TOKEN];	//Token text
+	unsigned len;				//Token length
+	char *end;				//End of number converted by strtod
+	double value;				//Number value
+	int n;					//Node
+	bool digits = false;			//Number has mantissa digits
+
+	skipSpace();
+	start = pos_;
+
+	if (*pos_ == '(')
+		{
+		pos_++;
+		n = parseExpression();
+		skipSpace();
+		if (*pos_ != ')')
+			return -1;
+		pos_++;
+		return n;
+		}
+
+	if (isdigit((unsigned char)*pos_) || *pos_ == '.')
+		{
+		//Scan decimal number, hex and other strtod extensions are left to sCalc
+		while (isdigit((unsigned char)*pos_))
+			{
+			pos_++;
+			digits = true;
+			}
+		if (*pos_ == '.')
+			pos_++;
+		while (isdigit((unsigned char)*pos_))
+			{
+			pos_++;
+			digits = true;
+			}
+		if (digits && (*pos_ == 'e' || *pos_ == 'E'))
+			{
+			const char *exponent = pos_ + 1;
+			if (*exponent == '+' || *exponent == '-')
+				exponent++;
+			if (isdigit((unsigned char)*exponent))
+				{
+				pos_ = exponent;
+				while (isdigit((unsigned char)*pos_))
+					pos_++;
+				}
+			}
+		len = pos_ - start;
+		if (!digits || isalpha((unsigned char)*pos_) || len >= sizeof(token))
+			return -1;
+		memcpy(token, start, len);
+		token[len] = '\0';
+		value = strtod(token, &end);
+		if (end != token + len)
+			return -1;
+		return node(TRANSFORM_CONST, 0, -1, value);
+		}
+
+	if (isalpha((unsigned char)*pos_))
+		{
+		len = 0;
+		while (isalnum((unsigned char)*pos_) && len < sizeof(token) - 1)
+			token[len++] = toupper(*pos_++);
+		token[len] = '\0';
+		if (len == 1 && token[0] >= 'A' && token[0] < 'A' + TRANSFORM_ARGS)
+			return node(TRANSFORM_ARG, token[0] - 'A', -1, 0.0);
+		if (!strcmp(token, "PI"))
+			return node(TRANSFORM_CONST, 0, -1, M_PI);
+		if (!strcmp(token, "D2R"))
+			return node(TRANSFORM_CONST, 0, -1, M_PI / 180.0);
+		if (!strcmp(token, "R2D"))
+			return node(TRANSFORM_CONST, 0, -1, 180.0 / M_PI);
+		return parseFunction(token);
+		}
+
+	return -1;
+}
+
+//Parse function arguments for function name
+int GalilTransform::parseFunction(const char *name)
+{
+	unsigned i;
+	int n;		//Function node
+
+	for (i = 0; i < sizeof(transformFunctions) / sizeof(transformFunction); i++)
+		if (!strcmp(name, transformFunctions[i].name))
+			break;
+	if (i == sizeof(transformFunctions) / sizeof(transformFunction))
+		return -1;
+
+	skipSpace();
+	if (*pos_ != '(')
+		return -1;
+	pos_++;
+	n = parseExpression();
+	skipSpace();
+	//Variadic functions fold remaining arguments pairwise
+	while (transformFunctions[i].variadic && n >= 0 && *pos_ == ',')
+		{
+		pos_++;
+		n = fold(transformFunctions[i].op, n, parseExpression());
+		skipSpace();
+		}
+	if (n < 0 || *pos_ != ')')
+		return -1;
+	pos_++;
+
+	if (transformFunctions[i].variadic)
+		return n;
+	return fold(transformFunctions[i].op, n, -1);
+}
+
+//Emit node n and the nodes it depends on into native program
+//Nodes not reachable from the root, such as constants consumed by folding, are pruned
+void GalilTransform::emit(int n, int map[])
+{
+	transformInstr in = tree_[n];
+
+	if (map[n] >= 0)
+		return;
+	if (in.op != TRANSFORM_CONST && in.op != TRANSFORM_ARG)
+		{
+		emit(in.a, map);
+		in.a = map[in.a];
+		if (in.b >= 0)
+			{
+			emit(in.b, map);
+			in.b = map[in.b];
+			}
+		}
+	if (in.op == TRANSFORM_ARG)
+		argsUsed_ |= (1 << in.a);
+	code_[ncode_] = in;
+	map[n] = ncode_++;
+}
+
+//Compile expression into native program
+//Returns false if expression is not in the subset handled natively
+bool GalilTransform::compileNative(const char *expr)
+{
+	transformInstr tree[MAX_TRANSFORM_NODES];	//Expression tree
+	int map[MAX_TRANSFORM_NODES];			//Tree node to program register
+	int memo[MAX_TRANSFORM_NODES];			//Tree node to partial derivative node
+	int droot[TRANSFORM_ARGS];			//Partial derivative node for each argument
+	int root;					//Root node
+	unsigned i, j;
+
+	tree_ = tree;
+	ntree_ = 0;
+	pos_ = expr;
+
+	root = parseExpression();
+	skipSpace();
+	if (root >= 0 && *pos_ == '\0')
+		{
+		for (i = 0; i < MAX_TRANSFORM_NODES; i++)
+			map[i] = -1;
+		emit(root, map);
+		nmain_ = ncode_;
+
+		//Derive partial derivative for each argument used
+		symbolic_ = true;
+		for (i = 0; i < TRANSFORM_ARGS && symbolic_; i++)
+			{
+			droot[i] = -1;
+			if (!(argsUsed_ & (1 << i)))
+				continue;
+			for (j = 0; j < MAX_TRANSFORM_NODES; j++)
+				memo[j] = -1;
+			droot[i] = differentiate(root, i, memo);
+			if (droot[i] < 0)
+				symbolic_ = false;
+			}
+
+		//Append partial derivatives to program
+		for (i = 0; i < TRANSFORM_ARGS; i++)
+			{
+			droot_[i] = -1;
+			if (symbolic_ && droot[i] >= 0 && !isConstant(droot[i], 0.0))
+				{
+				emit(droot[i], map);
+				droot_[i] = map[droot[i]];
+				}
+			}
+		}
+
+	tree_ = NULL;
+	pos_ = NULL;
+	return (ncode_ > 0);
+}
+
+//Constant node
+int GalilTransform::constant(double value)
+{
+	return node(TRANSFORM_CONST, 0, -1, value);
+}
+
+//Is node n the constant value
+bool GalilTransform::isConstant(int n, double value)
+{
+	return (n >= 0 && tree_[n].op == TRANSFORM_CONST && tree_[n].value == value);
+}
+
+//Derivative builders, simplify terms with zero and one so derivatives stay small
+int GalilTransform::add(int a, int b)
+{
+	if (a < 0 || b < 0)
+		return -1;
+	if (isConstant(a, 0.0))
+		return b;
+	if (isConstant(b, 0.0))
+		return a;
+	return fold(TRANSFORM_ADD, a, b);
+}
+
+int GalilTransform::sub(int a, int b)
+{
+	if (a < 0 || b < 0)
+		return -1;
+	if (isConstant(b, 0.0))
+		return a;
+	if (isConstant(a, 0.0))
+		return fold(TRANSFORM_NEG, b, -1);
+	return fold(TRANSFORM_SUB, a, b);
+}
+
+int GalilTransform::mul(int a, int b)
+{
+	if (a < 0 || b < 0)
+		return -1;
+	if (isConstant(a, 0.0) || isConstant(b, 0.0))
+		return constant(0.0);
+	if (isConstant(a, 1.0))
+		return b;
+	if (isConstant(b, 1.0))
+		return a;
+	return fold(TRANSFORM_MUL, a, b);
+}
+
+int GalilTransform::div(int a, int b)
+{
+	if (a < 0 || b < 0)
+		return -1;
+	if (isConstant(a, 0.0))
+		return constant(0.0);
+	if (isConstant(b, 1.0))
+		return a;
+	return fold(TRANSFORM_DIV, a, b);
+}
+
+//Build partial derivative of node n with respect to argument arg
+//Returns derivative node, or -1 if derivative cannot be derived symbolically
+int GalilTransform::differentiate(int n, int arg, int memo[])
+{
+	transformInstr in = tree_[n];	//Node to differentiate, copied as tree grows
+	int u, v;			//Operands
+	int du, dv = -1;		//Operand derivatives
+	int d;				//Result
+
+	if (memo[n] >= 0)
+		return memo[n];
+
+	if (in.op == TRANSFORM_CONST)
+		return (memo[n] = constant(0.0));
+	if (in.op == TRANSFORM_ARG)
+		return (memo[n] = constant((in.a == arg) ? 1.0 : 0.0));
+
+	u = in.a;
+	v = in.b;
+	du = differentiate(u, arg, memo);
+	if (du < 0)
+		return -1;
+	if (v >= 0 && (dv = differentiate(v, arg, memo)) < 0)
+		return -1;
+	//Operands do not depend on argument
+	if (isConstant(du, 0.0) && (v < 0 || isConstant(dv, 0.0)))
+		return (memo[n] = constant(0.0));
+
+	switch (in.op)
+		{
+		case TRANSFORM_ADD: d = add(du, dv); break;
+		case TRANSFORM_SUB: d = sub(du, dv); break;
+		case TRANSFORM_NEG: d = fold(TRANSFORM_NEG, du, -1); break;
+		case TRANSFORM_MUL: d = add(mul(du, v), mul(u, dv)); break;
+		case TRANSFORM_DIV: d = sub(div(du, v), div(mul(u, dv), mul(v, v))); break;
+		case TRANSFORM_POW:
+			if (isConstant(dv, 0.0))
+				//Exponent does not depend on argument
+				d = mul(mul(v, fold(TRANSFORM_POW, u, sub(v, constant(1.0)))), du);
+			else
+				d = mul(n, add(mul(dv, fold(TRANSFORM_LN, u, -1)), div(mul(v, du), u)));
+			break;
+		case TRANSFORM_ABS: d = mul(du, div(u, n)); break;
+		case TRANSFORM_SQRT: d = div(du, mul(constant(2.0), n)); break;
+		case TRANSFORM_EXP: d = mul(n, du); break;
+		case TRANSFORM_LOG10: d = div(du, mul(u, constant(log(10.0)))); break;
+		case TRANSFORM_LN: d = div(du, u); break;
+		case TRANSFORM_SIN: d = mul(fold(TRANSFORM_COS, u, -1), du); break;
+		case TRANSFORM_COS: d = fold(TRANSFORM_NEG, mul(fold(TRANSFORM_SIN, u, -1), du), -1); break;
+		case TRANSFORM_TAN:
+			d = fold(TRANSFORM_COS, u, -1);
+			d = div(du, mul(d, d));
+			break;
+		case TRANSFORM_ASIN: d = div(du, fold(TRANSFORM_SQRT, sub(constant(1.0), mul(u, u)), -1)); break;
+		case TRANSFORM_ACOS: d = fold(TRANSFORM_NEG, div(du, fold(TRANSFORM_SQRT, sub(constant(1.0), mul(u, u)), -1)), -1); break;
+		case TRANSFORM_ATAN: d = div(du, add(constant(1.0), mul(u, u))); break;
+		case TRANSFORM_SINH: d = mul(fold(TRANSFORM_COSH, u, -1), du); break;
+		case TRANSFORM_COSH: d = mul(fold(TRANSFORM_SINH, u, -1), du); break;
+		case TRANSFORM_TANH:
+			d = fold(TRANSFORM_COSH, u, -1);
+			d = div(du, mul(d, d));
+			break;
+		case TRANSFORM_CEIL:
+		case TRANSFORM_FLOOR: d = constant(0.0); break;
+		//MIN, MAX derivative is discontinuous, use central difference
+		default: d = -1; break;
+		}
+
+	return (memo[n] = d);
+}
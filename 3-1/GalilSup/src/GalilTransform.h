@@ -0,0 +1,130 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Compiled kinematic transform expression
+// Expressions are compiled by sCalcPostfix, and where the expression uses only arithmetic
+// and common math functions also by a native compiler
+// Native compiler builds an expression tree, folds constants, shares common subexpressions
+// and emits a flat program evaluated without allocation
+// sCalcPerform is used when native compile is not possible, or native result is not finite
+// Partial derivatives of natively compiled expressions are derived symbolically at compile time
+// Central difference is used when symbolic derivatives are not available
+
+#ifndef GalilTransform_H
+#define GalilTransform_H
+
+//Size of compiled kinematic expression buffer
+#define KINEMATIC_RPN_SIZE 512
+//Maximum nodes in a natively compiled expression including partial derivatives
+#define MAX_TRANSFORM_NODES 256
+//Maximum length of number or name in a natively compiled expression
+#define MAX_TRANSFORM_TOKEN 32
+//Number of arguments available to expressions A-P
+#define TRANSFORM_ARGS 16
+//Maximum transforms evaluated together by evaluateBatch
+#define TRANSFORM_BATCH 8
+//Central difference step relative to argument magnitude
+#define TRANSFORM_DIFF_STEP 1.0e-6
+
+//Native program operations
+enum transformOp {
+  TRANSFORM_CONST, TRANSFORM_ARG,
+  TRANSFORM_ADD, TRANSFORM_SUB, TRANSFORM_MUL, TRANSFORM_DIV, TRANSFORM_POW,
+  TRANSFORM_MIN, TRANSFORM_MAX, TRANSFORM_NEG,
+  TRANSFORM_ABS, TRANSFORM_SQRT, TRANSFORM_EXP, TRANSFORM_LOG10, TRANSFORM_LN,
+  TRANSFORM_SIN, TRANSFORM_COS, TRANSFORM_TAN, TRANSFORM_ASIN, TRANSFORM_ACOS, TRANSFORM_ATAN,
+  TRANSFORM_SINH, TRANSFORM_COSH, TRANSFORM_TANH, TRANSFORM_CEIL, TRANSFORM_FLOOR
+};
+
+//Native program instruction
+//Result of instruction i is stored in register i
+struct transformInstr {
+  transformOp op;		//Operation
+  int a;			//Register of first operand, or argument number
+  int b;			//Register of second operand
+  double value;			//Constant value
+};
+
+class GalilTransform {
+public:
+  GalilTransform();
+  //Compile expression, returns true if sCalcPostfix compiled the expression
+  bool compile(const char *expr);
+  //Discard compiled expression, used when expression is emptied
+  void clear(void);
+  //Evaluate compiled expression with the given arguments
+  //Returns sCalcPerform status
+  long evaluate(double args[], double *result) const;
+  //Evaluate several natively compiled expressions together
+  //Expressions with the same program shape share one pass, operating across lanes
+  //reg must hold MAX_TRANSFORM_NODES * TRANSFORM_BATCH doubles
+  //done is false where native evaluation was not possible, result not finite, or transform cleared
+  static void evaluateBatch(const GalilTransform *calc[], double *args[], double result[], bool done[], unsigned n, double reg[]);
+  //Directional derivative of compiled expression, the Jacobian row times direction
+  //Returns 0 on success
+  long derivative(double args[], double dir[], double *result) const;
+  //Was expression compiled
+  bool compiled(void) const;
+  //Was expression compiled natively
+  bool native(void) const;
+  //Bit mask of arguments A-P used by native program
+  unsigned argsUsed(void) const;
+  //Were partial derivatives derived symbolically
+  bool symbolic(void) const;
+  //Native program length
+  unsigned length(void) const;
+
+private:
+  //Native expression tree builder
+  int node(transformOp op, int a, int b, double value);
+  int fold(transformOp op, int a, int b);
+  int parseExpression(void);
+  int parseTerm(void);
+  int parseUnary(bool *power);
+  int parsePower(bool *power);
+  int parsePrimary(void);
+  int parseFunction(const char *name);
+  int differentiate(int n, int arg, int memo[]);
+  int constant(double value);
+  bool isConstant(int n, double value);
+  int add(int a, int b);
+  int sub(int a, int b);
+  int mul(int a, int b);
+  int div(int a, int b);
+  void run(double args[], double reg[], unsigned length) const;
+  bool sameShape(const GalilTransform *other) const;
+  void skipSpace(void);
+  bool compileNative(const char *expr);
+  void emit(int n, int map[]);
+  double calculate(transformOp op, double x, double y) const;
+
+  unsigned char rpn_[KINEMATIC_RPN_SIZE];	//Expression compiled by sCalcPostfix
+  bool compiled_;				//Expression compiled by sCalcPostfix
+  bool native_;					//Expression compiled natively
+  transformInstr *tree_;			//Expression tree built during native compile
+  unsigned ntree_;				//Nodes in expression tree
+  transformInstr code_[MAX_TRANSFORM_NODES];	//Native program
+  unsigned ncode_;				//Native program length including partial derivatives
+  unsigned nmain_;				//Native program length for expression only
+  int droot_[TRANSFORM_ARGS];			//Register holding partial derivative for each argument, -1 if zero
+  bool symbolic_;				//Partial derivatives derived symbolically
+  unsigned argsUsed_;				//Bit mask of arguments used by native program
+  const char *pos_;				//Parse position during native compile
+};
+
+#endif //GalilTransform_H
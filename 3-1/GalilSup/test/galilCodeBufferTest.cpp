@@ -0,0 +1,133 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilCodeBuffer unit tests, and append benchmark
+
+#include <string.h>
+#include <time.h>
+#include <string>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilCodeBuffer.h"
+
+//Appends timed by the benchmark
+#define BENCH_APPENDS 200000
+
+static void testEmpty(void)
+{
+  GalilCodeBuffer code(100);
+
+  testOk1(strcmp(code.c_str(), "") == 0);
+  testOk1(code.length() == 0);
+  testOk1(code.allocated() == 0);
+  testOk1(!code.overflow());
+}
+
+static void testAppend(void)
+{
+  GalilCodeBuffer code(100000);
+
+  code.append("#THREADA\n");
+  code.appendf("IF (_BG%c=1)\n", 'A');
+  code.appendf("%s=%d\n", "homedA", 0);
+  testOk1(strcmp(code.c_str(), "#THREADA\nIF (_BGA=1)\nhomedA=0\n") == 0);
+  testOk1(code.length() == strlen(code.c_str()));
+  testOk1(code.allocated() == CODE_BUFFER_INITIAL_SIZE);
+}
+
+//Storage grows past the initial size without losing code
+static void testGrowth(void)
+{
+  GalilCodeBuffer code(100000);
+  std::string expected;
+  char line[32];
+  int i;
+
+  for (i = 0; i < 2000; i++)
+     {
+     sprintf(line, "v%d=%d\n", i, i * 3);
+     code.appendf("v%d=%d\n", i, i * 3);
+     expected += line;
+     }
+  testOk1(code.length() == expected.length());
+  testOk(strcmp(code.c_str(), expected.c_str()) == 0, "Code intact after growth to %u bytes", (unsigned)code.length());
+  testOk1(code.allocated() > code.length());
+  testOk1(code.allocated() <= 100000 + 1);
+  testOk1(!code.overflow());
+}
+
+//Appends beyond maximum length are discarded, and flagged
+static void testOverflow(void)
+{
+  GalilCodeBuffer code(10);
+
+  code.append("0123456789");
+  testOk(code.length() == 10 && !code.overflow(), "Append up to maximum length accepted");
+  code.append("A");
+  testOk1(code.overflow());
+  testOk(strcmp(code.c_str(), "0123456789") == 0, "Code unchanged by discarded append");
+  code.append("");
+  testOk(code.length() == 10, "Appends after overflow discarded");
+
+  //Clear resets overflow, and keeps storage
+  code.clear();
+  testOk1(!code.overflow());
+  testOk1(code.length() == 0 && strcmp(code.c_str(), "") == 0);
+  testOk1(code.allocated() == 11);
+
+  //Formatted append overflow
+  code.appendf("%s", "01234");
+  code.appendf("%d", 123456);
+  testOk1(code.overflow());
+  testOk1(strcmp(code.c_str(), "01234") == 0);
+
+  //Release frees storage
+  code.release();
+  testOk1(code.allocated() == 0 && code.length() == 0 && !code.overflow());
+  code.append("AB");
+  testOk1(strcmp(code.c_str(), "AB") == 0);
+}
+
+//Appends are linear time, the previous strcat based generator was quadratic
+static void benchAppend(void)
+{
+  GalilCodeBuffer code(BENCH_APPENDS * 32);
+  clock_t begin;
+  double seconds;
+  int i;
+
+  begin = clock();
+  for (i = 0; i < BENCH_APPENDS; i++)
+     code.appendf("IF (_LR%c=0)\n", 'A' + (i % 8));
+  seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+  testOk(code.length() == (size_t)BENCH_APPENDS * 12 && !code.overflow(), "%d appends", BENCH_APPENDS);
+  testDiag("%d formatted appends, %u bytes in %.3f s", BENCH_APPENDS, (unsigned)code.length(), seconds);
+}
+
+MAIN(galilCodeBufferTest)
+{
+  testPlan(24);
+  testEmpty();
+  testAppend();
+  testGrowth();
+  testOverflow();
+  benchAppend();
+  return testDone();
+}
@@ -0,0 +1,377 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilMinifyCode fixture tests
+// Fixtures use the code generator formats from GalilAxis, and GalilController for representative axis, limit,
+// and digital input configurations, plus user code with comments, quoted strings, and duplicate subroutines
+// Minified code must have the same statements in the same order once split on ; and duplicate subroutine
+// jumps are expanded, fit the column limit, and keep labels at line start
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilCodeBuffer.h"
+#include "GalilCodeMinify.h"
+
+using namespace std;
+
+//Controller column limit used by most models
+#define TEST_COLUMNS 80
+
+//Program statement blocks, each starts with a label except possibly the first
+typedef vector<vector<string> > Blocks;
+
+//Axis thread, and limit code as generated by GalilAxis for homing to limits, or to home switch
+static void genAxis(char c, bool limitAsHome, GalilCodeBuffer *thread, GalilCodeBuffer *limit)
+{
+  limit->appendf("IF (((_SC%c=2) | (_SC%c=3)) & (_BG%c=1))\noldecel%c=_DC%c;ocds=_VDS;ocdt=_VDT;DC%c=limdc%c;VDS=limdc%c;VDT=limdc%c;ST%c\n",c,c,c,c,c,c,c,c,c,c);
+  if (!limitAsHome)
+     limit->appendf("DC%c=oldecel%c;VDS=ocds;VDT=ocdt;home%c=0;MG \"home%c\",home%c;ENDIF\n",c,c,c,c,c);
+  else
+     limit->appendf("DC%c=oldecel%c;VDS=ocds;VDT=ocdt;ENDIF\n",c,c);
+
+  thread->appendf("#THREAD%c\n", c);
+  thread->appendf("IF ((home%c=1))\n",c);
+  if (limitAsHome)
+     {
+     thread->appendf("IF ((home%c=1) & (_MO%c=0) & (hjog%c=0) & (_BG%c=0) & ((_LR%c=0) | (_LF%c=0)))\nspeed%c=_SP%c;DC%c=hjgdc%c;JG%c=hjgsp%c;WT10;BG%c;hjog%c=1;ENDIF\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+     thread->appendf("IF ((_LR%c=1) & (_LF%c=1) & (hjog%c=1) & (_BG%c=1))\nST%c;ENDIF\n",c,c,c,c,c);
+     thread->appendf("IF ((_LR%c=1) & (_LF%c=1) & (hjog%c=1) & (_BG%c=0))\nIF ((home%c=1) & (_MO%c=0) & (ueip%c=1) & (ui%c=1))\nSP%c=speed%c;DC%c=67107840;FI%c;WT10;BG%c;hjog%c=2\nELSE\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+     }
+  else
+     {
+     thread->appendf("IF ((_HM%c=hswact%c) & (hjog%c=0) & (_BG%c=1))\nST%c;ENDIF\n",c,c,c,c,c);
+     thread->appendf("IF ((home%c=1) & (_MO%c=0) & (_HM%c=hswact%c) & (hjog%c=0) & (_BG%c=0))\nspeed%c=_SP%c;DC%c=hjgdc%c;JG%c=hjgsp%c;WT10;BG%c;hjog%c=1;ENDIF\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+     thread->appendf("IF ((_HM%c=hswiact%c) & (hjog%c=1) & (_BG%c=1))\nST%c;ENDIF\n",c,c,c,c,c);
+     thread->appendf("IF ((_HM%c=hswiact%c) & (hjog%c=1) & (_BG%c=0))\nIF ((home%c=1) & (_MO%c=0) & (ueip%c=1) & (ui%c=1))\nSP%c=speed%c;DC%c=67107840;FI%c;WT10;BG%c;hjog%c=2\nELSE\n",c,c,c,c,c,c,c,c,c,c,c,c,c,c);
+     }
+  thread->appendf("hjog%c=3;ENDIF;ENDIF\n",c);
+  thread->appendf("IF ((hjog%c=2) & (_BG%c=0))\nhjog%c=3;ENDIF\n",c,c,c);
+  if (limitAsHome)
+     thread->appendf("IF ((_LR%c=1) & (_LF%c=1) & (hjog%c=3) & (_BG%c=0))\n",c,c,c,c);
+  else
+     thread->appendf("IF ((_HM%c=hswiact%c) & (hjog%c=3) & (_BG%c=0))\n",c,c,c,c);
+  thread->appendf("WT10;hjog%c=0;SP%c=speed%c;home%c=0\n",c,c,c,c);
+  thread->appendf("homed%c=1;MG \"homed%c\",homed%c;MG \"home%c\",home%c;ENDIF\nENDIF\n",c,c,c,c,c);
+  if (c == 'A')
+     {
+     thread->append("counter=counter+1\n");
+     thread->append("IF (mlock=1)\n");
+     thread->append("II ,,dpon,dvalues\nENDIF\n");
+     }
+  thread->appendf("JP #THREAD%c\n", c);
+}
+
+//Generated controller program assembled as GalilStartController does
+static string genProgram(const char *axes, bool limitAsHome, bool interlock)
+{
+  GalilCodeBuffer card(100000), thread(100000), limit(100000), digital(100000);
+  size_t i;
+
+  card.append("#AUTO\n");
+  limit.append("#LIMSWI\n");
+  if (interlock)
+     digital.append("#ININT\ndpoff=dpon\n");
+  for (i = 0; i < strlen(axes); i++)
+     {
+     if (axes[i] != 'A')
+        card.appendf("XQ #THREAD%c,%d\n", axes[i], (int)(axes[i] - 'A'));
+     genAxis(axes[i], limitAsHome, &thread, &limit);
+     }
+  thread.append("#CMDERR\nerrstr=_ED;errcde=_TC;cmderr=cmderr+1\nEN\n");
+  if (interlock)
+     {
+     limit.append("RE 1\n");
+     digital.append("IF ((@IN[1]=0) & (dpoff=1))\nSTA;MOA\nENDIF\nRI 1\nEN\n");
+     card.append("II 1,8\n");
+     }
+  else
+     limit.append("RE 1\nEN\n");
+  return string(card.c_str()) + thread.c_str() + limit.c_str() + digital.c_str();
+}
+
+//User code with comments, blank lines, quoted strings, trailing comments, and duplicate subroutines
+static string userProgram(void)
+{
+  return string(
+     "REM User program\n"
+     "#AUTO\n"
+     "   XQ #POLLA,1   \n"
+     "\n"
+     "NO initialise\n"
+     "count=0;\n"
+     "MG \"a;b\", count\n"
+     "' full line comment\n"
+     "JS #DELAY1\n"
+     "JS #DELAY2\n"
+     "JP #AUTO\n"
+     "#DELAY1\n"
+     "WT 100\n"
+     "count=count+1\n"
+     "EN\n"
+     "#DELAY2\n"
+     "WT 100\n"
+     "count=count+1\n"
+     "EN\n"
+     "#POLLA\n"
+     "WT 5 ' sample wait\n"
+     "IF (_BGA=0)\n"
+     "ENDIF\n"
+     "JP #POLLA\n"
+     "#POLLB\n"
+     "WT 5 ' sample wait\n"
+     "IF (_BGA=0)\n"
+     "ENDIF\n"
+     "JP #POLLB\n"
+     "#WAITA\n"
+     "JP #WAITA,_BGA=1\n"
+     "EN\n"
+     "#WAITB\n"
+     "JP #WAITB,_BGA=1\n"
+     "EN\n"
+     "#CMDERR\n"
+     "errcde=_TC\n"
+     "EN\n"
+     "#ERRCOPY\n"
+     "errcde=_TC\n"
+     "EN\n");
+}
+
+//Split program into statements, dropping comment lines, and empty statements
+//; inside quotes, and after a trailing apostrophe comment does not split
+static vector<string> statements(const string &prog)
+{
+  vector<string> result;
+  string line, stmt;
+  size_t pos = 0, end, i, first, last;
+  bool quoted, comment;
+
+  while (pos < prog.length())
+     {
+     end = prog.find('\n', pos);
+     end = (end == string::npos) ? prog.length() : end;
+     line = prog.substr(pos, end - pos);
+     pos = end + 1;
+     first = line.find_first_not_of(" \t\r");
+     if (first == string::npos)
+        continue;
+     line = line.substr(first);
+     if (line.compare(0, 3, "REM") == 0 || line[0] == '\'' || line == "NO" || line.compare(0, 3, "NO ") == 0)
+        continue;
+     quoted = comment = false;
+     stmt.clear();
+     for (i = 0; i <= line.length(); i++)
+        {
+        if (i < line.length() && line[i] == '"')
+           quoted = !quoted;
+        if (i < line.length() && line[i] == '\'' && !quoted)
+           comment = true;
+        if (i == line.length() || (line[i] == ';' && !quoted && !comment))
+           {
+           first = stmt.find_first_not_of(" \t\r");
+           last = stmt.find_last_not_of(" \t\r");
+           if (first != string::npos)
+              result.push_back(stmt.substr(first, last - first + 1));
+           stmt.clear();
+           }
+        else
+           stmt += line[i];
+        }
+     }
+  return result;
+}
+
+//Whole word label replace, as the minifier does
+static string replaceLabel(const string &stmt, const string &label, const string &with)
+{
+  string result = stmt;
+  size_t pos = 0, end;
+
+  while ((pos = result.find(label, pos)) != string::npos)
+     {
+     end = pos + label.length();
+     if (end == result.length() || !isalnum((unsigned char)result[end]))
+        {
+        result.replace(pos, label.length(), with);
+        pos += with.length();
+        }
+     else
+        pos = end;
+     }
+  return result;
+}
+
+//Group statements into label blocks, and expand subroutines that are only a jump to another subroutine
+//The expanded body is the target body with its own label replaced, which is what the controller executes
+static Blocks expand(const vector<string> &stmts)
+{
+  Blocks blocks;
+  map<string, size_t> labels;
+  string target;
+  size_t i, j;
+
+  for (i = 0; i < stmts.size(); i++)
+     {
+     if (blocks.empty() || stmts[i][0] == '#')
+        blocks.push_back(vector<string>());
+     blocks.back().push_back(stmts[i]);
+     if (stmts[i][0] == '#')
+        labels[stmts[i]] = blocks.size() - 1;
+     }
+  for (i = 0; i < blocks.size(); i++)
+     {
+     if (blocks[i].size() != 2 || blocks[i][0][0] != '#' || blocks[i][1].compare(0, 4, "JP #") != 0)
+        continue;
+     target = blocks[i][1].substr(3);
+     if (target.find(',') != string::npos || !labels.count(target) || labels[target] == i)
+        continue;
+     const vector<string> &body = blocks[labels[target]];
+     blocks[i].resize(1);
+     for (j = 1; j < body.size(); j++)
+        blocks[i].push_back(replaceLabel(body[j], target, blocks[i][0]));
+     }
+  return blocks;
+}
+
+//Split program into lines
+static vector<string> lines(const string &prog)
+{
+  vector<string> result;
+  size_t pos = 0, end;
+
+  while (pos < prog.length())
+     {
+     end = prog.find('\n', pos);
+     end = (end == string::npos) ? prog.length() : end;
+     result.push_back(prog.substr(pos, end - pos));
+     pos = end + 1;
+     }
+  return result;
+}
+
+//Minify fixture, check minified program is equivalent, and within limits
+static string checkFixture(const char *name, const string &prog, unsigned columns)
+{
+  string mini = prog;			//Minified program
+  vector<string> before = lines(prog);	//Original lines
+  vector<string> after;			//Minified lines
+  bool fits = true, labelsStart = true, commentsEnd = true;
+  unsigned count, labels, longest;	//GalilCodeUsage results
+  unsigned expLabels = 0, expLongest = 0;
+  string download;			//Minified program in download form
+  size_t i, quote;
+
+  GalilMinifyCode(&mini, columns);
+  after = lines(mini);
+
+  testOk(expand(statements(prog)) == expand(statements(mini)), "%s: same statements after minify", name);
+
+  for (i = 0; i < after.size(); i++)
+     {
+     //Source lines longer than the limit are kept whole, merged lines must fit
+     if (after[i].length() > columns && find(before.begin(), before.end(), after[i]) == before.end())
+        fits = false;
+     //Labels only at line start
+     if (after[i].find(";#") != string::npos)
+        labelsStart = false;
+     //Nothing merged after a trailing comment
+     quote = after[i].find('\'');
+     if (quote != string::npos && after[i].find(';', quote) != string::npos)
+        commentsEnd = false;
+     expLabels += (after[i][0] == '#');
+     expLongest = (after[i].length() > expLongest) ? after[i].length() : expLongest;
+     }
+  testOk(fits, "%s: merged lines within %u columns", name, columns);
+  testOk(labelsStart, "%s: labels start lines", name);
+  testOk(commentsEnd, "%s: no statement merged after trailing comment", name);
+  testOk(after.size() < before.size(), "%s: %u lines reduced to %u", name, (unsigned)before.size(), (unsigned)after.size());
+
+  //Usage is counted on download form, which has \r line ends
+  download = mini;
+  for (i = 0; i < download.length(); i++)
+     download[i] = (download[i] == '\n') ? '\r' : download[i];
+  GalilCodeUsage(download, &count, &labels, &longest);
+  testOk(count == after.size() && labels == expLabels && longest == expLongest,
+         "%s: usage %u lines, %u labels, longest %u", name, count, labels, longest);
+  return mini;
+}
+
+//Generated code, all axes homing to limits
+static void testLimitsAsHome(void)
+{
+  string mini = checkFixture("8 axes, limits as home", genProgram("ABCDEFGH", true, false), TEST_COLUMNS);
+  testOk(mini.find("#THREADH\n") != string::npos && mini.find("JP #THREADH\n") != string::npos, "Last axis thread kept");
+}
+
+//Generated code, home switch axes, and digital input interlock
+static void testHomeSwitch(void)
+{
+  string mini = checkFixture("4 axes, home switch, interlock", genProgram("ABCD", false, true), TEST_COLUMNS);
+  testOk(mini.find("#ININT\n") != string::npos && mini.find("RI 1;EN\n") != string::npos, "Input interrupt kept");
+}
+
+//Narrow column limit forces more lines, but the same statements
+static void testNarrowColumns(void)
+{
+  checkFixture("2 axes, 40 columns", genProgram("AB", true, false), 40);
+}
+
+//User code
+static void testUserCode(void)
+{
+  string mini = checkFixture("User code", userProgram(), TEST_COLUMNS);
+
+  testOk(mini.find("REM") == string::npos && mini.find("NO ") == string::npos && mini.find("' full") == string::npos, "Comment lines removed");
+  testOk(mini.find("MG \"a;b\", count") != string::npos, "Quoted ; kept");
+  testOk(mini.find("#DELAY2\nJP #DELAY1\n") != string::npos, "Duplicate subroutine ending in EN replaced by jump");
+  testOk(mini.find("#POLLB\nJP #POLLA\n") != string::npos, "Duplicate looping subroutine replaced by jump");
+  testOk(mini.find("#WAITB\nJP #WAITA\n") != string::npos, "Duplicate self referencing subroutine replaced by jump");
+  testOk(mini.find("#CMDERR\nerrcde=_TC;EN\n") != string::npos && mini.find("#ERRCOPY\nerrcde=_TC;EN\n") != string::npos,
+         "Interrupt subroutine not deduplicated");
+}
+
+//Minify is stable
+static void testIdempotent(void)
+{
+  string once = genProgram("ABCD", false, true);
+  string twice;
+
+  GalilMinifyCode(&once, TEST_COLUMNS);
+  twice = once;
+  GalilMinifyCode(&twice, TEST_COLUMNS);
+  testOk(once == twice, "Minified code unchanged by second minify");
+}
+
+MAIN(galilCodeMinifyTest)
+{
+  testPlan(33);
+  testLimitsAsHome();
+  testHomeSwitch();
+  testNarrowColumns();
+  testUserCode();
+  testIdempotent();
+  return testDone();
+}
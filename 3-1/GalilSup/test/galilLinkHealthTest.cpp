@@ -0,0 +1,219 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilLinkHealth unit tests
+// A loopback link simulator delivers data records, and answers heartbeat probes, dropping packets
+// by pattern.  The poller side applies the same probe, and status rules as GalilController::checkLinkHealth
+
+#include <stdio.h>
+#include <math.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilLinkHealth.h"
+
+//Heartbeat period, poller cycle, data record interval, and probe round trip time in seconds
+#define HEARTBEAT 1.0
+#define POLL_PERIOD 0.01
+#define RECORD_PERIOD 0.02
+#define PROBE_RTT 0.002
+
+//Packet drop patterns
+typedef struct {
+  double recordStallStart;	//Drop all records from this time
+  double recordStallEnd;	//Until this time
+  double probeStallStart;	//Drop all probe responses from this time
+  double probeStallEnd;		//Until this time
+  unsigned lossPercent;		//Random loss of records, and probe responses
+} DropPattern;
+
+//Simulation results
+typedef struct {
+  double degradedTime;		//First time link degraded, -1 if never
+  double lostTime;		//First time link lost, -1 if never
+  double recoveredTime;		//First time link ok after degraded, -1 if never
+  unsigned probes;		//Probes sent
+  unsigned records;		//Records delivered
+} LinkResult;
+
+//Deterministic pseudo random loss
+static bool dropped(unsigned *seed, unsigned lossPercent)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return ((*seed >> 16) % 100) < lossPercent;
+}
+
+static bool within(double t, double start, double end)
+{
+  return (t >= start && t < end);
+}
+
+//Run link for duration seconds with given heartbeat period
+static LinkResult simulate(double period, double duration, const DropPattern &drop)
+{
+  LinkResult result = {-1.0, -1.0, -1.0, 0, 0};
+  double lastRecord = 0.0, lastCommand = 0.0, nextRecord = 0.0;
+  double now, commandAge, recordAge;
+  unsigned seed = 1;
+  long tick;
+  int status;
+
+  for (tick = 0; (now = tick * POLL_PERIOD) <= duration; tick++)
+     {
+     //Records arriving since last poll
+     while (nextRecord <= now)
+        {
+        if (!within(nextRecord, drop.recordStallStart, drop.recordStallEnd) && !dropped(&seed, drop.lossPercent))
+           {
+           lastRecord = nextRecord;
+           result.records++;
+           }
+        nextRecord += RECORD_PERIOD;
+        }
+     //Probe when idle
+     commandAge = now - lastCommand;
+     if (GalilLinkProbeDue(period, commandAge))
+        {
+        result.probes++;
+        if (!within(now, drop.probeStallStart, drop.probeStallEnd) && !dropped(&seed, drop.lossPercent))
+           lastCommand = now + PROBE_RTT;
+        now += PROBE_RTT;
+        commandAge = now - lastCommand;
+        }
+     recordAge = now - lastRecord;
+     status = GalilLinkStatus(period, recordAge, commandAge);
+     if (status != LINK_OK && result.degradedTime < 0.0)
+        result.degradedTime = now;
+     if (status == LINK_LOST && result.lostTime < 0.0)
+        result.lostTime = now;
+     if (status == LINK_OK && result.degradedTime >= 0.0 && result.recoveredTime < 0.0)
+        result.recoveredTime = now;
+     }
+  return result;
+}
+
+//Clean link, probes once per heartbeat period
+static void testClean(void)
+{
+  DropPattern drop = {-1, -1, -1, -1, 0};
+  LinkResult r = simulate(HEARTBEAT, 20.0, drop);
+
+  testOk(r.degradedTime < 0.0, "Clean link never degraded");
+  testOk(r.probes >= 19 && r.probes <= 21, "Clean link probed once per heartbeat, %u probes in 20 s", r.probes);
+}
+
+//Random loss is tolerated
+static void testRandomLoss(void)
+{
+  DropPattern drop = {-1, -1, -1, -1, 20};
+  LinkResult r = simulate(HEARTBEAT, 60.0, drop);
+
+  testOk(r.degradedTime < 0.0, "20%% random loss never degraded, %u records delivered", r.records);
+}
+
+//Data record stall with commands still answered
+static void testRecordStall(void)
+{
+  DropPattern drop = {10.0, 1000.0, -1, -1, 0};
+  LinkResult r = simulate(HEARTBEAT, 30.0, drop);
+
+  testOk(r.degradedTime >= 10.0 + 2.0 * HEARTBEAT - RECORD_PERIOD && r.degradedTime <= 10.0 + 2.0 * HEARTBEAT + POLL_PERIOD + PROBE_RTT,
+         "Record stall at 10 s degraded at %.3f s", r.degradedTime);
+  testOk(r.lostTime >= 10.0 + 4.0 * HEARTBEAT - RECORD_PERIOD && r.lostTime <= 10.0 + 4.0 * HEARTBEAT + POLL_PERIOD + PROBE_RTT,
+         "Record stall at 10 s lost at %.3f s", r.lostTime);
+}
+
+//Probe responses dropped with records still arriving, as when the command path stalls
+static void testCommandStall(void)
+{
+  DropPattern drop = {-1, -1, 10.0, 1000.0, 0};
+  LinkResult r = simulate(HEARTBEAT, 30.0, drop);
+
+  testOk(r.lostTime > 10.0 && r.lostTime <= 10.0 + 4.0 * HEARTBEAT + POLL_PERIOD + PROBE_RTT,
+         "Command stall at 10 s lost at %.3f s", r.lostTime);
+  testOk(r.probes > 25, "Probes repeat each poll while unanswered, %u probes", r.probes);
+}
+
+//Short burst loss degrades, then recovers without declaring link lost
+static void testBurst(void)
+{
+  DropPattern drop = {10.0, 13.0, 10.0, 13.0, 0};
+  LinkResult r = simulate(HEARTBEAT, 30.0, drop);
+
+  //Last probe answered up to 1 heartbeat before the burst
+  testOk(r.degradedTime >= 10.0 + HEARTBEAT && r.degradedTime <= 12.0 + POLL_PERIOD + PROBE_RTT,
+         "3 s burst degraded at %.3f s", r.degradedTime);
+  testOk(r.lostTime < 0.0, "3 s burst not lost");
+  testOk(r.recoveredTime >= 13.0 && r.recoveredTime <= 13.0 + HEARTBEAT, "3 s burst recovered at %.3f s", r.recoveredTime);
+
+  drop.recordStallEnd = 11.5;
+  drop.probeStallStart = drop.probeStallEnd = -1;
+  r = simulate(HEARTBEAT, 30.0, drop);
+  testOk(r.degradedTime < 0.0, "Record burst shorter than 2 heartbeats not degraded");
+}
+
+//Heartbeat off never declares link lost, and never probes
+static void testHeartbeatOff(void)
+{
+  DropPattern drop = {5.0, 1000.0, 5.0, 1000.0, 0};
+  LinkResult r = simulate(0.0, 30.0, drop);
+
+  testOk(r.degradedTime < 0.0 && r.probes == 0, "Heartbeat off, total stall not reported, no probes");
+}
+
+//Status boundaries
+static void testStatus(void)
+{
+  testOk1(GalilLinkStatus(1.0, 1.999, 0.0) == LINK_OK);
+  testOk1(GalilLinkStatus(1.0, 2.0, 0.0) == LINK_DEGRADED);
+  testOk1(GalilLinkStatus(1.0, 0.0, 2.0) == LINK_DEGRADED);
+  testOk1(GalilLinkStatus(1.0, 4.0, 0.0) == LINK_LOST);
+  testOk1(GalilLinkStatus(1.0, 0.0, 4.0) == LINK_LOST);
+  testOk1(GalilLinkProbeDue(1.0, 0.999) == false);
+  testOk1(GalilLinkProbeDue(1.0, 1.0) == true);
+}
+
+//Round trip time statistics
+static void testRTT(void)
+{
+  double last = 0.0, max = 0.0, mean = 0.0;
+  int i;
+
+  GalilLinkRTTUpdate(2.0, &last, &max, &mean);
+  testOk(last == 2.0 && max == 2.0 && mean == 2.0, "First round trip sets mean");
+  GalilLinkRTTUpdate(18.0, &last, &max, &mean);
+  testOk(last == 18.0 && max == 18.0 && mean == 3.0, "Mean weights newest sample 1/%g", LINK_RTT_WEIGHT);
+  for (i = 0; i < 500; i++)
+     GalilLinkRTTUpdate(1.0, &last, &max, &mean);
+  testOk(last == 1.0 && max == 18.0 && fabs(mean - 1.0) < 1e-6, "Mean converges, max held");
+}
+
+MAIN(galilLinkHealthTest)
+{
+  testPlan(22);
+  testClean();
+  testRandomLoss();
+  testRecordStall();
+  testCommandStall();
+  testBurst();
+  testHeartbeatOff();
+  testStatus();
+  testRTT();
+  return testDone();
+}
@@ -0,0 +1,212 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilPath unit tests
+// Paths are built with two link arm kinematics, the csaxis is the arm tip x position at a fixed height
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <string>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilPath.h"
+
+using namespace std;
+
+//Arm link lengths, and tip height
+#define LINK1 300.0
+#define LINK2 250.0
+#define HEIGHT 150.0
+
+//Two link arm, real axis are shoulder, and elbow angle in radians
+class TwoLinkArm : public GalilPathKinematics {
+public:
+  TwoLinkArm() : reverses(0) {}
+  int reverse(double x, double q[])
+  {
+    double c2 = (x * x + HEIGHT * HEIGHT - LINK1 * LINK1 - LINK2 * LINK2) / (2.0 * LINK1 * LINK2);
+
+    reverses++;
+    //Tip out of reach
+    if (c2 < -1.0 || c2 > 1.0)
+       return -1;
+    q[1] = acos(c2);
+    q[0] = atan2(HEIGHT, x) - atan2(LINK2 * sin(q[1]), LINK1 + LINK2 * cos(q[1]));
+    return 0;
+  }
+  int forward(const double q[], double *x)
+  {
+    *x = LINK1 * cos(q[0]) + LINK2 * cos(q[0] + q[1]);
+    return 0;
+  }
+  unsigned reverses;
+};
+
+//Linear kinematics, real axis A = csaxis / 2, and B = csaxis
+class Linear : public GalilPathKinematics {
+public:
+  int reverse(double x, double q[])
+  {
+    q[0] = x / 2.0;
+    q[1] = x;
+    return 0;
+  }
+  int forward(const double q[], double *x)
+  {
+    *x = q[1];
+    return 0;
+  }
+};
+
+//Every accepted segment midpoint is within tolerance of the straight csaxis path
+static void testTwoLink(void)
+{
+  TwoLinkArm arm;
+  GalilPath path;
+  double q0[PATH_AXES] = {0}, q1[PATH_AXES] = {0}, qm[PATH_AXES] = {0};
+  double cs, prev, mid, deviation, maxdev = 0.0;
+  bool ordered = true;
+  size_t k;
+
+  testOk(path.build(&arm, "AB", 250.0, 500.0, 0.01) == 0, "Two link path built");
+  testOk(path.points() > 1 && path.points() <= PATH_MAX_SEGMENTS, "Path subdivided into %u segments", (unsigned)path.points());
+  testOk(path.deviation() <= 0.01, "Reported deviation %g within tolerance", path.deviation());
+
+  //Check each segment independently, segment end csaxis positions are recovered by forward transform
+  arm.reverse(250.0, q0);
+  prev = 250.0;
+  for (k = 0; k < path.points(); k++)
+     {
+     arm.forward(path.point(k), &cs);
+     qm[0] = (q0[0] + path.point(k)[0]) / 2.0;
+     qm[1] = (q0[1] + path.point(k)[1]) / 2.0;
+     arm.forward(qm, &mid);
+     deviation = fabs(mid - (prev + cs) / 2.0);
+     maxdev = (deviation > maxdev) ? deviation : maxdev;
+     ordered = (cs > prev) ? ordered : false;
+     memcpy(q0, path.point(k), sizeof(q0));
+     prev = cs;
+     }
+  testOk(maxdev <= 0.01 && fabs(maxdev - path.deviation()) < 1e-9, "Segment midpoint deviation %g", maxdev);
+  testOk(ordered, "Segment ends advance along csaxis path");
+  arm.reverse(500.0, q1);
+  testOk(path.point(path.points() - 1)[0] == q1[0] && path.point(path.points() - 1)[1] == q1[1], "Path ends exactly at reverse transformed end point");
+}
+
+//Linear kinematics need no subdivision
+static void testLinear(void)
+{
+  Linear linear;
+  GalilPath path;
+
+  testOk(path.build(&linear, "AB", -10.0, 90.0, 1e-9) == 0 && path.points() == 1, "Linear path is one segment");
+  testOk(path.deviation() == 0.0, "Linear path deviation is 0");
+}
+
+//Segments are limited to PATH_MAX_SEGMENTS when tolerance cannot be met
+static void testLimit(void)
+{
+  TwoLinkArm arm;
+  GalilPath path;
+
+  testOk(path.build(&arm, "AB", 150.0, 500.0, 1e-12) == 0, "Path built with unreachable tolerance");
+  testOk(path.points() == PATH_MAX_SEGMENTS, "Segments limited to %d", PATH_MAX_SEGMENTS);
+  testOk(path.deviation() > 1e-12, "Deviation %g reported above tolerance", path.deviation());
+}
+
+//Reverse transform failure fails the path
+static void testReach(void)
+{
+  TwoLinkArm arm;
+  GalilPath path;
+
+  testOk(path.build(&arm, "AB", 400.0, 600.0, 0.01) != 0, "Path end out of reach fails");
+  testOk(path.points() == 0, "Failed path has no points");
+}
+
+//Increments sum to the move, with different resolutions per axis
+static void testSegments(void)
+{
+  TwoLinkArm arm;
+  GalilPath path;
+  vector<string> segments;
+  double res[2] = {1e-5, 2.5e-6};	//Encoder counts for A, motor steps for C
+  double q0[PATH_AXES] = {0}, q1[PATH_AXES] = {0};
+  long last[2], start[2], sum[2] = {0, 0};
+  long a, b;
+  int fields;
+  bool formatted = true;
+  size_t k;
+  const char *c;
+
+  path.build(&arm, "AC", 250.0, 500.0, 0.01);
+  arm.reverse(250.0, q0);
+  arm.reverse(500.0, q1);
+  start[0] = last[0] = lrint(q0[0] / res[0]);
+  start[1] = last[1] = lrint(q0[1] / res[1]);
+  path.segments(res, last, segments);
+  testOk(segments.size() == path.points(), "One segment per point");
+  for (k = 0; k < segments.size(); k++)
+     {
+     //Axis A, and C increments, other axis empty
+     fields = 1;
+     for (c = segments[k].c_str(); *c; c++)
+        fields += (*c == ',') ? 1 : 0;
+     if (fields != PATH_AXES || sscanf(segments[k].c_str(), "%ld,,%ld,", &a, &b) != 2)
+        {
+        formatted = false;
+        break;
+        }
+     sum[0] += a;
+     sum[1] += b;
+     }
+  testOk(formatted, "Segments are axis increments at axis position (%s)", segments[0].c_str());
+  testOk(sum[0] == lrint(q1[0] / res[0]) - start[0] && sum[1] == lrint(q1[1] / res[1]) - start[1], "Increments sum to move in each axis resolution");
+  testOk(last[0] == lrint(q1[0] / res[0]) && last[1] == lrint(q1[1] / res[1]), "Last position updated to path end");
+}
+
+//Segments where no real axis moves a whole step are skipped
+static void testNoMove(void)
+{
+  Linear linear;
+  GalilPath path;
+  vector<string> segments;
+  double res[2] = {1.0, 1.0};
+  long last[2] = {0, 0};
+
+  path.build(&linear, "AB", 0.0, 0.2, 0.01);
+  path.segments(res, last, segments);
+  testOk(segments.size() == 0, "Move below one step makes no segments");
+}
+
+MAIN(galilPathTest)
+{
+  testPlan(18);
+  testTwoLink();
+  testLinear();
+  testLimit();
+  testReach();
+  testSegments();
+  testNoMove();
+  return testDone();
+}
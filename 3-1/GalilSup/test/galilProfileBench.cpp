@@ -0,0 +1,164 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Linear profile build, and execute setup benchmark
+// Usage: galilProfileBench [points] [axes]
+// Without arguments 100,000 points, and 8 axes with 1,000,000 points are run, and build time per point compared
+// Build time per point should not grow with profile length
+// Build is GalilProfileBuffer::buildLinear over every point, as GalilController::buildLinearProfile runs it
+// Execute setup formats every built segment, and packs them onto controller command lines as runLinearProfile does
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "GalilProfileBuffer.h"
+
+//Controller command line length
+#define COMMAND_LINE 80
+//Segment time, seconds
+#define SEGMENT_TIME 0.001
+
+static double seconds(clock_t begin)
+{
+  return (double)(clock() - begin) / CLOCKS_PER_SEC;
+}
+
+//Build, and execute setup for one profile size
+//Returns build time per point in seconds, or 0 on failure
+static double bench(long points, int naxes)
+{
+  GalilProfileBuffer buffer;
+  GalilProfileMotor motors[PROFILE_AXES];
+  double startp[PROFILE_AXES] = {0};
+  char axes[PROFILE_AXES + 1];
+  char message[256];
+  char text[128];
+  char line[256];
+  double *positions[PROFILE_AXES];
+  double *times;
+  double build, setup;
+  size_t len, tlen, segment, lines = 0, bytes = 0;
+  clock_t begin;
+  bool query;
+  long i;
+  int k;
+
+  naxes = (naxes < 1) ? 1 : (naxes > PROFILE_AXES) ? PROFILE_AXES : naxes;
+
+  //Profile, each axis follows a different smooth path so every segment moves
+  times = (double *)malloc(points * (naxes + 1) * sizeof(double));
+  if (!times || !buffer.allocate(points))
+     {
+     printf("Cannot allocate %ld points\n", points);
+     free(times);
+     return 0.0;
+     }
+  for (k = 0; k < naxes; k++)
+     positions[k] = times + (k + 1) * points;
+  for (i = 0; i < points; i++)
+     {
+     times[i] = SEGMENT_TIME;
+     for (k = 0; k < naxes; k++)
+        positions[k][i] = 100.3 * i + 5000.0 * sin(i * 0.001 * (k + 1));
+     }
+  for (k = 0; k < naxes; k++)
+     {
+     axes[k] = (char)('A' + k);
+     motors[k].positions = positions[k];
+     motors[k].axisNo = k;
+     motors[k].mres = 1.0;
+     motors[k].maxVelocity = 1e9;
+     motors[k].lowLimit = -1e12;
+     motors[k].highLimit = 1e12;
+     }
+  axes[naxes] = '\0';
+
+  //Build
+  begin = clock();
+  buffer.clear();
+  buffer.setAxes(axes, startp);
+  if (!buffer.buildLinear(motors, naxes, times, (int)points, message, sizeof(message)))
+     {
+     printf("Build failed: %s\n", message);
+     free(times);
+     return 0.0;
+     }
+  buffer.setType(PROFILE_LINEAR);
+  build = seconds(begin);
+
+  //Execute setup, lines are packed as GalilController::packLinearSegments does
+  //Coordsys select, and free space query start each line, a segment too long for the query is sent alone
+  begin = clock();
+  segment = 0;
+  while (segment < buffer.segments())
+     {
+     len = sprintf(line, "CA S;MG _LMS");
+     query = true;
+     while (segment < buffer.segments())
+        {
+        tlen = buffer.format(segment, text, sizeof(text));
+        if (len + tlen + 4 > COMMAND_LINE)
+           {
+           if (!query || len > 12)
+              break;
+           len = sprintf(line, "CA S");
+           query = false;
+           }
+        len += sprintf(line + len, ";LI %s", text);
+        segment++;
+        if (!query)
+           break;
+        }
+     lines++;
+     bytes += len;
+     }
+  setup = seconds(begin);
+
+  printf("%ld points, %d axes, %lu segments\n", points, naxes, (unsigned long)buffer.segments());
+  printf("Build         %8.3f s  %8.1f ns/point\n", build, build * 1e9 / points);
+  printf("Execute setup %8.3f s  %8.1f ns/segment, %lu lines, %lu bytes\n", setup, setup * 1e9 / buffer.segments(),
+         (unsigned long)lines, (unsigned long)bytes);
+
+  free(times);
+  return build / points;
+}
+
+int main(int argc, char *argv[])
+{
+  double small, large;	//Build time per point
+
+  if (argc > 1)
+     {
+     if (atol(argv[1]) < 2)
+        {
+        printf("Usage: galilProfileBench [points] [axes]\n");
+        return 1;
+        }
+     return (bench(atol(argv[1]), (argc > 2) ? atoi(argv[2]) : 8) > 0.0) ? 0 : 1;
+     }
+
+  small = bench(100000, 8);
+  large = bench(1000000, 8);
+  if (small <= 0.0 || large <= 0.0)
+     return 1;
+  printf("Build time per point 1,000,000 / 100,000 points %.2f\n", large / small);
+  return 0;
+}
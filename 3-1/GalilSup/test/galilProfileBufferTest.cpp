@@ -0,0 +1,586 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilProfileBuffer unit tests
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilProfileBuffer.h"
+
+//Command buffer size used by the driver
+#define COMMAND_SIZE 256
+
+static const double zeros[PROFILE_AXES] = {0};
+
+//Storage is allocated once, and append fails when full
+static void testStorage(void)
+{
+  GalilProfileBuffer buffer;
+  double deltas[PROFILE_AXES] = {1, 2, 3, 4, 5, 6, 7, 8};
+  size_t i;
+
+  testOk(buffer.allocate(10) && buffer.maxSegments() == 10, "Allocate 10 segments");
+  buffer.setAxes("ABCDEFGH", zeros);
+  for (i = 0; i < 10; i++)
+     buffer.append(deltas, 100);
+  testOk(!buffer.append(deltas, 100) && buffer.segments() == 10, "Append fails when full");
+  buffer.clear();
+  testOk(buffer.segments() == 0 && buffer.type() == PROFILE_NONE && buffer.maxSegments() == 10, "Clear keeps storage");
+}
+
+//Deltas are rounded, axis outside axis list are ignored
+static void testAppend(void)
+{
+  GalilProfileBuffer buffer;
+  double startp[PROFILE_AXES] = {10, 20, 30, 40, 50, 60, 70, 80};
+  double deltas[PROFILE_AXES] = {1.4, -2.6, 3.5, 4, 5, 6, 7, 8};
+  double velocities[PROFILE_AXES] = {100.4, -200.6, 0, 0, 0, 0, 0, 0};
+
+  buffer.allocate(4);
+  buffer.setAxes("ACF", startp);
+  buffer.append(deltas, 99.6);
+  testOk(buffer.delta(0, 0) == 1 && buffer.delta(0, 1) == 0 && buffer.delta(0, 2) == 4 && buffer.delta(0, 5) == 6,
+         "Deltas rounded, axis not in list ignored");
+  testOk(buffer.speed(0) == 100, "Speed rounded");
+  testOk(buffer.startPosition(0) == 10 && buffer.startPosition(2) == 30 && buffer.startPosition(1) == 0, "Start positions for axis list only");
+
+  buffer.clear();
+  buffer.setAxes("AB", startp);
+  buffer.appendPVT(deltas, velocities, 64);
+  buffer.appendPVT(deltas, velocities, 100);
+  testOk(buffer.velocity(0, 0) == 100 && buffer.velocity(0, 1) == -201 && buffer.samples(1) == 100, "PVT velocities rounded");
+  testOk(buffer.totalSamples() == 164, "PVT total samples");
+}
+
+//Linear segment text
+static void testFormat(void)
+{
+  GalilProfileBuffer buffer;
+  double deltas[PROFILE_AXES] = {1000, 0, -1000, 0, 0, -2147483647.0, 0, 0};
+  char text[COMMAND_SIZE];
+
+  buffer.allocate(2);
+  buffer.setAxes("AC", zeros);
+  buffer.append(deltas, 5000);
+  testOk(buffer.format(0, text, sizeof(text)) == strlen("1000,,-1000<5000") && strcmp(text, "1000,,-1000<5000") == 0, "Format %s", text);
+  buffer.clear();
+  buffer.setAxes("BF", zeros);
+  buffer.append(deltas, 1);
+  buffer.format(0, text, sizeof(text));
+  testOk(strcmp(text, ",0,,,,-2147483647<1") == 0, "Format %s", text);
+  testOk(buffer.format(1, text, sizeof(text)) == 0 && text[0] == '\0', "Format past end is empty");
+  testOk(buffer.format(0, text, 8) == 0, "Format into short buffer is empty");
+}
+
+//PVT commands for each axis in each segment, then zero time commands
+static void testPVTCommands(void)
+{
+  GalilProfileBuffer buffer;
+  GalilProfileCursor cursor;
+  double deltas[PROFILE_AXES] = {100, -50, 0, 0, 0, 0, 0, 0};
+  double velocities[PROFILE_AXES] = {1000, 0, 0, 0, 0, 0, 0, 0};
+  const char *expected[] = {"PVA=100,1000,32", "PVB=-50,0,32", "PVA=100,1000,32", "PVB=-50,0,32", "PVA=0,0,0", "PVB=0,0,0"};
+  char text[COMMAND_SIZE];
+  bool slot, match = true;
+  unsigned n = 0, slots = 0;
+
+  buffer.allocate(2);
+  buffer.setAxes("AB", zeros);
+  buffer.appendPVT(deltas, velocities, 32);
+  buffer.appendPVT(deltas, velocities, 32);
+  buffer.setType(PROFILE_PVT);
+  buffer.startCursor(&cursor, false, 0);
+  while (buffer.nextCommand(&cursor, text, sizeof(text), &slot))
+     {
+     if (n >= 6 || strcmp(text, expected[n]) != 0)
+        match = false;
+     slots += slot;
+     n++;
+     }
+  testOk(match && n == 6, "PVT command sequence");
+  testOk(slots == 3, "PVT uses a buffer segment per segment, and one to end");
+}
+
+//Export file format
+static void testExport(void)
+{
+  GalilProfileBuffer buffer;
+  double startp[PROFILE_AXES] = {-5, 7, 0, 0, 0, 0, 0, 0};
+  double deltas[PROFILE_AXES] = {10, -20, 0, 0, 0, 0, 0, 0};
+  char fileName[] = "galilProfileBufferTest.txt";
+  char text[4096];
+  FILE *file;
+  size_t n;
+
+  buffer.allocate(2);
+  buffer.setAxes("AB", startp);
+  buffer.appendContour(deltas, 16);
+  buffer.appendContour(deltas, 8);
+  buffer.setType(PROFILE_CONTOUR);
+  testOk(buffer.exportFile(fileName), "Export contour profile");
+  file = fopen(fileName, "r");
+  n = (file) ? fread(text, 1, sizeof(text) - 1, file) : 0;
+  text[n] = '\0';
+  if (file)
+     fclose(file);
+  remove(fileName);
+  testOk(strcmp(text, "CONTOUR\nAB\n-5,7,\n10,-20,16\n10,-20,8\n") == 0, "Export file contents");
+  testOk(!buffer.exportFile("no/such/directory/profile.txt"), "Export to bad path fails");
+}
+
+//Linear build, rounding error is corrected, and limits are reported with the failing segment
+static void testBuildLinear(void)
+{
+  GalilProfileBuffer buffer;
+  GalilProfileMotor motors[2];
+  double posA[5] = {0.4, 1.0, 1.6, 2.2, 2.8};
+  double posB[5] = {10, 110, 210, 310, 410};
+  double times[5] = {0, 0.1, 0.1, 0.1, 0.1};
+  char message[256];
+  long sum = 0;
+  size_t i;
+  int k;
+
+  buffer.allocate(10);
+  buffer.setAxes("AC", zeros);
+  for (k = 0; k < 2; k++)
+     {
+     motors[k].positions = (k) ? posB : posA;
+     motors[k].axisNo = (k) ? 2 : 0;
+     motors[k].mres = 0.5;
+     motors[k].maxVelocity = 2000;
+     motors[k].lowLimit = -1000;
+     motors[k].highLimit = 1000;
+     }
+  testOk(buffer.buildLinear(motors, 2, times, 5, message, sizeof(message)) && buffer.segments() == 4, "Build 4 segments");
+  for (i = 0; i < buffer.segments(); i++)
+     sum += buffer.delta(i, 0);
+  testOk(fabs(sum - (posA[4] - posA[0])) <= 1.0 && buffer.delta(0, 2) == 100, "Rounding error kept within 1 step, sum %ld", sum);
+  testOk(motors[1].maxProfileVelocity == 1000 && motors[1].maxPosition == 410 && motors[1].minPosition == 10, "Statistics");
+
+  buffer.clear();
+  buffer.setAxes("AC", zeros);
+  motors[1].maxVelocity = 500;
+  testOk(!buffer.buildLinear(motors, 2, times, 5, message, sizeof(message)) &&
+         strcmp(message, "Seg 1: Velocity too high motor C 500.00 > 250.00, increase time, check profile") == 0, "%s", message);
+  motors[1].maxVelocity = 2000;
+  motors[1].highLimit = 300;
+  buffer.clear();
+  buffer.setAxes("AC", zeros);
+  testOk(!buffer.buildLinear(motors, 2, times, 5, message, sizeof(message)) && buffer.segments() == 2 &&
+         strcmp(message, "Motor C position beyond soft limits in segment 3") == 0, "%s", message);
+  motors[1].highLimit = 1000;
+  posB[2] = posB[1];
+  posA[2] = posA[1];
+  buffer.clear();
+  buffer.setAxes("AC", zeros);
+  testOk(!buffer.buildLinear(motors, 2, times, 5, message, sizeof(message)) &&
+         strcmp(message, "Seg 2: Vector zero move distance, reduce time, add motors, and check profile") == 0, "%s", message);
+}
+
+//PVT test profile, axis A, and B, segment times are multiples of the contour slice
+#define HERMITE_SEGMENTS 4
+#define HERMITE_EXPONENT 3
+static const double hermiteDeltas[HERMITE_SEGMENTS][2] = {{400, -300}, {1200, -900}, {2000, 500}, {600, 1000}};
+static const double hermiteVelocities[HERMITE_SEGMENTS][2] = {{15000, -12000}, {25000, 0}, {20000, 22000}, {0, 0}};
+static const long hermiteSamples[HERMITE_SEGMENTS] = {64, 48, 80, 32};
+
+//Build test profile as PVT, or contour
+static void buildHermite(GalilProfileBuffer *buffer, profileType type, const long samples[])
+{
+  double deltas[PROFILE_AXES] = {0}, velocities[PROFILE_AXES] = {0};
+  int i;
+
+  buffer->allocate(HERMITE_SEGMENTS);
+  buffer->setAxes("AB", zeros);
+  buffer->setSampleTime(0.001);
+  for (i = 0; i < HERMITE_SEGMENTS; i++)
+     {
+     deltas[0] = hermiteDeltas[i][0];
+     deltas[1] = hermiteDeltas[i][1];
+     velocities[0] = hermiteVelocities[i][0];
+     velocities[1] = hermiteVelocities[i][1];
+     if (type == PROFILE_PVT)
+        buffer->appendPVT(deltas, velocities, samples[i]);
+     else
+        buffer->appendContour(deltas, samples[i]);
+     }
+  buffer->setType(type);
+}
+
+//Reference cubic hermite position of axis at profile time t samples
+static double hermite(int axis, double t)
+{
+  double start = 0.0, h, s, v0, v1, d;
+  int i;
+
+  for (i = 0; i < HERMITE_SEGMENTS - 1 && t > hermiteSamples[i]; i++)
+     {
+     start += hermiteDeltas[i][axis];
+     t -= hermiteSamples[i];
+     }
+  h = hermiteSamples[i];
+  s = t / h;
+  d = hermiteDeltas[i][axis];
+  v0 = (i) ? hermiteVelocities[i - 1][axis] * 0.001 * h : 0.0;
+  v1 = hermiteVelocities[i][axis] * 0.001 * h;
+  return start + (s * s * (3.0 - 2.0 * s)) * d + (s * (s - 1.0) * (s - 1.0)) * v0 + (s * s * (s - 1.0)) * v1;
+}
+
+//Contour slices from nextCommand, as slice time, and deltas for axis A, and B
+//Returns number of slices before the terminating slice
+static int contourSlices(const GalilProfileBuffer &buffer, long time[], int deltas[][2], int max, bool *terminated)
+{
+  GalilProfileCursor cursor;
+  char text[COMMAND_SIZE];
+  int n = 0, exponent, a, b;
+  bool slot;
+
+  *terminated = false;
+  buffer.startCursor(&cursor, true, HERMITE_EXPONENT);
+  while (buffer.nextCommand(&cursor, text, sizeof(text), &slot) && n < max)
+     {
+     exponent = HERMITE_EXPONENT;
+     if (sscanf(text, "CD %d,%d=%d", &a, &b, &exponent) < 2)
+        break;
+     if (exponent == 0)
+        {
+        *terminated = (a == 0 && b == 0);
+        break;
+        }
+     time[n] = 1L << exponent;
+     deltas[n][0] = a;
+     deltas[n][1] = b;
+     n++;
+     }
+  return n;
+}
+
+//Largest slice velocity change at segment boundaries, and within segments, counts per slice
+static void sliceJumps(const long time[], const int deltas[][2], int n, double *boundary, double *interior)
+{
+  long t = 0, end = hermiteSamples[0];
+  double jump;
+  int i, axis, seg = 0;
+
+  *boundary = *interior = 0.0;
+  for (i = 1; i < n; i++)
+     {
+     t += time[i - 1];
+     for (axis = 0; axis < 2; axis++)
+        {
+        jump = fabs((double)deltas[i][axis] - deltas[i - 1][axis]);
+        if (t == end)
+           *boundary = (jump > *boundary) ? jump : *boundary;
+        else
+           *interior = (jump > *interior) ? jump : *interior;
+        }
+     if (t == end && seg < HERMITE_SEGMENTS - 1)
+        end += hermiteSamples[++seg];
+     }
+}
+
+//PVT commands end exactly on each point
+static void testPVTEndpoints(void)
+{
+  GalilProfileBuffer buffer;
+  GalilProfileCursor cursor;
+  char text[COMMAND_SIZE];
+  double total[2] = {0}, expected[2] = {0};
+  int d, v, n, i, seg = 0;
+  bool slot, velocities = true;
+  char axis;
+
+  buildHermite(&buffer, PROFILE_PVT, hermiteSamples);
+  buffer.startCursor(&cursor, false, 0);
+  while (buffer.nextCommand(&cursor, text, sizeof(text), &slot))
+     {
+     if (sscanf(text, "PV%c=%d,%d,%d", &axis, &d, &v, &n) != 4 || n == 0)
+        continue;
+     i = axis - 'A';
+     total[i] += d;
+     if (v != hermiteVelocities[seg][i] || n != hermiteSamples[seg])
+        velocities = false;
+     seg += (i == 1);
+     }
+  for (i = 0; i < HERMITE_SEGMENTS; i++)
+     {
+     expected[0] += hermiteDeltas[i][0];
+     expected[1] += hermiteDeltas[i][1];
+     }
+  testOk(total[0] == expected[0] && total[1] == expected[1], "PVT commands end on profile end point");
+  testOk(velocities, "PVT commands carry point velocities, and times");
+}
+
+//PVT streamed as contour slices follows the cubic hermite, velocity is continuous at points
+static void testPVTContour(void)
+{
+  GalilProfileBuffer buffer, linear;
+  long time[256], oddSamples[HERMITE_SEGMENTS] = {42, 26, 30, 38};
+  int deltas[256][2];
+  long pos[2] = {0, 0}, t = 0, boundaryTime = 0;
+  int n, i, axis, seg = 0;
+  bool terminated, follows = true, exact = true;
+  double boundary, interior, linearBoundary, linearInterior;
+
+  buildHermite(&buffer, PROFILE_PVT, hermiteSamples);
+  n = contourSlices(buffer, time, deltas, 256, &terminated);
+  testOk(terminated && n == 28, "PVT as contour, %d slices then terminating slice", n);
+  for (i = 0; i < n; i++)
+     {
+     t += time[i];
+     for (axis = 0; axis < 2; axis++)
+        {
+        pos[axis] += deltas[i][axis];
+        if (pos[axis] != (long)rint(hermite(axis, (double)t)))
+           follows = false;
+        }
+     //Slices end exactly on every point
+     if (seg < HERMITE_SEGMENTS && t == boundaryTime + hermiteSamples[seg])
+        {
+        boundaryTime = t;
+        for (axis = 0; axis < 2; axis++)
+           if (pos[axis] != (long)rint(hermite(axis, (double)t)) || fabs(hermite(axis, (double)t) - rint(hermite(axis, (double)t))) > 1e-6)
+              exact = false;
+        seg++;
+        }
+     }
+  testOk(follows, "Contour slices follow cubic hermite between points");
+  testOk(exact && seg == HERMITE_SEGMENTS, "Contour slices end exactly on every point");
+
+  //Velocity changes at points no more than within segments, where linear interpolation jumps
+  sliceJumps(time, deltas, n, &boundary, &interior);
+  buildHermite(&linear, PROFILE_CONTOUR, hermiteSamples);
+  n = contourSlices(linear, time, deltas, 256, &terminated);
+  sliceJumps(time, deltas, n, &linearBoundary, &linearInterior);
+  testOk(boundary <= interior + 2.0, "Hermite velocity continuous at points, change %g <= %g counts/slice", boundary, interior + 2.0);
+  testOk(linearBoundary > linearInterior + 2.0, "Linear contour velocity jumps at points, change %g > %g counts/slice", linearBoundary, linearInterior + 2.0);
+
+  //Segment times not multiple of the slice still end on the profile end point
+  buildHermite(&buffer, PROFILE_PVT, oddSamples);
+  n = contourSlices(buffer, time, deltas, 256, &terminated);
+  pos[0] = pos[1] = 0;
+  for (i = 0; i < n; i++)
+     for (axis = 0; axis < 2; axis++)
+        pos[axis] += deltas[i][axis];
+  testOk(terminated && pos[0] == 4200 && pos[1] == 300, "Unaligned segment times end on profile end point %ld,%ld", pos[0], pos[1]);
+}
+
+//Contour profile slices are linear between points, and end exactly on the profile end point
+static void testContourEndpoints(void)
+{
+  GalilProfileBuffer buffer;
+  long time[256], t = 0, segStart = 0;
+  int deltas[256][2];
+  long pos[2] = {0, 0};
+  double start[2] = {0, 0}, s;
+  int n, i, axis, seg = 0;
+  bool terminated, linear = true;
+
+  buildHermite(&buffer, PROFILE_CONTOUR, hermiteSamples);
+  n = contourSlices(buffer, time, deltas, 256, &terminated);
+  for (i = 0; i < n; i++)
+     {
+     t += time[i];
+     if (t > segStart + hermiteSamples[seg])
+        {
+        segStart += hermiteSamples[seg];
+        start[0] += hermiteDeltas[seg][0];
+        start[1] += hermiteDeltas[seg][1];
+        seg++;
+        }
+     s = (double)(t - segStart) / hermiteSamples[seg];
+     for (axis = 0; axis < 2; axis++)
+        {
+        pos[axis] += deltas[i][axis];
+        if (pos[axis] != (long)rint(start[axis] + s * hermiteDeltas[seg][axis]))
+           linear = false;
+        }
+     }
+  testOk(linear, "Contour slices linear between points");
+  testOk(terminated && pos[0] == 4200 && pos[1] == 300, "Contour slices end on profile end point");
+}
+
+//Append linear segment taking segTime seconds on axis A, and B
+static void appendMove(GalilProfileBuffer *buffer, double a, double b, double segTime)
+{
+  double deltas[PROFILE_AXES] = {a, b};
+
+  buffer->append(deltas, sqrt(a * a + b * b) / segTime);
+}
+
+//Merge with segments split at rounded points, speed rounding, and merge limits
+static void testMerge(void)
+{
+  GalilProfileBuffer buffer;
+  double speeds[4] = {1000, 1001, 999, 1002};
+  double dev;
+  size_t i;
+
+  //Line 100001,50000 split in 3 at rounded points, speeds differ by rounding
+  buffer.allocate(1000);
+  buffer.setAxes("AB", zeros);
+  appendMove(&buffer, 33334, 16667, 1.0);
+  appendMove(&buffer, 33333, 16666, 1.0);
+  appendMove(&buffer, 33334, 16667, 1.0);
+  dev = buffer.merge(1.0);
+  testOk(buffer.segments() == 1 && buffer.delta(0, 0) == 100001 && buffer.delta(0, 1) == 50000 && dev <= 1.0,
+         "Odd split merged, end point exact, deviation %.3f", dev);
+  testOk(abs(buffer.speed(0) - 37268) <= 1, "Merged speed %d keeps run time", buffer.speed(0));
+
+  //Speed rounding within tolerance is merged, speed change beyond tolerance starts a new run
+  buffer.clear();
+  buffer.setAxes("AB", zeros);
+  for (i = 0; i < 4; i++)
+     appendMove(&buffer, speeds[i], 0, 1.0);
+  buffer.merge(1.0);
+  testOk(buffer.segments() == 2 && buffer.delta(0, 0) == 3000 && buffer.delta(1, 0) == 1002, "Speed rounding merged");
+  testOk(buffer.sourceSegment(0) == 0 && buffer.sourceSegment(1) == 3, "Merged segments map to appended segments");
+
+  //Merged deltas beyond segment storage are not merged
+  buffer.clear();
+  buffer.setAxes("AB", zeros);
+  appendMove(&buffer, 2000000000, 0, 1.0);
+  appendMove(&buffer, 2000000000, 0, 1.0);
+  buffer.merge(1.0);
+  testOk(buffer.segments() == 2 && buffer.delta(1, 0) == 2000000000, "Deltas beyond INT_MAX not merged");
+
+  //Zero length segments have no time, and arent merged with each other
+  buffer.clear();
+  buffer.setAxes("AB", zeros);
+  for (i = 0; i < 3; i++)
+     appendMove(&buffer, 0, 0, 1.0);
+  dev = buffer.merge(1.0);
+  testOk(buffer.segments() == 3 && buffer.speed(0) == 0 && dev == 0.0, "Zero length segments kept");
+
+  //Reversal within tolerance would merge to a segment that doesnt move
+  buffer.clear();
+  buffer.setAxes("AB", zeros);
+  appendMove(&buffer, 50, 0, 1.0);
+  appendMove(&buffer, -50, 0, 1.0);
+  dev = buffer.merge(100.0);
+  testOk(buffer.segments() == 2 && buffer.delta(0, 0) == 50 && buffer.speed(1) == 50 && dev == 0.0, "Reversal not merged to zero length");
+
+  //Merged speed rounding to 0 is not merged
+  buffer.clear();
+  buffer.setAxes("AB", zeros);
+  appendMove(&buffer, 2, 0, 2.0);
+  appendMove(&buffer, -1, 0, 1.0);
+  buffer.merge(100.0);
+  testOk(buffer.segments() == 2 && buffer.speed(0) == 1 && buffer.speed(1) == 1, "Merged speed below 1 not merged");
+
+  //Runs are limited to PROFILE_MERGE_MAX segments
+  buffer.clear();
+  buffer.setAxes("AB", zeros);
+  for (i = 0; i < 600; i++)
+     appendMove(&buffer, 10, 10, 0.001);
+  buffer.merge(1.0);
+  testOk(buffer.segments() == 3 && buffer.delta(0, 0) == 10 * PROFILE_MERGE_MAX && buffer.delta(2, 1) == 10 * (600 - 2 * PROFILE_MERGE_MAX),
+         "600 segments merged to 3");
+  testOk(buffer.sourceSegment(1) == PROFILE_MERGE_MAX && buffer.sourceSegment(2) == 2 * PROFILE_MERGE_MAX, "Run starts map to appended segments");
+
+  //Tolerance 0 merges only exact lines
+  buffer.clear();
+  buffer.setAxes("AB", zeros);
+  appendMove(&buffer, 300, 100, 0.1);
+  appendMove(&buffer, 300, 100, 0.1);
+  appendMove(&buffer, 300, 101, 0.1);
+  dev = buffer.merge(0.0);
+  testOk(buffer.segments() == 2 && dev == 0.0 && buffer.sourceSegment(1) == 2, "Tolerance 0 merges exact line only");
+  dev = buffer.merge(1.0);
+  testOk(buffer.segments() == 1 && buffer.delta(0, 1) == 301 && dev > 0.0 && dev <= 1.0, "Merge again, deviation %.3f", dev);
+}
+
+//Fixed link model, 2ms round trip, linear segments streamed as LI commands
+static const GalilStreamModel linkModel = {0.002, 0.001, 511, 0, 80, 12, false};
+
+//Linear profile of n identical segments taking segTime seconds each
+static void buildStream(GalilProfileBuffer *buffer, size_t n, double segTime)
+{
+  double deltas[PROFILE_AXES] = {1000, -1000};
+  size_t i;
+
+  buffer->allocate(n);
+  buffer->setAxes("AB", zeros);
+  for (i = 0; i < n; i++)
+     buffer->append(deltas, sqrt(2.0) * 1000 / segTime);
+  buffer->setType(PROFILE_LINEAR);
+}
+
+//Slow profile streams, buffered segments never run out
+static void testStreamFeasible(void)
+{
+  GalilProfileBuffer buffer;
+  double failTime;
+
+  buildStream(&buffer, 5000, 0.01);
+  testOk(buffer.simulateStream(&linkModel, 1.0, &failTime) == -1 && failTime == 0.0, "10ms segments can be streamed");
+  testOk(buffer.streamTimeScale(&linkModel, 64.0) == 1.0, "No time scaling needed");
+}
+
+//Fast profile runs out of buffered segments after the initial buffer is consumed
+static void testStreamFails(void)
+{
+  GalilProfileBuffer buffer;
+  double failTime;
+  long fail;
+
+  buildStream(&buffer, 5000, 0.0002);
+  fail = buffer.simulateStream(&linkModel, 1.0, &failTime);
+  testOk(fail >= linkModel.bufferSize && fail < 5000, "0.2ms segments fall behind at segment %ld", fail);
+  testOk(fabs(failTime - fail * 0.0002) < 0.0002 + linkModel.rtt, "Fail time %.4f matches segment %ld", failTime, fail);
+  testOk(buffer.streamTimeScale(&linkModel, 1.5) == 0.0, "Cant be streamed at largest scale");
+}
+
+//Bisection finds the smallest time scale to 1%
+static void testStreamBisect(void)
+{
+  GalilProfileBuffer buffer;
+  double failTime;
+  double scale;
+
+  buildStream(&buffer, 5000, 0.0002);
+  scale = buffer.streamTimeScale(&linkModel, 64.0);
+  testDiag("Time scale %.3f", scale);
+  testOk(scale > 1.0 && buffer.simulateStream(&linkModel, scale, &failTime) == -1, "Profile streams at scale %.3f", scale);
+  testOk(buffer.simulateStream(&linkModel, scale - 0.02, &failTime) >= 0, "Profile falls behind at scale %.3f", scale - 0.02);
+}
+
+MAIN(galilProfileBufferTest)
+{
+  testPlan(52);
+  testStorage();
+  testAppend();
+  testFormat();
+  testPVTCommands();
+  testExport();
+  testBuildLinear();
+  testPVTEndpoints();
+  testPVTContour();
+  testContourEndpoints();
+  testMerge();
+  testStreamFeasible();
+  testStreamFails();
+  testStreamBisect();
+  return testDone();
+}
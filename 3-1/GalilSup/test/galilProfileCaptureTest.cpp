@@ -0,0 +1,126 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilProfileCapture unit tests
+
+#include <stdio.h>
+#include <math.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilProfileCapture.h"
+
+//Add record with encoder, aux encoder, and error derived from time
+static void addRecord(GalilProfileCapture *capture, unsigned time, int value)
+{
+  int tp[PROFILE_AXES], td[PROFILE_AXES], te[PROFILE_AXES];
+  int j;
+
+  for (j = 0; j < PROFILE_AXES; j++)
+     {
+     tp[j] = value + j;
+     td[j] = 2 * value;
+     te[j] = -value;
+     }
+  capture->add(time, tp, td, te);
+}
+
+//Records only captured whilst active
+static void testActive(void)
+{
+  GalilProfileCapture capture;
+
+  addRecord(&capture, 0, 0);
+  testOk(!capture.active() && capture.records() == 0, "Not active before allocate");
+  testOk(capture.allocate(100), "Allocate 100 records");
+  addRecord(&capture, 0, 0);
+  testOk(capture.records() == 0, "Not active before start");
+  capture.start("AB");
+  addRecord(&capture, 0, 0);
+  addRecord(&capture, 8, 8);
+  capture.stop();
+  addRecord(&capture, 16, 16);
+  testOk(capture.records() == 2 && !capture.active(), "Records captured between start, and stop only");
+  capture.start("C");
+  testOk(capture.records() == 0 && capture.axes()[0] == 'C', "Start discards previous capture");
+}
+
+//Interpolation between records, and outside capture
+static void testValue(void)
+{
+  GalilProfileCapture capture;
+  unsigned i;
+
+  capture.allocate(100);
+  capture.start("AB");
+  for (i = 0; i < 10; i++)
+     addRecord(&capture, 1000 + 8 * i, 8 * i);
+  testOk(capture.value(CAPTURE_TP, 1, 12.0) == 13.0, "Encoder interpolated %g", capture.value(CAPTURE_TP, 1, 12.0));
+  testOk(capture.value(CAPTURE_TD, 0, 12.0) == 24.0 && capture.value(CAPTURE_TE, 0, 12.0) == -12.0, "Aux encoder, and error interpolated");
+  testOk(capture.value(CAPTURE_TP, 0, -5.0) == 0.0 && capture.value(CAPTURE_TP, 0, 500.0) == 72.0, "First, and last record used outside capture");
+  capture.setStart(1016);
+  testOk(capture.started() && capture.value(CAPTURE_TP, 0, 4.0) == 20.0, "Aligned to profile start %g", capture.value(CAPTURE_TP, 0, 4.0));
+  capture.setStart(990);
+  testOk(capture.value(CAPTURE_TP, 0, 10.0) == 0.0 && capture.value(CAPTURE_TP, 0, 14.0) == 4.0, "Profile start before first record");
+}
+
+//Sample counter wrap
+static void testWrap(void)
+{
+  GalilProfileCapture capture;
+  unsigned i;
+
+  capture.allocate(100);
+  capture.start("A");
+  for (i = 0; i < 20; i++)
+     addRecord(&capture, (65500 + 8 * i) & 0xFFFF, 8 * i);
+  capture.setStart(65532);
+  testOk(capture.value(CAPTURE_TP, 0, 0.0) == 32.0 && capture.value(CAPTURE_TP, 0, 100.0) == 132.0, "Sample counter wrap");
+  capture.setStart(60);
+  testOk(capture.value(CAPTURE_TP, 0, 0.0) == 96.0, "Profile start after wrap");
+}
+
+//Storage full, records are decimated and capture spans the whole profile
+static void testDecimate(void)
+{
+  GalilProfileCapture capture;
+  bool linear = true;
+  unsigned i;
+
+  capture.allocate(64);
+  capture.start("A");
+  for (i = 0; i < 1000; i++)
+     addRecord(&capture, (8 * i) & 0xFFFF, 8 * i);
+  testOk(capture.records() <= 64 && capture.records() >= 32, "%u records kept of 1000", (unsigned)capture.records());
+  testOk(capture.value(CAPTURE_TP, 0, 0.0) == 0.0 && capture.value(CAPTURE_TP, 0, 7900.0) == 7900.0, "Capture spans profile");
+  for (i = 0; i < 7900; i += 37)
+     if (fabs(capture.value(CAPTURE_TP, 0, i) - i) > 1e-9)
+        linear = false;
+  testOk(linear, "Decimated records keep their times");
+}
+
+MAIN(galilProfileCaptureTest)
+{
+  testPlan(15);
+  testActive();
+  testValue();
+  testWrap();
+  testDecimate();
+  return testDone();
+}
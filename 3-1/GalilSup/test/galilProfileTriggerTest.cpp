@@ -0,0 +1,253 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilProfileTrigger unit tests
+// Armed profile arm, and trigger ordering.  Execute, armed, abort, and input events are applied in every order
+// up to SEQUENCE_LENGTH, and checked against a reference model of when begin is sent
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilProfileTrigger.h"
+
+//Longest event sequence checked against the model
+#define SEQUENCE_LENGTH 6
+
+//Events the profile sees after an armed execute is accepted
+enum triggerEvent {
+  EVENT_EXECUTE,	//Execute received by triggerProfile
+  EVENT_READY,		//Profile thread has armed the profile
+  EVENT_ABORT,		//Abort received by abortProfile
+  EVENT_INPUT,		//Input trigger began the profile
+  EVENTS
+};
+
+//Reference model, what the profile has seen so far
+struct TriggerModel {
+  bool executed;	//Execute accepted
+  bool ready;		//Profile thread armed the profile
+  bool aborted;		//Aborted before begin
+  bool begun;		//Begin sent, or input began the profile
+  int begins;		//Begin commands sent
+};
+
+//Expected action for event, and update model
+static profileTriggerAction modelEvent(TriggerModel *m, int event)
+{
+  switch (event)
+     {
+     case EVENT_EXECUTE:
+        if (m->executed || m->aborted || m->begun)
+           return TRIGGER_REJECT;
+        m->executed = true;
+        if (!m->ready)
+           return TRIGGER_WAIT;
+        m->begun = true;
+        m->begins++;
+        return TRIGGER_BEGIN;
+     case EVENT_READY:
+        if (m->aborted)
+           return TRIGGER_ABORT;
+        if (m->ready)
+           return TRIGGER_REJECT;
+        m->ready = true;
+        if (!m->executed)
+           return TRIGGER_WAIT;
+        m->begun = true;
+        m->begins++;
+        return TRIGGER_BEGIN;
+     case EVENT_ABORT:
+        if (!m->begun)
+           m->aborted = true;
+        return TRIGGER_WAIT;
+     default:
+        if (m->ready && !m->aborted && !m->begun)
+           m->begun = true;
+        return TRIGGER_WAIT;
+     }
+}
+
+//Apply event to trigger
+static profileTriggerAction applyEvent(GalilProfileTrigger *trigger, int event)
+{
+  switch (event)
+     {
+     case EVENT_EXECUTE:
+        return trigger->execute();
+     case EVENT_READY:
+        return trigger->ready();
+     case EVENT_ABORT:
+        trigger->abort();
+        return TRIGGER_WAIT;
+     default:
+        trigger->inputBegan();
+        return TRIGGER_WAIT;
+     }
+}
+
+//Apply every event sequence up to SEQUENCE_LENGTH.  Returns sequences checked, counts mismatches
+static int checkSequences(int *mismatches, int *doubleBegins, int *beginsAfterAbort)
+{
+  GalilProfileTrigger trigger;
+  TriggerModel model;
+  int events[SEQUENCE_LENGTH];
+  int sequences = 0;
+  int length, code, i;
+  bool abortSeen;
+
+  *mismatches = *doubleBegins = *beginsAfterAbort = 0;
+  for (length = 1; length <= SEQUENCE_LENGTH; length++)
+     {
+     int total = 1;
+     for (i = 0; i < length; i++)
+        total *= EVENTS;
+     for (code = 0; code < total; code++)
+        {
+        int rest = code;
+        for (i = 0; i < length; i++)
+           {
+           events[i] = rest % EVENTS;
+           rest /= EVENTS;
+           }
+        trigger.start(true);
+        model.executed = model.ready = model.aborted = model.begun = false;
+        model.begins = 0;
+        abortSeen = false;
+        bool match = true;
+        for (i = 0; i < length; i++)
+           {
+           profileTriggerAction expected = modelEvent(&model, events[i]);
+           profileTriggerAction action = applyEvent(&trigger, events[i]);
+           if (action != expected)
+              match = false;
+           if (action == TRIGGER_BEGIN && abortSeen)
+              (*beginsAfterAbort)++;
+           if (events[i] == EVENT_ABORT)
+              abortSeen = true;
+           }
+        if (trigger.aborted() != model.aborted || trigger.waiting() != (model.ready && !model.aborted && !model.begun))
+           match = false;
+        if (!match)
+           (*mismatches)++;
+        if (model.begins > 1)
+           (*doubleBegins)++;
+        sequences++;
+        }
+     }
+  return sequences;
+}
+
+MAIN(galilProfileTriggerTest)
+{
+  testPlan(21);
+
+  //Profile not armed, execute whilst executing is rejected
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(false);
+     testOk(!trigger.arm() && trigger.state() == TRIGGER_IDLE, "Unarmed profile starts idle");
+     testOk(trigger.execute() == TRIGGER_REJECT, "Execute whilst unarmed profile executes is rejected");
+  }
+
+  //Execute whilst armed begins now, once
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     testOk(trigger.arm() && trigger.state() == TRIGGER_ARMING, "Armed profile starts arming");
+     testOk(trigger.ready() == TRIGGER_WAIT && trigger.waiting(), "Armed profile waits for trigger");
+     testOk(trigger.execute() == TRIGGER_BEGIN && !trigger.waiting(), "Execute whilst armed begins");
+     testOk(trigger.execute() == TRIGGER_REJECT, "Second execute is rejected");
+  }
+
+  //Execute whilst arming begins once armed
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     testOk(trigger.execute() == TRIGGER_WAIT && trigger.state() == TRIGGER_PENDING, "Execute whilst arming is pending");
+     testOk(trigger.execute() == TRIGGER_REJECT, "Second execute whilst arming is rejected");
+     testOk(trigger.ready() == TRIGGER_BEGIN && trigger.state() == TRIGGER_BEGUN, "Pending execute begins once armed");
+  }
+
+  //Abort whilst armed, execute that follows doesnt begin
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     trigger.ready();
+     trigger.abort();
+     testOk(trigger.aborted() && !trigger.waiting(), "Abort whilst armed stops waiting");
+     testOk(trigger.execute() == TRIGGER_REJECT, "Execute after abort whilst armed is rejected");
+  }
+
+  //Abort after execute whilst arming, profile doesnt begin once armed
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     trigger.execute();
+     trigger.abort();
+     testOk(trigger.ready() == TRIGGER_ABORT, "Abort after execute whilst arming doesnt begin");
+  }
+
+  //Abort whilst arming
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     trigger.abort();
+     testOk(trigger.ready() == TRIGGER_ABORT && !trigger.waiting(), "Abort whilst arming doesnt arm");
+  }
+
+  //Input began the profile, execute that follows is rejected, abort leaves it begun
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     trigger.ready();
+     trigger.inputBegan();
+     testOk(trigger.state() == TRIGGER_BEGUN && !trigger.waiting(), "Input trigger begins armed profile");
+     testOk(trigger.execute() == TRIGGER_REJECT, "Execute after input trigger is rejected");
+     trigger.abort();
+     testOk(!trigger.aborted(), "Abort after begin is left to the profile stream");
+  }
+
+  //Input before armed is ignored
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     trigger.inputBegan();
+     testOk(trigger.state() == TRIGGER_ARMING, "Input whilst arming is ignored");
+  }
+
+  //Next execute starts again
+  {
+     GalilProfileTrigger trigger;
+     trigger.start(true);
+     trigger.abort();
+     trigger.start(true);
+     testOk(!trigger.aborted() && trigger.state() == TRIGGER_ARMING, "Execute after abort starts arming again");
+  }
+
+  //Every event order up to SEQUENCE_LENGTH against the model
+  {
+     int mismatches, doubleBegins, beginsAfterAbort;
+     int sequences = checkSequences(&mismatches, &doubleBegins, &beginsAfterAbort);
+     testDiag("%d event sequences checked", sequences);
+     testOk(mismatches == 0, "Trigger matches model for every sequence (%d mismatches)", mismatches);
+     testOk(doubleBegins == 0, "Begin sent at most once (%d sequences sent more)", doubleBegins);
+     testOk(beginsAfterAbort == 0, "Begin never sent after abort (%d sequences)", beginsAfterAbort);
+  }
+
+  return testDone();
+}
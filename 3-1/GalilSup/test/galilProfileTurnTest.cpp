@@ -0,0 +1,142 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilProfileTurn unit tests
+// Stream threads send command lines by appending to a log whilst holding the connection lock
+
+#include <stdio.h>
+
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "GalilProfileTurn.h"
+
+//Command lines each stream sends
+#define LINES 200
+//Longest wait for other stream.  Long, so a missed wake up shows in elapsed time
+#define TURN_TIMEOUT 1.0
+
+//Connection lock
+class TestLock : public GalilTurnLock {
+public:
+  TestLock() { mutex_ = epicsMutexMustCreate(); }
+  ~TestLock() { epicsMutexDestroy(mutex_); }
+  void lock(void) { epicsMutexLock(mutex_); }
+  void unlock(void) { epicsMutexUnlock(mutex_); }
+private:
+  epicsMutexId mutex_;
+};
+
+//Command lines sent, in order.  Appended with connection lock
+static char sent[PROFILE_TURN_STREAMS * LINES];
+static int nsent;
+
+struct Stream {
+  GalilProfileTurn *turns;	//Turn taking under test
+  int index;			//Stream number
+  int yields;			//Times stream waited for the other stream
+  epicsEventId done;		//Signalled when all lines are sent
+};
+
+//Send LINES command lines, yielding after each
+static void streamThread(void *arg)
+{
+  Stream *stream = (Stream *)arg;
+  int i;
+
+  stream->turns->lock(stream->index);
+  for (i = 0; i < LINES; i++)
+     {
+     sent[nsent++] = (char)('S' + stream->index);
+     if (stream->turns->yield(stream->index))
+        stream->yields++;
+     }
+  stream->turns->unlock(stream->index);
+  epicsEventSignal(stream->done);
+}
+
+static void startStream(Stream *stream, GalilProfileTurn *turns, int index)
+{
+  stream->turns = turns;
+  stream->index = index;
+  stream->yields = 0;
+  stream->done = epicsEventMustCreate(epicsEventEmpty);
+  epicsThreadCreate((index) ? "turnT" : "turnS", epicsThreadPriorityMedium,
+                    epicsThreadGetStackSize(epicsThreadStackSmall), streamThread, stream);
+}
+
+//Stream alone never waits
+static void testSingle(void)
+{
+  TestLock connection;
+  GalilProfileTurn turns(&connection, TURN_TIMEOUT);
+  Stream stream;
+  epicsTimeStamp begint, endt;
+
+  nsent = 0;
+  epicsTimeGetCurrent(&begint);
+  startStream(&stream, &turns, 0);
+  epicsEventWait(stream.done);
+  epicsTimeGetCurrent(&endt);
+  testOk(nsent == LINES && stream.yields == 0, "Stream alone sent %d lines without yielding", nsent);
+  testOk(epicsTimeDiffInSeconds(&endt, &begint) < TURN_TIMEOUT, "Stream alone took %.3f s", epicsTimeDiffInSeconds(&endt, &begint));
+  epicsEventDestroy(stream.done);
+}
+
+//Streams sending together take turns, one command line each
+static void testTurns(void)
+{
+  TestLock connection;
+  GalilProfileTurn turns(&connection, TURN_TIMEOUT);
+  Stream stream[PROFILE_TURN_STREAMS];
+  epicsTimeStamp begint, endt;
+  int i, last, repeats = 0;
+
+  //Hold connection until both streams wait for it, so they start together
+  nsent = 0;
+  connection.lock();
+  for (i = 0; i < PROFILE_TURN_STREAMS; i++)
+     startStream(&stream[i], &turns, i);
+  epicsThreadSleep(0.1);
+  epicsTimeGetCurrent(&begint);
+  connection.unlock();
+  for (i = 0; i < PROFILE_TURN_STREAMS; i++)
+     epicsEventWait(stream[i].done);
+  epicsTimeGetCurrent(&endt);
+
+  testOk(nsent == PROFILE_TURN_STREAMS * LINES, "Streams sent %d lines", nsent);
+  //Lines alternate until the first stream has sent its last line
+  for (last = nsent - 1; last > 0 && sent[last] == sent[nsent - 1]; last--);
+  for (i = 1; i <= last; i++)
+     repeats += (sent[i] == sent[i - 1]) ? 1 : 0;
+  testOk(repeats == 0, "Streams took turns, %d lines sent twice in a row", repeats);
+  testOk(stream[0].yields > 0 && stream[1].yields > 0, "Both streams yielded, %d %d", stream[0].yields, stream[1].yields);
+  testOk(epicsTimeDiffInSeconds(&endt, &begint) < TURN_TIMEOUT, "Streams took %.3f s, no turn timed out", epicsTimeDiffInSeconds(&endt, &begint));
+  for (i = 0; i < PROFILE_TURN_STREAMS; i++)
+     epicsEventDestroy(stream[i].done);
+}
+
+MAIN(galilProfileTurnTest)
+{
+  testPlan(6);
+  testSingle();
+  testTurns();
+  return testDone();
+}
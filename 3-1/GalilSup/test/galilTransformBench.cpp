@@ -0,0 +1,326 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// Kinematic transform evaluation benchmark
+// Usage: galilTransformBench [evaluations] [cycles]
+// Edits are run as many times as poll cycles
+// Without arguments 1,000,000 evaluations of each expression, 10,000 poll cycles, and 10,000 edits are run
+// Native is GalilTransform::evaluate, cached is sCalcPerform over postfix compiled once, as before native compilation
+// Poll cycles evaluate forward transforms for 8 CS axes, and report cost per cycle against a 1 kHz poll period
+// Recompile is sCalcPostfix, and sCalcPerform every evaluation, as doCalc did before postfix was cached
+// Batch is GalilTransform::evaluateBatch over all CS axes, as GalilController::batchForwardTransforms runs it
+// Poll cycles are run with mixed transforms, and with transforms of the same program shape that share batch passes
+// Edits change one forward transform in a 16 CS axis configuration, two controllers of 8 CS axes
+// Full edit compiles every CS axis transforms, as writeOctet did, affected edit compiles only the edited CS axis
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+extern "C" {
+#include "sCalcPostfix.h"
+}
+
+#include "GalilTransform.h"
+
+//Representative CS axis transforms
+//Linear combination, two link arm, and trigonometric forward, reverse kinematics
+static const char *expressions[] = {
+  "(A+B)/2",
+  "A-B",
+  "0.25*(A+B+C+D)",
+  "300*COS(A*D2R)+250*COS((A+B)*D2R)",
+  "ATAN((250*SIN(B*D2R))/(300+250*COS(B*D2R)))*R2D",
+  "SQRT(SQR(A)+SQR(B))",
+  "MAX(A,B)-MIN(C,D)+ABS(E)"
+};
+
+#define EXPRESSIONS (sizeof(expressions) / sizeof(expressions[0]))
+
+//Forward transforms of the same program shape, for 8 CS axes
+static const char *matched[] = {
+  "(A+B)/2", "(C+D)/2", "(E+F)/2", "(G+H)/2",
+  "(A+C)/2", "(B+D)/2", "(E+G)/2", "(F+H)/2"
+};
+
+//CS axes evaluated each poll cycle
+#define POLL_CSAXES 8
+//Poll period, seconds
+#define POLL_PERIOD 0.001
+//CS axes in edit configuration
+#define EDIT_CSAXES 16
+//Reverse transforms per CS axis in edit configuration
+#define EDIT_REVERSES 2
+
+static double seconds(clock_t begin)
+{
+  return (double)(clock() - begin) / CLOCKS_PER_SEC;
+}
+
+//Vary arguments between evaluations so results are not reused
+static void setArgs(double args[], long i)
+{
+  int k;
+
+  for (k = 0; k < TRANSFORM_ARGS; k++)
+     args[k] = 10.0 + 0.001 * (i % 1000) + k;
+}
+
+//Time native, and cached sCalcPerform evaluation of one expression
+//Returns native time per evaluation in seconds, or 0 on failure
+static double bench(const char *expr, long evaluations)
+{
+  GalilTransform calc;
+  unsigned char rpn[KINEMATIC_RPN_SIZE];
+  double args[TRANSFORM_ARGS];
+  double result, sum = 0.0;
+  double native, cached;
+  clock_t begin;
+  short err;
+  long i;
+
+  if (!calc.compile(expr) || sCalcPostfix(expr, rpn, &err))
+     {
+     printf("Cannot compile %s\n", expr);
+     return 0.0;
+     }
+
+  //Native
+  begin = clock();
+  for (i = 0; i < evaluations; i++)
+     {
+     setArgs(args, i);
+     calc.evaluate(args, &result);
+     sum += result;
+     }
+  native = seconds(begin);
+
+  //Cached postfix
+  begin = clock();
+  for (i = 0; i < evaluations; i++)
+     {
+     setArgs(args, i);
+     sCalcPerform(args, TRANSFORM_ARGS, NULL, 0, &result, NULL, 0, rpn, 6);
+     sum += result;
+     }
+  cached = seconds(begin);
+
+  printf("%-50s %s %8.1f ns  cached %8.1f ns  %5.1fx  (%g)\n", expr, (calc.native()) ? "native" : "sCalc ",
+         native * 1e9 / evaluations, cached * 1e9 / evaluations, (native > 0.0) ? cached / native : 0.0, sum);
+  return native / evaluations;
+}
+
+//Print poll cycle cost, and share of poll period
+static void report(const char *name, double total, long cycles)
+{
+  double cycle = total / cycles;
+
+  printf("%-10s %8.2f us/cycle  %6.2f%% of %g ms period\n", name, cycle * 1e6, 100.0 * cycle / POLL_PERIOD,
+         POLL_PERIOD * 1e3);
+}
+
+//Forward transforms for POLL_CSAXES CS axes each poll cycle
+//Real axis readbacks are packed once per cycle, as GalilController::buildKinematicSnapshot does
+//Returns 0 on success
+static int pollBench(const char *name, const char *expr[], long cycles)
+{
+  GalilTransform calc[POLL_CSAXES];
+  unsigned char rpn[POLL_CSAXES][KINEMATIC_RPN_SIZE];
+  const GalilTransform *batch[POLL_CSAXES];
+  double *batchArgs[POLL_CSAXES];
+  double batchResult[POLL_CSAXES];
+  bool done[POLL_CSAXES];
+  double reg[MAX_TRANSFORM_NODES * TRANSFORM_BATCH];
+  double args[TRANSFORM_ARGS];
+  double result, sum = 0.0;
+  clock_t begin;
+  short err;
+  long i;
+  int k;
+
+  for (k = 0; k < POLL_CSAXES; k++)
+     {
+     batch[k] = &calc[k];
+     batchArgs[k] = args;
+     if (!calc[k].compile(expr[k]) || sCalcPostfix(expr[k], rpn[k], &err))
+        {
+        printf("Cannot compile %s\n", expr[k]);
+        return -1;
+        }
+     }
+
+  printf("%ld poll cycles, %d CS axes %s forward transforms\n", cycles, POLL_CSAXES, name);
+
+  //Recompile every evaluation
+  begin = clock();
+  for (i = 0; i < cycles; i++)
+     {
+     setArgs(args, i);
+     for (k = 0; k < POLL_CSAXES; k++)
+        {
+        unsigned char local[KINEMATIC_RPN_SIZE];
+        sCalcPostfix(expr[k], local, &err);
+        sCalcPerform(args, TRANSFORM_ARGS, NULL, 0, &result, NULL, 0, local, 6);
+        sum += result;
+        }
+     }
+  report("Recompile", seconds(begin), cycles);
+
+  //Cached postfix
+  begin = clock();
+  for (i = 0; i < cycles; i++)
+     {
+     setArgs(args, i);
+     for (k = 0; k < POLL_CSAXES; k++)
+        {
+        sCalcPerform(args, TRANSFORM_ARGS, NULL, 0, &result, NULL, 0, rpn[k], 6);
+        sum += result;
+        }
+     }
+  report("Cached", seconds(begin), cycles);
+
+  //Native
+  begin = clock();
+  for (i = 0; i < cycles; i++)
+     {
+     setArgs(args, i);
+     for (k = 0; k < POLL_CSAXES; k++)
+        {
+        calc[k].evaluate(args, &result);
+        sum += result;
+        }
+     }
+  report("Native", seconds(begin), cycles);
+
+  //Batch, every CS axis shares the cycle's packed arguments
+  begin = clock();
+  for (i = 0; i < cycles; i++)
+     {
+     setArgs(args, i);
+     GalilTransform::evaluateBatch(batch, batchArgs, batchResult, done, POLL_CSAXES, reg);
+     for (k = 0; k < POLL_CSAXES; k++)
+        {
+        if (!done[k])
+           calc[k].evaluate(args, &batchResult[k]);
+        sum += batchResult[k];
+        }
+     }
+  report("Batch", seconds(begin), cycles);
+
+  printf("(%g)\n", sum);
+  return 0;
+}
+
+//Compile forward, and reverse transforms of one CS axis, as GalilCSAxis::parseTransforms does
+static void compileAxis(GalilTransform calc[], const char *forward, const char *reverse[])
+{
+  int k;
+
+  calc[0].compile(forward);
+  for (k = 0; k < EDIT_REVERSES; k++)
+     calc[k + 1].compile(reverse[k]);
+}
+
+//Edit one forward transform in an EDIT_CSAXES configuration
+//Returns 0 on success
+static int editBench(long edits)
+{
+  GalilTransform calc[EDIT_CSAXES][EDIT_REVERSES + 1];
+  char forward[EDIT_CSAXES][64];
+  char reverse[EDIT_CSAXES][EDIT_REVERSES][64];
+  const char *rev[EDIT_REVERSES];
+  double full, affected;
+  clock_t begin;
+  long i;
+  int j, k;
+
+  //Two link arm on real axis pairs, reverse transforms in the CS axis
+  for (j = 0; j < EDIT_CSAXES; j++)
+     {
+     sprintf(forward[j], "300*COS(%c*D2R)+250*COS((%c+%c)*D2R)", 'A' + j % 8, 'A' + j % 8, 'A' + (j + 1) % 8);
+     for (k = 0; k < EDIT_REVERSES; k++)
+        sprintf(reverse[j][k], "ATAN(%c/%c)*R2D+%d", 'I' + j % 8, 'I' + (j + k + 1) % 8, k);
+     }
+
+  //Full, every CS axis compiled again
+  begin = clock();
+  for (i = 0; i < edits; i++)
+     {
+     forward[i % EDIT_CSAXES][0] = (i & 1) ? '3' : '2';
+     for (j = 0; j < EDIT_CSAXES; j++)
+        {
+        for (k = 0; k < EDIT_REVERSES; k++)
+           rev[k] = reverse[j][k];
+        compileAxis(calc[j], forward[j], rev);
+        }
+     }
+  full = seconds(begin);
+
+  //Affected, only the edited CS axis compiled again
+  begin = clock();
+  for (i = 0; i < edits; i++)
+     {
+     j = i % EDIT_CSAXES;
+     forward[j][0] = (i & 1) ? '3' : '2';
+     for (k = 0; k < EDIT_REVERSES; k++)
+        rev[k] = reverse[j][k];
+     compileAxis(calc[j], forward[j], rev);
+     }
+  affected = seconds(begin);
+
+  printf("%ld edits, %d CS axes, %d reverse transforms each\n", edits, EDIT_CSAXES, EDIT_REVERSES);
+  printf("Full       %8.2f us/edit\n", full * 1e6 / edits);
+  printf("Affected   %8.2f us/edit  %5.1fx\n", affected * 1e6 / edits, (affected > 0.0) ? full / affected : 0.0);
+  return (calc[0][0].compiled()) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+  long evaluations = 1000000;
+  long cycles = 10000;
+  const char *mixed[POLL_CSAXES];
+  unsigned i;
+
+  if (argc > 1)
+     {
+     evaluations = atol(argv[1]);
+     cycles = (argc > 2) ? atol(argv[2]) : cycles;
+     if (evaluations < 1 || cycles < 1)
+        {
+        printf("Usage: galilTransformBench [evaluations] [cycles]\n");
+        return 1;
+        }
+     }
+
+  printf("%ld evaluations per expression, time per evaluation\n", evaluations);
+  for (i = 0; i < EXPRESSIONS; i++)
+     if (bench(expressions[i], evaluations) <= 0.0)
+        return 1;
+  for (i = 0; i < POLL_CSAXES; i++)
+     mixed[i] = expressions[i % EXPRESSIONS];
+  printf("\n");
+  if (pollBench("mixed", mixed, cycles))
+     return 1;
+  printf("\n");
+  if (pollBench("matched shape", matched, cycles))
+     return 1;
+  printf("\n");
+  return (editBench(cycles)) ? 1 : 0;
+}
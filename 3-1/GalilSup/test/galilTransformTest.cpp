@@ -0,0 +1,381 @@
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// Licence as published by the Free Software Foundation; either
+// version 2.1 of the Licence, or (at your option) any later version.
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public Licence for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// Licence along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Contact details:
+// mark.clift@synchrotron.org.au
+// 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+//
+// GalilTransform unit tests
+// Native results, and derivatives are checked against reference functions written in C
+// Native results are checked against sCalcPerform over a seeded corpus of random expressions
+
+#if defined _WIN32 || _WIN64
+#define _USE_MATH_DEFINES
+#endif /* _WIN32/_WIN64 */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+extern "C" {
+#include "sCalcPostfix.h"
+}
+
+#include "GalilTransform.h"
+
+//Relative tolerance for native, and reference results
+#define TOLERANCE 1e-12
+//Relative tolerance for central difference derivatives
+#define DIFF_TOLERANCE 1e-6
+//Random expressions in fuzz corpus, and argument sets each is evaluated with
+#define FUZZ_EXPRESSIONS 5000
+#define FUZZ_ARG_SETS 4
+//Fuzz expression nesting depth
+#define FUZZ_DEPTH 4
+
+static bool close(double x, double y, double tolerance)
+{
+  return fabs(x - y) <= tolerance * ((fabs(y) > 1.0) ? fabs(y) : 1.0);
+}
+
+//Argument sets used for evaluation
+static void setArgs(double args[], unsigned set)
+{
+  unsigned i;
+
+  for (i = 0; i < TRANSFORM_ARGS; i++)
+     args[i] = 0.25 + 0.5 * i + 0.37 * set;
+}
+
+//Reference functions, and their partial derivative wrt A, and B
+typedef struct {
+  const char *expr;
+  double (*f)(const double *x);
+  double (*dfa)(const double *x);
+  double (*dfb)(const double *x);
+} Reference;
+
+static double f0(const double *x) { return x[0] + 2.0 * x[1]; }
+static double f0a(const double *) { return 1.0; }
+static double f0b(const double *) { return 2.0; }
+static double f1(const double *x) { return x[0] * cos(x[1]) - x[2]; }
+static double f1a(const double *x) { return cos(x[1]); }
+static double f1b(const double *x) { return -x[0] * sin(x[1]); }
+static double f2(const double *x) { return sqrt(x[0] * x[0] + x[1] * x[1]); }
+static double f2a(const double *x) { return x[0] / f2(x); }
+static double f2b(const double *x) { return x[1] / f2(x); }
+static double f3(const double *x) { return atan(x[1] / x[0]) * 180.0 / M_PI; }
+static double f3a(const double *x) { return -x[1] / (x[0] * x[0] + x[1] * x[1]) * 180.0 / M_PI; }
+static double f3b(const double *x) { return x[0] / (x[0] * x[0] + x[1] * x[1]) * 180.0 / M_PI; }
+static double f4(const double *x) { return pow(x[0], 3.0) / x[1] + exp(-x[1]); }
+static double f4a(const double *x) { return 3.0 * x[0] * x[0] / x[1]; }
+static double f4b(const double *x) { return -pow(x[0], 3.0) / (x[1] * x[1]) - exp(-x[1]); }
+static double f5(const double *x) { return log(x[0]) + log10(x[1]) + sinh(x[0] - x[1]); }
+static double f5a(const double *x) { return 1.0 / x[0] + cosh(x[0] - x[1]); }
+static double f5b(const double *x) { return 1.0 / (x[1] * log(10.0)) - cosh(x[0] - x[1]); }
+
+static const Reference references[] = {
+  {"A+2*B", f0, f0a, f0b},
+  {"A*COS(B)-C", f1, f1a, f1b},
+  {"SQRT(A*A+B*B)", f2, f2a, f2b},
+  {"ATAN(B/A)*R2D", f3, f3a, f3b},
+  {"A^3/B+EXP(-B)", f4, f4a, f4b},
+  {"LN(A)+LOG(B)+SINH(A-B)", f5, f5a, f5b}
+};
+
+#define REFERENCES (sizeof(references) / sizeof(references[0]))
+
+//Natively compiled expressions agree with reference, including symbolic derivatives
+static void testNative(void)
+{
+  GalilTransform calc;
+  double args[TRANSFORM_ARGS], dir[TRANSFORM_ARGS];
+  double result, derivA, derivB;
+  bool valueOk, derivOk;
+  unsigned i, set;
+
+  for (i = 0; i < REFERENCES; i++)
+     {
+     testOk(calc.compile(references[i].expr) && calc.native() && calc.symbolic(), "%s compiled natively", references[i].expr);
+     valueOk = derivOk = true;
+     for (set = 0; set < 4; set++)
+        {
+        setArgs(args, set);
+        if (calc.evaluate(args, &result) || !close(result, references[i].f(args), TOLERANCE))
+           valueOk = false;
+        memset(dir, 0, sizeof(dir));
+        dir[0] = 1.0;
+        calc.derivative(args, dir, &derivA);
+        dir[0] = 0.0;
+        dir[1] = 1.0;
+        calc.derivative(args, dir, &derivB);
+        if (!close(derivA, references[i].dfa(args), TOLERANCE) || !close(derivB, references[i].dfb(args), TOLERANCE))
+           derivOk = false;
+        }
+     testOk(valueOk, "%s value", references[i].expr);
+     testOk(derivOk, "%s symbolic derivative", references[i].expr);
+     }
+}
+
+//Arguments used, constant folding, and common subexpressions
+static void testProgram(void)
+{
+  GalilTransform calc, other;
+
+  calc.compile("A*COS(B)-C");
+  testOk(calc.argsUsed() == 0x7, "Arguments used A, B, C");
+  calc.compile("2*3+PI*0+D");
+  other.compile("6+D");
+  testOk(calc.length() == other.length(), "Constants folded, length %u", calc.length());
+  calc.compile("SIN(A)*SIN(A)+SIN(A)");
+  other.compile("SIN(A)*SIN(B)+SIN(C)");
+  testOk(calc.length() < other.length(), "Common subexpressions shared, length %u < %u", calc.length(), other.length());
+  calc.compile("MIN(A,B,C)+MAX(A,2)");
+  testOk(calc.native() && !calc.symbolic(), "MIN, MAX compiled natively without symbolic derivatives");
+}
+
+//Expressions left to sCalcPerform
+static void testFallback(void)
+{
+  GalilTransform calc;
+  double args[TRANSFORM_ARGS], dir[TRANSFORM_ARGS] = {0};
+  double result, deriv;
+
+  setArgs(args, 0);
+  testOk(calc.compile("-A^2") && !calc.native(), "Negated power left to sCalc");
+  testOk(calc.compile("A^B^C") && !calc.native(), "Chained power left to sCalc");
+  testOk(calc.compile("A>B?A:B") && !calc.native(), "Conditional left to sCalc");
+  testOk(calc.evaluate(args, &result) == 0 && result == args[1], "sCalc result %g", result);
+  dir[1] = 1.0;
+  testOk(calc.derivative(args, dir, &deriv) == 0 && close(deriv, 1.0, DIFF_TOLERANCE), "Central difference derivative %g", deriv);
+  testOk(!calc.compile("A+") && !calc.compiled() && calc.evaluate(args, &result) != 0, "Invalid expression rejected");
+}
+
+//Batch evaluation agrees with evaluate, lanes with different shapes, and non native lanes are handled
+static void testBatch(void)
+{
+  GalilTransform calc[TRANSFORM_BATCH];
+  const GalilTransform *pcalc[TRANSFORM_BATCH];
+  double args[TRANSFORM_BATCH][TRANSFORM_ARGS];
+  double *pargs[TRANSFORM_BATCH];
+  double result[TRANSFORM_BATCH], single;
+  bool done[TRANSFORM_BATCH];
+  double reg[MAX_TRANSFORM_NODES * TRANSFORM_BATCH];
+  const char *exprs[TRANSFORM_BATCH] = {"A*COS(B)-C", "E*COS(F)-G", "2*COS(A)-B", "SQRT(A*A+B*B)",
+                                        "A*COS(B)-1", "A>B?A:B", "SQRT(A*A+C*C)", "H*COS(I)-J"};
+  bool match = true, doneOk = true;
+  unsigned i;
+
+  for (i = 0; i < TRANSFORM_BATCH; i++)
+     {
+     calc[i].compile(exprs[i]);
+     pcalc[i] = &calc[i];
+     setArgs(args[i], i);
+     pargs[i] = args[i];
+     }
+  GalilTransform::evaluateBatch(pcalc, pargs, result, done, TRANSFORM_BATCH, reg);
+  for (i = 0; i < TRANSFORM_BATCH; i++)
+     {
+     if (done[i] != calc[i].native())
+        doneOk = false;
+     calc[i].evaluate(args[i], &single);
+     if (done[i] && result[i] != single)
+        match = false;
+     }
+  testOk(doneOk, "Batch evaluates native lanes only");
+  testOk(match, "Batch results identical to evaluate");
+
+  //Non finite native result is left to caller
+  calc[0].compile("SQRT(A)");
+  args[0][0] = -1.0;
+  GalilTransform::evaluateBatch(pcalc, pargs, result, done, 1, reg);
+  testOk(!done[0], "Non finite batch result not done");
+}
+
+//Cleared transform is not evaluated, and batch leaves it to the caller
+static void testClear(void)
+{
+  GalilTransform calc;
+  const GalilTransform *pcalc[1] = {&calc};
+  double args[TRANSFORM_ARGS], result, reg[MAX_TRANSFORM_NODES * TRANSFORM_BATCH];
+  double *pargs[1] = {args};
+  bool done[1];
+
+  setArgs(args, 0);
+  calc.compile("A*COS(B)-C");
+  calc.clear();
+  testOk(!calc.compiled() && !calc.native() && calc.argsUsed() == 0, "Clear discards compiled expression");
+  testOk(calc.evaluate(args, &result) != 0, "Cleared transform not evaluated");
+  GalilTransform::evaluateBatch(pcalc, pargs, &result, done, 1, reg);
+  testOk(!done[0], "Batch skips cleared transform");
+}
+
+//Fuzz corpus random number generator, seeded so failures can be reproduced
+static unsigned fuzzSeed;
+
+static unsigned fuzzRandom(unsigned n)
+{
+  fuzzSeed ^= fuzzSeed << 13;
+  fuzzSeed ^= fuzzSeed >> 17;
+  fuzzSeed ^= fuzzSeed << 5;
+  return fuzzSeed % n;
+}
+
+//Append random expression of at most depth levels to expr
+static void fuzzExpression(char *expr, size_t size, unsigned depth)
+{
+  static const char *leaves[] = {"2", "0.5", "3.25", "1e-3", "10", "PI", "D2R", "R2D"};
+  static const char *binary[] = {"+", "-", "*", "/"};
+  static const char *functions[] = {"ABS", "SQR", "SQRT", "EXP", "LOG", "LN", "LOGE", "SIN", "COS", "TAN",
+                                    "ASIN", "ACOS", "ATAN", "SINH", "COSH", "TANH", "CEIL", "FLOOR"};
+  static const char *powers[] = {"2", "3", "0.5", "-1", "B"};
+  size_t len = strlen(expr);
+  char arg[2] = {0};
+
+  if (len + 64 > size)
+     depth = 0;
+
+  switch ((depth) ? fuzzRandom(7) : fuzzRandom(2))
+     {
+     case 0:
+        //Argument A-P
+        arg[0] = (char)('A' + fuzzRandom(TRANSFORM_ARGS));
+        strcat(expr, arg);
+        break;
+     case 1:
+        strcat(expr, leaves[fuzzRandom(sizeof(leaves) / sizeof(leaves[0]))]);
+        break;
+     case 2:
+     case 3:
+        strcat(expr, "(");
+        fuzzExpression(expr, size, depth - 1);
+        strcat(expr, binary[fuzzRandom(sizeof(binary) / sizeof(binary[0]))]);
+        fuzzExpression(expr, size, depth - 1);
+        strcat(expr, ")");
+        break;
+     case 4:
+        strcat(expr, functions[fuzzRandom(sizeof(functions) / sizeof(functions[0]))]);
+        strcat(expr, "(");
+        fuzzExpression(expr, size, depth - 1);
+        strcat(expr, ")");
+        break;
+     case 5:
+        strcat(expr, (fuzzRandom(2)) ? "MIN(" : "MAX(");
+        fuzzExpression(expr, size, depth - 1);
+        strcat(expr, ",");
+        fuzzExpression(expr, size, depth - 1);
+        if (fuzzRandom(2))
+           {
+           strcat(expr, ",");
+           fuzzExpression(expr, size, depth - 1);
+           }
+        strcat(expr, ")");
+        break;
+     default:
+        if (fuzzRandom(2))
+           {
+           strcat(expr, "-");
+           fuzzExpression(expr, size, 0);
+           }
+        else
+           {
+           strcat(expr, "(");
+           fuzzExpression(expr, size, depth - 1);
+           strcat(expr, ")^");
+           strcat(expr, powers[fuzzRandom(sizeof(powers) / sizeof(powers[0]))]);
+           }
+        break;
+     }
+}
+
+//Results agree within 1 ulp
+static bool ulpClose(double x, double y)
+{
+  return x == y || nextafter(x, y) == y;
+}
+
+//Native results agree with sCalcPerform within 1 ulp, and evaluation fails where sCalcPerform fails
+static void testFuzz(void)
+{
+  GalilTransform calc;
+  char expr[256];
+  unsigned char rpn[KINEMATIC_RPN_SIZE];
+  double args[TRANSFORM_ARGS], sargs[TRANSFORM_ARGS];
+  double result, expected;
+  long status, sstatus;
+  short err;
+  unsigned i, set, native = 0, compared = 0, mismatched = 0, statusMismatched = 0;
+  int k;
+
+  fuzzSeed = 20240917;
+  for (i = 0; i < FUZZ_EXPRESSIONS; i++)
+     {
+     strcpy(expr, "");
+     fuzzExpression(expr, sizeof(expr), FUZZ_DEPTH);
+     if (!calc.compile(expr) || sCalcPostfix(expr, rpn, &err))
+        {
+        testDiag("Corpus expression %s not compiled", expr);
+        mismatched++;
+        continue;
+        }
+     if (!calc.native())
+        continue;
+     native++;
+     for (set = 0; set < FUZZ_ARG_SETS; set++)
+        {
+        //Arguments of both signs, and magnitudes either side of 1
+        for (k = 0; k < TRANSFORM_ARGS; k++)
+           args[k] = sargs[k] = ((double)fuzzRandom(20001) - 10000.0) / ((set & 1) ? 10000.0 : 100.0);
+        status = calc.evaluate(args, &result);
+        sstatus = sCalcPerform(sargs, TRANSFORM_ARGS, NULL, 0, &expected, NULL, 0, rpn, 6);
+        if ((status != 0) != (sstatus != 0))
+           {
+           if (statusMismatched++ < 5)
+              testDiag("%s status %ld, sCalcPerform %ld", expr, status, sstatus);
+           continue;
+           }
+        if (status)
+           continue;
+        compared++;
+        if (!ulpClose(result, expected))
+           {
+           if (mismatched++ < 5)
+              testDiag("%s = %.17g, sCalcPerform %.17g", expr, result, expected);
+           }
+        }
+     }
+
+  testOk(native >= FUZZ_EXPRESSIONS * 9 / 10, "%u of %u corpus expressions compiled natively", native, FUZZ_EXPRESSIONS);
+  testOk(statusMismatched == 0, "Evaluation fails where sCalcPerform fails");
+  testOk(mismatched == 0 && compared > 0, "%u native results within 1 ulp of sCalcPerform", compared);
+}
+
+MAIN(galilTransformTest)
+{
+  testPlan(37);
+  testNative();
+  testProgram();
+  testFallback();
+  testBatch();
+  testClear();
+  testFuzz();
+  return testDone();
+}
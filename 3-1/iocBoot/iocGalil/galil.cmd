@@ -64,6 +64,35 @@ GalilCreateAxis("Galil","H",1,"",1)
 #Create all CS axes (ie. I-P axis)
 GalilCreateCSAxes("Galil")
 
+# GalilCreateRemoteAxis command parameters are:
+#
+# 1. char *portName Asyn port for controller using the axis
+# 2. char *axis unused axis A-H on portName
+# 3. char *remotePortName Asyn port for controller the axis is on
+# 4. char *remoteAxis axis A-H created on remotePortName
+#
+# CS axes on portName may then use the axis in kinematic transforms
+# Moves are started on both controllers together in sync start only mode
+# Bindings must not form a cycle, remotePortName must not use axes on portName directly or through other ports
+#
+# Example, CS axes on "Galil" use axis A on "Galil2" as axis E
+#GalilCreateRemoteAxis("Galil", "E", "Galil2", "A")
+
+# GalilCreateProfile command parameters are:
+#
+# 1. char *portName Asyn port for controller
+# 2. Int maxPoints in trajectory
+#    Storage for built trajectories is allocated here for maxPoints
+# 3. Int inputTrigger
+#    0 = armed profiles begin on Execute only
+#    1 = generated code includes #PTRIG, so an armed linear profile can begin on a digital input
+#        #PTRIG runs on the highest numbered controller thread, which must not be used by an axis
+#        One profile at a time can be armed with an input trigger
+#    Call before GalilStartController, as the input trigger is part of the generated code
+
+# Create trajectory profiles
+GalilCreateProfile("Galil", 2000, 0)
+
 # GalilStartController command parameters are:
 #
 # 1. char *portName Asyn port for controller
@@ -76,6 +105,10 @@ GalilCreateCSAxes("Galil")
 # 4. int   display code. Set bit 1 to display generated code and or the code file specified.  Set bit 2 to display uploaded code
 # 5. int   Thread mask.  Check these threads are running after controller code start.  Bit 0 = thread 0 and so on
 #             if thread mask = 0 and GalilCreateAxis appears > 0 then threads 0 to number of GalilCreateAxis is checked (good when using the generated code)
+# 6. int   Fingerprint check.
+#             0 = always upload and compare full program, and upload again after download
+#             1 = compare program fingerprint (controller variable codehash set by thread 0, and fingerprint line in program)
+#                 Full upload and compare only if fingerprint differs
 
 # Start the controller
 GalilStartController("Galil", "", 1, 0, 0)
@@ -87,11 +120,14 @@ GalilStartController("Galil", "", 1, 0, 0)
 # Start the controller
 GalilStartController("RIO", "rio.gmc", 1, 0, 0)
 
-# GalilCreateProfile command parameters are:
+# Controllers can instead be started concurrently, to reduce IOC boot time with many controllers
+# GalilQueueStartController command parameters are the same as GalilStartController
+# GalilStartQueuedControllers command parameters are:
 #
-# 1. char *portName Asyn port for controller
-# 2. Int maxPoints in trajectory
-
-# Create trajectory profiles
-GalilCreateProfile("Galil", 2000)
+# 1. int   Maximum number of controllers started at the same time
+#
+# Example
+#GalilQueueStartController("Galil", "", 1, 0, 0)
+#GalilQueueStartController("RIO", "rio.gmc", 1, 0, 0)
+#GalilStartQueuedControllers(4)
 